@@ -137,7 +137,6 @@ static void NedapGen(uint8_t subType, uint16_t customerCode, uint32_t id, bool i
     buffer[4] = (translateTable[idxC4] << 4) | translateTable[idxC5];
 
     // checksum
-    init_table(CRC_XMODEM);
     uint16_t checksum = crc16_xmodem(buffer, 5);
 
     buffer[6] = ((checksum & 0x000F) << 4) | (buffer[4] & 0x0F);
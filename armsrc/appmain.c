@@ -2008,6 +2008,11 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareReadSector(packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
             break;
         }
+        case CMD_HF_MIFARE_DUMP: {
+            mf_dump_t *payload = (mf_dump_t *)packet->data.asBytes;
+            MifareDump(payload);
+            break;
+        }
         case CMD_HF_MIFARE_WRITEBL: {
             uint8_t block_no = packet->oldarg[0];
             uint8_t key_type = packet->oldarg[1];
@@ -3266,6 +3271,11 @@ static void PacketReceived(PacketCommandNG *packet) {
             reply_ng(CMD_PING, PM3_SUCCESS, packet->data.asBytes, packet->length);
             break;
         }
+        case CMD_BENCH: {
+            // payload is only read off the link, used by `hw bench` to time uploads
+            reply_ng(CMD_BENCH, PM3_SUCCESS, NULL, 0);
+            break;
+        }
 #ifdef WITH_LCD
         case CMD_LCD_RESET: {
             LCDReset();
@@ -573,8 +573,6 @@ bool iso18092_setup_ex(uint8_t fpga_minor_mode, uint32_t preserve_low_bytes) {
     // iso18092_set_timeout(2120); // 106 * 20ms  maximum start-up time of card
     iso18092_set_timeout(1060); // 106 * 10ms  maximum start-up time of card
 
-    init_table(CRC_FELICA);
-
     // connect Demodulated Signal to ADC:
     SetAdcMuxFor(GPIO_MUXSEL_HIPKD);
 
@@ -48,6 +48,8 @@ static uint8_t colpos = 0;
 
 // the block number for the ISO14443-4 PCB
 static uint8_t iso14_pcb_blocknum = 0;
+// the client has more APDUs queued behind this one, USB data is no abort request
+static bool iso14_apdu_queued = false;
 
 // optional ATQA/SAK overrides for SimulateIso14443aInit (set via iso14a_set_atqa_sak_override)
 static uint16_t s_atqa_override = 0;
@@ -3685,7 +3687,7 @@ int iso14_apdu(uint8_t *cmd, uint16_t cmd_len, bool send_chaining, void *data, u
     // S-Block WTX
     while (len && ((data_bytes[0] & 0xF2) == 0xF2)) {
 
-        if (BUTTON_PRESS() || data_available()) {
+        if (BUTTON_PRESS() || (iso14_apdu_queued == false && data_available())) {
             BigBuf_free();
             return -3;
         }
@@ -3830,6 +3832,7 @@ void ReaderIso14443a(PacketCommandNG *c) {
         FpgaDisableTracing();
 
         uint8_t res = 0;
+        iso14_apdu_queued = ((param & ISO14A_APDU_QUEUED) == ISO14A_APDU_QUEUED);
         arg0 = iso14_apdu(
                    cmd,
                    len,
@@ -3838,6 +3841,7 @@ void ReaderIso14443a(PacketCommandNG *c) {
                    sizeof(buf),
                    &res
                );
+        iso14_apdu_queued = false;
 
         reply_mix(CMD_ACK, arg0, res, 0, buf, sizeof(buf));
     }
@@ -256,6 +256,145 @@ void MifareReadSector(uint8_t sector_no, uint8_t key_type, uint8_t *key) {
     reply_old(CMD_ACK, retval == PM3_SUCCESS, 0, 0, outbuf, 16 * num_blocks);
 }
 
+// (re)authenticate to a sector while dumping. Nested when a crypto1 session is running,
+// otherwise the card has dropped out after a failed exchange and gets selected again.
+static bool mifare_dump_auth(struct Crypto1State *pcs, const uint8_t *uid, uint8_t cascade_levels, uint32_t cuid, bool *authed,
+                             uint8_t block_no, uint8_t key_type, const uint8_t *key) {
+    uint64_t ui64Key = bytes_to_num(key, 6);
+
+    if (*authed) {
+        if (mifare_classic_auth(pcs, cuid, block_no, key_type, ui64Key, AUTH_NESTED) == 0) {
+            return true;
+        }
+        *authed = false;
+    }
+
+    if (iso14443a_fast_select_card(uid, cascade_levels) == 0) {
+        return false;
+    }
+
+    if (mifare_classic_auth(pcs, cuid, block_no, key_type, ui64Key, AUTH_FIRST)) {
+        return false;
+    }
+
+    *authed = true;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Read a whole MIFARE Classic card with a key table.
+// The card stays selected, sectors are authenticated nested. Blocks which key A
+// can't read are retried with key B. Every sector is sent back as soon as it is read,
+// an empty reply with the overall status ends the dump.
+//-----------------------------------------------------------------------------
+void MifareDump(const mf_dump_t *payload) {
+    uint8_t sectorcnt = MIN(payload->sectorcnt, MIFARE_4K_MAXSECTOR);
+
+    LED_A_ON();
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    clear_trace();
+    set_tracing(true);
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs = &mpcs;
+
+    uint8_t uid[10] = {0x00};
+    uint32_t cuid = 0;
+    uint8_t cascade_levels = 0;
+    bool authed = false;
+    int retval = PM3_SUCCESS;
+
+    // frame waiting time (FWT) in 1/fc
+    uint32_t timeout = iso14a_get_timeout();
+    uint32_t fwt = 256 * 16 * (1 << 7);
+    iso14a_set_timeout(fwt / (8 * 16));
+
+    iso14a_card_select_t card_info;
+    if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't select card");
+        retval = PM3_EFAILED;
+        goto out;
+    }
+
+    cascade_levels = (card_info.uidlen == 10) ? 3 : (card_info.uidlen == 7) ? 2 : 1;
+
+    mf_dump_sector_t sector;
+
+    for (uint8_t s = 0; s < sectorcnt; s++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            retval = PM3_EOPABORTED;
+            break;
+        }
+
+        uint8_t first = FirstBlockOfSector(s);
+        const uint8_t *keys[2] = { payload->keya[s], payload->keyb[s] };
+        bool key_failed[2] = { false, false };
+        int8_t current = -1;
+
+        memset(&sector, 0, sizeof(sector));
+        sector.sector = s;
+        sector.blockcnt = NumBlocksPerSector(s);
+
+        for (uint8_t b = 0; b < sector.blockcnt; b++) {
+
+            // stay with the key of the running session, the other one only when that fails
+            uint8_t order[2] = { MF_KEY_A, MF_KEY_B };
+            if (current == MF_KEY_B) {
+                order[0] = MF_KEY_B;
+                order[1] = MF_KEY_A;
+            }
+
+            for (uint8_t i = 0; i < 2; i++) {
+                uint8_t kt = order[i];
+                if (key_failed[kt]) {
+                    continue;
+                }
+
+                if (current != kt) {
+                    if (mifare_dump_auth(pcs, uid, cascade_levels, cuid, &authed, first, kt, keys[kt]) == false) {
+                        if (g_dbglevel >= DBG_INFO) Dbprintf("Sector %2d - key %c auth error", s, (kt == MF_KEY_A) ? 'A' : 'B');
+                        key_failed[kt] = true;
+                        current = -1;
+                        continue;
+                    }
+                    current = kt;
+                }
+
+                if (mifare_classic_readblock(pcs, first + b, sector.data + (b * MIFARE_BLOCK_SIZE)) == 0) {
+                    sector.readmask |= (1 << b);
+                    break;
+                }
+
+                // access conditions or a bad frame, the card is idle now
+                authed = false;
+                current = -1;
+            }
+        }
+
+        uint16_t all = (1 << sector.blockcnt) - 1;
+        int status = (sector.readmask == all) ? PM3_SUCCESS : (sector.readmask) ? PM3_EPARTIAL : PM3_EFAILED;
+        if (status != PM3_SUCCESS) {
+            retval = PM3_EPARTIAL;
+        }
+
+        reply_ng(CMD_HF_MIFARE_DUMP, status, (uint8_t *)&sector, 4 + sector.blockcnt * MIFARE_BLOCK_SIZE);
+    }
+
+out:
+    if (authed) {
+        mifare_classic_halt(pcs);
+    }
+
+    iso14a_set_timeout(timeout);
+    crypto1_deinit(pcs);
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    set_tracing(false);
+    reply_ng(CMD_HF_MIFARE_DUMP, retval, NULL, 0);
+}
+
 static int MifareUFastRead0(void) {
     uint8_t resp[18] = { 0 };    // 4 pages + crc
     uint8_t resp_par[1] = {0};
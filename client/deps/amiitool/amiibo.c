@@ -6,6 +6,8 @@
  */
 
 #include "amiibo.h"
+#include <stdlib.h>
+#include <pthread.h>
 #include "md.h"
 #include "aes.h"
 #include "commonutil.h"
@@ -29,6 +31,87 @@ static void nfc3d_amiibo_keygen(const nfc3d_keygen_masterkeys_t *masterKeys, con
     nfc3d_keygen(masterKeys, seed, derivedKeys);
 }
 
+// direct mapped, a miss replaces the slot
+#define NFC3D_AMIIBO_KEYCACHE_SLOTS 4096
+
+typedef struct {
+    bool valid;
+    const nfc3d_keygen_masterkeys_t *master;
+    uint8_t seed[NFC3D_KEYGEN_SEED_SIZE];
+    nfc3d_keygen_derivedkeys_t keys;
+} nfc3d_amiibo_keycache_slot_t;
+
+struct nfc3d_amiibo_keycache_s {
+    pthread_mutex_t lock;
+    uint32_t hits;
+    uint32_t misses;
+    nfc3d_amiibo_keycache_slot_t slots[NFC3D_AMIIBO_KEYCACHE_SLOTS];
+};
+
+nfc3d_amiibo_keycache_t *nfc3d_amiibo_keycache_new(void) {
+    nfc3d_amiibo_keycache_t *cache = calloc(1, sizeof(nfc3d_amiibo_keycache_t));
+    if (cache != NULL) {
+        pthread_mutex_init(&cache->lock, NULL);
+    }
+    return cache;
+}
+
+void nfc3d_amiibo_keycache_free(nfc3d_amiibo_keycache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void nfc3d_amiibo_keycache_stats(nfc3d_amiibo_keycache_t *cache, uint32_t *hits, uint32_t *misses) {
+    pthread_mutex_lock(&cache->lock);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static void nfc3d_amiibo_keygen_cached(const nfc3d_keygen_masterkeys_t *masterKeys, nfc3d_amiibo_keycache_t *cache, const uint8_t *dump, nfc3d_keygen_derivedkeys_t *derivedKeys) {
+    if (cache == NULL) {
+        nfc3d_amiibo_keygen(masterKeys, dump, derivedKeys);
+        return;
+    }
+
+    uint8_t seed[NFC3D_KEYGEN_SEED_SIZE] = {0};
+    nfc3d_amiibo_calc_seed(dump, seed);
+
+    // keygen only takes the first 16 - magicBytesSize bytes of the first half,
+    // so the tag keys (16 magic bytes) only depend on the UID and the salt
+    size_t leading = 16 - masterKeys->magicBytesSize;
+    memset(seed + leading, 0x00, 16 - leading);
+
+    uint32_t h = 2166136261U;
+    for (size_t i = 0; i < sizeof(seed); i++) {
+        h = (h ^ seed[i]) * 16777619U;
+    }
+    h ^= (uint32_t)(uintptr_t)masterKeys;
+    nfc3d_amiibo_keycache_slot_t *slot = &cache->slots[h % NFC3D_AMIIBO_KEYCACHE_SLOTS];
+
+    pthread_mutex_lock(&cache->lock);
+    if (slot->valid && (slot->master == masterKeys) && (memcmp(slot->seed, seed, sizeof(seed)) == 0)) {
+        memcpy((uint8_t *)derivedKeys, (const uint8_t *)&slot->keys, sizeof(nfc3d_keygen_derivedkeys_t));
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    nfc3d_keygen(masterKeys, seed, derivedKeys);
+
+    pthread_mutex_lock(&cache->lock);
+    slot->valid = true;
+    slot->master = masterKeys;
+    memcpy(slot->seed, seed, sizeof(seed));
+    memcpy((uint8_t *)&slot->keys, (const uint8_t *)derivedKeys, sizeof(nfc3d_keygen_derivedkeys_t));
+    pthread_mutex_unlock(&cache->lock);
+}
+
 static void nfc3d_amiibo_cipher(const nfc3d_keygen_derivedkeys_t *keys, const uint8_t *in, uint8_t *out) {
     mbedtls_aes_context aes;
     size_t nc_off = 0;
@@ -69,6 +152,10 @@ static void nfc3d_amiibo_internal_to_tag(const uint8_t *intl, uint8_t *tag) {
 }
 
 bool nfc3d_amiibo_unpack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *tag, uint8_t *plain) {
+    return nfc3d_amiibo_unpack_ex(amiiboKeys, NULL, tag, plain);
+}
+
+bool nfc3d_amiibo_unpack_ex(const nfc3d_amiibo_keys_t *amiiboKeys, nfc3d_amiibo_keycache_t *cache, const uint8_t *tag, uint8_t *plain) {
 
     uint8_t internal[NFC3D_AMIIBO_SIZE] = {0};
 
@@ -79,8 +166,8 @@ bool nfc3d_amiibo_unpack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *t
     nfc3d_amiibo_tag_to_internal(tag, internal);
 
     // Generate keys
-    nfc3d_amiibo_keygen(&amiiboKeys->data, internal, &dataKeys);
-    nfc3d_amiibo_keygen(&amiiboKeys->tag, internal, &tagKeys);
+    nfc3d_amiibo_keygen_cached(&amiiboKeys->data, cache, internal, &dataKeys);
+    nfc3d_amiibo_keygen_cached(&amiiboKeys->tag, cache, internal, &tagKeys);
 
     // Decrypt
     nfc3d_amiibo_cipher(&dataKeys, internal, plain);
@@ -108,13 +195,17 @@ bool nfc3d_amiibo_unpack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *t
 }
 
 void nfc3d_amiibo_pack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *plain, uint8_t *tag) {
+    nfc3d_amiibo_pack_ex(amiiboKeys, NULL, plain, tag);
+}
+
+void nfc3d_amiibo_pack_ex(const nfc3d_amiibo_keys_t *amiiboKeys, nfc3d_amiibo_keycache_t *cache, const uint8_t *plain, uint8_t *tag) {
     uint8_t cipher[NFC3D_AMIIBO_SIZE] = {0};
     nfc3d_keygen_derivedkeys_t tagKeys = {0};
     nfc3d_keygen_derivedkeys_t dataKeys = {0};
 
     // Generate keys
-    nfc3d_amiibo_keygen(&amiiboKeys->tag, plain, &tagKeys);
-    nfc3d_amiibo_keygen(&amiiboKeys->data, plain, &dataKeys);
+    nfc3d_amiibo_keygen_cached(&amiiboKeys->tag, cache, plain, &tagKeys);
+    nfc3d_amiibo_keygen_cached(&amiiboKeys->data, cache, plain, &dataKeys);
 
     // Generate tag HMAC
     mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256)
@@ -149,10 +240,14 @@ void nfc3d_amiibo_pack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *pla
 }
 
 bool nfc3d_amiibo_load_keys(nfc3d_amiibo_keys_t *amiiboKeys) {
+    return nfc3d_amiibo_load_keys_ex(amiiboKeys, AMIBOO_KEY_FN);
+}
+
+bool nfc3d_amiibo_load_keys_ex(nfc3d_amiibo_keys_t *amiiboKeys, const char *filename) {
 
     uint8_t *dump = NULL;
     size_t bytes_read = 0;
-    if (loadFile_safe(AMIBOO_KEY_FN, "", (void **)&dump, &bytes_read) != PM3_SUCCESS) {
+    if (loadFile_safe(filename, "", (void **)&dump, &bytes_read) != PM3_SUCCESS) {
         return false;
     }
 
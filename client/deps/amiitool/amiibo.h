@@ -23,9 +23,21 @@ typedef struct {
 } nfc3d_amiibo_keys_t;
 #pragma pack()
 
+// Cache of derived keys, shared by threads. The tag keys only depend on the UID and
+// the keygen salt, the data keys also on the write counter.
+typedef struct nfc3d_amiibo_keycache_s nfc3d_amiibo_keycache_t;
+
+nfc3d_amiibo_keycache_t *nfc3d_amiibo_keycache_new(void);
+void nfc3d_amiibo_keycache_free(nfc3d_amiibo_keycache_t *cache);
+void nfc3d_amiibo_keycache_stats(nfc3d_amiibo_keycache_t *cache, uint32_t *hits, uint32_t *misses);
+
 bool nfc3d_amiibo_unpack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *tag, uint8_t *plain);
 void nfc3d_amiibo_pack(const nfc3d_amiibo_keys_t *amiiboKeys, const uint8_t *plain, uint8_t *tag);
+// same, cache may be NULL
+bool nfc3d_amiibo_unpack_ex(const nfc3d_amiibo_keys_t *amiiboKeys, nfc3d_amiibo_keycache_t *cache, const uint8_t *tag, uint8_t *plain);
+void nfc3d_amiibo_pack_ex(const nfc3d_amiibo_keys_t *amiiboKeys, nfc3d_amiibo_keycache_t *cache, const uint8_t *plain, uint8_t *tag);
 bool nfc3d_amiibo_load_keys(nfc3d_amiibo_keys_t *amiiboKeys);
+bool nfc3d_amiibo_load_keys_ex(nfc3d_amiibo_keys_t *amiiboKeys, const char *filename);
 void nfc3d_amiibo_copy_app_data(const uint8_t *src, uint8_t *dst);
 
 #endif
@@ -142,6 +142,8 @@ void id48lib_generator(
 /// this init() function, can repeatedly call
 /// the next() function until it returns false
 /// to obtain all potential keys.
+/// The search state is a single library-wide context,
+/// see id48lib_key_recovery_ctx_init() for a reentrant version.
 /// </summary>
 /// <param name="input_partial_key">
 /// Top 48 bits of the key, such as those discovered
@@ -200,6 +202,75 @@ bool id48lib_key_recovery_next(
     ID48LIB_KEY *potential_key_output
 );
 
+/// <summary>
+/// Opaque key recovery context.
+/// Each context holds its own search state, so different
+/// contexts may be used concurrently from different threads.
+/// </summary>
+typedef struct _ID48LIB_RECOVERY_CTX ID48LIB_RECOVERY_CTX;
+
+/// <summary>
+/// Called once for each potential key found by
+/// id48lib_key_recovery_range().
+/// </summary>
+/// <returns>
+/// true to continue the search, false to stop it.
+/// </returns>
+typedef bool (*ID48LIB_KEY_RECOVERY_CALLBACK)(const ID48LIB_KEY *potential_key, void *user_data);
+
+/// <summary>
+/// Allocates a key recovery context.
+/// Returns NULL when out of memory.
+/// Release with id48lib_key_recovery_ctx_free().
+/// </summary>
+ID48LIB_RECOVERY_CTX *id48lib_key_recovery_ctx_new(void);
+void id48lib_key_recovery_ctx_free(
+    ID48LIB_RECOVERY_CTX *ctx
+);
+/// <summary>
+/// Same as id48lib_key_recovery_init(), but acts on the
+/// given context and only searches keys with K₄₇..K₄₀
+/// in the inclusive range [k47_to_k40_first, k47_to_k40_last].
+/// Splitting [0x00, 0xFF] into several ranges allows the
+/// search to be spread across threads, one context each.
+/// </summary>
+void id48lib_key_recovery_ctx_init(
+    ID48LIB_RECOVERY_CTX *ctx,
+    const ID48LIB_KEY *input_partial_key,
+    const ID48LIB_NONCE *input_nonce,
+    const ID48LIB_FRN *input_frn,
+    const ID48LIB_GRN *input_grn,
+    uint8_t k47_to_k40_first,
+    uint8_t k47_to_k40_last
+);
+/// <summary>
+/// Same as id48lib_key_recovery_next(), but acts on the given context.
+/// </summary>
+bool id48lib_key_recovery_ctx_next(
+    ID48LIB_RECOVERY_CTX *ctx,
+    ID48LIB_KEY *potential_key_output
+);
+/// <summary>
+/// Searches all keys with K₄₇..K₄₀ in the inclusive range
+/// [k47_to_k40_first, k47_to_k40_last], streaming each
+/// potential key to the callback as soon as it is found.
+/// The search state is kept on the stack, so this function
+/// is reentrant and needs no context allocation.
+/// </summary>
+/// <returns>
+/// The number of potential keys passed to the callback.
+/// </returns>
+uint32_t id48lib_key_recovery_range(
+    const ID48LIB_KEY *input_partial_key,
+    const ID48LIB_NONCE *input_nonce,
+    const ID48LIB_FRN *input_frn,
+    const ID48LIB_GRN *input_grn,
+    uint8_t k47_to_k40_first,
+    uint8_t k47_to_k40_last,
+    ID48LIB_KEY_RECOVERY_CALLBACK callback,
+    void *user_data
+);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -24,6 +24,7 @@
  */
 
 #include "id48_internals.h"
+#include <stdlib.h>
 
 #ifndef nullptr
 #define nullptr ((void*)0)
@@ -105,6 +106,13 @@ typedef struct _RECOVERY_STATE {
     /// </summary>
     ID48LIB_NONCE known_nonce;
     /// <summary>
+    /// Inclusive range of K₄₇..K₄₀ values searched by this state.
+    /// The full keyspace is [0x00, 0xFF].
+    /// Constant after initialization.
+    /// </summary>
+    uint8_t k47_to_k40_first;
+    uint8_t k47_to_k40_last;
+    /// <summary>
     /// boolean to identify first run after initialization (an edge case)
     /// </summary>
     bool is_fresh_initialization;
@@ -221,34 +229,36 @@ static bool validate_output_from_additional_fifteen_zero_bits(RECOVERY_STATE *s)
 }
 
 
-// intentionally declare this global state only here, as a way
-// of forcing the above functions to act on a pointer.  Ensuring
-// the above routines don't inadvertently use the global state
-// makes it easier to enable a multi-threaded version.
-RECOVERY_STATE g_S = { 0 };
-
 static void init(
+    RECOVERY_STATE       *s,
     const ID48LIB_KEY    *input_partial_key,
     const ID48LIB_NONCE *input_nonce,
     const ID48LIB_FRN    *input_frn,
-    const ID48LIB_GRN    *input_grn
+    const ID48LIB_GRN    *input_grn,
+    uint8_t               k47_to_k40_first,
+    uint8_t               k47_to_k40_last
 ) {
-    memset(&g_S, 0, sizeof(RECOVERY_STATE));
-    memset(&(g_S.states[0]), 0xAA, sizeof(ID48LIBX_STATE_REGISTERS) * MAXIMUM_STATE_HISTORY);
-    g_S.known_k95_to_k48.k[0] = input_partial_key->k[0];
-    g_S.known_k95_to_k48.k[1] = input_partial_key->k[1];
-    g_S.known_k95_to_k48.k[2] = input_partial_key->k[2];
-    g_S.known_k95_to_k48.k[3] = input_partial_key->k[3];
-    g_S.known_k95_to_k48.k[4] = input_partial_key->k[4];
-    g_S.known_k95_to_k48.k[5] = input_partial_key->k[5];
-    g_S.known_nonce = *input_nonce;
-    g_S.expected_output_bits = create_expected_output_bits(input_frn, input_grn);
-    g_S.more_keys_to_test = true;
-    g_S.is_fresh_initialization = true;
+    ASSERT(s != nullptr);
+    memset(s, 0, sizeof(RECOVERY_STATE));
+    memset(&(s->states[0]), 0xAA, sizeof(ID48LIBX_STATE_REGISTERS) * MAXIMUM_STATE_HISTORY);
+    s->known_k95_to_k48.k[0] = input_partial_key->k[0];
+    s->known_k95_to_k48.k[1] = input_partial_key->k[1];
+    s->known_k95_to_k48.k[2] = input_partial_key->k[2];
+    s->known_k95_to_k48.k[3] = input_partial_key->k[3];
+    s->known_k95_to_k48.k[4] = input_partial_key->k[4];
+    s->known_k95_to_k48.k[5] = input_partial_key->k[5];
+    s->known_nonce = *input_nonce;
+    s->expected_output_bits = create_expected_output_bits(input_frn, input_grn);
+    s->k47_to_k40_first = k47_to_k40_first;
+    s->k47_to_k40_last = k47_to_k40_last;
+    s->more_keys_to_test = (k47_to_k40_first <= k47_to_k40_last);
+    s->is_fresh_initialization = true;
 }
 static bool get_next_potential_key(
+    RECOVERY_STATE *s,
     ID48LIB_KEY *potential_key_output
 ) {
+    ASSERT(s != nullptr);
     memset(potential_key_output, 0, sizeof(ID48LIB_KEY));
 
     // Three possible states when this function enters:
@@ -265,7 +275,7 @@ static bool get_next_potential_key(
     //        bit that was zero.
 
     // Early exit when no more keys to test
-    if (!g_S.more_keys_to_test) {
+    if (!s->more_keys_to_test) {
         return false;
     }
 
@@ -273,19 +283,19 @@ static bool get_next_potential_key(
     int8_t current_key_bit_shift;
 
     // Setup the next key to be tested.
-    if (g_S.is_fresh_initialization) {
-        // first-time init is easy: key is zero, and zero bits set
-        g_S.is_fresh_initialization = false;
-        k_low.Raw = 0ull;
+    if (s->is_fresh_initialization) {
+        // first-time init is easy: key starts at the range, and zero bits set
+        s->is_fresh_initialization = false;
+        k_low.Raw = ((uint64_t)s->k47_to_k40_first) << 40;
         current_key_bit_shift = 47;
     } else {
         // by definition, a returned potential key had all the bits defined
         current_key_bit_shift = 0;
-        k_low = g_S.last_returned_potential_key;
+        k_low = s->last_returned_potential_key;
 
         // edge case: returned potential key 0xFFFFFFFFFFFFull, so no more keys to be tested!
         if (k_low.Raw == 0xFFFFFFFFFFFFull) {
-            g_S.more_keys_to_test = false;
+            s->more_keys_to_test = false;
             return false;
         }
 
@@ -317,7 +327,12 @@ static bool get_next_potential_key(
         ASSERT(current_key_bit_shift < 48);
         // Anytime bit shift is 40+, changes would affect s00 ...
         if (current_key_bit_shift > 39) {
-            restart_and_calculate_s00(&g_S, &k_low);
+            // EXIT CONDITION: K₄₇..K₄₀ moved past the end of the range
+            if ((k_low.Raw >> 40) > s->k47_to_k40_last) {
+                s->more_keys_to_test = false;
+                return false;
+            }
+            restart_and_calculate_s00(s, &k_low);
             current_key_bit_shift = 39; // k47..k40 used to get to s00
         }
 
@@ -327,8 +342,8 @@ static bool get_next_potential_key(
         while (current_key_bit_shift > 32) { // k39..k33 used to move from s00-->s07
             uint8_t src_idx = 39 - current_key_bit_shift;
             bool input_bit = !!(((uint8_t)(k_low.Raw >> current_key_bit_shift)) & 0x1u);
-            ID48LIBX_SUCCESSOR_RESULT r = successor_fn(&(g_S.states[src_idx]), input_bit);
-            g_S.states[src_idx + 1] = r.state;
+            ID48LIBX_SUCCESSOR_RESULT r = successor_fn(&(s->states[src_idx]), input_bit);
+            s->states[src_idx + 1] = r.state;
             --current_key_bit_shift;
         }
 
@@ -339,11 +354,11 @@ static bool get_next_potential_key(
         // Check if the current state + current key bit (as stored) gives expected result.
         const uint8_t src_idx = 39 - current_key_bit_shift;
         bool input_bit = !!(((uint8_t)(k_low.Raw >> current_key_bit_shift)) & 0x1u);
-        ID48LIBX_SUCCESSOR_RESULT r = successor_fn(&(g_S.states[src_idx]), input_bit);
+        ID48LIBX_SUCCESSOR_RESULT r = successor_fn(&(s->states[src_idx]), input_bit);
         // can unconditionally overwrite next state...
-        g_S.states[src_idx + 1] = r.state;
+        s->states[src_idx + 1] = r.state;
 
-        bool expected_result = get_expected_output_bit(&g_S, src_idx);
+        bool expected_result = get_expected_output_bit(s, src_idx);
         bool matched = expected_result == (!!r.output);
         // when matched the last bit, actually check the next 15x inputs (all zero) as well
         if (matched && current_key_bit_shift == 0) {
@@ -351,18 +366,18 @@ static bool get_next_potential_key(
             // but, must also test 15x additional zero bit inputs before
             // reporting that this may be a potential key
             ASSERT(src_idx == 39);
-            matched = validate_output_from_additional_fifteen_zero_bits(&g_S);
+            matched = validate_output_from_additional_fifteen_zero_bits(s);
         }
 
         // Exit point ... found a potential key!
         if (matched && current_key_bit_shift == 0) {
-            g_S.last_returned_potential_key = k_low;
-            potential_key_output->k[ 0] = g_S.known_k95_to_k48.k[0];
-            potential_key_output->k[ 1] = g_S.known_k95_to_k48.k[1];
-            potential_key_output->k[ 2] = g_S.known_k95_to_k48.k[2];
-            potential_key_output->k[ 3] = g_S.known_k95_to_k48.k[3];
-            potential_key_output->k[ 4] = g_S.known_k95_to_k48.k[4];
-            potential_key_output->k[ 5] = g_S.known_k95_to_k48.k[5];
+            s->last_returned_potential_key = k_low;
+            potential_key_output->k[ 0] = s->known_k95_to_k48.k[0];
+            potential_key_output->k[ 1] = s->known_k95_to_k48.k[1];
+            potential_key_output->k[ 2] = s->known_k95_to_k48.k[2];
+            potential_key_output->k[ 3] = s->known_k95_to_k48.k[3];
+            potential_key_output->k[ 4] = s->known_k95_to_k48.k[4];
+            potential_key_output->k[ 5] = s->known_k95_to_k48.k[5];
             potential_key_output->k[ 6] = (uint8_t)(k_low.Raw >> (8 * 5));
             potential_key_output->k[ 7] = (uint8_t)(k_low.Raw >> (8 * 4));
             potential_key_output->k[ 8] = (uint8_t)(k_low.Raw >> (8 * 3));
@@ -379,7 +394,7 @@ static bool get_next_potential_key(
         // Backtrack to find next one to be tested.
         else {
             // not required ... but makes debugging easier
-            memset(&g_S.states[src_idx + 1], 0xAA, sizeof(ID48LIBX_STATE_REGISTERS));
+            memset(&s->states[src_idx + 1], 0xAA, sizeof(ID48LIBX_STATE_REGISTERS));
 
             // that bit of the key results in wrong output.
             // backtrack until the next zero bit, flip it to one, and
@@ -401,7 +416,7 @@ static bool get_next_potential_key(
             // EXIT CONDITION: k_low wraps to invalid value
             if (current_key_bit_shift >= 48) {
                 // no more results available ... return!
-                g_S.more_keys_to_test = false;
+                s->more_keys_to_test = false;
                 return 0u;
             }
 
@@ -422,16 +437,73 @@ static bool get_next_potential_key(
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+struct _ID48LIB_RECOVERY_CTX {
+    RECOVERY_STATE s;
+};
+
+// the original iterator API keeps its search in this single global context
+static ID48LIB_RECOVERY_CTX g_ctx = { 0 };
+
+ID48LIB_RECOVERY_CTX *id48lib_key_recovery_ctx_new(void) {
+    return (ID48LIB_RECOVERY_CTX *)calloc(1, sizeof(ID48LIB_RECOVERY_CTX));
+}
+void id48lib_key_recovery_ctx_free(
+    ID48LIB_RECOVERY_CTX *ctx
+) {
+    free(ctx);
+}
+void id48lib_key_recovery_ctx_init(
+    ID48LIB_RECOVERY_CTX *ctx,
+    const ID48LIB_KEY    *input_partial_key,
+    const ID48LIB_NONCE *input_nonce,
+    const ID48LIB_FRN    *input_frn,
+    const ID48LIB_GRN    *input_grn,
+    uint8_t               k47_to_k40_first,
+    uint8_t               k47_to_k40_last
+) {
+    init(&(ctx->s), input_partial_key, input_nonce, input_frn, input_grn, k47_to_k40_first, k47_to_k40_last);
+}
+bool id48lib_key_recovery_ctx_next(
+    ID48LIB_RECOVERY_CTX *ctx,
+    ID48LIB_KEY *potential_key_output
+) {
+    return get_next_potential_key(&(ctx->s), potential_key_output);
+}
+uint32_t id48lib_key_recovery_range(
+    const ID48LIB_KEY    *input_partial_key,
+    const ID48LIB_NONCE *input_nonce,
+    const ID48LIB_FRN    *input_frn,
+    const ID48LIB_GRN    *input_grn,
+    uint8_t               k47_to_k40_first,
+    uint8_t               k47_to_k40_last,
+    ID48LIB_KEY_RECOVERY_CALLBACK callback,
+    void *user_data
+) {
+    // state lives on the caller's stack, so concurrent calls never share anything
+    RECOVERY_STATE s;
+    init(&s, input_partial_key, input_nonce, input_frn, input_grn, k47_to_k40_first, k47_to_k40_last);
+
+    uint32_t count = 0;
+    ID48LIB_KEY potential_key;
+    while (get_next_potential_key(&s, &potential_key)) {
+        ++count;
+        if ((callback != nullptr) && !callback(&potential_key, user_data)) {
+            break;
+        }
+    }
+    return count;
+}
+
 void id48lib_key_recovery_init(
     const ID48LIB_KEY    *input_partial_key,
     const ID48LIB_NONCE *input_nonce,
     const ID48LIB_FRN    *input_frn,
     const ID48LIB_GRN    *input_grn
 ) {
-    init(input_partial_key, input_nonce, input_frn, input_grn);
+    id48lib_key_recovery_ctx_init(&g_ctx, input_partial_key, input_nonce, input_frn, input_grn, 0x00u, 0xFFu);
 }
 bool id48lib_key_recovery_next(
     ID48LIB_KEY *potential_key_output
 ) {
-    return get_next_potential_key(potential_key_output);
+    return id48lib_key_recovery_ctx_next(&g_ctx, potential_key_output);
 }
@@ -149,6 +149,39 @@ bool recovery_succeeds(const TEST_VECTOR_T *test_vector, bool zero_partial_key)
     return key_found;
 }
 
+typedef struct _RANGE_TEST_STATE {
+    const ID48LIB_KEY *expected_key;
+    uint32_t potential_keys_found;
+    bool key_found;
+} RANGE_TEST_STATE;
+
+static bool range_callback(const ID48LIB_KEY *potential_key, void *user_data) {
+    RANGE_TEST_STATE *state = (RANGE_TEST_STATE *)user_data;
+    state->potential_keys_found++;
+    if (bytes_equal(potential_key->k, state->expected_key->k, sizeof(state->expected_key->k))) {
+        state->key_found = true;
+    }
+    return true;
+}
+
+// splits K47..K40 into 16 ranges, and checks the result matches the single iterator API
+bool range_recovery_succeeds(const TEST_VECTOR_T *test_vector) {
+
+    RANGE_TEST_STATE state = { .expected_key = &test_vector->key };
+    for (uint16_t first = 0; first < 0x100; first += 0x10) {
+        id48lib_key_recovery_range(&test_vector->key, &test_vector->nonce, &test_vector->expected_frn, &test_vector->expected_grn,
+                                   (uint8_t)first, (uint8_t)(first + 0x0F), range_callback, &state);
+    }
+
+    uint32_t iterator_keys_found = 0;
+    ID48LIB_KEY potential_key = {0};
+    id48lib_key_recovery_init(&test_vector->key, &test_vector->nonce, &test_vector->expected_frn, &test_vector->expected_grn);
+    while (id48lib_key_recovery_next(&potential_key)) {
+        iterator_keys_found++;
+    }
+    return state.key_found && (state.potential_keys_found == iterator_keys_found);
+}
+
 int main(void) {
     bool any_failures = false;
 
@@ -163,6 +196,11 @@ int main(void) {
             printf("FAILURE: id48lib_recovery: test vector '%s' (partially-zero'd key)\n", test_vectors[i].description);
             any_failures = true;
         }
+        printf("Testing recovery for test vector '%s' (split K47..K40 ranges)\n", test_vectors[i].description);
+        if (!range_recovery_succeeds(&test_vectors[i])) {
+            printf("FAILURE: id48lib_recovery: test vector '%s' (split K47..K40 ranges)\n", test_vectors[i].description);
+            any_failures = true;
+        }
     }
     if (any_failures) {
         printf("id48lib_recovery: some tests failed\n");
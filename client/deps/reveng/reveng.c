@@ -49,6 +49,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "util.h"       // num_CPUs
 
 #define FILE void
 #include "reveng.h"
@@ -58,6 +62,7 @@ static void engini(int *resc, model_t **result, const poly_t divisor, int flags,
 static void calout(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, int args, const poly_t *argpolys);
 static void calini(int *resc, model_t **result, const poly_t divisor, int flags, const poly_t xorout, int args, const poly_t *argpolys);
 static void chkres(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, const poly_t xorout, int args, const poly_t *argpolys);
+static int fastsrch(int *resc, model_t **result, const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks);
 
 static const poly_t pzero = PZERO;
 
@@ -78,6 +83,15 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
             free(pworks);
             goto requit;
         }
+        /* Widths up to 32 are searched by fastsrch() on native
+         * words, split across threads.
+         */
+        if (fastsrch(&resc, &result, guess, qpoly, rflags, args, argpolys, pworks)) {
+            for (wptr = pworks; plen(*wptr); ++wptr)
+                pfree(wptr);
+            free(pworks);
+            goto requit;
+        }
         /* Initialise the guessed poly to the starting value. */
         gpoly = pclone(guess->spoly);
         /* Clear the least significant term, to be set in the
@@ -157,6 +171,254 @@ requit:
     return (result);
 }
 
+/* Proxmark3: word parallel, threaded polynomial search.
+ *
+ * For widths of 4 to 32 bits every difference is turned into nibbles once,
+ * each candidate poly gets a 16 entry table and the remainder is computed
+ * four bits per step in a native word instead of through pcrc().
+ * The odd polys are handed out to the worker threads in chunks, a poly which
+ * divides all differences is collected. Once all threads are done the
+ * candidates are sorted, checked again with pcrc() and passed to engini()
+ * and friends, so models are reported in the same order as by the loop in
+ * reveng() whatever the thread timing.
+ */
+#define FS_CHUNK    0x10000UL  /* polys per claim, divides R_SPMASK + 1 */
+#define FS_MAXTHR   64
+
+typedef struct {
+    uint8_t *nib;           /* message nibbles, most significant first */
+    unsigned long nnib;
+    uint32_t lead;          /* the length % 4 leading bits */
+} fsdiff_t;
+
+typedef struct {
+    /* read only while the workers run */
+    const model_t *guess;
+    int rflags;
+    int args;
+    const poly_t *argpolys;
+    const poly_t *pworks;
+    const fsdiff_t *diffs;
+    int ndiffs;
+    int width;
+    uint32_t mask;
+    uint32_t first;         /* lowest odd poly */
+    uint64_t count;         /* number of odd polys to try */
+    /* shared */
+    uint64_t next;          /* next poly index to claim, atomic */
+    unsigned long seq;
+    pthread_mutex_t lock;
+    uint32_t *cands;        /* polys dividing all differences */
+    size_t ncands;
+    size_t maxcands;
+    int *resc;
+    model_t **result;
+} fswork_t;
+
+static int
+fsdivides(const fsdiff_t *d, int width, uint32_t mask, const uint32_t *tab) {
+    /* Returns nonzero if the poly behind tab divides the difference */
+    const int top = width - 4;
+    uint32_t reg = d->lead;
+    for (unsigned long i = 0; i < d->nnib; ++i)
+        reg = (((reg << 4) | d->nib[i]) & mask) ^ tab[reg >> top];
+    return (reg == 0);
+}
+
+static void
+fsmkpoly(poly_t *poly, uint32_t value, int width) {
+    palloc(poly, (unsigned long) width);
+    *poly->bitmap = (bmp_t) value << (BMP_BIT - width);
+}
+
+static void
+fscandidate(fswork_t *w, uint32_t value) {
+    /* Confirms a poly with pcrc() and searches for the rest of the
+     * model like reveng() does.
+     */
+    const model_t *guess = w->guess;
+    const poly_t *wptr;
+    poly_t gpoly = PZERO, rem;
+
+    fsmkpoly(&gpoly, value, w->width);
+    for (wptr = w->pworks; plen(*wptr); ++wptr) {
+        rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+        if (ptst(rem)) {
+            pfree(&rem);
+            break;
+        }
+        pfree(&rem);
+    }
+    if (!plen(*wptr)) {
+        if (w->rflags & R_HAVEI && w->rflags & R_HAVEX)
+            chkres(w->resc, w->result, gpoly, guess->init, guess->flags, guess->xorout, w->args, w->argpolys);
+        else if (w->rflags & R_HAVEI)
+            calout(w->resc, w->result, gpoly, guess->init, guess->flags, w->args, w->argpolys);
+        else if (w->rflags & R_HAVEX)
+            calini(w->resc, w->result, gpoly, guess->flags, guess->xorout, w->args, w->argpolys);
+        else
+            engini(w->resc, w->result, gpoly, guess->flags, w->args, w->argpolys);
+    }
+    pfree(&gpoly);
+}
+
+static void *
+fsworker(void *arg) {
+    fswork_t *w = (fswork_t *) arg;
+    uint32_t base[4], tab[16];
+
+    for (;;) {
+        uint64_t start = __atomic_fetch_add(&w->next, FS_CHUNK, __ATOMIC_SEQ_CST);
+        if (start >= w->count)
+            break;
+        uint64_t end = start + FS_CHUNK;
+        if (end > w->count)
+            end = w->count;
+
+        if (!(start & R_SPMASK)) {
+            poly_t gpoly = PZERO;
+            fsmkpoly(&gpoly, w->first + (uint32_t)(start << 1), w->width);
+            pthread_mutex_lock(&w->lock);
+            uprog(gpoly, w->guess->flags, w->seq++);
+            pthread_mutex_unlock(&w->lock);
+            pfree(&gpoly);
+        }
+
+        for (uint64_t i = start; i < end; ++i) {
+            const uint32_t value = w->first + (uint32_t)(i << 1);
+
+            /* base[k] = x^(width + k) mod (x^width + value) */
+            base[0] = value;
+            for (int k = 1; k < 4; ++k) {
+                uint32_t t = base[k - 1];
+                int carry = (t >> (w->width - 1)) & 1;
+                base[k] = ((t << 1) & w->mask) ^ (carry ? value : 0);
+            }
+            tab[0] = 0;
+            for (int n = 1; n < 16; ++n)
+                tab[n] = tab[n & (n - 1)] ^ base[__builtin_ctz(n)];
+
+            int d;
+            for (d = 0; d < w->ndiffs; ++d) {
+                if (!fsdivides(&w->diffs[d], w->width, w->mask, tab))
+                    break;
+            }
+            if (d == w->ndiffs) {
+                pthread_mutex_lock(&w->lock);
+                if (w->ncands == w->maxcands) {
+                    w->maxcands = w->maxcands ? w->maxcands << 1 : 64;
+                    uint32_t *tmp = realloc(w->cands, w->maxcands * sizeof(uint32_t));
+                    if (!tmp)
+                        uerror("cannot allocate memory for candidate list");
+                    w->cands = tmp;
+                }
+                w->cands[w->ncands++] = value;
+                pthread_mutex_unlock(&w->lock);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int
+fscmp(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int
+fastsrch(int *resc, model_t **result, const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks) {
+    /* Searches all polys like the loop in reveng().
+     * Returns zero, having done nothing, if the width is unsuitable.
+     */
+    const unsigned long width = plen(guess->spoly);
+    const poly_t *wptr;
+    fswork_t w;
+    fsdiff_t *diffs;
+    uint64_t end;
+    int ndiffs = 0, i, nthreads;
+    pthread_t threads[FS_MAXTHR];
+
+    if (width < 4 || width > 32)
+        return 0;
+    if (rflags & R_HAVEQ && plen(qpoly) != width)
+        return 0;
+
+    memset(&w, 0, sizeof(w));
+    w.guess = guess;
+    w.rflags = rflags;
+    w.args = args;
+    w.argpolys = argpolys;
+    w.pworks = pworks;
+    w.width = (int) width;
+    w.mask = (width == 32) ? UINT32_MAX : (UINT32_C(1) << width) - 1;
+    w.first = (uint32_t)(*guess->spoly.bitmap >> (BMP_BIT - width)) | 1;
+    end = (uint64_t) 1 << width;
+    if (rflags & R_HAVEQ)
+        end = *qpoly.bitmap >> (BMP_BIT - width);
+    w.count = (end > w.first) ? ((end - w.first + 1) >> 1) : 0;
+    w.resc = resc;
+    w.result = result;
+
+    for (wptr = pworks; plen(*wptr); ++wptr)
+        ++ndiffs;
+    if (!(diffs = calloc(ndiffs, sizeof(fsdiff_t))))
+        uerror("cannot allocate memory for difference table");
+
+    for (i = 0; i < ndiffs; ++i) {
+        const poly_t *p = &pworks[i];
+        const unsigned long len = plen(*p), lead = len & 3UL;
+        unsigned long bit = 0;
+        uint8_t v;
+
+        for (; bit < lead; ++bit)
+            diffs[i].lead = (diffs[i].lead << 1) | ((p->bitmap[bit / BMP_BIT] >> (BMP_BIT - 1 - bit % BMP_BIT)) & 1);
+        diffs[i].nnib = len >> 2;
+        if (diffs[i].nnib && !(diffs[i].nib = calloc(diffs[i].nnib, sizeof(uint8_t))))
+            uerror("cannot allocate memory for difference table");
+        for (unsigned long n = 0; n < diffs[i].nnib; ++n) {
+            v = 0;
+            for (int k = 0; k < 4; ++k, ++bit)
+                v = (v << 1) | ((p->bitmap[bit / BMP_BIT] >> (BMP_BIT - 1 - bit % BMP_BIT)) & 1);
+            diffs[i].nib[n] = v;
+        }
+    }
+    w.diffs = diffs;
+    w.ndiffs = ndiffs;
+
+    nthreads = num_CPUs();
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > FS_MAXTHR)
+        nthreads = FS_MAXTHR;
+    if ((uint64_t) nthreads * FS_CHUNK > w.count)
+        nthreads = (int)((w.count + FS_CHUNK - 1) / FS_CHUNK);
+
+    pthread_mutex_init(&w.lock, NULL);
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(&threads[i], NULL, fsworker, &w))
+            break;
+    }
+    /* if no thread could be started, do the work here */
+    if (i == 0)
+        fsworker(&w);
+    while (i--)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&w.lock);
+
+    /* threads finish their chunks in any order */
+    if (w.ncands)
+        qsort(w.cands, w.ncands, sizeof(uint32_t), fscmp);
+    for (size_t c = 0; c < w.ncands; ++c)
+        fscandidate(&w, w.cands[c]);
+    free(w.cands);
+
+    for (i = 0; i < ndiffs; ++i)
+        free(diffs[i].nib);
+    free(diffs);
+    return 1;
+}
+
 static poly_t *
 modpol(const poly_t init, int rflags, int args, const poly_t *argpolys) {
     /* Produce, in ascending length order, a list of differences
@@ -0,0 +1,38 @@
+#include "pm3.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static void print_record(const pm3_record *rec, void *userdata) {
+    (void) userdata;
+    if (rec->type != PM3_RECORD_UID) {
+        return;
+    }
+    printf("callback UID: ");
+    for (size_t i = 0; i < rec->len; i++) {
+        printf("%02X", rec->data[i]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2) {
+        printf("Usage: %s <port>\n", argv[0]);
+        exit(-1);
+    }
+
+    pm3 *p;
+    p = pm3_open(argv[1]);
+
+    pm3_record_callback_set(p, print_record, NULL);
+
+    // Execute the command, records are collected because of capture
+    pm3_console(p, "hf 14a reader", true, true);
+
+    for (size_t i = 0; i < pm3_records_count(p); i++) {
+        const pm3_record *rec = pm3_record_get(p, i);
+        printf("record type %d index %u len %zu\n", rec->type, rec->index, rec->len);
+    }
+
+    pm3_close(p);
+}
@@ -17,13 +17,49 @@
 #define LIBPM3_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct pm3_device pm3;
 
+// Typed results emitted by commands next to their text output
+typedef enum {
+    PM3_RECORD_KEY,      // index: sector, subtype: key type (0 = A, 1 = B), data: key
+    PM3_RECORD_BLOCK,    // index: block number, data: block content
+    PM3_RECORD_UID,      // data: UID
+    PM3_RECORD_TRACE,    // index: offset in trace buffer, subtype: 1 if tag response, timestamp: start of frame, data: frame
+} pm3_record_type;
+
+typedef struct pm3_record {
+    pm3_record_type type;
+    uint32_t index;
+    uint32_t timestamp;
+    uint8_t subtype;
+    size_t len;
+    const uint8_t *data;
+} pm3_record;
+
+// data is only valid during the callback
+typedef void (*pm3_record_cb)(const pm3_record *rec, void *userdata);
+
 pm3 *pm3_open(const char *port);
 int pm3_console(pm3 *dev, const char *cmd, bool capture, bool quiet);
 const char *pm3_grabbed_output_get(pm3 *dev);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
+
+// Records can be received as they happen through a callback (NULL to disable),
+// and are collected for the last pm3_console() call which had capture enabled.
+void pm3_record_callback_set(pm3 *dev, pm3_record_cb cb, void *userdata);
+size_t pm3_records_count(pm3 *dev);
+const pm3_record *pm3_record_get(pm3 *dev, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
 #endif // LIBPM3_H
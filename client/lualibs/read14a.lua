@@ -29,6 +29,7 @@ local ISO14A_COMMAND = {
     ISO14A_TOPAZMODE = 0x100,
     ISO14A_NO_RATS = 0x200,
     ISO14A_SEND_CHAINING = 0x400,
+    ISO14A_APDU_QUEUED = 0x800,
     ISO14A_CLEARTRACE = 0x20000,
 }
 
@@ -58,6 +58,25 @@ class _SwigNonDynamicMeta(type):
     __setattr__ = _swig_setattr_nondynamic_class_variable(type.__setattr__)
 
 
+PM3_RECORD_KEY = _pm3.PM3_RECORD_KEY
+PM3_RECORD_BLOCK = _pm3.PM3_RECORD_BLOCK
+PM3_RECORD_UID = _pm3.PM3_RECORD_UID
+PM3_RECORD_TRACE = _pm3.PM3_RECORD_TRACE
+class record(object):
+    thisown = property(lambda x: x.this.own(), lambda x, v: x.this.own(v), doc="The membership flag")
+
+    def __init__(self, *args, **kwargs):
+        raise AttributeError("No constructor defined")
+    __repr__ = _swig_repr
+    type = property(_pm3.record_type_get)
+    index = property(_pm3.record_index_get)
+    timestamp = property(_pm3.record_timestamp_get)
+    subtype = property(_pm3.record_subtype_get)
+    len = property(_pm3.record_len_get)
+    data = property(_pm3.record_data_get)
+
+# Register record in _pm3:
+_pm3.record_swigregister(record)
 class pm3(object):
     thisown = property(lambda x: x.this.own(), lambda x, v: x.this.own(v), doc="The membership flag")
     __repr__ = _swig_repr
@@ -68,6 +87,15 @@ class pm3(object):
 
     def console(self, cmd, capture=True, quiet=True):
         return _pm3.pm3_console(self, cmd, capture, quiet)
+
+    def record_callback_set(self, cb):
+        return _pm3.pm3_record_callback_set(self, cb)
+
+    def records_count(self):
+        return _pm3.pm3_records_count(self)
+
+    def record_get(self, index):
+        return _pm3.pm3_record_get(self, index)
     name = property(_pm3.pm3_name_get)
     grabbed_output = property(_pm3.pm3_grabbed_output_get)
 
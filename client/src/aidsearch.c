@@ -21,51 +21,25 @@
 #include "fileutils.h"
 #include "pm3_cmd.h"
 #include "util.h"
+#include "rescache.h"
 
-static int openAIDFile(json_t **root, bool verbose) {
-    json_error_t error;
+// aidlist.json is parsed once per session, see rescache.c
+#define AID_RESOURCE "aidlist"
 
-    char *path;
-    int res = searchFile(&path, RESOURCES_SUBDIR, "aidlist", ".json", false);
-    if (res != PM3_SUCCESS) {
-        return PM3_EFILE;
-    }
-
-    int retval = PM3_SUCCESS;
-    *root = json_load_file(path, 0, &error);
-    if (!*root) {
-        PrintAndLogEx(ERR, "json (%s) error on line %d: %s", path, error.line, error.text);
-        retval = PM3_ESOFT;
-        goto out;
-    }
-
-    if (!json_is_array(*root)) {
-        PrintAndLogEx(ERR, "Invalid json (%s) format. root must be an array.", path);
-        retval = PM3_ESOFT;
-        goto out;
+json_t *AIDSearchInit(bool verbose) {
+    json_t *root = rescache_get(AID_RESOURCE, verbose);
+    if (root == NULL) {
+        return NULL;
     }
 
-    PrintAndLogEx(DEBUG, "Loaded file " _YELLOW_("%s") " " _GREEN_("%zu") " records ( " _GREEN_("ok") " )"
-                  , path
-                  , json_array_size(*root)
-                 );
-out:
-    free(path);
-    return retval;
-}
-
-static int closeAIDFile(json_t *root) {
-    json_decref(root);
-    return PM3_SUCCESS;
-}
-
-json_t *AIDSearchInit(bool verbose) {
-    json_t *root = NULL;
-    int res = openAIDFile(&root, verbose);
-    if (res != PM3_SUCCESS)
+    if (!json_is_array(root)) {
+        PrintAndLogEx(ERR, "Invalid json (" AID_RESOURCE ") format. root must be an array.");
         return NULL;
+    }
 
-    return root;
+    PrintAndLogEx(DEBUG, "Using " _YELLOW_(AID_RESOURCE) " " _GREEN_("%zu") " records ( " _GREEN_("ok") " )", json_array_size(root));
+    // callers release it with AIDSearchFree()
+    return json_incref(root);
 }
 
 json_t *AIDSearchGetElm(json_t *root, size_t elmindx) {
@@ -78,7 +52,8 @@ json_t *AIDSearchGetElm(json_t *root, size_t elmindx) {
 }
 
 int AIDSearchFree(json_t *root) {
-    return closeAIDFile(root);
+    json_decref(root);
+    return PM3_SUCCESS;
 }
 
 static const char *jsonStrGet(json_t *data, const char *name) {
@@ -125,11 +100,30 @@ bool AIDGetFromElm(json_t *data, uint8_t *aid, size_t aidmaxlen, int *aidlen) {
     return true;
 }
 
+// AID -> element positions, only valid for the cached aidlist root
+static json_t *aidIndex(json_t *root) {
+    if (root == NULL || root != rescache_get(AID_RESOURCE, false)) {
+        return NULL;
+    }
+    return rescache_index(AID_RESOURCE, "AID");
+}
+
 bool AIDSeenBefore(json_t *root, const uint8_t *aid, size_t aidlen, size_t before_index) {
     if (root == NULL || aid == NULL || aidlen == 0) {
         return false;
     }
 
+    json_t *index = aidIndex(root);
+    if (index != NULL) {
+        char hexaid[(aidlen * 2) + 1];
+        hex_to_buffer((uint8_t *)hexaid, aid, aidlen, sizeof(hexaid) - 1, 0, 0, true);
+        json_t *positions = rescache_index_get(index, hexaid, sizeof(hexaid) - 1);
+        if (positions == NULL) {
+            return false;
+        }
+        return (size_t)json_integer_value(json_array_get(positions, 0)) < before_index;
+    }
+
     size_t limit = before_index;
     if (limit > json_array_size(root)) {
         limit = json_array_size(root);
@@ -193,40 +187,68 @@ int PrintAIDDescriptionEx(json_t *xroot, char *aid, const uint8_t *response, siz
 
     json_t *fallback_elm = NULL;
     json_t *contains_elm = NULL;
-    size_t maxaidlen = 0;
 
-    for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
-        json_t *data = AIDSearchGetElm(root, elmindx);
-        if (data == NULL) {
-            continue;
+    json_t *index = aidIndex(root);
+    if (index != NULL) {
+        // longest dictionary AID which is a prefix of the requested one
+        for (size_t plen = strlen(aid); plen > 0 && fallback_elm == NULL; plen--) {
+            json_t *positions = rescache_index_get(index, aid, plen);
+            size_t i;
+            json_t *jpos;
+            json_array_foreach(positions, i, jpos) {
+                json_t *data = AIDSearchGetElm(root, json_integer_value(jpos));
+                if (data == NULL) {
+                    continue;
+                }
+
+                if (fallback_elm == NULL) {
+                    fallback_elm = data;
+                }
+
+                if (response_hex != NULL) {
+                    const char *response_regex = jsonStrGet(data, "ResponseRegex");
+                    if (response_regex && str_regex_match_case_insensitive(response_regex, response_hex)) {
+                        contains_elm = data;
+                    }
+                }
+            }
         }
+    } else {
+        size_t maxaidlen = 0;
 
-        const char *dictaid = jsonStrGet(data, "AID");
-        if (dictaid == NULL) {
-            continue;
-        }
+        for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
+            json_t *data = AIDSearchGetElm(root, elmindx);
+            if (data == NULL) {
+                continue;
+            }
 
-        if (!aidCompare(aid, dictaid)) {  // dictaid may be less length than requested aid
-            continue;
-        }
+            const char *dictaid = jsonStrGet(data, "AID");
+            if (dictaid == NULL) {
+                continue;
+            }
 
-        size_t dictaidlen = strlen(dictaid);
-        if (dictaidlen > strlen(aid)) {
-            continue;
-        }
+            if (!aidCompare(aid, dictaid)) {  // dictaid may be less length than requested aid
+                continue;
+            }
 
-        if (dictaidlen > maxaidlen) {
-            maxaidlen = dictaidlen;
-            fallback_elm = data;
-            contains_elm = NULL;
-        } else if (dictaidlen < maxaidlen) {
-            continue;
-        }
+            size_t dictaidlen = strlen(dictaid);
+            if (dictaidlen > strlen(aid)) {
+                continue;
+            }
+
+            if (dictaidlen > maxaidlen) {
+                maxaidlen = dictaidlen;
+                fallback_elm = data;
+                contains_elm = NULL;
+            } else if (dictaidlen < maxaidlen) {
+                continue;
+            }
 
-        if (response_hex != NULL) {
-            const char *response_regex = jsonStrGet(data, "ResponseRegex");
-            if (response_regex && str_regex_match_case_insensitive(response_regex, response_hex)) {
-                contains_elm = data;
+            if (response_hex != NULL) {
+                const char *response_regex = jsonStrGet(data, "ResponseRegex");
+                if (response_regex && str_regex_match_case_insensitive(response_regex, response_hex)) {
+                    contains_elm = data;
+                }
             }
         }
     }
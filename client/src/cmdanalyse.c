@@ -299,10 +299,8 @@ static int CmdAnalyseCRC(const char *Cmd) {
 
     // 51  f5  7a  d6
     uint8_t uid[] = {0x51, 0xf5, 0x7a, 0xd6}; //12 34 56
-    init_table(CRC_LEGIC);
     uint8_t legic8 = CRC8Legic(uid, sizeof(uid)) & 0xFF;
     PrintAndLogEx(INFO, "Legic 16 | %X (EF6F expected) [legic8 = %02x]", crc16_legic(data, (size_t)dlen, legic8), legic8);
-    init_table(CRC_FELICA);
     PrintAndLogEx(INFO, "FeliCa | %X ", crc16_xmodem(data, (size_t)dlen));
 
     PrintAndLogEx(INFO, "\nTests of reflection. Current methods in source code");
@@ -38,6 +38,7 @@
 #include "iso7816/apduinfo.h"    // GetAPDUCodeDescription
 #include "nfc/ndef.h"            // NDEFRecordsDecodeAndPrint
 #include "cmdnfc.h"              // print_type4_cc_info
+#include "pm3.h"                 // PM3_RECORD_UID
 #include "fileutils.h"           // saveFile
 #include "atrs.h"                // getATRinfo
 #include "desfire.h"             // desfire enums
@@ -651,6 +652,7 @@ int Hf14443_4aGetCardData(iso14a_card_select_t *card) {
     }
 
     PrintAndLogEx(SUCCESS, " UID: " _GREEN_("%s"), sprint_hex(card->uid, card->uidlen));
+    PrintAndLogRecord(PM3_RECORD_UID, 0, 0, 0, card->uid, card->uidlen);
     PrintAndLogEx(SUCCESS, "ATQA: %02X %02X", card->atqa[1], card->atqa[0]);
     PrintAndLogEx(SUCCESS, " SAK: %02X [%" PRIu64 "]", card->sak, resp.oldarg[0]);
 
@@ -768,6 +770,7 @@ static int CmdHF14AReader(const char *Cmd) {
             }
 
             PrintAndLogEx(SUCCESS, " UID: " _GREEN_("%s"), sprint_hex(card.uid, card.uidlen));
+            PrintAndLogRecord(PM3_RECORD_UID, 0, 0, 0, card.uid, card.uidlen);
 
             if (!(silent && continuous)) {
                 PrintAndLogEx(SUCCESS, "ATQA: " _GREEN_("%02X %02X"), card.atqa[1], card.atqa[0]);
@@ -1327,6 +1330,68 @@ int SelectCard14443A_4(bool disconnect, bool verbose, iso14a_card_select_t *card
     return SelectCard14443A_4_WithParameters(disconnect, verbose, card, NULL);
 }
 
+// Checks the answer to one ISO14A_APDU reader command and copies the APDU response to dataout
+static int APDU14aResponse(const PacketResponseNG *resp, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, bool *chainingout) {
+    const uint8_t *recv = resp->data.asBytes;
+    int iLen = resp->oldarg[0];
+    uint8_t res = resp->oldarg[1];
+
+    int dlen = iLen - 2;
+    if (dlen < 0) {
+        dlen = 0;
+    }
+    *dataoutlen += dlen;
+
+    if (maxdataoutlen && *dataoutlen > maxdataoutlen) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: Buffer too small(%d), needs %d bytes", *dataoutlen, maxdataoutlen);
+        return PM3_EAPDU_FAIL;
+    }
+
+    // I-block ACK
+    if ((res & 0xF2) == 0xA2) {
+        *dataoutlen = 0;
+        *chainingout = true;
+        return PM3_SUCCESS;
+    }
+
+    if (iLen == 0) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: No APDU response");
+        return PM3_EAPDU_FAIL;
+    }
+
+    // check apdu length
+    if (iLen < 2 && iLen >= 0) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: Small APDU response, len %d", iLen);
+        return PM3_EAPDU_FAIL;
+    }
+
+    // check block TODO
+    if (iLen == -2) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: Block type mismatch");
+        return PM3_EAPDU_FAIL;
+    }
+
+    memcpy(dataout, recv, dlen);
+
+    // chaining
+    if ((res & 0x10) != 0) {
+        *chainingout = true;
+    }
+
+    // CRC Check
+    if (iLen == -1) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: ISO 14443A CRC error");
+        return PM3_EAPDU_FAIL;
+    }
+
+    // Button pressed / user cancelled
+    if (iLen == -3) {
+        PrintAndLogEx(DEBUG, "\naborted via keyboard!");
+        return PM3_EAPDU_FAIL;
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen, bool activateField, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, bool *chainingout) {
     *chainingout = false;
 
@@ -1392,64 +1457,7 @@ static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen
         return PM3_EAPDU_FAIL;
     }
 
-    const uint8_t *recv = resp.data.asBytes;
-    int iLen = resp.oldarg[0];
-    uint8_t res = resp.oldarg[1];
-
-    int dlen = iLen - 2;
-    if (dlen < 0) {
-        dlen = 0;
-    }
-    *dataoutlen += dlen;
-
-    if (maxdataoutlen && *dataoutlen > maxdataoutlen) {
-        PrintAndLogEx(DEBUG, "ERR: APDU: Buffer too small(%d), needs %d bytes", *dataoutlen, maxdataoutlen);
-        return PM3_EAPDU_FAIL;
-    }
-
-    // I-block ACK
-    if ((res & 0xF2) == 0xA2) {
-        *dataoutlen = 0;
-        *chainingout = true;
-        return PM3_SUCCESS;
-    }
-
-    if (iLen == 0) {
-        PrintAndLogEx(DEBUG, "ERR: APDU: No APDU response");
-        return PM3_EAPDU_FAIL;
-    }
-
-    // check apdu length
-    if (iLen < 2 && iLen >= 0) {
-        PrintAndLogEx(DEBUG, "ERR: APDU: Small APDU response, len %d", iLen);
-        return PM3_EAPDU_FAIL;
-    }
-
-    // check block TODO
-    if (iLen == -2) {
-        PrintAndLogEx(DEBUG, "ERR: APDU: Block type mismatch");
-        return PM3_EAPDU_FAIL;
-    }
-
-    memcpy(dataout, recv, dlen);
-
-    // chaining
-    if ((res & 0x10) != 0) {
-        *chainingout = true;
-    }
-
-    // CRC Check
-    if (iLen == -1) {
-        PrintAndLogEx(DEBUG, "ERR: APDU: ISO 14443A CRC error");
-        return PM3_EAPDU_FAIL;
-    }
-
-    // Button pressed / user cancelled
-    if (iLen == -3) {
-        PrintAndLogEx(DEBUG, "\naborted via keyboard!");
-        return PM3_EAPDU_FAIL;
-    }
-    return PM3_SUCCESS;
+    return APDU14aResponse(&resp, dataout, maxdataoutlen, dataoutlen, chainingout);
 }
 
 int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen) {
@@ -1526,6 +1534,39 @@ int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bo
     return PM3_SUCCESS;
 }
 
+// Sends one APDU, which must fit in one frame, without waiting for the answer.
+// Several APDUs can be in flight, the answers are picked up in order with ReceiveAPDU14a().
+// The field must be on and the card selected. While it waits out WTX the device can only be
+// stopped with the button, the USB buffer may already hold the next APDU.
+int SendAPDU14a(const uint8_t *datain, int datainlen) {
+    if ((gs_frame_len && (datainlen > gs_frame_len - 3)) || (datainlen > PM3_CMD_DATA_SIZE - 3)) {
+        return PM3_EINVARG;
+    }
+
+    SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_APDU | ISO14A_NO_DISCONNECT | ISO14A_APDU_QUEUED, datainlen, 0, datain, datainlen);
+    return PM3_SUCCESS;
+}
+
+// Gets the answer to the oldest APDU sent with SendAPDU14a().
+// A card answer split with I-block chaining isn't followed since the next APDU may already be on its way.
+int ReceiveAPDU14a(uint8_t *dataout, int maxdataoutlen, int *dataoutlen) {
+    *dataoutlen = 0;
+
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_ACK, &resp, 1500) == false) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: Reply timeout");
+        return PM3_EAPDU_FAIL;
+    }
+
+    bool chaining = false;
+    int res = APDU14aResponse(&resp, dataout, maxdataoutlen, dataoutlen, &chaining);
+    if (res == PM3_SUCCESS && chaining) {
+        PrintAndLogEx(DEBUG, "ERR: APDU: Chained answer in a pipelined exchange");
+        return PM3_EAPDU_FAIL;
+    }
+    return res;
+}
+
 // ISO14443-4. 7. Half-duplex block transmission protocol
 static int CmdHF14AAPDU(const char *Cmd) {
     CLIParserContext *ctx;
@@ -2795,6 +2836,7 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
 
     PrintAndLogEx(INFO, "---------- " _CYAN_("ISO14443-A Information") " ----------");
     PrintAndLogEx(SUCCESS, " UID: " _GREEN_("%s") " %s", sprint_hex(card.uid, card.uidlen), get_uid_type(&card));
+    PrintAndLogRecord(PM3_RECORD_UID, 0, 0, 0, card.uid, card.uidlen);
     PrintAndLogEx(SUCCESS, "ATQA: " _GREEN_("%02X %02X"), card.atqa[1], card.atqa[0]);
     PrintAndLogEx(SUCCESS, " SAK: " _GREEN_("%02X [%" PRIu64 "]"), card.sak, select_status);
     if (version_hw_available) {
@@ -2244,6 +2244,202 @@ static int CmdHF15WriteDsfid(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// number of READ (MULTIPLE) BLOCK(S) requests kept in flight during a dump
+#define HF15_DUMP_PIPELINE   2
+
+// Puts a read of `count` blocks starting at `blockno` into packet.
+// The first `hdrlen` bytes (flags, command, uid) are kept.
+static void hf15_dump_request(iso15_raw_cmd_t *packet, uint8_t hdrlen, uint8_t blockno, uint16_t count) {
+    packet->rawlen = hdrlen;
+    if (count == 1) {
+        packet->raw[1] = ISO15693_READBLOCK;
+        packet->raw[packet->rawlen++] = blockno;
+    } else {
+        packet->raw[1] = ISO15693_READ_MULTI_BLOCK;
+        packet->raw[packet->rawlen++] = blockno;
+        packet->raw[packet->rawlen++] = (count - 1) & 0xFF;
+    }
+    AddCrc15(packet->raw, packet->rawlen);
+    packet->rawlen += 2;
+}
+
+// Checks the answer to a hf15_dump_request() and copies lock status and data into tag.
+// Returns PM3_EWRONGANSWER with the error code in tag_error if the tag refused,
+// PM3_ERFTRANS / PM3_ECRC for a broken answer.
+static int hf15_dump_answer(const PacketResponseNG *resp, iso15_tag_t *tag, uint8_t blockno, uint16_t count, uint8_t *tag_error) {
+
+    const uint8_t *d = resp->data.asBytes;
+
+    if (resp->length < 2) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(FAILED, "iso15693 command failed");
+        return PM3_ERFTRANS;
+    }
+
+    if (CheckCrc15(d, resp->length) == false) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(FAILED, "crc ( " _RED_("fail") " )");
+        return PM3_ECRC;
+    }
+
+    if ((d[0] & ISO15_RES_ERROR) == ISO15_RES_ERROR) {
+        *tag_error = d[1];
+        return PM3_EWRONGANSWER;
+    }
+
+    // status, lock byte and data of every block, crc
+    if (resp->length < 1 + count * (tag->bytesPerPage + 1) + 2) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(FAILED, "iso15693 answer too short ( %u bytes )", resp->length);
+        return PM3_ERFTRANS;
+    }
+
+    d++;
+    for (uint16_t i = blockno; i < blockno + count; i++) {
+        tag->locks[i] = *d++;
+        memcpy(&tag->data[i * tag->bytesPerPage], d, tag->bytesPerPage);
+        d += tag->bytesPerPage;
+    }
+    return PM3_SUCCESS;
+}
+
+// Reads `count` blocks one by one, two tries per block.
+// Returns the number of blocks read, less than count if the tag refused or stopped answering.
+static uint16_t hf15_dump_blocks(iso15_raw_cmd_t *packet, uint8_t hdrlen, iso15_tag_t *tag, uint8_t blockno, uint16_t count) {
+
+    uint16_t n = 0;
+
+    for (int retry = 0; (retry < 2 && n < count); retry++) {
+
+        hf15_dump_request(packet, hdrlen, blockno + n, 1);
+
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_ISO15693_COMMAND, (uint8_t *)packet, ISO15_RAW_LEN(packet->rawlen));
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(CMD_HF_ISO15693_COMMAND, &resp, 2000) == false) {
+            continue;
+        }
+
+        uint8_t tag_error = 0;
+        int res = hf15_dump_answer(&resp, tag, blockno + n, 1, &tag_error);
+        if (res == PM3_EWRONGANSWER) {
+
+            // heuristic determine end of available memory
+            if (tag_error != ISO15_ERROR_GENERIC && tag_error != ISO15_ERROR_BLOCK_UNAVAILABLE) {
+                PrintAndLogEx(NORMAL, "");
+                PrintAndLogEx(FAILED, "Tag returned Error %i: %s", tag_error, TagErrorStr(tag_error));
+            }
+            break;
+        }
+
+        if (res != PM3_SUCCESS) {
+            continue;
+        }
+
+        retry = 0;
+        n++;
+        PrintAndLogEx(INPLACE, "blk %3d", blockno + n);
+    }
+    return n;
+}
+
+// Reads the tag memory with READ MULTIPLE BLOCKS.
+// The batch size starts at what fits in one answer frame and is halved until the tag accepts it,
+// a tag which doesn't answer the first one at all is read one block per command.
+// HF15_DUMP_PIPELINE requests are kept in flight so the tag is read while the client handles the last answer.
+// A batch which fails is read again block by block.
+// Returns the number of blocks read.
+static int hf15_dump_read(iso15_raw_cmd_t *packet, uint8_t hdrlen, iso15_tag_t *tag, bool verbose) {
+
+    typedef struct {
+        uint8_t blockno;
+        uint16_t count;
+    } hf15_dump_req_t;
+
+    uint16_t pages = MIN(tag->pagesCount, ISO15693_TAG_MAX_PAGES);
+    if (tag->bytesPerPage == 0 || pages * tag->bytesPerPage > ISO15693_TAG_MAX_SIZE) {
+        pages = ISO15693_TAG_MAX_SIZE / MAX(tag->bytesPerPage, 1);
+    }
+
+    // largest power of two blocks which fits in one answer:  status, lock byte + data per block, crc
+    uint16_t batch = 1;
+    while ((batch * 2) <= pages && (1 + (batch * 2) * (tag->bytesPerPage + 1) + 2) <= PM3_CMD_DATA_SIZE) {
+        batch *= 2;
+    }
+
+    hf15_dump_req_t inflight[HF15_DUMP_PIPELINE];
+    uint8_t ninflight = 0;
+    bool probing = (batch > 1);
+    uint16_t blocknum = 0;
+    uint16_t next = 0;
+
+    clearCommandBuffer();
+
+    while (blocknum < pages) {
+
+        // only one request at a time until the tag accepted a batch
+        while (ninflight < (probing ? 1 : HF15_DUMP_PIPELINE) && next < pages) {
+            uint16_t count = MIN(batch, pages - next);
+            hf15_dump_request(packet, hdrlen, next, count);
+            SendCommandNG(CMD_HF_ISO15693_COMMAND, (uint8_t *)packet, ISO15_RAW_LEN(packet->rawlen));
+            inflight[ninflight].blockno = next;
+            inflight[ninflight].count = count;
+            ninflight++;
+            next += count;
+        }
+
+        hf15_dump_req_t req = inflight[0];
+        memmove(inflight, inflight + 1, (ninflight - 1) * sizeof(hf15_dump_req_t));
+        ninflight--;
+
+        PacketResponseNG resp;
+        uint8_t tag_error = 0;
+        int res = PM3_ETIMEOUT;
+        if (WaitForResponseTimeout(CMD_HF_ISO15693_COMMAND, &resp, 2000)) {
+            res = hf15_dump_answer(&resp, tag, req.blockno, req.count, &tag_error);
+        }
+
+        if (res == PM3_SUCCESS) {
+            if (probing && verbose) {
+                PrintAndLogEx(NORMAL, "");
+                PrintAndLogEx(INFO, "Reading " _YELLOW_("%u") " blocks per command", batch);
+            }
+            probing = false;
+            blocknum += req.count;
+            PrintAndLogEx(INPLACE, "blk %3d", blocknum);
+            continue;
+        }
+
+        // the answers to requests sent after the failed one are dropped
+        for (; ninflight > 0; ninflight--) {
+            WaitForResponseTimeout(CMD_HF_ISO15693_COMMAND, &resp, 2000);
+        }
+        next = blocknum;
+
+        if (probing && res == PM3_EWRONGANSWER && batch > 1) {
+            batch /= 2;
+            probing = (batch > 1);
+            continue;
+        }
+
+        // no answer at all to READ MULTIPLE, single block reads from here on
+        if (probing && res == PM3_ETIMEOUT) {
+            batch = 1;
+            probing = false;
+        }
+
+        uint16_t n = hf15_dump_blocks(packet, hdrlen, tag, req.blockno, req.count);
+        blocknum += n;
+        next = blocknum;
+        if (n < req.count) {
+            break;
+        }
+    }
+
+    return blocknum;
+}
+
 // Reads all memory pages
 // need to write to file
 static int CmdHF15Dump(const char *Cmd) {
@@ -2301,8 +2497,8 @@ static int CmdHF15Dump(const char *Cmd) {
         scan = true;
     }
 
-    // request to be sent to device/card
-    uint16_t approxlen = 2 + ISO15693_UID_LENGTH + 1 + 2;
+    // request to be sent to device/card, room for first block and block count
+    uint16_t approxlen = 2 + ISO15693_UID_LENGTH + 2 + 2;
     iso15_raw_cmd_t *packet = (iso15_raw_cmd_t *)calloc(1, sizeof(iso15_raw_cmd_t) + approxlen);
     if (packet == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
@@ -2417,10 +2613,9 @@ static int CmdHF15Dump(const char *Cmd) {
         tag->pagesCount = 128;
     }
 
-    // add length for blockno (1)
-    packet->rawlen++;
-    packet->raw[0] |= ISO15_REQ_OPTION; // Add option to dump lock status
-    packet->raw[1] = ISO15693_READBLOCK;
+    // READ MULTIPLE BLOCKS with option flag, lock status for each block
+    uint8_t hdrlen = (used_uid) ? 2 + ISO15693_UID_LENGTH : 2;
+    packet->raw[0] |= ISO15_REQ_OPTION;
 
     packet->flags = (ISO15_READ_RESPONSE | ISO15_NO_DISCONNECT);
     if (fast) {
@@ -2429,58 +2624,10 @@ static int CmdHF15Dump(const char *Cmd) {
 
     PrintAndLogEx(SUCCESS, "Reading memory");
 
-    int blocknum = 0;
-
-    for (int retry = 0; (retry < 2 && blocknum < tag->pagesCount); retry++) {
-        if (used_uid) {
-            packet->raw[10] = (uint8_t)blocknum & 0xFF;
-            AddCrc15(packet->raw, 11);
-        } else {
-            packet->raw[2] = (uint8_t)blocknum & 0xFF;
-            AddCrc15(packet->raw, 3);
-        }
-
-        clearCommandBuffer();
-        SendCommandNG(CMD_HF_ISO15693_COMMAND, (uint8_t *)packet, ISO15_RAW_LEN(packet->rawlen));
-
-        if (WaitForResponseTimeout(CMD_HF_ISO15693_COMMAND, &resp, 2000)) {
-
-            if (resp.length < 2) {
-                PrintAndLogEx(NORMAL, "");
-                PrintAndLogEx(FAILED, "iso15693 command failed");
-                continue;
-            }
-
-            d = resp.data.asBytes;
-
-            if (CheckCrc15(d, resp.length) == false) {
-                PrintAndLogEx(NORMAL, "");
-                PrintAndLogEx(FAILED, "crc ( " _RED_("fail") " )");
-                continue;
-            }
-
-            if ((d[0] & ISO15_RES_ERROR) == ISO15_RES_ERROR) {
-
-                // heuristic determine end of available memory
-                if (d[1] == 0x0F || d[1] == 0x10) {
-                    break;
-                }
-
-                PrintAndLogEx(NORMAL, "");
-                PrintAndLogEx(FAILED, "Tag returned Error %i: %s", d[1], TagErrorStr(d[1]));
-                break;
-            }
-
-            tag->locks[blocknum] = d[1];
-
-            // copy read data
-            memcpy(&tag->data[blocknum * tag->bytesPerPage], d + 2, tag->bytesPerPage);
-
-            retry = 0;
-            blocknum++;
-
-            PrintAndLogEx(INPLACE, "blk %3d", blocknum);
-        }
+    int blocknum = hf15_dump_read(packet, hdrlen, tag, verbose);
+    if (blocknum < tag->pagesCount) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(INFO, "Read " _YELLOW_("%d") " of %u blocks", blocknum, tag->pagesCount);
     }
 
     free(packet);
@@ -28,6 +28,9 @@
 #include "protocols.h"    // definitions of ISO14B protocol
 #include "iso14b.h"
 #include "cliparser.h"    // cliparsing
+#include "util.h"         // kbd_enter_pressed
+#include "util_posix.h"   // msclock
+#include "cryptorf/smattack.h"
 
 #define TIMEOUT 2000
 
@@ -529,12 +532,167 @@ static int CmdHFCryptoRFESave(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+typedef struct {
+    uint64_t last_progress;
+    bool progress;
+    bool aborted;
+} cryptorf_recover_t;
+
+static const char *cryptorf_recover_stage(sma_stage_t stage) {
+    switch (stage) {
+        case SMA_STAGE_RIGHT:
+            return "right states";
+        case SMA_STAGE_RIGHT_MITM:
+            return "right candidates";
+        case SMA_STAGE_LEFT:
+            return "left states";
+        case SMA_STAGE_LEFT_MITM:
+            return "left candidates";
+        case SMA_STAGE_COMBINE:
+            return "combining";
+        case SMA_STAGE_VERIFY:
+            return "verifying";
+    }
+    return "";
+}
+
+// called from the search threads, one at a time
+static bool cryptorf_recover_report(const sma_status_t *s, void *arg) {
+    cryptorf_recover_t *r = (cryptorf_recover_t *)arg;
+
+    if (kbd_enter_pressed()) {
+        r->aborted = true;
+        return false;
+    }
+
+    if (s->done < s->total) {
+        if (msclock() - r->last_progress > 500) {
+            PrintAndLogEx(INPLACE, "Searching %s... %3u%%", cryptorf_recover_stage(s->stage), (uint32_t)((s->done * 100) / s->total));
+            r->last_progress = msclock();
+            r->progress = true;
+        }
+        return true;
+    }
+
+    if (r->progress) {
+        PrintAndLogEx(NORMAL, "");
+        r->progress = false;
+    }
+
+    switch (s->stage) {
+        case SMA_STAGE_RIGHT:
+            PrintAndLogEx(INFO, "Top-bin for the right state contains " _GREEN_("%u") " correct bits, " _YELLOW_("%" PRIu64) " right bins", s->rbits, s->count);
+            if (s->rbits < 96) {
+                PrintAndLogEx(WARNING, "The right top-bin is smaller than 96 bits, better find another trace");
+            }
+            break;
+        case SMA_STAGE_RIGHT_MITM:
+            PrintAndLogEx(INFO, "Right state " _YELLOW_("0x%07" PRIx64) ", " _YELLOW_("%" PRIu64) " right candidates", s->rstate, s->count);
+            break;
+        case SMA_STAGE_LEFT:
+            PrintAndLogEx(INFO, "Found " _YELLOW_("%" PRIu64) " left cipher states", s->count);
+            break;
+        case SMA_STAGE_LEFT_MITM:
+            PrintAndLogEx(INFO, "Found " _YELLOW_("%" PRIu64) " left candidates", s->count);
+            break;
+        case SMA_STAGE_COMBINE:
+            PrintAndLogEx(INFO, "Combined to " _YELLOW_("%" PRIu64) " valid candidates", s->count);
+            break;
+        case SMA_STAGE_VERIFY:
+            if (s->count == 0) {
+                PrintAndLogEx(INFO, "No key with this right state");
+            }
+            break;
+    }
+    return true;
+}
+
+static int CmdHFCryptoRFRecover(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf cryptorf recover",
+                  "Recover the secret Gc of a SecureMemory / CryptoRF tag from one sniffed authentication,\n"
+                  "the card random Ci, the reader random Q, the reader challenge Ch and the card answer Ci+1.\n"
+                  "Same attack as tools/cryptorf/sma_multi, no device needed.",
+                  "hf cryptorf recover --ci ffffffffffffffff --q 1234567812345678 --ch 88c9d4466a501a87 --ci1 dec2ee1b1c9276e9"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1(NULL, "ci", "<hex>", "card random, 8 hex bytes"),
+        arg_str1(NULL, "q", "<hex>", "reader random, 8 hex bytes"),
+        arg_str1(NULL, "ch", "<hex>", "reader challenge, 8 hex bytes"),
+        arg_str1(NULL, "ci1", "<hex>", "card answer Ci+1, 8 hex bytes"),
+        arg_int0(NULL, "threads", "<dec>", "search threads (def: number of CPUs)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    uint8_t ci[8] = {0};
+    uint8_t q[8] = {0};
+    uint8_t ch[8] = {0};
+    uint8_t ci1[8] = {0};
+    int cilen = 0, qlen = 0, chlen = 0, ci1len = 0;
+    CLIGetHexWithReturn(ctx, 1, ci, &cilen);
+    CLIGetHexWithReturn(ctx, 2, q, &qlen);
+    CLIGetHexWithReturn(ctx, 3, ch, &chlen);
+    CLIGetHexWithReturn(ctx, 4, ci1, &ci1len);
+    int threads = arg_get_int_def(ctx, 5, num_CPUs());
+    CLIParserFree(ctx);
+
+    if (cilen != 8 || qlen != 8 || chlen != 8 || ci1len != 8) {
+        PrintAndLogEx(WARNING, "Ci, Q, Ch and Ci+1 must be 8 hex bytes each");
+        return PM3_EINVARG;
+    }
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    PrintAndLogEx(INFO, "  Ci... %s", sprint_hex_inrow(ci, sizeof(ci)));
+    PrintAndLogEx(INFO, "   Q... %s", sprint_hex_inrow(q, sizeof(q)));
+    PrintAndLogEx(INFO, "  Ch... %s", sprint_hex_inrow(ch, sizeof(ch)));
+    PrintAndLogEx(INFO, "Ci+1... %s", sprint_hex_inrow(ci1, sizeof(ci1)));
+    PrintAndLogEx(INFO, "Searching with " _YELLOW_("%d") " threads, press " _GREEN_("<Enter>") " to abort", threads);
+
+    cryptorf_recover_t r = {
+        .last_progress = msclock(),
+        .progress = false,
+        .aborted = false,
+    };
+
+    uint8_t gc[8] = {0};
+    uint64_t t1 = msclock();
+    sma_result_t res = sma_recover(ci, q, ch, ci1, threads, cryptorf_recover_report, &r, gc);
+    t1 = msclock() - t1;
+
+    if (r.progress) {
+        PrintAndLogEx(NORMAL, "");
+    }
+
+    switch (res) {
+        case SMA_FOUND:
+            PrintAndLogEx(SUCCESS, "Valid key found [ " _GREEN_("%s") " ] in %.1f s", sprint_hex_inrow(gc, sizeof(gc)), (float)t1 / 1000.0);
+            return PM3_SUCCESS;
+        case SMA_ABORTED:
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            return PM3_EOPABORTED;
+        case SMA_NOMEM:
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        case SMA_NOT_FOUND:
+            break;
+    }
+    PrintAndLogEx(FAILED, "No key found in %.1f s, better find another trace", (float)t1 / 1000.0);
+    return PM3_ESOFT;
+}
+
 static command_t CommandTable[] = {
     {"help",    CmdHelp,              AlwaysAvailable, "This help"},
     {"dump",    CmdHFCryptoRFDump,    IfPm3Iso14443b,  "Read all memory pages of an CryptoRF tag, save to file"},
     {"info",    CmdHFCryptoRFInfo,    IfPm3Iso14443b,  "Tag information"},
     {"list",    CmdHFCryptoRFList,    AlwaysAvailable,  "List ISO 14443B history"},
     {"reader",  CmdHFCryptoRFReader,  IfPm3Iso14443b,  "Act as a CryptoRF reader to identify a tag"},
+    {"recover", CmdHFCryptoRFRecover, AlwaysAvailable, "Recover the secret Gc from one authentication"},
     {"sim",     CmdHFCryptoRFSim,     IfPm3Iso14443b,  "Fake CryptoRF tag"},
     {"sniff",   CmdHFCryptoRFSniff,   IfPm3Iso14443b,  "Eavesdrop CryptoRF"},
     {"eload",   CmdHFCryptoRFELoad,   AlwaysAvailable, "Upload file into emulator memory"},
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <inttypes.h>
+#include <time.h>
 #include "cmdparser.h"   // command_t
 #include "comms.h"
 #include "cmdtrace.h"
@@ -82,6 +83,12 @@
 #define FELICA_IC_CODE_LIST_JSON "felica/felica_ic_code_list"
 
 #define FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE 32U
+// Search Service Code requests kept in flight once the card has answered one
+#define FELICA_SEARCH_SERVICE_CODE_PIPELINE 4U
+#define FELICA_NODE_CACHE_FILE "felica_nodes.json"
+#define FELICA_NODE_CACHE_VERSION 1
+#define FELICA_NODE_CACHE_MAX_ENTRIES 256U
+#define FELICA_NODE_CACHE_MAX_NODES 2048U
 #define FELICA_MAX_NODE_NUMBER 0x03FFU
 #define FELICA_LITE_NODE_DISCOVERY_MAX_NODE_NUMBER 16U
 #define FELICA_PRESENCE_SERVICE_CODE_LE ((uint16_t)FELICA_SERVICE_ATTRIBUTE_RANDOM_RO_WITHOUT_KEY)
@@ -2522,11 +2529,12 @@ static int CmdHFFelicaSeacInfo(const char *Cmd) {
 }
 
 /**
- * Clears command buffer and sends the given data to pm3 with NG mode.
+ * Sends the given data to pm3 with NG mode, without dropping queued answers.
+ * Callers keeping several frames in flight use this directly.
  */
-static void clear_and_send_command_ex(uint8_t flags, uint16_t datalen, uint8_t *data, uint16_t numbits, bool verbose, bool normalize_frame) {
+static void send_command_ex(uint8_t flags, uint16_t datalen, const uint8_t *data, uint16_t numbits, bool verbose, bool normalize_frame) {
     uint16_t payload_len = 0;
-    uint8_t *payload = data;
+    const uint8_t *payload = data;
 
     // ARMSRC implementation adds FeliCa preamble and length automatically (felica_sendraw:575-576)
     // A bunch of code in this module adds length byte at data[0] regardless of that, which is wrong
@@ -2546,7 +2554,6 @@ static void clear_and_send_command_ex(uint8_t flags, uint16_t datalen, uint8_t *
         payload_len = datalen;
     }
 
-    clearCommandBuffer();
     if (verbose) {
         PrintAndLogEx(INFO, "Send raw command - Frame: %s", sprint_hex(payload, payload_len));
     }
@@ -2563,6 +2570,14 @@ static void clear_and_send_command_ex(uint8_t flags, uint16_t datalen, uint8_t *
     SendCommandNG(CMD_HF_FELICA_COMMAND, packet_buf, FELICA_RAW_LEN(payload_len));
 }
 
+/**
+ * Clears command buffer and sends the given data to pm3 with NG mode.
+ */
+static void clear_and_send_command_ex(uint8_t flags, uint16_t datalen, uint8_t *data, uint16_t numbits, bool verbose, bool normalize_frame) {
+    clearCommandBuffer();
+    send_command_ex(flags, datalen, data, numbits, verbose, normalize_frame);
+}
+
 static void clear_and_send_command(uint8_t flags, uint16_t datalen, uint8_t *data, bool verbose) {
     clear_and_send_command_ex(flags, datalen, data, 0, verbose, true);
 }
@@ -3243,62 +3258,118 @@ static bool felica_discover_nodes_with_request_code_list(uint8_t *flags,
     return supported;
 }
 
-static bool felica_discover_nodes_with_search_service_code(uint8_t *flags,
-                                                           const uint8_t *idm,
-                                                           uint32_t retry_count,
-                                                           felica_node_discovery_visitor_t visitor,
-                                                           void *ctx,
-                                                           uint32_t *discovered_count,
-                                                           int *stop_status) {
+static bool felica_search_service_code_reply_ok(const PacketResponseNG *resp) {
+    if (resp->length < sizeof(felica_frame_response_noidm_t)) {
+        return false;
+    }
+    const felica_frame_response_noidm_t *frame_response = (const felica_frame_response_noidm_t *)resp->data.asBytes;
+    return (frame_response->cmd_code[0] == FELICA_SRCHSYSCODE_ACK);
+}
+
+// Collects the answers of requests still in flight, so they can't be taken for later ones.
+static void felica_drain_pipeline(uint32_t in_flight) {
+    PacketResponseNG resp;
+    while (in_flight--) {
+        if (WaitForResponseTimeout(CMD_HF_FELICA_COMMAND, &resp, FELICA_DEFAULT_TIMEOUT_MS) == false) {
+            break;
+        }
+    }
+    clearCommandBuffer();
+}
+
+/**
+ * Walks Search Service Code from index `start` until the system node.
+ * The first exchange goes alone, so the card gets probed and connected with the caller flags.
+ * Afterwards up to FELICA_SEARCH_SERVICE_CODE_PIPELINE requests are kept in flight, the
+ * pm3 answers them in order. A lost answer drains the pipeline and that index is retried
+ * the usual way.
+ * @param supported true if the card already answered, updated on the first answer.
+ */
+static bool felica_search_service_code_walk(uint8_t *flags,
+                                            const uint8_t *idm,
+                                            uint32_t retry_count,
+                                            uint32_t start,
+                                            bool *supported,
+                                            felica_node_discovery_visitor_t visitor,
+                                            void *ctx,
+                                            uint32_t *discovered_count,
+                                            int *stop_status) {
 
     uint8_t data[12] = {0};
     data[0] = sizeof(data);
     data[1] = FELICA_SRCHSYSCODE_REQ;
     memcpy(data + 2, idm, 8);
 
-    bool supported = false;
-    uint32_t local_count = 0;
+    uint32_t next_send = start;
+    uint32_t in_flight = 0;
 
-    for (uint32_t cursor = 0; cursor <= 0xFFFFU; cursor++) {
+    for (uint32_t cursor = start; cursor <= 0xFFFFU; cursor++) {
         if (felica_discovery_aborted(stop_status)) {
-            felica_set_discovered_count(discovered_count, local_count);
+            felica_drain_pipeline(in_flight);
             return false;
         }
 
-        data[10] = cursor & 0xFF;
-        data[11] = (cursor >> 8) & 0xFF;
+        PacketResponseNG resp;
+        bool got_answer = false;
 
-        felica_search_service_code_response_t resp;
-        if (send_search_service_code(*flags, sizeof(data), data, false,
-                                     FELICA_DEFAULT_TIMEOUT_MS, retry_count,
-                                     supported ? FELICA_DISCOVERY_RETRY_BACKOFF_MS : 0,
-                                     supported,
-                                     &resp) != PM3_SUCCESS) {
-            felica_set_discovered_count(discovered_count, local_count);
-            return false;
+        if (*supported) {
+            if (in_flight == 0) {
+                clearCommandBuffer();
+                next_send = cursor;
+            }
+            while (in_flight < FELICA_SEARCH_SERVICE_CODE_PIPELINE && next_send <= 0xFFFFU) {
+                data[10] = next_send & 0xFF;
+                data[11] = (next_send >> 8) & 0xFF;
+                send_command_ex(*flags, sizeof(data), data, 0, false, true);
+                next_send++;
+                in_flight++;
+            }
+
+            got_answer = waitCmdFelicaEx(false, &resp, false, false, FELICA_DEFAULT_TIMEOUT_MS) &&
+                         felica_search_service_code_reply_ok(&resp);
+            in_flight--;
+            if (got_answer == false) {
+                felica_drain_pipeline(in_flight);
+                in_flight = 0;
+            }
         }
 
-        if (supported == false) {
-            supported = true;
-            felica_print_node_discovery_method_used(FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE);
+        felica_search_service_code_response_t ssc_resp;
+        if (got_answer) {
+            memcpy(&ssc_resp, resp.data.asBytes, sizeof(ssc_resp));
+        } else {
+            data[10] = cursor & 0xFF;
+            data[11] = (cursor >> 8) & 0xFF;
+            if (send_search_service_code(*flags, sizeof(data), data, false,
+                                         FELICA_DEFAULT_TIMEOUT_MS, retry_count,
+                                         *supported ? FELICA_DISCOVERY_RETRY_BACKOFF_MS : 0,
+                                         *supported,
+                                         &ssc_resp) != PM3_SUCCESS) {
+                return false;
+            }
+
+            if (*supported == false) {
+                *supported = true;
+                felica_print_node_discovery_method_used(FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE);
+            }
+            felica_drop_connect_flag(flags);
         }
-        felica_drop_connect_flag(flags);
 
-        const uint8_t frame_len = resp.frame_response.length[0];
+        const uint8_t frame_len = ssc_resp.frame_response.length[0];
         if (frame_len != 0x0C && frame_len != 0x0E) {
-            felica_set_discovered_count(discovered_count, local_count);
+            felica_drain_pipeline(in_flight);
             return false;
         }
 
-        const uint16_t node_code_le = (uint16_t)resp.payload[0] | ((uint16_t)resp.payload[1] << 8);
+        const uint16_t node_code_le = (uint16_t)ssc_resp.payload[0] | ((uint16_t)ssc_resp.payload[1] << 8);
         felica_discovered_node_t node = {0};
         node.node_code_le = node_code_le;
         node.type = felica_node_type_from_code(node_code_le);
         node.has_end_code = (node.type == FELICA_NODE_TYPE_AREA && frame_len == 0x0E);
-        node.end_code_le = node.has_end_code ? ((uint16_t)resp.payload[2] | ((uint16_t)resp.payload[3] << 8)) : 0;
+        node.end_code_le = node.has_end_code ? ((uint16_t)ssc_resp.payload[2] | ((uint16_t)ssc_resp.payload[3] << 8)) : 0;
 
-        if (felica_emit_discovered_node(&node, visitor, ctx, &local_count, stop_status) != PM3_SUCCESS) {
-            felica_set_discovered_count(discovered_count, local_count);
+        if (felica_emit_discovered_node(&node, visitor, ctx, discovered_count, stop_status) != PM3_SUCCESS) {
+            felica_drain_pipeline(in_flight);
             return false;
         }
 
@@ -3307,9 +3378,28 @@ static bool felica_discover_nodes_with_search_service_code(uint8_t *flags,
         }
     }
 
+    // requests sent past the system node
+    felica_drain_pipeline(in_flight);
+    return true;
+}
+
+static bool felica_discover_nodes_with_search_service_code(uint8_t *flags,
+                                                           const uint8_t *idm,
+                                                           uint32_t retry_count,
+                                                           felica_node_discovery_visitor_t visitor,
+                                                           void *ctx,
+                                                           uint32_t *discovered_count,
+                                                           int *stop_status) {
+
+    bool supported = false;
+    uint32_t local_count = 0;
+
+    bool done = felica_search_service_code_walk(flags, idm, retry_count, 0, &supported,
+                                                visitor, ctx, &local_count, stop_status);
+
     felica_set_discovered_count(discovered_count, local_count);
 
-    return supported;
+    return done && supported;
 }
 
 static bool felica_request_service_send_probe_batch(uint8_t *flags,
@@ -3598,11 +3688,494 @@ static int felica_parse_node_discovery_method(const char *method_str, felica_nod
     return PM3_EINVARG;
 }
 
+/*
+ * Node layouts seen before, kept in ~/.proxmark3/felica_nodes.json.
+ *
+ * Only Search Service Code layouts are stored, since for those a rescan can prove the
+ * layout unchanged without walking it again: one Request Service per 32 nodes confirms
+ * every known node still exists (and gives its key version), and Search Service Code at
+ * the index of the system node confirms nothing was added. Nodes appended at the end are
+ * picked up from there, anything else falls back to a full discovery.
+ *
+ * A card is looked up by IDm first. Failing that, a layout from another card with the
+ * same PMm and system code is tried, cards of one issuer and batch share their layout.
+ */
+typedef struct {
+    felica_discovered_node_t *nodes;
+    uint16_t *key_versions_le;  // 0xFFFF when not known
+    size_t count;
+    size_t capacity;
+} felica_node_list_t;
+
+typedef struct {
+    uint8_t idm[8];
+    uint8_t pmm[8];
+    uint16_t system_code;       // FELICA_SYSTEM_CODE_WILDCARD when not known
+    int64_t used;               // last use, seconds since epoch
+    felica_node_list_t list;    // system node last
+} felica_node_cache_entry_t;
+
+typedef struct {
+    felica_node_discovery_visitor_t visitor;
+    void *ctx;
+    felica_node_list_t list;
+    bool overflow;              // more nodes than a layout may hold
+} felica_node_recorder_t;
+
+static felica_node_cache_entry_t felica_node_cache[FELICA_NODE_CACHE_MAX_ENTRIES];
+static size_t felica_node_cache_count = 0;
+static bool felica_node_cache_loaded = false;
+
+static void felica_node_list_free(felica_node_list_t *list) {
+    free(list->nodes);
+    free(list->key_versions_le);
+    memset(list, 0, sizeof(*list));
+}
+
+static bool felica_node_list_append(felica_node_list_t *list, const felica_discovered_node_t *node, uint16_t key_version_le) {
+    if (list->count == list->capacity) {
+        if (list->capacity >= FELICA_NODE_CACHE_MAX_NODES) {
+            return false;
+        }
+        size_t capacity = (list->capacity) ? list->capacity * 2 : 64;
+        felica_discovered_node_t *nodes = realloc(list->nodes, capacity * sizeof(*nodes));
+        if (nodes == NULL) {
+            return false;
+        }
+        list->nodes = nodes;
+        uint16_t *key_versions = realloc(list->key_versions_le, capacity * sizeof(*key_versions));
+        if (key_versions == NULL) {
+            return false;
+        }
+        list->key_versions_le = key_versions;
+        list->capacity = capacity;
+    }
+    list->nodes[list->count] = *node;
+    list->key_versions_le[list->count] = key_version_le;
+    list->count++;
+    return true;
+}
+
+static bool felica_node_list_copy(felica_node_list_t *dst, const felica_node_list_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    for (size_t i = 0; i < src->count; i++) {
+        if (felica_node_list_append(dst, &src->nodes[i], src->key_versions_le[i]) == false) {
+            felica_node_list_free(dst);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool felica_node_list_contains(const felica_node_list_t *list, uint16_t node_code_le) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->nodes[i].node_code_le == node_code_le) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int felica_node_recorder_visitor(const felica_discovered_node_t *node, void *ctx) {
+    felica_node_recorder_t *rec = (felica_node_recorder_t *)ctx;
+    if (rec->overflow == false && felica_node_list_append(&rec->list, node, 0xFFFF) == false) {
+        rec->overflow = true;
+    }
+    if (rec->visitor == NULL) {
+        return PM3_SUCCESS;
+    }
+    return rec->visitor(node, rec->ctx);
+}
+
+/**
+ * Reads the key versions of list nodes from index `from`, FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE per frame.
+ * @return false if the card didn't answer or a node other than the system node is missing.
+ */
+static bool felica_node_list_read_key_versions(uint8_t *flags, const uint8_t *idm, uint32_t retry_count,
+                                               felica_node_list_t *list, size_t from, size_t *changed) {
+    for (size_t i = from; i < list->count; i += FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE) {
+        size_t n = list->count - i;
+        if (n > FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE) {
+            n = FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE;
+        }
+
+        uint16_t codes[FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE];
+        uint16_t key_versions[FELICA_REQUEST_SERVICE_DISCOVERY_BATCH_SIZE];
+        for (size_t j = 0; j < n; j++) {
+            codes[j] = list->nodes[i + j].node_code_le;
+        }
+
+        size_t returned = 0;
+        if (felica_request_service_key_versions(*flags, idm, codes, n, retry_count, key_versions, &returned) != PM3_SUCCESS ||
+                returned != n) {
+            return false;
+        }
+        felica_drop_connect_flag(flags);
+
+        for (size_t j = 0; j < n; j++) {
+            if (key_versions[j] == 0xFFFF && list->nodes[i + j].type != FELICA_NODE_TYPE_SYSTEM) {
+                PrintAndLogEx(INFO, "Node " _YELLOW_("%04X") " of the cached layout is gone",
+                              felica_to_network_order(codes[j]));
+                return false;
+            }
+            uint16_t *kv = &list->key_versions_le[i + j];
+            if (changed && *kv != 0xFFFF && *kv != key_versions[j]) {
+                (*changed)++;
+            }
+            *kv = key_versions[j];
+        }
+    }
+    return true;
+}
+
+static bool felica_node_cache_parse_entry(const json_t *obj, felica_node_cache_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+
+    const char *idm = felica_get_json_string(obj, "idm");
+    const char *pmm = felica_get_json_string(obj, "pmm");
+    const char *system = felica_get_json_string(obj, "system");
+    const char *nodes = felica_get_json_string(obj, "nodes");
+    const char *keys = felica_get_json_string(obj, "keys");
+    if (idm == NULL || pmm == NULL || system == NULL || nodes == NULL || keys == NULL) {
+        return false;
+    }
+
+    if (hex_to_bytes(idm, entry->idm, sizeof(entry->idm)) != sizeof(entry->idm) ||
+            hex_to_bytes(pmm, entry->pmm, sizeof(entry->pmm)) != sizeof(entry->pmm)) {
+        return false;
+    }
+    entry->system_code = (uint16_t)strtoul(system, NULL, 16);
+    entry->used = json_integer_value(json_object_get(obj, "used"));
+
+    // "0000-FFFE 1008 100B ... FFFF", node codes as stored on the card, area end codes after a dash
+    const char *p = nodes;
+    const char *k = keys;
+    while (*p) {
+        char *end = NULL;
+        felica_discovered_node_t node = {0};
+        node.node_code_le = (uint16_t)strtoul(p, &end, 16);
+        if (end == p) {
+            break;
+        }
+        node.type = felica_node_type_from_code(node.node_code_le);
+        if (*end == '-') {
+            p = end + 1;
+            node.has_end_code = true;
+            node.end_code_le = (uint16_t)strtoul(p, &end, 16);
+        }
+        p = end;
+
+        uint16_t key_version = (uint16_t)strtoul(k, &end, 16);
+        if (end == k) {
+            key_version = 0xFFFF;
+        }
+        k = end;
+
+        if (felica_node_list_append(&entry->list, &node, key_version) == false) {
+            break;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+    }
+
+    if (entry->list.count == 0 || *p != '\0' ||
+            entry->list.nodes[entry->list.count - 1].type != FELICA_NODE_TYPE_SYSTEM) {
+        felica_node_list_free(&entry->list);
+        return false;
+    }
+    return true;
+}
+
+static void felica_node_cache_load(void) {
+    if (felica_node_cache_loaded) {
+        return;
+    }
+    felica_node_cache_loaded = true;
+
+    if (g_session.incognito) {
+        return;
+    }
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, FELICA_NODE_CACHE_FILE, false) != PM3_SUCCESS) {
+        return;
+    }
+    if (fileExists(path) == false) {
+        free(path);
+        return;
+    }
+
+    json_error_t error;
+    json_t *root = json_load_file(path, 0, &error);
+    if (root == NULL) {
+        PrintAndLogEx(WARNING, "Failed to parse `%s` line %d: %s", path, error.line, error.text);
+        free(path);
+        return;
+    }
+    free(path);
+
+    const json_t *cards = json_object_get(root, "cards");
+    if (json_integer_value(json_object_get(root, "version")) == FELICA_NODE_CACHE_VERSION && json_is_array(cards)) {
+        size_t i;
+        json_t *obj;
+        json_array_foreach(cards, i, obj) {
+            if (felica_node_cache_count == FELICA_NODE_CACHE_MAX_ENTRIES) {
+                break;
+            }
+            if (felica_node_cache_parse_entry(obj, &felica_node_cache[felica_node_cache_count])) {
+                felica_node_cache_count++;
+            }
+        }
+    }
+    json_decref(root);
+}
+
+static void felica_node_cache_save(void) {
+    if (g_session.incognito) {
+        return;
+    }
+
+    json_t *root = json_object();
+    json_t *cards = json_array();
+    json_object_set_new(root, "version", json_integer(FELICA_NODE_CACHE_VERSION));
+    json_object_set_new(root, "cards", cards);
+
+    for (size_t i = 0; i < felica_node_cache_count; i++) {
+        const felica_node_cache_entry_t *entry = &felica_node_cache[i];
+
+        // " XXXX-XXXX" and " XXXX" per node
+        const size_t nodes_size = (entry->list.count * 10) + 1;
+        const size_t keys_size = (entry->list.count * 5) + 1;
+        char *nodes = calloc(nodes_size, sizeof(char));
+        char *keys = calloc(keys_size, sizeof(char));
+        if (nodes == NULL || keys == NULL) {
+            free(nodes);
+            free(keys);
+            break;
+        }
+
+        size_t np = 0, kp = 0;
+        for (size_t j = 0; j < entry->list.count; j++) {
+            const felica_discovered_node_t *node = &entry->list.nodes[j];
+            np += snprintf(nodes + np, nodes_size - np, (node->has_end_code) ? "%s%04X-%04X" : "%s%04X",
+                           (j) ? " " : "", node->node_code_le, node->end_code_le);
+            kp += snprintf(keys + kp, keys_size - kp, "%s%04X", (j) ? " " : "", entry->list.key_versions_le[j]);
+        }
+
+        char system[5];
+        snprintf(system, sizeof(system), "%04X", entry->system_code);
+
+        json_t *obj = json_object();
+        json_object_set_new(obj, "idm", json_string(sprint_hex_inrow(entry->idm, sizeof(entry->idm))));
+        json_object_set_new(obj, "pmm", json_string(sprint_hex_inrow(entry->pmm, sizeof(entry->pmm))));
+        json_object_set_new(obj, "system", json_string(system));
+        json_object_set_new(obj, "used", json_integer(entry->used));
+        json_object_set_new(obj, "nodes", json_string(nodes));
+        json_object_set_new(obj, "keys", json_string(keys));
+        json_array_append_new(cards, obj);
+
+        free(nodes);
+        free(keys);
+    }
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, FELICA_NODE_CACHE_FILE, true) == PM3_SUCCESS) {
+        if (json_dump_file(root, path, JSON_INDENT(2)) != 0) {
+            PrintAndLogEx(WARNING, "Failed to save FeliCa node cache to `%s`", path);
+        }
+        free(path);
+    }
+    json_decref(root);
+}
+
+static felica_node_cache_entry_t *felica_node_cache_find(const uint8_t *idm, const uint8_t *pmm, uint16_t system_code) {
+    felica_node_cache_load();
+
+    for (size_t i = 0; i < felica_node_cache_count; i++) {
+        if (memcmp(felica_node_cache[i].idm, idm, sizeof(felica_node_cache[i].idm)) == 0) {
+            return &felica_node_cache[i];
+        }
+    }
+
+    if (pmm == NULL || system_code == FELICA_SYSTEM_CODE_WILDCARD) {
+        return NULL;
+    }
+
+    felica_node_cache_entry_t *family = NULL;
+    for (size_t i = 0; i < felica_node_cache_count; i++) {
+        felica_node_cache_entry_t *entry = &felica_node_cache[i];
+        if (entry->system_code == system_code && memcmp(entry->pmm, pmm, sizeof(entry->pmm)) == 0 &&
+                (family == NULL || entry->used > family->used)) {
+            family = entry;
+        }
+    }
+    return family;
+}
+
+// Takes over the list, replacing the entry of this IDm or the least recently used one.
+static void felica_node_cache_store(const uint8_t *idm, const uint8_t *pmm, uint16_t system_code, felica_node_list_t *list) {
+    felica_node_cache_load();
+
+    felica_node_cache_entry_t *entry = NULL;
+    for (size_t i = 0; i < felica_node_cache_count; i++) {
+        if (memcmp(felica_node_cache[i].idm, idm, sizeof(felica_node_cache[i].idm)) == 0) {
+            entry = &felica_node_cache[i];
+            break;
+        }
+    }
+
+    if (entry == NULL && felica_node_cache_count < FELICA_NODE_CACHE_MAX_ENTRIES) {
+        entry = &felica_node_cache[felica_node_cache_count++];
+    }
+
+    if (entry == NULL) {
+        entry = &felica_node_cache[0];
+        for (size_t i = 1; i < felica_node_cache_count; i++) {
+            if (felica_node_cache[i].used < entry->used) {
+                entry = &felica_node_cache[i];
+            }
+        }
+    }
+
+    felica_node_list_free(&entry->list);
+    memcpy(entry->idm, idm, sizeof(entry->idm));
+    if (pmm) {
+        memcpy(entry->pmm, pmm, sizeof(entry->pmm));
+    } else {
+        memset(entry->pmm, 0, sizeof(entry->pmm));
+    }
+    entry->system_code = system_code;
+    entry->used = (int64_t)time(NULL);
+    entry->list = *list;
+    memset(list, 0, sizeof(*list));
+
+    felica_node_cache_save();
+}
+
+/**
+ * Checks a cached layout against the card and replays it to the visitor.
+ * @return PM3_SUCCESS if the layout got replayed, PM3_ENODATA if there's no usable layout
+ * and a full discovery is needed, or the status the visitor stopped with.
+ */
+static int felica_discover_nodes_from_cache(const uint8_t *idm, const uint8_t *pmm, uint16_t system_code,
+                                            uint8_t *flags, uint32_t retry_count,
+                                            felica_node_discovery_visitor_t visitor, void *ctx,
+                                            uint32_t *discovered_count) {
+
+    const felica_node_cache_entry_t *entry = felica_node_cache_find(idm, pmm, system_code);
+    if (entry == NULL) {
+        return PM3_ENODATA;
+    }
+    const bool same_card = (memcmp(entry->idm, idm, sizeof(entry->idm)) == 0);
+
+    felica_node_list_t list;
+    if (felica_node_list_copy(&list, &entry->list) == false) {
+        return PM3_ENODATA;
+    }
+
+    size_t changed = 0;
+    if (felica_node_list_read_key_versions(flags, idm, retry_count, &list, 0, (same_card) ? &changed : NULL) == false) {
+        felica_node_list_free(&list);
+        return PM3_ENODATA;
+    }
+
+    // all known nodes are there, whatever answers at the index of the system node is new
+    felica_node_recorder_t added;
+    memset(&added, 0, sizeof(added));
+    bool supported = true;
+    int stop_status = PM3_SUCCESS;
+    bool walked = felica_search_service_code_walk(flags, idm, retry_count, (uint32_t)(list.count - 1), &supported,
+                                                  felica_node_recorder_visitor, &added, NULL, &stop_status);
+    if (walked == false || added.overflow || added.list.count == 0) {
+        felica_node_list_free(&added.list);
+        felica_node_list_free(&list);
+        return (stop_status == PM3_EOPABORTED) ? stop_status : PM3_ENODATA;
+    }
+
+    const size_t known = list.count - 1;
+    const size_t extra = added.list.count - 1;
+    if (extra) {
+        // only nodes added behind the known ones keep the order right
+        for (size_t i = 0; i < extra; i++) {
+            if (felica_node_list_contains(&list, added.list.nodes[i].node_code_le)) {
+                PrintAndLogEx(INFO, "Cached node layout changed, running a full discovery");
+                felica_node_list_free(&added.list);
+                felica_node_list_free(&list);
+                return PM3_ENODATA;
+            }
+        }
+
+        list.count = known;
+        for (size_t i = 0; i < added.list.count; i++) {
+            if (felica_node_list_append(&list, &added.list.nodes[i], 0xFFFF) == false) {
+                felica_node_list_free(&added.list);
+                felica_node_list_free(&list);
+                return PM3_ENODATA;
+            }
+        }
+        if (felica_node_list_read_key_versions(flags, idm, retry_count, &list, known, NULL) == false) {
+            felica_node_list_free(&added.list);
+            felica_node_list_free(&list);
+            return PM3_ENODATA;
+        }
+    }
+    felica_node_list_free(&added.list);
+
+    const char *name = felica_node_discovery_method_display_name(FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE);
+    if (extra) {
+        PrintAndLogEx(INFO, "Node discovery method used: %s, cached layout " _GREEN_("extended") " by %zu node(s)", name, extra);
+    } else {
+        PrintAndLogEx(INFO, "Node discovery method used: %s, cached layout " _GREEN_("verified"), name);
+    }
+    if (same_card == false) {
+        PrintAndLogEx(INFO, "Layout taken from card " _YELLOW_("%s") " with the same PMm", sprint_hex_inrow(entry->idm, sizeof(entry->idm)));
+    }
+    if (changed) {
+        PrintAndLogEx(INFO, "Key versions changed on " _YELLOW_("%zu") " node(s) since the last scan", changed);
+    }
+
+    uint32_t local_count = 0;
+    stop_status = PM3_SUCCESS;
+    for (size_t i = 0; i < list.count; i++) {
+        if (felica_discovery_aborted(&stop_status) ||
+                felica_emit_discovered_node(&list.nodes[i], visitor, ctx, &local_count, &stop_status) != PM3_SUCCESS) {
+            break;
+        }
+    }
+    felica_set_discovered_count(discovered_count, local_count);
+
+    if (stop_status == PM3_SUCCESS) {
+        felica_node_cache_store(idm, pmm, system_code, &list);
+    }
+    felica_node_list_free(&list);
+    return stop_status;
+}
+
+// Keeps a layout found by a full Search Service Code discovery, with the key versions.
+static void felica_node_cache_learn(const uint8_t *idm, const uint8_t *pmm, uint16_t system_code,
+                                    uint8_t *flags, uint32_t retry_count, felica_node_list_t *list) {
+    if (list->count == 0 || list->nodes[list->count - 1].type != FELICA_NODE_TYPE_SYSTEM) {
+        return;
+    }
+    if (felica_node_list_read_key_versions(flags, idm, retry_count, list, 0, NULL) == false) {
+        return;
+    }
+    felica_node_cache_store(idm, pmm, system_code, list);
+}
+
+/**
+ * Discovers the nodes of a system and hands them to the visitor.
+ * @param system_code system polled for, FELICA_SYSTEM_CODE_WILDCARD if not known.
+ * @param use_cache verify a cached layout instead of walking it, and keep what gets found.
+ */
 static int felica_discover_nodes(const uint8_t *idm,
                                  const uint8_t *pmm,
+                                 uint16_t system_code,
                                  uint8_t *flags,
                                  uint32_t retry_count,
                                  felica_node_discovery_method_t selected_method,
+                                 bool use_cache,
                                  felica_node_discovery_visitor_t visitor,
                                  void *ctx,
                                  felica_node_discovery_method_t *method_out,
@@ -3618,50 +4191,77 @@ static int felica_discover_nodes(const uint8_t *idm,
 
     uint32_t discovered_count = 0;
     const bool auto_mode = (selected_method == FELICA_NODE_DISCOVERY_NONE);
+
+    // only Search Service Code layouts are cached
+    use_cache = use_cache && (auto_mode || selected_method == FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE);
+    if (use_cache) {
+        int ret = felica_discover_nodes_from_cache(idm, pmm, system_code, flags, retry_count,
+                                                   visitor, ctx, &discovered_count);
+        if (ret != PM3_ENODATA) {
+            *out_method = FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE;
+            *out_count = discovered_count;
+            return ret;
+        }
+    }
+
+    felica_node_recorder_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.visitor = visitor;
+    rec.ctx = ctx;
+
+    int ret = PM3_ERFTRANS;
+    *out_method = FELICA_NODE_DISCOVERY_NONE;
+    *out_count = 0;
     for (size_t i = 0; i < ARRAYLEN(FELICA_NODE_DISCOVERY_METHODS); i++) {
         const felica_node_discovery_method_info_t *info = &FELICA_NODE_DISCOVERY_METHODS[i];
         if (!auto_mode && selected_method != info->method) {
             continue;
         }
 
+        const bool record = use_cache && (info->method == FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE);
+        felica_node_discovery_visitor_t method_visitor = (record) ? felica_node_recorder_visitor : visitor;
+        void *method_ctx = (record) ? (void *)&rec : ctx;
+
         discovered_count = 0;
         int stop_status = PM3_SUCCESS;
         bool discovered = false;
         if (info->method == FELICA_NODE_DISCOVERY_READ_WITHOUT_ENCRYPTION) {
             discovered = felica_discover_nodes_with_read_without_encryption_ex(flags, idm, retry_count, pmm,
-                         visitor, ctx, &discovered_count, &stop_status);
+                         method_visitor, method_ctx, &discovered_count, &stop_status);
         } else {
-            discovered = info->run(flags, idm, retry_count, visitor, ctx, &discovered_count, &stop_status);
+            discovered = info->run(flags, idm, retry_count, method_visitor, method_ctx, &discovered_count, &stop_status);
         }
 
         if (discovered) {
             *out_method = info->method;
             *out_count = discovered_count;
-            return PM3_SUCCESS;
+            if (record && rec.overflow == false) {
+                felica_node_cache_learn(idm, pmm, system_code, flags, retry_count, &rec.list);
+            }
+            ret = PM3_SUCCESS;
+            break;
         }
 
         if (stop_status != PM3_SUCCESS) {
             *out_method = info->method;
             *out_count = discovered_count;
-            return stop_status;
+            ret = stop_status;
+            break;
         }
 
         if (discovered_count > 0) {
             *out_method = info->method;
             *out_count = discovered_count;
-            return PM3_ERFTRANS;
+            break;
         }
 
         if (!auto_mode) {
-            *out_method = FELICA_NODE_DISCOVERY_NONE;
-            *out_count = discovered_count;
-            return PM3_ERFTRANS;
+            break;
         }
     }
 
-    *out_method = FELICA_NODE_DISCOVERY_NONE;
-    *out_count = 0;
-    return PM3_ERFTRANS;
+    felica_node_list_free(&rec.list);
+    return ret;
 }
 
 static bool felica_format_service_attribute(uint16_t service_code_le, char *attrib_str, size_t attrib_str_size) {
@@ -4479,6 +5079,7 @@ static int felica_dump_discovery_visitor(const felica_discovered_node_t *node, v
 static int felica_dump_single_system(const felica_discovered_system_t *system,
                                      felica_dump_system_t *dump_system,
                                      uint32_t retry_count,
+                                     bool use_cache,
                                      uint32_t *discovered_nodes_out,
                                      uint32_t *service_count_out,
                                      uint32_t *public_service_count_out) {
@@ -4529,8 +5130,8 @@ static int felica_dump_single_system(const felica_discovered_system_t *system,
     dump_ctx.block_frame[14] = 0x80;
 
     uint32_t discovered_nodes = 0;
-    int ret = felica_discover_nodes(idm, pmm, &flags, retry_count,
-                                    FELICA_NODE_DISCOVERY_NONE,
+    int ret = felica_discover_nodes(idm, pmm, system->system_code, &flags, retry_count,
+                                    FELICA_NODE_DISCOVERY_NONE, use_cache,
                                     felica_dump_discovery_visitor, &dump_ctx,
                                     NULL, &discovered_nodes);
 
@@ -5587,13 +6188,15 @@ static int CmdHFFelicaDump(const char *Cmd) {
                   "hf felica dump\n"
                   "hf felica dump --retry 5\n"
                   "hf felica dump --idm 11100910C11BC407\n"
-                  "hf felica dump -f my-felica-dump");
+                  "hf felica dump -f my-felica-dump\n"
+                  "hf felica dump --no-cache");
     void *argtable[] = {
         arg_param_begin,
         arg_lit0(NULL, "no-auth", "read public services"),
         arg_u64_0("r", "retry", "<dec>", "number of retries"),
         arg_str0(NULL, "idm", "<hex>", "use custom IDm"),
         arg_str0("f", "file", "<fn>", "Specify a filename for JSON dump file"),
+        arg_lit0(NULL, "no-cache", "don't use or update the node layout cache"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -5604,6 +6207,7 @@ static int CmdHFFelicaDump(const char *Cmd) {
     char filename[FILE_PATH_SIZE] = {0};
     int fnlen = 0;
     CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool use_cache = (arg_get_lit(ctx, 5) == false);
     CLIParserFree(ctx);
     if (res) {
         return PM3_EINVARG;
@@ -5646,7 +6250,7 @@ static int CmdHFFelicaDump(const char *Cmd) {
         uint32_t public_service_count = 0;
         felica_dump_system_t *dump_system = &dump_systems[dump_system_count];
         const int ret = felica_dump_single_system(&discovered_systems.systems[i], dump_system,
-                                                  retry_count, &discovered_nodes, &service_count, &public_service_count);
+                                                  retry_count, use_cache, &discovered_nodes, &service_count, &public_service_count);
 
         if (ret == PM3_EOPABORTED) {
             DropField();
@@ -5816,12 +6420,14 @@ static int CmdHFFelicaDiscoverNodes(const char *Cmd) {
                   "hf felica discnodes\n"
                   "hf felica discnodes --retry 5\n"
                   "hf felica discnodes --method request_service\n"
-                  "hf felica discnodes --idm 11100910C11BC407");
+                  "hf felica discnodes --idm 11100910C11BC407\n"
+                  "hf felica discnodes --no-cache");
     void *argtable[] = {
         arg_param_begin,
         arg_u64_0("r", "retry", "<dec>", "number of retries"),
         arg_str0("m", "method", "<str>", "node discovery method"),
         arg_str0(NULL, "idm", "<hex>", "use custom IDm"),
+        arg_lit0(NULL, "no-cache", "don't use or update the node layout cache"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -5832,6 +6438,7 @@ static int CmdHFFelicaDiscoverNodes(const char *Cmd) {
     uint8_t idm[8] = {0};
     int ilen = 0;
     int res = CLIParamHexToBuf(arg_get_str(ctx, 3), idm, sizeof(idm), &ilen);
+    bool use_cache = (arg_get_lit(ctx, 4) == false);
     felica_node_discovery_method_t selected_method = FELICA_NODE_DISCOVERY_NONE;
     int method_parse_status = PM3_EINVARG;
     if (method_str_status == PM3_SUCCESS) {
@@ -5865,8 +6472,8 @@ static int CmdHFFelicaDiscoverNodes(const char *Cmd) {
     uint32_t discovered_nodes = 0;
     felica_node_discovery_method_t used_method = FELICA_NODE_DISCOVERY_NONE;
     uint64_t discovery_started = msclock();
-    int ret = felica_discover_nodes(idm, pmm, &flags, retry_count,
-                                    selected_method,
+    int ret = felica_discover_nodes(idm, pmm, FELICA_SYSTEM_CODE_WILDCARD, &flags, retry_count,
+                                    selected_method, use_cache,
                                     felica_scsvcode_discovery_visitor, &scsv_ctx,
                                     &used_method, &discovered_nodes);
     uint64_t discovery_duration_ms = msclock() - discovery_started;
@@ -5939,8 +6546,8 @@ static int CmdHFFelicaDumpServiceArea(const char *Cmd) {
     scsv_ctx.area_end_stack[0] = 0xFFFF;
 
     uint32_t discovered_nodes = 0;
-    int ret = felica_discover_nodes(idm, NULL, &flags, retry_count,
-                                    FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE,
+    int ret = felica_discover_nodes(idm, NULL, FELICA_SYSTEM_CODE_WILDCARD, &flags, retry_count,
+                                    FELICA_NODE_DISCOVERY_SEARCH_SERVICE_CODE, false,
                                     felica_scsvcode_discovery_visitor, &scsv_ctx,
                                     NULL, &discovered_nodes);
 
@@ -42,6 +42,7 @@
 #include "loclass/cipherutils.h"   // BitstreamOut_t
 #include "proxendian.h"
 #include "preferences.h"
+#include "pm3.h"                   // PM3_RECORD_*
 #include "mifare/gen4.h"
 #include "generator.h"              // keygens.
 #include "fpga.h"
@@ -571,6 +572,8 @@ bool mfc_value(const uint8_t *d, int32_t *val) {
 
 void mf_print_block_one(uint8_t blockno, uint8_t *d, bool verbose) {
 
+    PrintAndLogRecord(PM3_RECORD_BLOCK, blockno, 0, 0, d, MFBLOCK_SIZE);
+
     if (blockno == 0) {
         char ascii[24] = {0};
         ascii_to_buffer((uint8_t *)ascii, d, MFBLOCK_SIZE, sizeof(ascii) - 1, 1);
@@ -615,6 +618,8 @@ void mf_print_block_one(uint8_t blockno, uint8_t *d, bool verbose) {
 static void mf_print_block(uint16_t maxblocks, uint8_t blockno, uint8_t *d, bool verbose) {
     uint8_t sectorno = mfSectorNum(blockno);
 
+    PrintAndLogRecord(PM3_RECORD_BLOCK, blockno, 0, 0, d, MFBLOCK_SIZE);
+
     char secstr[6] = "     ";
     if (mfFirstBlockOfSector(sectorno) == blockno) {
         sprintf(secstr, " %3d ", sectorno);
@@ -953,6 +958,56 @@ static int mfc_read_tag(iso14a_card_select_t *card, uint8_t *carddata, uint8_t n
         return PM3_ELENGTH;
     }
 
+    // firmware side dump, one command for the whole card
+    uint16_t readmask[MIFARE_4K_MAXSECTOR] = {0};
+    uint8_t first_sector = 0;
+    int res = mf_read_card(numSectors, keyA, keyB, carddata, readmask, &first_sector);
+
+    if (res == PM3_EOPABORTED) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(FAILED, "Failed to dump card");
+        free(keyA);
+        free(keyB);
+        return res;
+    }
+
+    if (first_sector) {
+        PrintAndLogEx(NORMAL, "");
+    }
+
+    for (uint8_t sectorNo = 0; sectorNo < first_sector; sectorNo++) {
+        for (uint8_t blockNo = 0; blockNo < mfNumBlocksPerSector(sectorNo); blockNo++) {
+
+            if ((readmask[sectorNo] & (1 << blockNo)) == 0) {
+                PrintAndLogEx(FAILED, "Sector... %2d Block... %2d ( " _RED_("fail") " )", sectorNo, blockNo);
+                continue;
+            }
+
+            if (mfIsSectorTrailerBasedOnBlocks(sectorNo, blockNo)) {
+                // sector trailer. Fill in the keys.
+                uint8_t *data = carddata + (MFBLOCK_SIZE * (mfFirstBlockOfSector(sectorNo) + blockNo));
+                memcpy(data, keyA + (sectorNo * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+                memcpy(data + 10, keyB + (sectorNo * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+            }
+        }
+    }
+
+    if (first_sector == numSectors) {
+        free(keyA);
+        free(keyB);
+
+        if (res == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "Succeeded in dumping all blocks");
+        }
+        return PM3_SUCCESS;
+    }
+
+    // no reply at all means an older firmware, else the dump broke off. Either way the
+    // remaining sectors are read block by block
+    if (first_sector) {
+        PrintAndLogEx(WARNING, "Card dump stopped after sector " _YELLOW_("%u") ", reading the rest block by block", first_sector - 1);
+    }
+
     PrintAndLogEx(INFO, "Reading sector access bits...");
     PrintAndLogEx(INFO, "." NOLF);
 
@@ -961,7 +1016,7 @@ static int mfc_read_tag(iso14a_card_select_t *card, uint8_t *carddata, uint8_t n
     mf_readblock_t payload;
     uint8_t current_key;
 
-    for (uint8_t sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+    for (uint8_t sectorNo = first_sector; sectorNo < numSectors; sectorNo++) {
 
         current_key = MF_KEY_A;
 
@@ -1014,7 +1069,7 @@ static int mfc_read_tag(iso14a_card_select_t *card, uint8_t *carddata, uint8_t n
     PrintAndLogEx(SUCCESS, "Finished reading sector access bits");
     PrintAndLogEx(INFO, "Dumping all blocks from card...");
 
-    for (uint8_t sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+    for (uint8_t sectorNo = first_sector; sectorNo < numSectors; sectorNo++) {
 
         for (uint8_t blockNo = 0; blockNo < mfNumBlocksPerSector(sectorNo); blockNo++) {
 
@@ -2252,12 +2307,16 @@ static int CmdHF14AMfNested(const char *Cmd) { //TODO: single mode broken? can't
         // nested sectors
         bool calibrate = !ignore_static_encrypted;
 
+        // keep the key recovery memory around for all sectors
+        mf_nested_arena_init();
+
         for (trgKeyType = MF_KEY_A; trgKeyType <= MF_KEY_B; ++trgKeyType) {
             for (uint8_t sectorNo = 0; sectorNo < SectorsCnt; ++sectorNo) {
                 for (int i = 0; i < MIFARE_SECTOR_RETRY; i++) {
 
                     while (kbd_enter_pressed()) {
                         PrintAndLogEx(WARNING, "\naborted via keyboard!");
+                        mf_nested_arena_free();
                         return PM3_EOPABORTED;
                     }
 
@@ -2294,11 +2353,13 @@ static int CmdHF14AMfNested(const char *Cmd) { //TODO: single mode broken? can't
                         default :
                             PrintAndLogEx(ERR, "Unknown error\n");
                     }
+                    mf_nested_arena_free();
                     free(e_sector);
                     return PM3_ESOFT;
                 }
             }
         }
+        mf_nested_arena_free();
 
         t1 = msclock() - t1;
         PrintAndLogEx(SUCCESS, "Time in nested " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
@@ -2524,6 +2585,9 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
     // Decryption backup logic for special card 0x009080A2(keyB NT1 dist is 160 & 320, not 161 & 321).
     bool forceDetectDist;
 
+    // keep the key recovery memory around for all sectors
+    mf_nested_arena_init();
+
     // nested sectors
     for (trgKeyType = MF_KEY_A; trgKeyType <= MF_KEY_B; ++trgKeyType) {
         for (uint8_t sectorNo = 0; sectorNo < SectorsCnt; ++sectorNo) {
@@ -2557,11 +2621,13 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
                     default :
                         PrintAndLogEx(ERR, "unknown error.\n");
                 }
+                mf_nested_arena_free();
                 free(e_sector);
                 return PM3_ESOFT;
             }
         }
     }
+    mf_nested_arena_free();
 
     t1 = msclock() - t1;
     PrintAndLogEx(SUCCESS, "time in static nested " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
@@ -5066,6 +5132,14 @@ void printKeyTableEx(size_t sectorscnt, sector_t *e_sector, uint8_t start_sector
             s = i;
         }
 
+        for (uint8_t kt = MF_KEY_A; kt <= MF_KEY_B; kt++) {
+            if (e_sector[i].foundKey[kt]) {
+                uint8_t k[MIFARE_KEY_SIZE];
+                num_to_bytes(e_sector[i].Key[kt], MIFARE_KEY_SIZE, k);
+                PrintAndLogRecord(PM3_RECORD_KEY, s, kt, 0, k, sizeof(k));
+            }
+        }
+
         char extra[24] = {0x00};
         if (sectorscnt == 18 && i > 15) {
             strcat(extra, "( " _MAGENTA_("*") " )");
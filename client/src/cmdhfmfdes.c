@@ -51,6 +51,7 @@
 #include "mifare/mifaredefault.h"
 #include "generator.h"
 #include "mifare/aiddesfire.h"
+#include "rescache.h"
 #include "mifare/prime.h"
 #include "util.h"
 #include "crypto/originality.h"
@@ -2706,42 +2707,29 @@ static int mfdesBruteAIDGeneratorDictionaryInit(mfdes_bruteaid_generator_diction
     memset(gen, 0, sizeof(*gen));
     gen->step = step;
 
-    char *path = NULL;
-    int res = searchFile(&path, RESOURCES_SUBDIR, "aid_desfire", ".json", true);
-    if (res != PM3_SUCCESS) {
-        PrintAndLogEx(ERR, "Cannot locate aid_desfire dictionary file");
-        return PM3_EFILE;
-    }
-
-    json_error_t error;
-    json_t *root = json_load_file(path, 0, &error);
-    free(path);
+    json_t *root = rescache_get("aid_desfire", false);
     if (root == NULL) {
-        PrintAndLogEx(ERR, "Failed to load aid_desfire dictionary: line %d: %s", error.line, error.text);
-        return PM3_ESOFT;
+        PrintAndLogEx(ERR, "Failed to load aid_desfire dictionary");
+        return PM3_EFILE;
     }
 
     if (json_is_array(root) == false) {
         PrintAndLogEx(ERR, "Invalid aid_desfire dictionary format (root must be array)");
-        json_decref(root);
         return PM3_ESOFT;
     }
 
     size_t max_count = json_array_size(root);
     if (max_count == 0) {
-        json_decref(root);
         return PM3_SUCCESS;
     }
 
     if (max_count > (SIZE_MAX / (2 * sizeof(uint32_t)))) {
-        json_decref(root);
         return PM3_EMALLOC;
     }
 
     size_t alloc_count = max_count * 2;
     gen->aids = calloc(alloc_count, sizeof(uint32_t));
     if (gen->aids == NULL) {
-        json_decref(root);
         return PM3_EMALLOC;
     }
 
@@ -2803,7 +2791,6 @@ static int mfdesBruteAIDGeneratorDictionaryInit(mfdes_bruteaid_generator_diction
             }
         }
     }
-    json_decref(root);
 
     gen->total_count = (gen->aids_count + step - 1) / step;
     return PM3_SUCCESS;
@@ -7178,6 +7165,11 @@ static int DesfileReadFileAndPrint(DesfireContext_t *dctx,
                 length = maxdatafilelength;
             }
 
+            // whole file, with the size known it can be read in chunks
+            if (filetype == RFTData && length == 0 && offset < fsettings.fileSize) {
+                length = fsettings.fileSize - offset;
+            }
+
             DesfireSetCommMode(dctx, commMode);
 
             if (fsettings.fileCommMode != 0 && noauth)
@@ -7212,7 +7204,7 @@ static int DesfileReadFileAndPrint(DesfireContext_t *dctx,
     size_t resplen = 0;
 
     if (filetype == RFTData) {
-        res = DesfireReadFile(dctx, fnum, offset, length, resp, &resplen);
+        res = DesfireReadFileChunked(dctx, fnum, offset, length, resp, &resplen);
         if (res != PM3_SUCCESS) {
             PrintAndLogEx(ERR, "Desfire ReadFile command " _RED_("error") ". Result: %d", res);
             DropField();
@@ -33,6 +33,7 @@
 #include "amiibo.h"         // amiiboo fcts
 #include "base64.h"
 #include "util_posix.h"     // msclock
+#include "workpool.h"
 #include "fileutils.h"      // saveFile
 #include "cmdtrace.h"       // trace list
 #include "preferences.h"    // setDeviceDebugLevel
@@ -7468,13 +7469,249 @@ static int CmdHF14AMfuList(const char *Cmd) {
     return CmdTraceListAlias(Cmd, "hf 14a", "14a -c");
 }
 
+// batch amiibo processing of a folder of raw dumps
+#define AMIIBO_BATCH_MAX_FILES      8192
+#define AMIIBO_BATCH_MAX_THREADS    64
+// NTAG215 pages 0..129 are covered by the crypto, the rest (locks, CFG, PWD, PACK, signature) is copied
+#define AMIIBO_BATCH_MAX_SIZE       (NFC3D_AMIIBO_SIZE + 52)
+
+typedef enum {
+    AMIIBO_BATCH_VERIFY = 0,
+    AMIIBO_BATCH_DECRYPT,
+    AMIIBO_BATCH_ENCRYPT,
+} amiibo_batch_mode_t;
+
+typedef struct {
+    const char *filename;
+    int res;                // PM3_EFILE unreadable or wrong size, PM3_ESOFT bad signature, PM3_EFAILED not saved
+} amiibo_batch_t;
+
+typedef struct {
+    amiibo_batch_t *items;
+    workpool_t wp;
+    amiibo_batch_mode_t mode;
+    const char *outdir;
+    const nfc3d_amiibo_keys_t *keys;
+    nfc3d_amiibo_keycache_t *cache;
+} amiibo_batch_pool_t;
+
+static void amiibo_batch_file(amiibo_batch_pool_t *pool, amiibo_batch_t *v) {
+
+    uint8_t buf[MFU_DUMP_PREFIX_LENGTH + AMIIBO_BATCH_MAX_SIZE + 1];
+
+    FILE *f = fopen(v->filename, "rb");
+    if (f == NULL) {
+        v->res = PM3_EFILE;
+        return;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    // raw dump, or a pm3 dump with its header
+    size_t offset = 0;
+    if (len > AMIIBO_BATCH_MAX_SIZE) {
+        offset = MFU_DUMP_PREFIX_LENGTH;
+    }
+    if (len < offset + NFC3D_AMIIBO_SIZE || len > offset + AMIIBO_BATCH_MAX_SIZE) {
+        v->res = PM3_EFILE;
+        return;
+    }
+
+    uint8_t out[NFC3D_AMIIBO_SIZE];
+    if (pool->mode == AMIIBO_BATCH_ENCRYPT) {
+        nfc3d_amiibo_pack_ex(pool->keys, pool->cache, buf + offset, out);
+    } else if (nfc3d_amiibo_unpack_ex(pool->keys, pool->cache, buf + offset, out) == false) {
+        v->res = PM3_ESOFT;
+        return;
+    }
+
+    v->res = PM3_SUCCESS;
+    if (pool->outdir == NULL) {
+        return;
+    }
+
+    memcpy(buf + offset, out, sizeof(out));
+
+    char fn[FILE_PATH_SIZE];
+    if (snprintf(fn, sizeof(fn), "%s%s%s", pool->outdir, PATHSEP, path_basename(v->filename)) >= (int)sizeof(fn)) {
+        v->res = PM3_EFAILED;
+        return;
+    }
+    f = fopen(fn, "wb");
+    if (f == NULL) {
+        v->res = PM3_EFAILED;
+        return;
+    }
+    if (fwrite(buf, 1, len, f) != len) {
+        v->res = PM3_EFAILED;
+    }
+    fclose(f);
+}
+
+static int amiibo_batch_cmp(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+static void *amiibo_batch_worker(void *arg) {
+    amiibo_batch_pool_t *pool = arg;
+    uint64_t i, end;
+    while (workpool_claim(&pool->wp, 1, &i, &end)) {
+        amiibo_batch_file(pool, &pool->items[i]);
+    }
+    return NULL;
+}
+
+static int amiibo_batch(const nfc3d_amiibo_keys_t *keys, amiibo_batch_mode_t mode, const char *dir, const char *outdir, int threads, bool verbose) {
+
+    if (outdir && strcmp(dir, outdir) == 0) {
+        PrintAndLogEx(WARNING, "Output folder must differ from the input folder");
+        return PM3_EINVARG;
+    }
+    if (outdir && path_is_directory(outdir) == false) {
+        PrintAndLogEx(ERR, "Can't find folder " _YELLOW_("%s"), outdir);
+        return PM3_EFILE;
+    }
+
+    char *paths = calloc(AMIIBO_BATCH_MAX_FILES, FILE_PATH_SIZE);
+    if (paths == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    size_t dircount = 0;
+    int res = collect_file_paths_recursive(dir, paths, FILE_PATH_SIZE, AMIIBO_BATCH_MAX_FILES, &dircount, false, 0);
+    if (res == PM3_EOVFLOW) {
+        PrintAndLogEx(WARNING, "More than %u files in folder, only processing the first ones", AMIIBO_BATCH_MAX_FILES);
+    } else if (res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "Can't read folder " _YELLOW_("%s"), dir);
+        free(paths);
+        return PM3_EFILE;
+    }
+
+    // keep the bin files only
+    size_t count = 0;
+    for (size_t i = 0; i < dircount; i++) {
+        const char *path = paths + i * FILE_PATH_SIZE;
+        if (str_endswith(path, ".bin")) {
+            memmove(paths + count * FILE_PATH_SIZE, path, FILE_PATH_SIZE);
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        PrintAndLogEx(WARNING, "No bin files found");
+        free(paths);
+        return PM3_EFILE;
+    }
+
+    amiibo_batch_t *items = calloc(count, sizeof(amiibo_batch_t));
+    nfc3d_amiibo_keycache_t *cache = nfc3d_amiibo_keycache_new();
+    if (items == NULL || cache == NULL) {
+        free(items);
+        nfc3d_amiibo_keycache_free(cache);
+        free(paths);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    // sorted, so the listing doesn't depend on the folder order
+    qsort(paths, count, FILE_PATH_SIZE, amiibo_batch_cmp);
+    for (size_t i = 0; i < count; i++) {
+        items[i].filename = paths + i * FILE_PATH_SIZE;
+    }
+
+    threads = MAX(1, MIN(threads, AMIIBO_BATCH_MAX_THREADS));
+    threads = MIN((size_t)threads, count);
+
+    amiibo_batch_pool_t pool = {
+        .items = items,
+        .mode = mode,
+        .outdir = outdir,
+        .keys = keys,
+        .cache = cache,
+    };
+
+    PrintAndLogEx(INFO, "Processing " _YELLOW_("%zu") " file(s) with " _YELLOW_("%d") " thread(s)", count, threads);
+
+    uint64_t t1 = msclock();
+
+    workpool_run(&pool.wp, threads, count, amiibo_batch_worker, &pool, 0);
+
+    t1 = msclock() - t1;
+
+    size_t ok = 0, unreadable = 0, badsig = 0, unsaved = 0;
+    for (size_t i = 0; i < count; i++) {
+        const amiibo_batch_t *v = &items[i];
+        switch (v->res) {
+            case PM3_SUCCESS:
+                ok++;
+                break;
+            case PM3_ESOFT:
+                badsig++;
+                break;
+            case PM3_EFAILED:
+                unsaved++;
+                break;
+            default:
+                unreadable++;
+                break;
+        }
+
+        if (verbose || v->res != PM3_SUCCESS) {
+            const char *state = _GREEN_("ok");
+            if (v->res == PM3_ESOFT) {
+                state = _RED_("signature fail");
+            } else if (v->res == PM3_EFAILED) {
+                state = _RED_("not saved");
+            } else if (v->res != PM3_SUCCESS) {
+                state = _RED_("not an amiibo dump");
+            }
+            PrintAndLogEx(INFO, "%s ( %s )", path_basename(v->filename), state);
+        }
+    }
+
+    uint32_t hits = 0, misses = 0;
+    nfc3d_amiibo_keycache_stats(cache, &hits, &misses);
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "----------------- " _CYAN_("Summary") " -----------------");
+    PrintAndLogEx(INFO, "Files.................. %zu", count);
+    if (mode == AMIIBO_BATCH_ENCRYPT) {
+        PrintAndLogEx(INFO, "Encrypted.............. %zu", ok);
+    } else {
+        PrintAndLogEx(INFO, "Signature ok........... %zu", ok);
+    }
+    if (badsig) {
+        PrintAndLogEx(INFO, "Signature fail......... " _RED_("%zu"), badsig);
+    }
+    if (unreadable) {
+        PrintAndLogEx(INFO, "Unreadable............. " _RED_("%zu"), unreadable);
+    }
+    if (unsaved) {
+        PrintAndLogEx(INFO, "Not saved.............. " _RED_("%zu"), unsaved);
+    }
+    PrintAndLogEx(INFO, "Derived keys........... %u generated, %u cached", misses, hits);
+    PrintAndLogEx(INFO, "Time................... %" PRIu64 " ms", t1);
+    if (outdir) {
+        PrintAndLogEx(INFO, "Saved to............... " _YELLOW_("%s"), outdir);
+    }
+
+    nfc3d_amiibo_keycache_free(cache);
+    free(items);
+    free(paths);
+    return (ok == count) ? PM3_SUCCESS : PM3_ESOFT;
+}
+
 static int CmdHF14AAmiibo(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mfu amiibo",
                   "Tries to read all memory from amiibo tag and decrypt it",
                   "hf mfu amiiboo --dec -f hf-mfu-04579DB27C4880-dump.bin  --> decrypt file\n"
-                  "hf mfu amiiboo -v --dec                                 --> decrypt tag"
+                  "hf mfu amiiboo -v --dec                                 --> decrypt tag\n"
+                  "hf mfu amiibo -d amiibos                                --> check signatures of all bin files in folder\n"
+                  "hf mfu amiibo --dec -d amiibos --outdir plain           --> decrypt all bin files in folder\n"
+                  "hf mfu amiibo --enc -d plain --outdir amiibos           --> encrypt and sign all bin files in folder"
                  );
 
     void *argtable[] = {
@@ -7484,6 +7721,10 @@ static int CmdHF14AAmiibo(const char *Cmd) {
         arg_str0("i", "in", "<fn>", "Specify a filename for input dump file"),
         arg_str0("o", "out", "<fn>", "Specify a filename for output dump file"),
         arg_lit0("v", "verbose", "Verbose output"),
+        arg_str0("k", "key", "<fn>", "Master keys file (def: key_retail.bin)"),
+        arg_str0("d", "dir", "<dir>", "Folder with raw dumps, every bin file is processed"),
+        arg_str0(NULL, "outdir", "<dir>", "Folder for the processed dumps of --dir"),
+        arg_int0("t", "threads", "<dec>", "Number of threads for --dir (def: number of CPUs)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -7500,6 +7741,23 @@ static int CmdHF14AAmiibo(const char *Cmd) {
     CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)outfilename, FILE_PATH_SIZE, &outfnlen);
 
     bool verbose = arg_get_lit(ctx, 5);
+
+    int keyfnlen = 0;
+    char keyfilename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 6), (uint8_t *)keyfilename, FILE_PATH_SIZE, &keyfnlen);
+    if (keyfnlen == 0) {
+        strcpy(keyfilename, "key_retail.bin");
+    }
+
+    int dirlen = 0;
+    char dir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 7), (uint8_t *)dir, FILE_PATH_SIZE, &dirlen);
+
+    int outdirlen = 0;
+    char outdir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 8), (uint8_t *)outdir, FILE_PATH_SIZE, &outdirlen);
+
+    int threads = arg_get_int_def(ctx, 9, num_CPUs());
     CLIParserFree(ctx);
 
     // sanity checks
@@ -7508,13 +7766,38 @@ static int CmdHF14AAmiibo(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    // load keys
+    if (dirlen && infnlen) {
+        PrintAndLogEx(WARNING, "Only specify a file or a folder");
+        return PM3_EINVARG;
+    }
+
+    if (outdirlen && dirlen == 0) {
+        PrintAndLogEx(WARNING, "--outdir needs a --dir");
+        return PM3_EINVARG;
+    }
+
+    if (shall_encrypt && dirlen && outdirlen == 0) {
+        PrintAndLogEx(WARNING, "Encrypting a folder needs an --outdir");
+        return PM3_EINVARG;
+    }
+
+    // load keys, once for all dumps
     nfc3d_amiibo_keys_t amiibo_keys;
-    if (nfc3d_amiibo_load_keys(&amiibo_keys) == false) {
+    if (nfc3d_amiibo_load_keys_ex(&amiibo_keys, keyfilename) == false) {
         PrintAndLogEx(INFO, "loading key file ( " _RED_("fail") " )");
         return PM3_EFILE;
     }
 
+    if (dirlen) {
+        amiibo_batch_mode_t mode = AMIIBO_BATCH_VERIFY;
+        if (shall_decrypt) {
+            mode = AMIIBO_BATCH_DECRYPT;
+        } else if (shall_encrypt) {
+            mode = AMIIBO_BATCH_ENCRYPT;
+        }
+        return amiibo_batch(&amiibo_keys, mode, dir, (outdirlen) ? outdir : NULL, threads, verbose);
+    }
+
     int res = PM3_ESOFT;
 
     uint8_t original[NFC3D_AMIIBO_SIZE] = {0};
@@ -8086,7 +8369,7 @@ static command_t CommandTable[] = {
     {"-----------", CmdHelp,                IfPm3Iso14443a,  "----------------------- " _CYAN_("magic") " ----------------------------"},
     {"setuid",   CmdHF14AMfUCSetUid,        IfPm3Iso14443a,  "Set UID - MAGIC tags only"},
     {"-----------", CmdHelp,                IfPm3Iso14443a,  "----------------------- " _CYAN_("amiibo") " ----------------------------"},
-    {"amiibo",   CmdHF14AAmiibo,            IfPm3Iso14443a,  "Amiibo tag operations"},
+    {"amiibo",   CmdHF14AAmiibo,            AlwaysAvailable, "Amiibo tag operations"},
     {NULL, NULL, NULL, NULL}
 };
 
@@ -44,6 +44,7 @@
 #include "cmdflashmem.h" // get_signature..
 #include "uart/uart.h"   // configure timeout
 #include "util_posix.h"
+#include "jansson.h"
 #include "flash.h" // reboot to bootloader mode
 #include "proxgui.h"
 #include "graph.h" // for graph data
@@ -1592,6 +1593,297 @@ static int CmdPing(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+#define HW_BENCH_WINDOW     4       // commands in flight during the throughput runs
+#define HW_BENCH_TIMEOUT    2000
+#define HW_BENCH_MIX_SIZE   32
+
+typedef struct {
+    uint32_t count;
+    uint64_t min;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t mean;
+} hw_bench_stats_t;
+
+static const uint16_t hw_bench_sizes[] = {32, 64, 128, 256, PM3_CMD_DATA_SIZE};
+#define HW_BENCH_NSIZES ARRAYLEN(hw_bench_sizes)
+
+static const char *hw_bench_transport(void) {
+    if (strncmp(g_conn.serial_port_name, "sim:", 4) == 0) {
+        return "sim";
+    }
+    if (strncmp(g_conn.serial_port_name, "bt:", 3) == 0) {
+        return "bt";
+    }
+    switch (g_conn.send_via_ip) {
+        case PM3_TCPv4:
+        case PM3_TCPv6:
+            return "tcp";
+        case PM3_UDPv4:
+        case PM3_UDPv6:
+            return "udp";
+        case PM3_NONE:
+        default:
+            break;
+    }
+    // BT add-on and other serial links end on the FPC usart of the device
+    return (g_conn.send_via_fpc_usart) ? "usart" : "usb-cdc";
+}
+
+static int hw_bench_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// n ping round trips of len bytes, NG or MIX framed, timed in us
+static int hw_bench_latency(uint16_t len, bool mix, uint32_t n, hw_bench_stats_t *st) {
+
+    uint64_t *us = calloc(n, sizeof(uint64_t));
+    if (us == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint8_t data[PM3_CMD_DATA_SIZE] = {0};
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = i & 0xFF;
+    }
+
+    clearCommandBuffer();
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        PacketResponseNG resp;
+        uint64_t t = usclock();
+        if (mix) {
+            SendCommandMIX(CMD_PING, 0, 0, 0, data, len);
+        } else {
+            SendCommandNG(CMD_PING, data, len);
+        }
+        if (WaitForResponseTimeout(CMD_PING, &resp, HW_BENCH_TIMEOUT) == false) {
+            free(us);
+            return PM3_ETIMEOUT;
+        }
+        us[i] = usclock() - t;
+        sum += us[i];
+        if ((resp.length != len) || (memcmp(data, resp.data.asBytes, len) != 0)) {
+            free(us);
+            return PM3_ESOFT;
+        }
+    }
+
+    qsort(us, n, sizeof(uint64_t), hw_bench_cmp_u64);
+    st->count = n;
+    st->min = us[0];
+    st->p50 = us[((n - 1) * 50) / 100];
+    st->p99 = us[((n - 1) * 99) / 100];
+    st->max = us[n - 1];
+    st->mean = sum / n;
+    free(us);
+    return PM3_SUCCESS;
+}
+
+// n commands of len bytes with up to HW_BENCH_WINDOW in flight.
+// Returns the payload bytes per second in one direction.
+static int hw_bench_stream(uint16_t cmd, uint16_t len, uint32_t n, uint64_t *bps) {
+
+    uint8_t data[PM3_CMD_DATA_SIZE];
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = i & 0xFF;
+    }
+
+    clearCommandBuffer();
+    uint32_t sent = 0, received = 0;
+    uint64_t t = usclock();
+    while (received < n) {
+        while ((sent < n) && (sent - received < HW_BENCH_WINDOW)) {
+            SendCommandNG(cmd, data, len);
+            sent++;
+        }
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(cmd, &resp, HW_BENCH_TIMEOUT) == false) {
+            clearCommandBuffer();
+            return PM3_ETIMEOUT;
+        }
+        if (resp.status != PM3_SUCCESS) {
+            // e.g. PM3_ENOTIMPL, CMD_BENCH on an older firmware
+            clearCommandBuffer();
+            return resp.status;
+        }
+        received++;
+    }
+    t = usclock() - t;
+    *bps = ((uint64_t)len * n * 1000000) / ((t) ? t : 1);
+    return PM3_SUCCESS;
+}
+
+static json_t *hw_bench_stats_json(const hw_bench_stats_t *st) {
+    return json_pack("{s:I, s:I, s:I, s:I, s:I, s:I}",
+                     "count", (json_int_t)st->count,
+                     "min_us", (json_int_t)st->min,
+                     "p50_us", (json_int_t)st->p50,
+                     "p99_us", (json_int_t)st->p99,
+                     "max_us", (json_int_t)st->max,
+                     "mean_us", (json_int_t)st->mean
+                    );
+}
+
+static int CmdBench(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw bench",
+                  "Measure the link between client and Proxmark3, works over USB-CDC, usart / BT, TCP and UDP.\n"
+                  " - round trip latency of an empty ping, min / p50 / p99 / max\n"
+                  " - NG vs MIX framing, same ping payload with and without the 24 bytes of MIX arguments\n"
+                  " - echo (ping) and upload only throughput for different payload sizes\n"
+                  " - download throughput of the BigBuf memory\n"
+                  "Use `--json` to get the results as JSON, to compare links or catch regressions.",
+                  "hw bench\n"
+                  "hw bench -n 500 --json"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", "count", "<dec>", "round trips per measurement (def 100)"),
+        arg_lit0("j", "json", "output results as JSON"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t n = arg_get_u32_def(ctx, 1, 100);
+    bool use_json = arg_get_lit(ctx, 2);
+    CLIParserFree(ctx);
+
+    if (n == 0) {
+        PrintAndLogEx(FAILED, "Count must be at least 1");
+        return PM3_EINVARG;
+    }
+
+    if (use_json == false) {
+        PrintAndLogEx(INFO, "Benchmarking " _YELLOW_("%s") " over " _YELLOW_("%s") ", %u round trips per test", g_conn.serial_port_name, hw_bench_transport(), n);
+    }
+
+    // latency
+    hw_bench_stats_t lat;
+    int res = hw_bench_latency(0, false, n, &lat);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Ping failed ( %d )", res);
+        return res;
+    }
+
+    // framing
+    hw_bench_stats_t ng, mix;
+    res = hw_bench_latency(HW_BENCH_MIX_SIZE, false, n, &ng);
+    if (res == PM3_SUCCESS) {
+        res = hw_bench_latency(HW_BENCH_MIX_SIZE, true, n, &mix);
+    }
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Ping failed ( %d )", res);
+        return res;
+    }
+
+    // throughput per payload size
+    uint64_t echo_bps[HW_BENCH_NSIZES] = {0};
+    uint64_t up_bps[HW_BENCH_NSIZES] = {0};
+    bool have_upload = true;
+    for (size_t i = 0; i < HW_BENCH_NSIZES; i++) {
+        res = hw_bench_stream(CMD_PING, hw_bench_sizes[i], n, &echo_bps[i]);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "Ping failed ( %d )", res);
+            return res;
+        }
+        if (have_upload && hw_bench_stream(CMD_BENCH, hw_bench_sizes[i], n, &up_bps[i]) != PM3_SUCCESS) {
+            have_upload = false;
+        }
+    }
+
+    // download
+    uint32_t dl_len = g_pm3_capabilities.bigbuf_size;
+    uint64_t dl_bps = 0;
+    uint8_t *dl = calloc(dl_len, sizeof(uint8_t));
+    if (dl_len && dl) {
+        uint64_t t = usclock();
+        if (GetFromDevice(BIG_BUF, dl, dl_len, 0, NULL, 0, NULL, HW_BENCH_TIMEOUT * 4, false)) {
+            t = usclock() - t;
+            dl_bps = ((uint64_t)dl_len * 1000000) / ((t) ? t : 1);
+        }
+    }
+    free(dl);
+
+    if (use_json) {
+        json_t *root = json_object();
+        json_object_set_new(root, "port", json_string(g_conn.serial_port_name));
+        json_object_set_new(root, "transport", json_string(hw_bench_transport()));
+        json_object_set_new(root, "latency", hw_bench_stats_json(&lat));
+
+        json_t *framing = json_object();
+        json_object_set_new(framing, "payload", json_integer(HW_BENCH_MIX_SIZE));
+        json_object_set_new(framing, "ng", hw_bench_stats_json(&ng));
+        json_object_set_new(framing, "mix", hw_bench_stats_json(&mix));
+        json_object_set_new(framing, "mix_extra_bytes", json_integer(3 * sizeof(uint64_t)));
+        json_object_set_new(framing, "overhead_p50_us", json_integer((json_int_t)mix.p50 - (json_int_t)ng.p50));
+        json_object_set_new(root, "framing", framing);
+
+        json_t *tp = json_array();
+        for (size_t i = 0; i < HW_BENCH_NSIZES; i++) {
+            json_t *e = json_object();
+            json_object_set_new(e, "payload", json_integer(hw_bench_sizes[i]));
+            json_object_set_new(e, "count", json_integer(n));
+            json_object_set_new(e, "echo_Bps", json_integer((json_int_t)echo_bps[i]));
+            json_object_set_new(e, "upload_Bps", (have_upload) ? json_integer((json_int_t)up_bps[i]) : json_null());
+            json_array_append_new(tp, e);
+        }
+        json_object_set_new(root, "throughput", tp);
+
+        json_t *download = json_object();
+        json_object_set_new(download, "bytes", json_integer(dl_len));
+        json_object_set_new(download, "Bps", (dl_bps) ? json_integer((json_int_t)dl_bps) : json_null());
+        json_object_set_new(root, "download", download);
+
+        char *s = json_dumps(root, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+        json_decref(root);
+        if (s == NULL) {
+            return PM3_EMALLOC;
+        }
+        PrintAndLogEx(NORMAL, "%s", s);
+        free(s);
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Latency") " ( empty ping, us ) ------------");
+    PrintAndLogEx(INFO, "min.... " _YELLOW_("%" PRIu64) "   p50... " _YELLOW_("%" PRIu64) "   p99... " _YELLOW_("%" PRIu64) "   max... " _YELLOW_("%" PRIu64)
+                  , lat.min, lat.p50, lat.p99, lat.max);
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Framing") " ( %u bytes ping, p50 us ) -------", HW_BENCH_MIX_SIZE);
+    PrintAndLogEx(INFO, "NG.... " _YELLOW_("%" PRIu64) "   MIX... " _YELLOW_("%" PRIu64) "   overhead... " _YELLOW_("%" PRId64)
+                  , ng.p50, mix.p50, (int64_t)mix.p50 - (int64_t)ng.p50);
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Throughput") " ( bytes/s ) ---------------");
+    PrintAndLogEx(INFO, " payload |       echo |     upload");
+    PrintAndLogEx(INFO, "---------+------------+-----------");
+    for (size_t i = 0; i < HW_BENCH_NSIZES; i++) {
+        if (have_upload) {
+            PrintAndLogEx(INFO, " %7u | %10" PRIu64 " | %10" PRIu64, hw_bench_sizes[i], echo_bps[i], up_bps[i]);
+        } else {
+            PrintAndLogEx(INFO, " %7u | %10" PRIu64 " |        n/a", hw_bench_sizes[i], echo_bps[i]);
+        }
+    }
+    if (have_upload == false) {
+        PrintAndLogEx(HINT, "Hint: upload needs a firmware with CMD_BENCH, reflash the device");
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    if (dl_bps) {
+        PrintAndLogEx(INFO, "Download.... " _YELLOW_("%" PRIu64) " bytes/s ( %u bytes BigBuf )", dl_bps, dl_len);
+    } else {
+        PrintAndLogEx(WARNING, "Download.... " _RED_("failed"));
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdConnect(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1710,6 +2002,7 @@ static command_t CommandTable[] = {
     {"timeout", CmdTimeout, AlwaysAvailable, "Set the communication timeout on the client side"},
     {"version", CmdVersion, AlwaysAvailable, "Show version information about the client and Proxmark3"},
     {"-------------", CmdHelp, AlwaysAvailable, "----------------------- " _CYAN_("Hardware") " -----------------------"},
+    {"bench", CmdBench, IfPm3Present, "Measure latency and throughput of the connection"},
     {"break", CmdBreak, IfPm3Present, "Send break loop usb command"},
     {"bootloader", CmdBootloader, IfPm3Present, "Reboot into bootloader mode"},
     {"connect", CmdConnect, AlwaysAvailable, "Connect to the device via serial port"},
@@ -18,6 +18,7 @@
 
 #include "cmdlfem4x70.h"
 #include <ctype.h>
+#include <pthread.h>
 #include "cmdparser.h"    // command_t
 #include "cliparser.h"
 #include "fileutils.h"
@@ -25,6 +26,7 @@
 #include "em4x70.h"
 #include "id48.h"
 #include "time.h"
+#include "util.h"       // num_CPUs()
 #include "util_posix.h" // msleep()
 
 #define LOCKBIT_0 BITMASK(6)
@@ -150,6 +152,7 @@ typedef struct _em4x70_cmd_input_recover_t {
 typedef struct _em4x70_cmd_output_recover_t {
     uint8_t potential_key_count;
     ID48LIB_KEY potential_keys[MAXIMUM_ID48_RECOVERED_KEY_COUNT];
+    uint32_t found_key_count; // keys the search found, on overflow only the lowest ones are kept
 } em4x70_cmd_output_recover_t;
 
 typedef struct _em4x70_cmd_input_verify_auth_t {
@@ -384,30 +387,110 @@ static int setpin_em4x70(const em4x70_cmd_input_setpin_t *opts, em4x70_tag_info_
     return resp.status;
 }
 
+// shared by the recovery threads, each thread takes the next K47..K40 value to search
+typedef struct _em4x70_recover_work_t {
+    const em4x70_cmd_input_recover_t *opts;
+    em4x70_cmd_output_recover_t *data_out;
+    pthread_mutex_t lock;
+    uint16_t next_k47_to_k40;
+    bool overflow;
+} em4x70_recover_work_t;
+
+// The list is kept sorted and free of duplicates. When it is full only the lowest keys
+// stay in it, so the result doesn't depend on the order the threads find them in.
+static bool recover_em4x70_found(const ID48LIB_KEY *potential_key, void *user_data) {
+    em4x70_recover_work_t *work = (em4x70_recover_work_t *)user_data;
+    em4x70_cmd_output_recover_t *out = work->data_out;
+
+    pthread_mutex_lock(&work->lock);
+
+    uint8_t pos = 0;
+    int cmp = 1;
+    while (pos < out->potential_key_count && (cmp = memcmp(&out->potential_keys[pos], potential_key, sizeof(ID48LIB_KEY))) < 0) {
+        ++pos;
+    }
+
+    if (pos < out->potential_key_count && cmp == 0) {
+        pthread_mutex_unlock(&work->lock);
+        return true;
+    }
+
+    ++out->found_key_count;
+    if (out->potential_key_count == MAXIMUM_ID48_RECOVERED_KEY_COUNT) {
+        work->overflow = true;
+        if (pos == MAXIMUM_ID48_RECOVERED_KEY_COUNT) {
+            pthread_mutex_unlock(&work->lock);
+            return true;
+        }
+        // drop the highest one
+        --out->potential_key_count;
+    }
+
+    memmove(&out->potential_keys[pos + 1], &out->potential_keys[pos], (out->potential_key_count - pos) * sizeof(ID48LIB_KEY));
+    out->potential_keys[pos] = *potential_key;
+    ++out->potential_key_count;
+
+    pthread_mutex_unlock(&work->lock);
+    return true;
+}
+
+static void *recover_em4x70_worker(void *arg) {
+    em4x70_recover_work_t *work = (em4x70_recover_work_t *)arg;
+
+    for (;;) {
+        uint16_t k47_to_k40 = __atomic_fetch_add(&work->next_k47_to_k40, 1, __ATOMIC_SEQ_CST);
+        if (k47_to_k40 > 0xFF) {
+            break;
+        }
+        id48lib_key_recovery_range(&work->opts->key, &work->opts->nonce, &work->opts->frn, &work->opts->grn,
+                                   (uint8_t)k47_to_k40, (uint8_t)k47_to_k40, recover_em4x70_found, work);
+    }
+    return NULL;
+}
+
 static int recover_em4x70(const em4x70_cmd_input_recover_t *opts, em4x70_cmd_output_recover_t *data_out) {
     memset(data_out, 0, sizeof(em4x70_cmd_output_recover_t));
 
-    // The library is stateful.  First must initialize its internal context.
-    id48lib_key_recovery_init(&opts->key, &opts->nonce, &opts->frn, &opts->grn);
-
-    // repeatedly call id48lib_key_recovery_next() to get the next potential key
-    ID48LIB_KEY q;
-    int result = PM3_SUCCESS;
+    em4x70_recover_work_t work = {
+        .opts = opts,
+        .data_out = data_out,
+        .next_k47_to_k40 = 0,
+        .overflow = false,
+    };
+    pthread_mutex_init(&work.lock, NULL);
 
-    while ((PM3_SUCCESS == result) && id48lib_key_recovery_next(&q)) {
+    // the 256 values of K47..K40 are independent searches, spread them over all cores
+    uint32_t thread_count = num_CPUs();
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    if (thread_count > 64) {
+        thread_count = 64;
+    }
 
-        if (data_out->potential_key_count >= MAXIMUM_ID48_RECOVERED_KEY_COUNT) {
-            result = PM3_EOVFLOW;
-        } else {
-            data_out->potential_keys[data_out->potential_key_count] = q;
-            ++data_out->potential_key_count;
+    pthread_t threads[64];
+    uint32_t started = 0;
+    for (; started < thread_count; ++started) {
+        if (pthread_create(&threads[started], NULL, recover_em4x70_worker, &work) != 0) {
+            break;
         }
     }
+    // no thread could be started, search on this one
+    if (started == 0) {
+        recover_em4x70_worker(&work);
+    }
+    for (uint32_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&work.lock);
 
-    if ((PM3_SUCCESS == result) && (data_out->potential_key_count == 0)) {
-        result = PM3_EFAILED;
+    if (work.overflow) {
+        return PM3_EOVFLOW;
     }
-    return result;
+    if (data_out->potential_key_count == 0) {
+        return PM3_EFAILED;
+    }
+    return PM3_SUCCESS;
 }
 
 static int verify_auth_em4x70(const em4x70_cmd_input_verify_auth_t *opts) {
@@ -946,7 +1029,7 @@ static int CmdEM4x70Recover(const char *Cmd) {
 
         result = recover_em4x70(&recover_ctx.opts, &recover_ctx.data);
         if (PM3_EOVFLOW == result) {
-            PrintAndLogEx(ERR, "Found more than %d potential keys. This is unexpected and likely a code failure.", MAXIMUM_ID48_RECOVERED_KEY_COUNT);
+            PrintAndLogEx(ERR, "Found %u potential keys, more than %d. This is unexpected and likely a code failure.", recover_ctx.data.found_key_count, MAXIMUM_ID48_RECOVERED_KEY_COUNT);
             return result;
         } else if (PM3_SUCCESS != result) {
             PrintAndLogEx(ERR, "No potential keys recovered.  This is unexpected and likely a code failure.");
@@ -1278,7 +1361,7 @@ static int CmdEM4x70AutoRecover(const char *Cmd) {
     result = recover_em4x70(&opts, &data);
 
     if (PM3_EOVFLOW == result) {
-        PrintAndLogEx(ERR, "Found more than %d potential keys. This is unexpected and likely a code failure.", MAXIMUM_ID48_RECOVERED_KEY_COUNT);
+        PrintAndLogEx(ERR, "Found %u potential keys, more than %d. This is unexpected and likely a code failure.", data.found_key_count, MAXIMUM_ID48_RECOVERED_KEY_COUNT);
         return result;
     } else if (PM3_SUCCESS != result) {
         PrintAndLogEx(ERR, "No potential keys recovered.  This is unexpected and likely a code failure.");
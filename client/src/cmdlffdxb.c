@@ -98,7 +98,6 @@ static int getFDXBBits(uint64_t national_code, uint16_t country_code, uint8_t is
     for (uint8_t i = 0; i < 8; ++i)
         raw[i] = bytebits_to_byte(bits + 11 + i * 9, 8);
 
-    init_table(CRC_11784);
     uint16_t crc = crc16_fdxb(raw, 8);
     num_to_bytebitsLSBF(crc >> 0, 8, bits + 83);
     num_to_bytebitsLSBF(crc >> 8, 8, bits + 92);
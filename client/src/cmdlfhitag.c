@@ -19,6 +19,7 @@
 #include "cmdlfhitaghts.h"
 #include "cmdlfhitagu.h"
 #include <ctype.h>
+#include <pthread.h>
 #include "cmdparser.h"  // command_t
 #include "comms.h"
 #include "cmdtrace.h"
@@ -32,7 +33,10 @@
 #include "cmddata.h"    // setDemodBuff
 #include "pm3_cmd.h"    // return codes
 #include "hitag2/hitag2_crypto.h"
+#include "hitag2/hitag2_bs.h"
+#include "hitag2/hitag2_crack2.h"
 #include "util_posix.h"             // msclock
+#include "workpool.h"
 
 static int CmdHelp(const char *Cmd);
 
@@ -463,24 +467,26 @@ static bool ht2_check_cryptokeys(const uint64_t *keys, const uint32_t keycount,
     uint32_t iv = REV32((nrar[3] << 24) + (nrar[2] << 16) + (nrar[1] << 8) + nrar[0]);
     uint32_t ar = (nrar[4] << 24) + (nrar[5] << 16) + (nrar[6] << 8) + nrar[7];
 
-    bool found = false;
-    for (uint32_t i = 0; i < keycount; i++) {
+    uint64_t *rkeys = calloc(keycount, sizeof(uint64_t));
+    if (rkeys == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return false;
+    }
 
+    for (uint32_t i = 0; i < keycount; i++) {
         uint64_t key = keys[i];
         key = BSWAP_48(key);
-        key = REV64(key);
-
-        hitag_state_t hs2;
-        ht2_hitag2_init_ex(&hs2, key, _ht2state.uid, iv);
+        rkeys[i] = REV64(key);
+    }
 
-        uint32_t tbits = ht2_hitag2_nstep(&hs2, 32);
-        if ((ar ^ tbits) == 0xFFFFFFFF) {
-            _ht2state.found_key = true;
-            _ht2state.key = key;
-            found = true;
-            break;
-        }
+    bool found = false;
+    int64_t idx = ht2_bs_find_key(rkeys, keycount, _ht2state.uid, iv, ar);
+    if (idx >= 0) {
+        _ht2state.found_key = true;
+        _ht2state.key = rkeys[idx];
+        found = true;
     }
+    free(rkeys);
     return found;
 }
 
@@ -2160,64 +2166,350 @@ static int CmdLFHitag2Lookup(const char *Cmd) {
         return res;
     }
 
-    bool found = false;
+    uint64_t *rkeys = calloc(key_count, sizeof(uint64_t));
+    if (rkeys == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(keys);
+        return PM3_EMALLOC;
+    }
+
     for (uint32_t i = 0; i < key_count; i++) {
+        uint64_t mykey = MemLeToUint6byte(keys + (i * HITAG_CRYPTOKEY_SIZE));
+        rkeys[i] = REV64(mykey);
+    }
 
-        uint8_t *pkey = keys + (i * HITAG_CRYPTOKEY_SIZE);
-        uint64_t mykey = MemLeToUint6byte(pkey);
-        mykey = REV64(mykey);
+    PrintAndLogEx(DEBUG, "Checking %u keys ( %s bitslice )", key_count, ht2_bs_best_backend()->name);
 
-        hitag_state_t hs2;
-        ht2_hitag2_init_ex(&hs2, mykey, uid, iv);
+    bool found = false;
+    int64_t idx = ht2_bs_find_key(rkeys, key_count, uid, iv, ar);
+    if (idx >= 0) {
+        PrintAndLogEx(SUCCESS, "Found valid key [ " _GREEN_("%s")" ]", sprint_hex_inrow(keys + (idx * HITAG_CRYPTOKEY_SIZE), HITAG_CRYPTOKEY_SIZE));
+        found = true;
+    }
+    free(rkeys);
+
+    free(keys);
+
+    if (found == false) {
+        PrintAndLogEx(WARNING, "check failed");
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    return PM3_SUCCESS;
+}
 
-        uint32_t tbits = ht2_hitag2_nstep(&hs2, 32);
-        if ((ar ^ tbits) == 0xFFFFFFFF) {
-            PrintAndLogEx(SUCCESS, "Found valid key [ " _GREEN_("%s")" ]", sprint_hex_inrow(pkey, HITAG_CRYPTOKEY_SIZE));
-            found = true;
+// in-client crack2 table search
+#define HT2_CRACK2_MAX_THREADS      64
+#define HT2_CRACK2_MAX_CANDIDATES   16
+
+typedef struct {
+    ht2_crack2_table_t *table;
+    const uint8_t *ks;
+    size_t kslen;
+    uint32_t offsets;               // bit offsets to look up
+    workpool_t wp;
+    uint32_t done;
+    int res;                        // first table read error
+    const uint8_t *uid;
+    const uint8_t *nrenc;
+    pthread_mutex_t lock;
+    // recovered keys, picked up by the main thread as they come in
+    uint8_t keys[HT2_CRACK2_MAX_CANDIDATES][HITAG_CRYPTOKEY_SIZE];
+    uint32_t key_offsets[HT2_CRACK2_MAX_CANDIDATES];
+    uint32_t key_count;
+} ht2_crack2_pool_t;
+
+static void ht2_crack2_add_key(ht2_crack2_pool_t *pool, const uint8_t *key, uint32_t offset) {
+    pthread_mutex_lock(&pool->lock);
+    bool known = false;
+    for (uint32_t i = 0; i < pool->key_count; i++) {
+        if (memcmp(pool->keys[i], key, HITAG_CRYPTOKEY_SIZE) == 0) {
+            known = true;
             break;
         }
+    }
+    if (known == false && pool->key_count < HT2_CRACK2_MAX_CANDIDATES) {
+        memcpy(pool->keys[pool->key_count], key, HITAG_CRYPTOKEY_SIZE);
+        pool->key_offsets[pool->key_count] = offset;
+        pool->key_count++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
 
-        if (g_debugMode) {
-            PrintAndLogEx(DEBUG, " tbits... %08" PRIx32 " Known ar... %08" PRIx32, tbits, ar);
-            PrintAndLogEx(DEBUG, " 0xFFFFFFFF ^ tbits... %08" PRIx32, tbits ^ 0xFFFFFFFF);
-            PrintAndLogEx(DEBUG, " 0xFFFFFFFF ^ ar...... %08" PRIx32, ar ^ 0xFFFFFFFF);
-            PrintAndLogEx(DEBUG, " tbits ^ ar........... %08" PRIx32 " ( 0xFFFFFFFF )",  ar ^ tbits);
+static void *ht2_crack2_worker(void *arg) {
+    ht2_crack2_pool_t *pool = arg;
+    uint64_t start, end;
+    while (workpool_claim(&pool->wp, 1, &start, &end)) {
+        uint32_t i = start;
+        uint64_t state = 0;
+        int res = ht2_crack2_search(pool->table, pool->ks, pool->kslen, i, &state);
+        if (res == PM3_SUCCESS) {
+            uint8_t key[HITAG_CRYPTOKEY_SIZE];
+            ht2_crack2_recover_key(state, i, pool->uid, pool->nrenc, key);
+            ht2_crack2_add_key(pool, key, i);
+        } else if (res != PM3_ENODATA) {
+            int none = PM3_SUCCESS;
+            __atomic_compare_exchange_n(&pool->res, &none, res, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+            workpool_stop(&pool->wp);
         }
+        __atomic_fetch_add(&pool->done, 1, __ATOMIC_SEQ_CST);
     }
+    return NULL;
+}
 
-    free(keys);
+static int ht2_crack2_table_search(const char *tablefn, const uint8_t *ks, size_t kslen, const uint8_t *uid, const uint8_t *nrenc, int threads, bool verify) {
 
-    if (found == false) {
-        PrintAndLogEx(WARNING, "check failed");
+    if (kslen < 12) {
+        PrintAndLogEx(WARNING, "Need at least 96 bits of keystream, got %zu", kslen * 8);
+        return PM3_EINVARG;
     }
 
-    PrintAndLogEx(NORMAL, "");
+    ht2_crack2_table_t *table = NULL;
+    int res = ht2_crack2_table_open(tablefn, &table);
+    if (res == PM3_EMALLOC) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return res;
+    }
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "Can't open table " _YELLOW_("%s"), tablefn);
+        return res;
+    }
+
+    ht2_crack2_pool_t pool = {
+        .table = table,
+        .ks = ks,
+        .kslen = kslen,
+        .offsets = (kslen * 8) - 48 + 1,
+        .uid = uid,
+        .nrenc = nrenc,
+    };
+    pthread_mutex_init(&pool.lock, NULL);
+
+    threads = MAX(1, MIN(threads, HT2_CRACK2_MAX_THREADS));
+
+    PrintAndLogEx(INFO, "Searching " _YELLOW_("%u") " bit offsets in the %s table with " _YELLOW_("%d") " thread(s)"
+                  , pool.offsets
+                  , ht2_crack2_table_is_packed(table) ? "packed" : "sorted/"
+                  , threads
+                 );
+
+    uint64_t t1 = msclock();
+
+    // without any thread the search is done here before it returns
+    workpool_start(&pool.wp, threads, pool.offsets, ht2_crack2_worker, &pool, 0);
+
+    // candidates stream in while the workers carry on, each one is tried right away
+    uint8_t found[HITAG_CRYPTOKEY_SIZE] = {0};
+    bool have_key = false;
+    bool aborted = false;
+    bool progress = false;
+    uint32_t tried = 0;
+    uint64_t last_progress = msclock();
+    while (have_key == false) {
+
+        bool finished = (workpool_running(&pool.wp) == false);
+
+        pthread_mutex_lock(&pool.lock);
+        uint32_t count = pool.key_count;
+        pthread_mutex_unlock(&pool.lock);
+
+        for (; tried < count && have_key == false; tried++) {
+
+            if (progress) {
+                PrintAndLogEx(NORMAL, "");
+                progress = false;
+            }
+            PrintAndLogEx(INFO, "Candidate key [ " _YELLOW_("%s") " ] from bit offset %u"
+                          , sprint_hex_inrow(pool.keys[tried], HITAG_CRYPTOKEY_SIZE)
+                          , pool.key_offsets[tried]
+                         );
+
+            if (verify == false) {
+                memcpy(found, pool.keys[tried], sizeof(found));
+                have_key = true;
+                break;
+            }
+
+            uint32_t idx = 0;
+            if (ht2_check_dictionary(1, pool.keys[tried], HITAG_CRYPTOKEY_SIZE, &idx) == PM3_SUCCESS) {
+                memcpy(found, pool.keys[tried], sizeof(found));
+                have_key = true;
+                break;
+            }
+            PrintAndLogEx(NORMAL, "");
+            PrintAndLogEx(INFO, "Tag refused the candidate, searching on");
+        }
+
+        if (have_key || (finished && tried == count)) {
+            break;
+        }
+
+        if (kbd_enter_pressed()) {
+            aborted = true;
+            break;
+        }
+
+        if (msclock() - last_progress > 500) {
+            PrintAndLogEx(INPLACE, "Searched %u / %u bit offsets", __atomic_load_n(&pool.done, __ATOMIC_SEQ_CST), pool.offsets);
+            last_progress = msclock();
+            progress = true;
+        }
+        msleep(10);
+    }
+
+    workpool_stop(&pool.wp);
+    workpool_join(&pool.wp);
+    pthread_mutex_destroy(&pool.lock);
+    ht2_crack2_table_close(table);
+
+    t1 = msclock() - t1;
+    if (progress) {
+        PrintAndLogEx(NORMAL, "");
+    }
+
+    if (aborted) {
+        PrintAndLogEx(WARNING, "\naborted via keyboard!");
+        return PM3_EOPABORTED;
+    }
+
+    if (pool.res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "Error reading table " _YELLOW_("%s"), tablefn);
+        return pool.res;
+    }
+
+    if (have_key == false) {
+        PrintAndLogEx(FAILED, "No key found, searched %u bit offsets in %.1f s", pool.done, (float)t1 / 1000.0);
+        return PM3_ESOFT;
+    }
+
+    if (verify) {
+        PrintAndLogEx(SUCCESS, "Found valid key [ " _GREEN_("%s") " ]", sprint_hex_inrow(found, sizeof(found)));
+    } else {
+        PrintAndLogEx(SUCCESS, "Found key [ " _GREEN_("%s") " ]", sprint_hex_inrow(found, sizeof(found)));
+    }
+    PrintAndLogEx(INFO, "Search time %.1f s", (float)t1 / 1000.0);
+    return PM3_SUCCESS;
+}
+
+// keystream as written by ht2crack2gentest, hex with any line breaks
+static int ht2_crack2_load_keystream(const char *fn, uint8_t *ks, size_t ks_size, size_t *kslen) {
+
+    char *text = NULL;
+    size_t textlen = 0;
+    if (loadFile_safe(fn, "", (void **)&text, &textlen) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    char *hex = calloc(textlen + 1, sizeof(char));
+    if (hex == NULL) {
+        free(text);
+        return PM3_EMALLOC;
+    }
+    for (size_t i = 0; i < textlen; i++) {
+        hex[i] = (text[i] == '\r' || text[i] == '\n') ? ' ' : text[i];
+    }
+    free(text);
+
+    int n = hex_to_bytes(hex, ks, ks_size);
+    free(hex);
+    if (n <= 0) {
+        return PM3_ESOFT;
+    }
+    *kslen = n;
     return PM3_SUCCESS;
 }
 
 static int CmdLFHitag2Crack2(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf hitag crack2",
-                  "This command tries to recover 2048 bits of Hitag 2 crypto stream data.\n",
-                  "lf hitag crack2 --nrar 73AA5A62EAB8529C"
+                  "This command tries to recover 2048 bits of Hitag 2 crypto stream data.\n"
+                  "With `--table` the keystream is searched right away in a table built by\n"
+                  "tools/hitag2crack/crack2/ht2crack2buildtable, its `sorted/` folder or a single file\n"
+                  "packed by ht2crack2packtable, and every key found is tried on the tag.\n"
+                  "`-f` searches a saved keystream instead, no device needed.",
+                  "lf hitag crack2 --nrar 73AA5A62EAB8529C\n"
+                  "lf hitag crack2 --nrar 73AA5A62EAB8529C --table /mnt/ht2/sorted\n"
+                  "lf hitag crack2 -f keystream.txt --uid 49435769 --nrar 656E4572 --table ht2table.bin"
                  );
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str0(NULL, "nrar", "<hex>", "specify nonce / answer as 8 hex bytes"),
+        arg_str0(NULL, "nrar", "<hex>", "specify nonce / answer as 8 hex bytes (nR only with -f)"),
+        arg_str0(NULL, "table", "<fn>", "ht2crack2 table, sorted/ folder or packed file"),
+        arg_str0("f", "file", "<fn>", "keystream file to search, hex (offline)"),
+        arg_str0(NULL, "uid", "<hex>", "tag UID, 4 hex bytes (def: read from tag)"),
+        arg_int0(NULL, "threads", "<dec>", "search threads (def: number of CPUs)"),
+        arg_lit0(NULL, "no-verify", "don't try the found key on the tag"),
         arg_param_end
     };
 
-    CLIExecWithReturn(ctx, Cmd, argtable, false);
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
     int nalen = 0;
     uint8_t nrar[8] = {0};
     CLIGetHexWithReturn(ctx, 1, nrar, &nalen);
+
+    int tlen = 0;
+    char tablefn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)tablefn, FILE_PATH_SIZE, &tlen);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 3), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    int ulen = 0;
+    uint8_t uid[HITAG_UID_SIZE] = {0};
+    CLIGetHexWithReturn(ctx, 4, uid, &ulen);
+
+    int threads = arg_get_int_def(ctx, 5, num_CPUs());
+    bool verify = (arg_get_lit(ctx, 6) == false);
     CLIParserFree(ctx);
 
     // sanity checks
-    if (nalen && nalen != 8) {
-        PrintAndLogEx(INFO, "NrAr wrong length. expected 8, got %i", nalen);
-        return PM3_EINVARG;
+    if (fnlen) {
+        if (nalen != 4 && nalen != 8) {
+            PrintAndLogEx(WARNING, "Keystream search needs nR, expected 4 or 8 bytes, got %i", nalen);
+            return PM3_EINVARG;
+        }
+        if (ulen != HITAG_UID_SIZE) {
+            PrintAndLogEx(WARNING, "Keystream search needs the UID, expected %u bytes, got %i", HITAG_UID_SIZE, ulen);
+            return PM3_EINVARG;
+        }
+        if (tlen == 0) {
+            PrintAndLogEx(WARNING, "Keystream search needs a table, `--table`");
+            return PM3_EINVARG;
+        }
+        // nothing to verify against
+        verify = false;
+    } else {
+        if (nalen && nalen != 8) {
+            PrintAndLogEx(INFO, "NrAr wrong length. expected 8, got %i", nalen);
+            return PM3_EINVARG;
+        }
+        if (tlen && nalen == 0) {
+            PrintAndLogEx(WARNING, "Table search needs the nR used, `--nrar`");
+            return PM3_EINVARG;
+        }
+        if (ulen && ulen != HITAG_UID_SIZE) {
+            PrintAndLogEx(WARNING, "UID wrong length. expected %u, got %i", HITAG_UID_SIZE, ulen);
+            return PM3_EINVARG;
+        }
+        if (IfPm3Hitag() == false) {
+            PrintAndLogEx(FAILED, "Device not compiled to support Hitag");
+            return PM3_EINVARG;
+        }
+    }
+
+    uint8_t ks[sizeof(((lf_hitag_crack_response_t *)0)->data)];
+    size_t kslen = 0;
+
+    if (fnlen) {
+        int res = ht2_crack2_load_keystream(filename, ks, sizeof(ks), &kslen);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(ERR, "Can't read keystream from " _YELLOW_("%s"), filename);
+            return res;
+        }
+        PrintAndLogEx(SUCCESS, "Loaded " _YELLOW_("%zu") " bits of keystream", kslen * 8);
+        return ht2_crack2_table_search(tablefn, ks, kslen, uid, nrar, threads, verify);
     }
 
     lf_hitag_data_t packet;
@@ -2254,7 +2546,12 @@ static int CmdLFHitag2Crack2(const char *Cmd) {
             }
             PrintAndLogEx(NORMAL, "");
             PrintAndLogEx(SUCCESS, "Nonce replay and length extension attack ( %s )", _GREEN_("ok"));
-            PrintAndLogEx(HINT, "Hint: Try `" _YELLOW_("tools/hitag2crack/crack2/ht2crack2search <FILE_with_above_bytes>") "`");
+            memcpy(ks, payload->data, sizeof(ks));
+            kslen = sizeof(ks);
+            if (tlen == 0) {
+                PrintAndLogEx(HINT, "Hint: Try `" _YELLOW_("tools/hitag2crack/crack2/ht2crack2search <FILE_with_above_bytes>") "`");
+                PrintAndLogEx(HINT, "Hint: or `" _YELLOW_("lf hitag crack2 --nrar <hex> --table <sorted folder>") "`");
+            }
             break;
         } else {
             PrintAndLogEx(NORMAL, "");
@@ -2272,7 +2569,22 @@ static int CmdLFHitag2Crack2(const char *Cmd) {
 
     t1 = msclock() - t1;
     PrintAndLogEx(SUCCESS, "\ntime " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
-    return PM3_SUCCESS;
+
+    if (tlen == 0 || kslen == 0) {
+        return PM3_SUCCESS;
+    }
+
+    if (ulen == 0) {
+        uint32_t tag_uid = 0;
+        if (ht2_get_uid(&tag_uid) == false) {
+            PrintAndLogEx(WARNING, "Can't read the UID, use `--uid`");
+            return PM3_ESOFT;
+        }
+        num_to_bytes(tag_uid, HITAG_UID_SIZE, uid);
+    }
+    PrintAndLogEx(INFO, "UID... " _YELLOW_("%s"), sprint_hex_inrow(uid, sizeof(uid)));
+
+    return ht2_crack2_table_search(tablefn, ks, kslen, uid, nrar, threads, verify);
 }
 
 /* Test code
@@ -2490,7 +2802,7 @@ static command_t CommandTable[] = {
     {"sim",         CmdLFHitagSim,              IfPm3Hitag,      "Simulate Hitag transponder"},
     {"-----------", CmdHelp,                    IfPm3Hitag,      "----------------------- " _CYAN_("Recovery") " -----------------------"},
     {"cc",          CmdLFHitagSCheckChallenges, IfPm3Hitag,      "Hitag S: test all provided challenges"},
-    {"crack2",      CmdLFHitag2Crack2,          IfPm3Hitag,      "Recover 2048bits of crypto stream"},
+    {"crack2",      CmdLFHitag2Crack2,          AlwaysAvailable, "Recover 2048bits of crypto stream, search it in a crack2 table"},
     {"chk",         CmdLFHitag2Chk,             IfPm3Hitag,      "Check keys"},
     {"lookup",      CmdLFHitag2Lookup,          AlwaysAvailable, "Uses authentication trace to check for key in dictionary file"},
     {"ta",          CmdLFHitag2CheckChallenges, IfPm3Hitag,      "Hitag 2: test all recorded authentications"},
@@ -111,7 +111,6 @@ int demodNedap(bool verbose) {
     buffer[4] = ((data[6] & 0x1e) << 3) | ((data[7] & 0x1e) >> 1);
 
     // CHECKSUM
-    init_table(CRC_XMODEM);
     checksum = crc16_xmodem(buffer, 5);
 
     buffer[6] = (data[3] << 7) | ((data[4] & 0xe0) >> 1) | ((data[4] & 0x01) << 3) | ((data[5] & 0xe0) >> 5);
@@ -324,7 +323,6 @@ static void NedapGen(uint8_t subType, uint16_t customerCode, uint32_t id, bool i
     buffer[4] = (translateTable[idxC4] << 4) | translateTable[idxC5];
 
     // checksum
-    init_table(CRC_XMODEM);
     uint16_t checksum = crc16_xmodem(buffer, 5);
 
     buffer[6] = ((checksum & 0x000F) << 4) | (buffer[4] & 0x0F);
@@ -337,7 +337,7 @@ static int CmdClear(const char *Cmd) {
 
 static command_t CommandTable[] = {
 
-    {"help",         CmdHelp,      AlwaysAvailable,         "Use `" _YELLOW_("<command> help") "` for details of a command"},
+    {"help",         CmdHelp,      AlwaysAvailable,         "Use `" _YELLOW_("<command> help") "` for details of a command, `" _YELLOW_("help <words>") "` to search all commands"},
     {"prefs",        CmdPref,      AlwaysAvailable,         "{ Edit client/device preferences... }"},
     {"--------",     CmdHelp,      AlwaysAvailable,         "----------------------- " _CYAN_("Technology") " -----------------------"},
     {"analyse",      CmdAnalyse,   AlwaysAvailable,         "{ Analyse utils... }"},
@@ -369,7 +369,10 @@ static command_t CommandTable[] = {
 };
 
 static int CmdHelp(const char *Cmd) {
-    (void)Cmd; // Cmd is not used so far
+    // `help <words>` searches the whole command tree
+    if (strlen(Cmd)) {
+        return CmdsSearch(CommandTable, Cmd);
+    }
     CmdsHelp(CommandTable);
     return PM3_SUCCESS;
 }
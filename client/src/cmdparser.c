@@ -22,8 +22,10 @@
 #include <string.h>
 #include <pthread.h>      // spinlock
 #include <stdlib.h>       // system
+#include <ctype.h>
 #include "ui.h"
 #include "comms.h"
+#include "util.h"
 #include "util_posix.h" // msleep
 
 #if defined(__MACH__) && defined(__APPLE__)
@@ -32,6 +34,8 @@
 
 #define MAX_PM3_INPUT_ARGS_LENGTH    4096
 
+static void indexCommandsRecursive(const command_t cmds[]);
+
 bool AlwaysAvailable(void) {
     return true;
 }
@@ -241,6 +245,142 @@ void CmdsHelp(const command_t Commands[]) {
     PrintAndLogEx(NORMAL, "");
 }
 
+//-----------------------------------------------------------------------------
+// Lookup index of a command table, built the first time the table is parsed.
+// Exact names go through an open addressing hash, prefixes through a binary
+// search of the sorted names.  The tables are static, so the index never expires.
+//-----------------------------------------------------------------------------
+#define CMD_INDEX_REGISTRY_SLOTS    1024    // power of two, well above the number of tables
+
+typedef struct {
+    const command_t *table;
+    uint32_t count;
+    uint32_t mask;
+    uint16_t *hash;         // table index + 1, 0 is an empty slot
+    uint16_t *sorted;       // table indices, sorted by name
+} cmd_table_index_t;
+
+static cmd_table_index_t *g_cmd_index[CMD_INDEX_REGISTRY_SLOTS];
+static pthread_mutex_t g_cmd_index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t cmd_index_hash(const char *s) {
+    uint32_t h = 2166136261U;
+    while (*s) {
+        h = (h ^ (uint8_t) * s++) * 16777619U;
+    }
+    return h;
+}
+
+static const command_t *g_cmd_sort_table;
+
+static int cmd_index_cmp(const void *a, const void *b) {
+    int res = strcmp(g_cmd_sort_table[*(const uint16_t *)a].Name, g_cmd_sort_table[*(const uint16_t *)b].Name);
+    if (res == 0) {
+        // keep the table order of duplicated names
+        return (int) * (const uint16_t *)a - (int) * (const uint16_t *)b;
+    }
+    return res;
+}
+
+static cmd_table_index_t *cmd_index_build(const command_t Commands[]) {
+
+    uint32_t count = 0;
+    while (Commands[count].Name) {
+        count++;
+    }
+
+    uint32_t size = 8;
+    while (size < count * 2) {
+        size <<= 1;
+    }
+
+    cmd_table_index_t *ix = calloc(1, sizeof(cmd_table_index_t));
+    if (ix == NULL) {
+        return NULL;
+    }
+    ix->table = Commands;
+    ix->count = count;
+    ix->mask = size - 1;
+    ix->hash = calloc(size, sizeof(uint16_t));
+    ix->sorted = calloc(count + 1, sizeof(uint16_t));
+    if (ix->hash == NULL || ix->sorted == NULL) {
+        free(ix->hash);
+        free(ix->sorted);
+        free(ix);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        ix->sorted[i] = i;
+
+        // first one wins, like the linear search did
+        uint32_t h = cmd_index_hash(Commands[i].Name) & ix->mask;
+        while (ix->hash[h]) {
+            if (strcmp(Commands[ix->hash[h] - 1].Name, Commands[i].Name) == 0) {
+                break;
+            }
+            h = (h + 1) & ix->mask;
+        }
+        if (ix->hash[h] == 0) {
+            ix->hash[h] = i + 1;
+        }
+    }
+
+    g_cmd_sort_table = Commands;
+    qsort(ix->sorted, count, sizeof(uint16_t), cmd_index_cmp);
+    return ix;
+}
+
+static const cmd_table_index_t *cmd_index_get(const command_t Commands[]) {
+
+    uint32_t h = (uint32_t)(((uintptr_t)Commands >> 4) * 2654435761U) & (CMD_INDEX_REGISTRY_SLOTS - 1);
+
+    pthread_mutex_lock(&g_cmd_index_lock);
+    for (uint32_t n = 0; n < CMD_INDEX_REGISTRY_SLOTS; n++) {
+        cmd_table_index_t *ix = g_cmd_index[h];
+        if (ix == NULL) {
+            ix = cmd_index_build(Commands);
+            g_cmd_index[h] = ix;
+            pthread_mutex_unlock(&g_cmd_index_lock);
+            return ix;
+        }
+        if (ix->table == Commands) {
+            pthread_mutex_unlock(&g_cmd_index_lock);
+            return ix;
+        }
+        h = (h + 1) & (CMD_INDEX_REGISTRY_SLOTS - 1);
+    }
+    pthread_mutex_unlock(&g_cmd_index_lock);
+    return NULL;
+}
+
+// returns the table index of name, or -1
+static int cmd_index_find(const cmd_table_index_t *ix, const char *name) {
+    uint32_t h = cmd_index_hash(name) & ix->mask;
+    while (ix->hash[h]) {
+        int i = ix->hash[h] - 1;
+        if (strcmp(ix->table[i].Name, name) == 0) {
+            return i;
+        }
+        h = (h + 1) & ix->mask;
+    }
+    return -1;
+}
+
+// returns the first position in ix->sorted whose name is >= prefix
+static uint32_t cmd_index_lower_bound(const cmd_table_index_t *ix, const char *prefix) {
+    uint32_t lo = 0, hi = ix->count;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (strcmp(ix->table[ix->sorted[mid]].Name, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
 static int execute_system_command(const char *command) {
 
     pthread_spinlock_t sycmd_spinlock;
@@ -288,6 +428,11 @@ int CmdsParse(const command_t Commands[], const char *Cmd) {
         dumpCommandsRecursive(Commands, 1, true);
         return PM3_SUCCESS;
     }
+    // Collect children into the command tree index
+    if (strcmp(Cmd, "XX_internal_command_index_XX") == 0) {
+        indexCommandsRecursive(Commands);
+        return PM3_SUCCESS;
+    }
 
     if (strcmp(Cmd, "coffee") == 0) {
         PrintAndLogEx(NORMAL, "");
@@ -345,19 +490,25 @@ int CmdsParse(const command_t Commands[], const char *Cmd) {
 
     bool request_help = (strcmp(Cmd + tmplen, "-h") == 0) || (strcmp(Cmd + tmplen, "--help") == 0);
 
-    int i = 0;
-    while (Commands[i].Name) {
-        if (0 == strcmp(Commands[i].Name, cmd_name)) {
-            if ((Commands[i].Help[0] == '{') ||  // always allow parsing categories
-                    request_help ||              // always allow requesting help
-                    Commands[i].IsAvailable()) {
-                break;
-            } else {
-                PrintAndLogEx(WARNING, "This command is " _YELLOW_("not available") " in this mode");
-                return PM3_ENOTIMPL;
-            }
+    const cmd_table_index_t *ix = cmd_index_get(Commands);
+    if (ix == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    // the terminating entry, when nothing matches
+    int i = ix->count;
+
+    int found = cmd_index_find(ix, cmd_name);
+    if (found >= 0) {
+        if ((Commands[found].Help[0] == '{') ||  // always allow parsing categories
+                request_help ||                  // always allow requesting help
+                Commands[found].IsAvailable()) {
+            i = found;
+        } else {
+            PrintAndLogEx(WARNING, "This command is " _YELLOW_("not available") " in this mode");
+            return PM3_ENOTIMPL;
         }
-        ++i;
     }
 
     /* try to find exactly one prefix-match */
@@ -365,9 +516,14 @@ int CmdsParse(const command_t Commands[], const char *Cmd) {
         int last_match = 0;
         int matches = 0;
 
-        for (i = 0; Commands[i].Name; i++) {
-            if (!strncmp(Commands[i].Name, cmd_name, strlen(cmd_name)) && Commands[i].IsAvailable()) {
-                last_match = i;
+        size_t cmd_len = strlen(cmd_name);
+        for (uint32_t n = cmd_index_lower_bound(ix, cmd_name); n < ix->count; n++) {
+            int j = ix->sorted[n];
+            if (strncmp(Commands[j].Name, cmd_name, cmd_len) != 0) {
+                break;
+            }
+            if (Commands[j].IsAvailable()) {
+                last_match = j;
                 matches++;
             }
         }
@@ -392,6 +548,133 @@ int CmdsParse(const command_t Commands[], const char *Cmd) {
 static char pparent[MAX_PM3_INPUT_ARGS_LENGTH] = {0};
 static char *parent = pparent;
 
+// Flattened command tree, full path of every command and category
+typedef struct {
+    char *path;
+    const command_t *cmd;
+} cmd_tree_entry_t;
+
+static cmd_tree_entry_t *g_cmd_tree = NULL;
+static size_t g_cmd_tree_count = 0;
+static size_t g_cmd_tree_size = 0;
+
+static void indexCommandsRecursive(const command_t cmds[]) {
+
+    for (int i = 0; cmds[i].Name; i++) {
+
+        if (cmds[i].Name[0] == '-' || cmds[i].Name[0] == ' ' || cmds[i].Name[0] == '\0') {
+            continue;
+        }
+
+        if (g_cmd_tree_count == g_cmd_tree_size) {
+            size_t size = (g_cmd_tree_size) ? g_cmd_tree_size * 2 : 1024;
+            cmd_tree_entry_t *tmp = realloc(g_cmd_tree, size * sizeof(cmd_tree_entry_t));
+            if (tmp == NULL) {
+                return;
+            }
+            g_cmd_tree = tmp;
+            g_cmd_tree_size = size;
+        }
+
+        char path[MAX_PM3_INPUT_ARGS_LENGTH] = {0};
+        snprintf(path, sizeof(path), "%s%s", parent, cmds[i].Name);
+        g_cmd_tree[g_cmd_tree_count].path = str_dup(path);
+        g_cmd_tree[g_cmd_tree_count].cmd = &cmds[i];
+        g_cmd_tree_count++;
+
+        if (cmds[i].Help[0] != '{') {
+            continue;
+        }
+
+        char currentparent[MAX_PM3_INPUT_ARGS_LENGTH] = {0};
+        snprintf(currentparent, sizeof currentparent, "%s%s ", parent, cmds[i].Name);
+
+        char *old_parent = parent;
+        parent = currentparent;
+        cmds[i].Parse("XX_internal_command_index_XX");
+        parent = old_parent;
+    }
+}
+
+// case insensitive strstr
+static bool cmd_contains(const char *s, const char *word) {
+    size_t n = strlen(word);
+    for (; *s; s++) {
+        size_t j = 0;
+        while (j < n && s[j] && tolower((uint8_t)s[j]) == tolower((uint8_t)word[j])) {
+            j++;
+        }
+        if (j == n) {
+            return true;
+        }
+    }
+    return (n == 0);
+}
+
+int CmdsSearch(const command_t Commands[], const char *Cmd) {
+
+    // walked once, the tables never change.  Some leaves use the `{` marker too,
+    // keep them quiet when they get the internal command
+    if (g_cmd_tree == NULL) {
+        uint8_t old_printAndLog = g_printAndLog;
+        g_printAndLog = 0;
+        indexCommandsRecursive(Commands);
+        g_printAndLog = old_printAndLog;
+    }
+
+    char words[MAX_PM3_INPUT_ARGS_LENGTH] = {0};
+    strncpy(words, Cmd, sizeof(words) - 1);
+
+    char *argv[32];
+    int argc = 0;
+    for (char *tok = strtok(words, " \t"); tok && argc < 32; tok = strtok(NULL, " \t")) {
+        argv[argc++] = tok;
+    }
+
+    size_t max_path_len = 16;
+    for (size_t i = 0; i < g_cmd_tree_count; i++) {
+        size_t len = strlen(g_cmd_tree[i].path);
+        if (len > max_path_len) {
+            max_path_len = len;
+        }
+    }
+
+    PrintAndLogEx(NORMAL, "");
+
+    size_t found = 0;
+    for (size_t i = 0; i < g_cmd_tree_count; i++) {
+        const cmd_tree_entry_t *e = &g_cmd_tree[i];
+
+        if (strcmp(e->cmd->Name, "help") == 0) {
+            continue;
+        }
+
+        // every word, in the path or in the help text
+        bool match = true;
+        for (int w = 0; w < argc && match; w++) {
+            match = cmd_contains(e->path, argv[w]) || cmd_contains(e->cmd->Help, argv[w]);
+        }
+        if (match == false) {
+            continue;
+        }
+
+        if (e->cmd->Help[0] == '{' || e->cmd->IsAvailable()) {
+            PrintAndLogEx(NORMAL, _GREEN_("%-*s") " %s", (int)max_path_len, e->path, e->cmd->Help);
+        } else {
+            PrintAndLogEx(NORMAL, "%-*s %s", (int)max_path_len, e->path, e->cmd->Help);
+        }
+        found++;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    if (found == 0) {
+        PrintAndLogEx(INFO, "No command matches " _YELLOW_("%s"), Cmd);
+    } else {
+        PrintAndLogEx(INFO, "Found " _YELLOW_("%zu") " command(s), the ones not in green are not available in this mode", found);
+    }
+    return PM3_SUCCESS;
+}
+
 void dumpCommandsRecursive(const command_t cmds[], int markdown, bool full_help) {
     if (cmds[0].Name == NULL) return;
 
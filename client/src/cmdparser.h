@@ -65,6 +65,8 @@ void CmdsHelp(const command_t Commands[]);
 void CmdsLS(const command_t Commands[]);
 // Parse a command line
 int CmdsParse(const command_t Commands[], const char *Cmd);
+// Print every command below Commands whose path or help text contains all the words in Cmd
+int CmdsSearch(const command_t Commands[], const char *Cmd);
 void dumpCommandsRecursive(const command_t cmds[], int markdown, bool full_help);
 
 #endif
@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #ifdef HAVE_PYTHON
 #ifdef _POSIX_C_SOURCE
@@ -47,11 +48,95 @@
 extern int luaopen_pm3(lua_State *L);
 #endif
 
+// Lua state kept between `script run` calls, see `prefs set script.persist`
+static lua_State *g_lua_persistent_state = NULL;
+
 #ifdef HAVE_PYTHON
 #ifdef HAVE_PYTHON_SWIG
 extern PyObject *PyInit__pm3(void);
 #endif // HAVE_PYTHON_SWIG
 
+// pyscripts folders added to sys.path, modules imported from there are per run
+#define PY_SCRIPT_DIRS_MAX 4
+static char *g_py_script_dirs[PY_SCRIPT_DIRS_MAX];
+static int g_py_script_dirs_cnt = 0;
+
+static bool Pm3Py_PathInDir(const char *path, const char *dir) {
+    size_t len = strlen(dir);
+    while (len > 0 && (dir[len - 1] == '/' || dir[len - 1] == '\\')) {
+        len--;
+    }
+    return (len > 0) && (strncmp(path, dir, len) == 0) && (path[len] == '/' || path[len] == '\\');
+}
+
+// Folder of the running script as an absolute path, modules next to it are its own
+static void Pm3Py_ScriptDir(const char *script_path, char *dir, size_t dirlen) {
+    char cwd[FILE_PATH_SIZE] = {0};
+    bool absolute = (script_path[0] == '/') || (script_path[0] == '\\') || (script_path[0] != '\0' && script_path[1] == ':');
+    if (absolute == false) {
+        if (getcwd(cwd, sizeof(cwd)) == NULL) {
+            dir[0] = '\0';
+            return;
+        }
+        while (strncmp(script_path, "./", 2) == 0 || strncmp(script_path, ".\\", 2) == 0) {
+            script_path += 2;
+        }
+    }
+    snprintf(dir, dirlen, "%s%s%s", cwd, absolute ? "" : "/", script_path);
+
+    // cut the file name
+    size_t len = strlen(dir);
+    while (len > 0 && dir[len - 1] != '/' && dir[len - 1] != '\\') {
+        len--;
+    }
+    dir[len] = '\0';
+}
+
+// Drops the modules a script imported from the pyscripts folders or its own
+// folder, so the next run imports them fresh and doesn't see their old state.
+// Everything else stays loaded for the following scripts.
+static void Pm3Py_DropScriptModules(PyObject *modules_before, const char *script_dir) {
+    PyObject *modules = PyImport_GetModuleDict();
+    PyObject *keys = PyDict_Keys(modules);
+    if (keys == NULL) {
+        PyErr_Clear();
+        return;
+    }
+
+    Py_ssize_t n = PyList_GET_SIZE(keys);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *key = PyList_GET_ITEM(keys, i);
+        if (PySet_Contains(modules_before, key) != 0) {
+            continue;
+        }
+
+        PyObject *mod = PyDict_GetItem(modules, key);
+        if (mod == NULL) {
+            continue;
+        }
+        PyObject *file = PyObject_GetAttrString(mod, "__file__");
+        if (file == NULL) {
+            // builtin and namespace modules
+            PyErr_Clear();
+            continue;
+        }
+
+        const char *fn = PyUnicode_Check(file) ? PyUnicode_AsUTF8(file) : NULL;
+        if (fn != NULL) {
+            bool drop = (script_dir[0] != '\0') && Pm3Py_PathInDir(fn, script_dir);
+            for (int d = 0; (drop == false) && (d < g_py_script_dirs_cnt); d++) {
+                drop = Pm3Py_PathInDir(fn, g_py_script_dirs[d]);
+            }
+            if (drop && PyDict_DelItem(modules, key)) {
+                PyErr_Clear();
+            }
+        }
+        Py_DECREF(file);
+        PyErr_Clear();
+    }
+    Py_DECREF(keys);
+}
+
 static void Pm3Py_FlushStream(const char *stream_name) {
     PyObject *flush_stream = PySys_GetObject(stream_name);
     if (!flush_stream) {
@@ -174,6 +259,27 @@ typedef enum {
 
 static int CmdHelp(const char *Cmd);
 
+static lua_State *pm3_lua_newstate(void) {
+    // create new Lua state
+    lua_State *lua_state = luaL_newstate();
+
+    // load Lua libraries
+    luaL_openlibs(lua_state);
+
+    //Sets the pm3 core libraries, that go a bit 'under the hood'
+    set_pm3_libraries(lua_state);
+
+    //Add the 'bin' library
+    set_bin_library(lua_state);
+
+    //Add the 'bit' library
+    set_bit_library(lua_state);
+#ifdef HAVE_LUA_SWIG
+    luaL_requiref(lua_state, "pm3", luaopen_pm3, 1);
+#endif
+    return lua_state;
+}
+
 #ifdef HAVE_PYTHON
 
 #define PYTHON_LIBRARIES_WILDCARD  "?.py"
@@ -224,6 +330,10 @@ static void set_python_path(const char *path) {
     if (PySys_SetObject("path", syspath)) {
         PrintAndLogEx(WARNING, "Error setting sys.path object");
     }
+
+    if ((strcmp(path, ".") != 0) && (g_py_script_dirs_cnt < PY_SCRIPT_DIRS_MAX)) {
+        g_py_script_dirs[g_py_script_dirs_cnt++] = str_dup(path);
+    }
 }
 
 static void set_python_paths(void) {
@@ -383,29 +493,43 @@ static int CmdScriptRun(const char *Cmd) {
 
         luascriptfile_idx++;
 
-        // create new Lua state
-        lua_State *lua_state;
-        lua_state = luaL_newstate();
-
-        // load Lua libraries
-        luaL_openlibs(lua_state);
-
-        //Sets the pm3 core libraries, that go a bit 'under the hood'
-        set_pm3_libraries(lua_state);
+        // Reuse the session state if asked to. A state left from before the
+        // preference was switched off is closed by the outermost script only.
+        bool persistent = g_session.lua_persistent;
+        if ((persistent == false) && (g_lua_persistent_state != NULL) && (luascriptfile_idx == 1)) {
+            lua_close(g_lua_persistent_state);
+            g_lua_persistent_state = NULL;
+        }
 
-        //Add the 'bin' library
-        set_bin_library(lua_state);
+        lua_State *lua_state;
+        if (persistent) {
+            if (g_lua_persistent_state == NULL) {
+                g_lua_persistent_state = pm3_lua_newstate();
+            }
+            lua_state = g_lua_persistent_state;
+        } else {
+            lua_state = pm3_lua_newstate();
+        }
+        int lua_top = lua_gettop(lua_state);
 
-        //Add the 'bit' library
-        set_bit_library(lua_state);
-#ifdef HAVE_LUA_SWIG
-        luaL_requiref(lua_state, "pm3", luaopen_pm3, 1);
-#endif
-        error = luaL_loadfile(lua_state, script_path);
+        error = pm3_lua_loadfile(lua_state, script_path);
         free(script_path);
         if (!error) {
-            lua_pushstring(lua_state, arguments);
-            lua_setglobal(lua_state, "args");
+            if (persistent) {
+                // the script gets its own globals, reads fall through to _G
+                lua_newtable(lua_state);
+                lua_newtable(lua_state);
+                lua_pushglobaltable(lua_state);
+                lua_setfield(lua_state, -2, "__index");
+                lua_setmetatable(lua_state, -2);
+                lua_pushstring(lua_state, arguments);
+                lua_setfield(lua_state, -2, "args");
+                // first upvalue of a main chunk is _ENV
+                lua_setupvalue(lua_state, -2, 1);
+            } else {
+                lua_pushstring(lua_state, arguments);
+                lua_setglobal(lua_state, "args");
+            }
 
             //Call it with 0 arguments
             error = lua_pcall(lua_state, 0, LUA_MULTRET, 0); // once again, returns non-0 on error,
@@ -422,8 +546,13 @@ static int CmdScriptRun(const char *Cmd) {
         }
 
         //luaL_dofile(lua_state, buf);
-        // close the Lua state
-        lua_close(lua_state);
+        if (persistent) {
+            // drop whatever the script returned
+            lua_settop(lua_state, lua_top);
+        } else {
+            // close the Lua state
+            lua_close(lua_state);
+        }
         luascriptfile_idx--;
         PrintAndLogEx(SUCCESS, "\nfinished " _YELLOW_("%s"), filename);
         return PM3_SUCCESS;
@@ -619,7 +748,16 @@ static int CmdScriptRun(const char *Cmd) {
             free(script_path);
             return PM3_ESOFT;
         }
+        char script_dir[FILE_PATH_SIZE] = {0};
+        Pm3Py_ScriptDir(script_path, script_dir, sizeof(script_dir));
+        PyObject *modules_before = PySet_New(PyImport_GetModuleDict());
         int ret = Pm3PyRun_SimpleFileNoExit(f, filename);
+        if (modules_before != NULL) {
+            Pm3Py_DropScriptModules(modules_before, script_dir);
+            Py_DECREF(modules_before);
+        } else {
+            PyErr_Clear();
+        }
 #if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION < 10
         // Py_DecodeLocale() allocates memory that needs to be free'd
         for (int i = 0; i < argc + 1; i++) {
@@ -703,7 +841,16 @@ int CmdScript(const char *Cmd) {
 }
 
 void CmdScriptCleanup(void) {
+    if (g_lua_persistent_state != NULL) {
+        lua_close(g_lua_persistent_state);
+        g_lua_persistent_state = NULL;
+    }
+    pm3_lua_cache_free();
 #ifdef HAVE_PYTHON
     Py_Finalize();
+    for (int i = 0; i < g_py_script_dirs_cnt; i++) {
+        free(g_py_script_dirs[i]);
+    }
+    g_py_script_dirs_cnt = 0;
 #endif
 }
@@ -18,6 +18,12 @@
 #include "cmdtrace.h"
 
 #include <ctype.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "cmdparser.h"    // command_t
 #include "protocols.h"
@@ -32,12 +38,48 @@
 #include "cmdlfhitagu.h"        // annotate hitagu
 #include "pm3_cmd.h"            // tracelog_hdr_t
 #include "cliparser.h"          // args..
+#include "pm3.h"                // PM3_RECORD_TRACE
 
 static int CmdHelp(const char *Cmd);
 
 // trace pointer
 static uint8_t *gs_trace;
-static uint16_t gs_traceLen = 0;
+static uint32_t gs_traceLen = 0;
+
+// Indexed trace file layout:
+//   trace_idx_hdr_t | tracelog records | trace_idx_entry_t[frames]
+// Plain tracelog dumps (no header) are still accepted by `trace load`.
+// Each `trace save --append` adds one session, timestamps restart per session.
+#define TRACE_IDX_MAGIC         "PM3TRIDX"
+#define TRACE_IDX_VERSION       1
+#define TRACE_IDX_MONOTONIC     0x0001
+
+typedef struct {
+    uint8_t magic[8];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t frames;
+    uint32_t sessions;
+    uint32_t data_offset;
+    uint32_t data_len;
+    uint32_t index_offset;
+} PACKED trace_idx_hdr_t;
+
+typedef struct {
+    uint32_t offset;            // relative to start of tracelog data
+    uint32_t timestamp;
+} PACKED trace_idx_entry_t;
+
+// frame index of gs_trace. Points into the mapped file or is built on demand
+static trace_idx_entry_t *gs_trace_index = NULL;
+static uint32_t gs_trace_frames = 0;
+static uint32_t gs_trace_sessions = 0;
+static bool gs_trace_monotonic = false;
+static bool gs_trace_index_owned = false;
+
+// set when gs_trace points into a mapped file
+static void *gs_trace_map = NULL;
+static size_t gs_trace_map_len = 0;
 
 typedef enum {
     TRACE_CRC_FAIL = 0,
@@ -47,16 +89,16 @@ typedef enum {
     TRACE_CRC_B_OK = 4,
 } trace_crc_status_t;
 
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+static bool is_last_record(uint32_t tracepos, uint32_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
     const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
                                       uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -101,14 +143,756 @@ static uint8_t calc_pos(const uint8_t *d) {
     return pos;
 }
 
+#define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
+
+static void trace_free(void) {
+
+    if (gs_trace_index_owned) {
+        free(gs_trace_index);
+    }
+    gs_trace_index = NULL;
+    gs_trace_index_owned = false;
+    gs_trace_frames = 0;
+    gs_trace_sessions = 0;
+    gs_trace_monotonic = false;
+
+    if (gs_trace_map) {
+#ifndef _WIN32
+        munmap(gs_trace_map, gs_trace_map_len);
+#else
+        free(gs_trace_map);
+#endif
+        gs_trace_map = NULL;
+        gs_trace_map_len = 0;
+    } else {
+        free(gs_trace);
+    }
+    gs_trace = NULL;
+    gs_traceLen = 0;
+}
+
+// walk the record headers once and remember where each frame starts
+static int trace_build_index(void) {
+
+    if (gs_trace_index) {
+        return PM3_SUCCESS;
+    }
+
+    uint32_t max = 256;
+    trace_idx_entry_t *idx = calloc(max, sizeof(trace_idx_entry_t));
+    if (idx == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint32_t n = 0;
+    uint32_t pos = 0;
+    bool monotonic = true;
+
+    while (is_last_record(pos, gs_traceLen) == false) {
+
+        const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + pos);
+        uint64_t next = (uint64_t)pos + SKIP_TO_NEXT(hdr);
+        if (next > gs_traceLen) {
+            break;
+        }
+
+        if (n == max) {
+            max *= 2;
+            trace_idx_entry_t *tmp = realloc(idx, max * sizeof(trace_idx_entry_t));
+            if (tmp == NULL) {
+                PrintAndLogEx(WARNING, "Failed to allocate memory");
+                free(idx);
+                return PM3_EMALLOC;
+            }
+            idx = tmp;
+        }
+
+        if (n && hdr->timestamp < idx[n - 1].timestamp) {
+            monotonic = false;
+        }
+
+        idx[n].offset = pos;
+        idx[n].timestamp = hdr->timestamp;
+        n++;
+        pos = (uint32_t)next;
+    }
+
+    gs_trace_index = idx;
+    gs_trace_index_owned = true;
+    gs_trace_frames = n;
+    gs_trace_monotonic = monotonic;
+    if (gs_trace_sessions == 0) {
+        gs_trace_sessions = 1;
+    }
+    return PM3_SUCCESS;
+}
+
+// map a trace file, indexed or plain tracelog dump
+static int trace_map_file(const char *path) {
+
+    uint8_t *map = NULL;
+    size_t map_len = 0;
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", path);
+        return PM3_EFILE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        PrintAndLogEx(FAILED, "error, when getting filesize");
+        close(fd);
+        return PM3_EFILE;
+    }
+    map_len = (size_t)st.st_size;
+
+    // private writable mapping, annotators are allowed to scribble on frames
+    map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        PrintAndLogEx(FAILED, "error, could not map file `" _YELLOW_("%s") "`", path);
+        return PM3_EFILE;
+    }
+#else
+    size_t len = 0;
+    if (loadFile_safeEx(path, "", (void **)&map, &len, false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+    map_len = len;
+#endif
+
+    gs_trace_map = map;
+    gs_trace_map_len = map_len;
+
+    const trace_idx_hdr_t *hdr = (const trace_idx_hdr_t *)map;
+    if (map_len < sizeof(trace_idx_hdr_t) || memcmp(hdr->magic, TRACE_IDX_MAGIC, sizeof(hdr->magic)) != 0) {
+
+        // plain tracelog dump
+        if (map_len > UINT32_MAX) {
+            PrintAndLogEx(FAILED, "error, trace file larger than 4 GB");
+            trace_free();
+            return PM3_EFILE;
+        }
+        gs_trace = map;
+        gs_traceLen = (uint32_t)map_len;
+        return PM3_SUCCESS;
+    }
+
+    if (hdr->version != TRACE_IDX_VERSION) {
+        PrintAndLogEx(FAILED, "error, unsupported trace file version %u", hdr->version);
+        trace_free();
+        return PM3_EFILE;
+    }
+
+    if ((uint64_t)hdr->data_offset + hdr->data_len > map_len ||
+            (uint64_t)hdr->index_offset + (uint64_t)hdr->frames * sizeof(trace_idx_entry_t) > map_len) {
+        PrintAndLogEx(FAILED, "error, trace file is truncated");
+        trace_free();
+        return PM3_EFILE;
+    }
+
+    // every indexed frame must lie within the data section, trace list jumps straight to them
+    const trace_idx_entry_t *idx = (const trace_idx_entry_t *)(map + hdr->index_offset);
+    for (uint32_t i = 0; i < hdr->frames; i++) {
+        if ((uint64_t)idx[i].offset + TRACELOG_HDR_LEN > hdr->data_len ||
+                (uint64_t)idx[i].offset + SKIP_TO_NEXT((const tracelog_hdr_t *)(map + hdr->data_offset + idx[i].offset)) > hdr->data_len) {
+            PrintAndLogEx(FAILED, "error, trace file index entry %u out of range", i);
+            trace_free();
+            return PM3_EFILE;
+        }
+    }
+
+    gs_trace = map + hdr->data_offset;
+    gs_traceLen = hdr->data_len;
+    gs_trace_index = (trace_idx_entry_t *)(map + hdr->index_offset);
+    gs_trace_frames = hdr->frames;
+    gs_trace_sessions = hdr->sessions;
+    gs_trace_monotonic = (hdr->flags & TRACE_IDX_MONOTONIC);
+    gs_trace_index_owned = false;
+    return PM3_SUCCESS;
+}
+
+// write trace buffer as indexed trace file, optionally appending it as a new session
+static int trace_save_indexed(const char *preferredName, bool append) {
+
+    int res = trace_build_index();
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    // a loaded index lives in the file mapping. Appending to that same file rewrites the
+    // index region underneath it, so take a heap copy first
+    if (gs_trace_index_owned == false && gs_trace_frames) {
+        trace_idx_entry_t *copy = calloc(gs_trace_frames, sizeof(trace_idx_entry_t));
+        if (copy == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+        memcpy(copy, gs_trace_index, gs_trace_frames * sizeof(trace_idx_entry_t));
+        gs_trace_index = copy;
+        gs_trace_index_owned = true;
+    }
+
+    char *fn = NULL;
+    FILE *f = NULL;
+    trace_idx_hdr_t hdr = {0};
+    trace_idx_entry_t *old_index = NULL;
+
+    if (append && searchFile(&fn, RESOURCES_SUBDIR, preferredName, ".trace", true) == PM3_SUCCESS) {
+
+        f = fopen(fn, "r+b");
+        if (f == NULL) {
+            PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+            free(fn);
+            return PM3_EFILE;
+        }
+
+        if (fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+                memcmp(hdr.magic, TRACE_IDX_MAGIC, sizeof(hdr.magic)) != 0 ||
+                hdr.version != TRACE_IDX_VERSION) {
+            PrintAndLogEx(FAILED, "`" _YELLOW_("%s") "` is not an indexed trace file", fn);
+            res = PM3_EFILE;
+            goto out;
+        }
+
+        if ((uint64_t)hdr.data_offset + hdr.data_len + gs_traceLen + ((uint64_t)hdr.frames + gs_trace_frames) * sizeof(trace_idx_entry_t) > UINT32_MAX) {
+            PrintAndLogEx(FAILED, "error, indexed trace file would exceed 4 GB");
+            res = PM3_EOVFLOW;
+            goto out;
+        }
+
+        old_index = calloc(hdr.frames + 1, sizeof(trace_idx_entry_t));
+        if (old_index == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            res = PM3_EMALLOC;
+            goto out;
+        }
+
+        if (fseek(f, hdr.index_offset, SEEK_SET) != 0 ||
+                fread(old_index, sizeof(trace_idx_entry_t), hdr.frames, f) != hdr.frames) {
+            PrintAndLogEx(FAILED, "error, trace file is truncated");
+            res = PM3_EFILE;
+            goto out;
+        }
+
+    } else {
+
+        fn = newfilenamemcopyEx(preferredName, ".trace", spDefault);
+        if (fn == NULL) {
+            return PM3_EMALLOC;
+        }
+
+        f = fopen(fn, "wb");
+        if (f == NULL) {
+            PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+            free(fn);
+            return PM3_EFILE;
+        }
+
+        memcpy(hdr.magic, TRACE_IDX_MAGIC, sizeof(hdr.magic));
+        hdr.version = TRACE_IDX_VERSION;
+        hdr.flags = TRACE_IDX_MONOTONIC;
+        hdr.data_offset = sizeof(trace_idx_hdr_t);
+    }
+
+    bool monotonic = gs_trace_monotonic && ((hdr.frames == 0) || (hdr.flags & TRACE_IDX_MONOTONIC));
+    if (monotonic && hdr.frames && gs_trace_frames && old_index[hdr.frames - 1].timestamp > gs_trace_index[0].timestamp) {
+        monotonic = false;
+    }
+
+    // new data overwrites the old index, which is written again after it
+    uint32_t base = hdr.data_len;
+    if (fseek(f, hdr.data_offset + hdr.data_len, SEEK_SET) != 0 ||
+            fwrite(gs_trace, 1, gs_traceLen, f) != gs_traceLen ||
+            fwrite(old_index ? old_index : gs_trace_index, sizeof(trace_idx_entry_t), old_index ? hdr.frames : 0, f) != (old_index ? hdr.frames : 0)) {
+        PrintAndLogEx(FAILED, "error, writing to `" _YELLOW_("%s") "`", fn);
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    for (uint32_t i = 0; i < gs_trace_frames; i++) {
+        trace_idx_entry_t e = {
+            .offset = gs_trace_index[i].offset + base,
+            .timestamp = gs_trace_index[i].timestamp,
+        };
+        if (fwrite(&e, sizeof(e), 1, f) != 1) {
+            PrintAndLogEx(FAILED, "error, writing to `" _YELLOW_("%s") "`", fn);
+            res = PM3_EFILE;
+            goto out;
+        }
+    }
+
+    hdr.data_len += gs_traceLen;
+    hdr.index_offset = hdr.data_offset + hdr.data_len;
+    hdr.frames += gs_trace_frames;
+    hdr.sessions += (gs_trace_sessions) ? gs_trace_sessions : 1;
+    hdr.flags = (monotonic) ? TRACE_IDX_MONOTONIC : 0;
+
+    if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+        PrintAndLogEx(FAILED, "error, writing to `" _YELLOW_("%s") "`", fn);
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%u") " frames ( " _YELLOW_("%u") " total, " _YELLOW_("%u") " sessions ) to indexed trace file `" _YELLOW_("%s") "`"
+                  , gs_trace_frames
+                  , hdr.frames
+                  , hdr.sessions
+                  , fn
+                 );
+
+out:
+    fclose(f);
+    free(old_index);
+    free(fn);
+    return res;
+}
+
+// pcapng export / import
+// Frames use the pseudo header from https://www.kaiser.cx/pcap-iso14443.html
+//   version (0x00), event (Rdr: 0xfe, Tag: 0xff), length (2 bytes, big endian)
+// ISO14443 uses LINKTYPE_ISO_14443. There is no registered link type for ISO15693,
+// those frames are written as LINKTYPE_USER0 with the same pseudo header.
+// Timestamps are carrier periods (1/13.56MHz) converted to nanoseconds.
+// Durations and parity bits have no place in pcapng. On import odd parity is regenerated
+// and ISO14443 durations are estimated from the nominal bit time.
+#define PCAPNG_BLOCK_SHB        0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_EPB        0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_END          0
+#define PCAPNG_OPT_IF_TSRESOL   9
+#define PCAPNG_LINKTYPE_ISO14443    264
+#define PCAPNG_LINKTYPE_USER0       147
+#define PCAPNG_PSEUDO_HDR_LEN   4
+#define PCAPNG_EVENT_RDR        0xFE
+#define PCAPNG_EVENT_TAG        0xFF
+
+#define PCAPNG_PAD4(x)          (((x) + 3) & ~3)
+
+static uint64_t carrier_to_ns(uint32_t ts) {
+    return (((uint64_t)ts * 100000) + 678) / 1356;
+}
+
+static uint32_t ns_to_carrier(uint64_t ns) {
+    return (uint32_t)(((ns * 1356) + 50000) / 100000);
+}
+
+static int pcapng_write_block(FILE *f, uint32_t type, const void *body, uint32_t body_len) {
+    uint32_t total = 12 + PCAPNG_PAD4(body_len);
+    static const uint8_t pad[4] = {0};
+    if (fwrite(&type, sizeof(type), 1, f) != 1 ||
+            fwrite(&total, sizeof(total), 1, f) != 1 ||
+            fwrite(body, 1, body_len, f) != body_len ||
+            fwrite(pad, 1, PCAPNG_PAD4(body_len) - body_len, f) != PCAPNG_PAD4(body_len) - body_len ||
+            fwrite(&total, sizeof(total), 1, f) != 1) {
+        return PM3_EFILE;
+    }
+    return PM3_SUCCESS;
+}
+
+static int trace_save_pcapng(const char *preferredName, uint16_t linktype) {
+
+    char *fn = newfilenamemcopyEx(preferredName, ".pcapng", spDefault);
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+        free(fn);
+        return PM3_EFILE;
+    }
+
+    // section header, no options
+    struct {
+        uint32_t magic;
+        uint16_t major;
+        uint16_t minor;
+        int64_t section_len;
+    } PACKED shb = { PCAPNG_BYTE_ORDER_MAGIC, 1, 0, -1 };
+
+    // interface description, nanosecond timestamps
+    struct {
+        uint16_t linktype;
+        uint16_t reserved;
+        uint32_t snaplen;
+        uint16_t opt_code;
+        uint16_t opt_len;
+        uint8_t tsresol;
+        uint8_t pad[3];
+        uint32_t opt_end;
+    } PACKED idb = { linktype, 0, 0, PCAPNG_OPT_IF_TSRESOL, 1, 9, {0}, PCAPNG_OPT_END };
+
+    int res = pcapng_write_block(f, PCAPNG_BLOCK_SHB, &shb, sizeof(shb));
+    if (res == PM3_SUCCESS) {
+        res = pcapng_write_block(f, PCAPNG_BLOCK_IDB, &idb, sizeof(idb));
+    }
+
+    // enhanced packet blocks, one per tracelog record
+    uint8_t body[20 + PCAPNG_PSEUDO_HDR_LEN + 0x8000];
+    uint32_t frames = 0;
+    uint32_t tracepos = 0;
+
+    while (res == PM3_SUCCESS && is_last_record(tracepos, gs_traceLen) == false) {
+
+        const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + tracepos);
+        if ((uint64_t)tracepos + SKIP_TO_NEXT(hdr) > gs_traceLen) {
+            break;
+        }
+        tracepos += SKIP_TO_NEXT(hdr);
+
+        uint64_t ts = carrier_to_ns(hdr->timestamp);
+        uint32_t caplen = PCAPNG_PSEUDO_HDR_LEN + hdr->data_len;
+        uint32_t epb[5] = { 0, (uint32_t)(ts >> 32), (uint32_t)ts, caplen, caplen };
+
+        memcpy(body, epb, sizeof(epb));
+        uint8_t *p = body + sizeof(epb);
+        p[0] = 0x00;
+        p[1] = (hdr->isResponse) ? PCAPNG_EVENT_TAG : PCAPNG_EVENT_RDR;
+        p[2] = (hdr->data_len >> 8) & 0xFF;
+        p[3] = hdr->data_len & 0xFF;
+        memcpy(p + PCAPNG_PSEUDO_HDR_LEN, hdr->frame, hdr->data_len);
+
+        res = pcapng_write_block(f, PCAPNG_BLOCK_EPB, body, sizeof(epb) + caplen);
+        frames++;
+    }
+
+    fclose(f);
+
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "error, writing to `" _YELLOW_("%s") "`", fn);
+    } else {
+        PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%u") " frames to pcapng file `" _YELLOW_("%s") "`", frames, fn);
+    }
+    free(fn);
+    return res;
+}
+
+static uint32_t pcapng_u32(uint32_t v, bool swap) {
+    return (swap) ? ((v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24)) : v;
+}
+
+static uint16_t pcapng_u16(uint16_t v, bool swap) {
+    return (swap) ? BSWAP_16(v) : v;
+}
+
+static bool is_pcapng_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    uint32_t type = 0;
+    bool ok = (fread(&type, sizeof(type), 1, f) == 1 && type == PCAPNG_BLOCK_SHB);
+    fclose(f);
+    return ok;
+}
+
+// convert pcapng enhanced packet blocks on ISO14443 / USER0 interfaces into trace buffer
+static int trace_load_pcapng(const char *path) {
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", path);
+        return PM3_EFILE;
+    }
+
+    uint32_t max = 0x10000;
+    uint8_t *trace = calloc(max, sizeof(uint8_t));
+    uint8_t *body = NULL;
+    uint32_t body_max = 0;
+    if (trace == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+#define PCAPNG_MAX_IF   16
+    uint16_t if_linktype[PCAPNG_MAX_IF] = {0};
+    uint8_t if_tsresol[PCAPNG_MAX_IF] = {0};
+    uint32_t if_count = 0;
+
+    bool swap = false;
+    uint32_t len = 0;
+    uint32_t frames = 0;
+    uint32_t skipped = 0;
+    int res = PM3_SUCCESS;
+
+    while (true) {
+
+        uint32_t bh[2];
+        if (fread(bh, sizeof(uint32_t), 2, f) != 2) {
+            break;
+        }
+
+        uint32_t type = bh[0];
+        uint32_t total = pcapng_u32(bh[1], swap);
+
+        if (type == PCAPNG_BLOCK_SHB) {
+            // byte order is only known after reading the magic
+            uint32_t magic = 0;
+            if (fread(&magic, sizeof(magic), 1, f) != 1) {
+                res = PM3_EFILE;
+                break;
+            }
+            if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+                swap = false;
+            } else if (pcapng_u32(magic, true) == PCAPNG_BYTE_ORDER_MAGIC) {
+                swap = true;
+            } else {
+                PrintAndLogEx(FAILED, "error, not a pcapng file");
+                res = PM3_EFILE;
+                break;
+            }
+            total = pcapng_u32(bh[1], swap);
+            if (total < 28 || fseek(f, total - 12, SEEK_CUR) != 0) {
+                res = PM3_EFILE;
+                break;
+            }
+            // interface ids are per section
+            if_count = 0;
+            continue;
+        }
+
+        type = pcapng_u32(type, swap);
+        if (total < 12 || (total & 3)) {
+            PrintAndLogEx(FAILED, "error, malformed pcapng block");
+            res = PM3_EFILE;
+            break;
+        }
+
+        uint32_t body_len = total - 12;
+        if (body_len > body_max) {
+            uint8_t *tmp = realloc(body, body_len);
+            if (tmp == NULL) {
+                PrintAndLogEx(WARNING, "Failed to allocate memory");
+                res = PM3_EMALLOC;
+                break;
+            }
+            body = tmp;
+            body_max = body_len;
+        }
+
+        // body + trailing length
+        if (fread(body, 1, body_len, f) != body_len || fseek(f, 4, SEEK_CUR) != 0) {
+            PrintAndLogEx(FAILED, "error, pcapng file is truncated");
+            res = PM3_EFILE;
+            break;
+        }
+
+        if (type == PCAPNG_BLOCK_IDB && body_len >= 8) {
+
+            if (if_count < PCAPNG_MAX_IF) {
+                uint16_t lt;
+                memcpy(&lt, body, sizeof(lt));
+                if_linktype[if_count] = pcapng_u16(lt, swap);
+                if_tsresol[if_count] = 6;   // default microseconds
+
+                // walk options, looking for if_tsresol
+                uint32_t o = 8;
+                while (o + 4 <= body_len) {
+                    uint16_t code, olen;
+                    memcpy(&code, body + o, 2);
+                    memcpy(&olen, body + o + 2, 2);
+                    code = pcapng_u16(code, swap);
+                    olen = pcapng_u16(olen, swap);
+                    if (code == PCAPNG_OPT_END || o + 4 + olen > body_len) {
+                        break;
+                    }
+                    if (code == PCAPNG_OPT_IF_TSRESOL && olen == 1) {
+                        if_tsresol[if_count] = body[o + 4];
+                    }
+                    o += 4 + PCAPNG_PAD4(olen);
+                }
+            }
+            if_count++;
+            continue;
+        }
+
+        if (type != PCAPNG_BLOCK_EPB || body_len < 20) {
+            continue;
+        }
+
+        uint32_t epb[5];
+        memcpy(epb, body, sizeof(epb));
+        uint32_t if_id = pcapng_u32(epb[0], swap);
+        uint64_t ts = ((uint64_t)pcapng_u32(epb[1], swap) << 32) | pcapng_u32(epb[2], swap);
+        uint32_t caplen = pcapng_u32(epb[3], swap);
+        const uint8_t *p = body + sizeof(epb);
+
+        if (if_id >= MIN(if_count, PCAPNG_MAX_IF) ||
+                (if_linktype[if_id] != PCAPNG_LINKTYPE_ISO14443 && if_linktype[if_id] != PCAPNG_LINKTYPE_USER0) ||
+                caplen < PCAPNG_PSEUDO_HDR_LEN || caplen > body_len - sizeof(epb) ||
+                (p[1] != PCAPNG_EVENT_RDR && p[1] != PCAPNG_EVENT_TAG)) {
+            skipped++;
+            continue;
+        }
+
+        uint16_t data_len = MIN((uint16_t)((p[2] << 8) | p[3]), caplen - PCAPNG_PSEUDO_HDR_LEN);
+        if (data_len == 0 || data_len > 0x7FFF) {
+            skipped++;
+            continue;
+        }
+
+        // scale timestamp to nanoseconds
+        uint8_t tsresol = if_tsresol[if_id];
+        if (tsresol & 0x80) {
+            uint8_t e = tsresol & 0x7F;
+            ts = (e >= 30) ? (ts >> (e - 30)) * 1000000000ULL >> 30 : (ts * 1000000000ULL) >> e;
+        } else {
+            for (uint8_t i = tsresol; i < 9; i++) {
+                ts *= 10;
+            }
+            for (uint8_t i = 9; i < tsresol; i++) {
+                ts /= 10;
+            }
+        }
+
+        uint32_t need = TRACELOG_HDR_LEN + data_len + ((data_len - 1) / 8 + 1);
+        if ((uint64_t)len + need > UINT32_MAX) {
+            PrintAndLogEx(WARNING, "trace buffer full, rest of pcapng file ignored");
+            break;
+        }
+
+        if (len + need > max) {
+            while (len + need > max) {
+                max = (max > UINT32_MAX / 2) ? UINT32_MAX : max * 2;
+            }
+            uint8_t *tmp = realloc(trace, max);
+            if (tmp == NULL) {
+                PrintAndLogEx(WARNING, "Failed to allocate memory");
+                res = PM3_EMALLOC;
+                break;
+            }
+            trace = tmp;
+        }
+
+        tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + len);
+        hdr->timestamp = ns_to_carrier(ts);
+        hdr->duration = 0;
+        hdr->data_len = data_len;
+        hdr->isResponse = (p[1] == PCAPNG_EVENT_TAG);
+        memcpy(hdr->frame, p + PCAPNG_PSEUDO_HDR_LEN, data_len);
+
+        if (if_linktype[if_id] == PCAPNG_LINKTYPE_ISO14443) {
+            // 128 carrier periods per bit, 8 bits + parity. REQA / WUPA are 7 bit short frames
+            if (hdr->isResponse == false && data_len == 1 && (hdr->frame[0] == ISO14443A_CMD_REQA || hdr->frame[0] == ISO14443A_CMD_WUPA)) {
+                hdr->duration = 7 * 128 + 96;
+            } else {
+                hdr->duration = MIN(data_len * 9 * 128, 0xFFFF);
+            }
+        }
+
+        uint8_t *par = hdr->frame + data_len;
+        memset(par, 0, TRACELOG_PARITY_LEN(hdr));
+        for (uint16_t i = 0; i < data_len; i++) {
+            par[i >> 3] |= (oddparity8(hdr->frame[i]) << (7 - (i & 7)));
+        }
+
+        len += need;
+        frames++;
+    }
+
+    fclose(f);
+    free(body);
+
+    if (res != PM3_SUCCESS || len == 0) {
+        free(trace);
+        if (res == PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "No ISO14443 / ISO15693 frames found in pcapng file");
+            res = PM3_ESOFT;
+        }
+        return res;
+    }
+
+    gs_trace = trace;
+    gs_traceLen = len;
+
+    PrintAndLogEx(SUCCESS, "Converted " _YELLOW_("%u") " frames from pcapng file", frames);
+    if (skipped) {
+        PrintAndLogEx(INFO, "Skipped %u packets with unsupported link type", skipped);
+    }
+    return PM3_SUCCESS;
+}
+
+// frame selection for `trace list`, works on the frame index so nothing before it is decoded
+typedef struct {
+    uint32_t idx;       // next index entry to look at
+    uint32_t end;       // one past the last index entry
+    uint32_t base;      // timestamp of first frame, the listing shows times relative to it
+    uint32_t from;      // timestamp window
+    uint32_t to;
+} trace_range_t;
+
+static int trace_range_init(trace_range_t *r, uint32_t first, uint32_t count, uint32_t from, uint32_t to) {
+
+    int res = trace_build_index();
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    r->idx = MIN(first, gs_trace_frames);
+    r->end = (count == 0) ? gs_trace_frames : (uint32_t)MIN((uint64_t)first + count, gs_trace_frames);
+    r->base = (gs_trace_frames) ? gs_trace_index[0].timestamp : 0;
+    r->from = from;
+    r->to = to;
+
+    if (gs_trace_monotonic == false) {
+        return PM3_SUCCESS;
+    }
+
+    // timestamps only go up, binary search the window
+    uint32_t lo = r->idx, hi = r->end;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (gs_trace_index[mid].timestamp - r->base < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    r->idx = lo;
+
+    hi = r->end;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (gs_trace_index[mid].timestamp - r->base <= to) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    r->end = lo;
+    return PM3_SUCCESS;
+}
+
+// next selected frame starting at or after tracepos. Frames consumed by the
+// previous line (ie merged topaz reader frames) are skipped.
+static bool trace_range_next(trace_range_t *r, uint32_t tracepos, uint32_t *offset) {
+    while (r->idx < r->end) {
+        const trace_idx_entry_t *e = &gs_trace_index[r->idx++];
+        if (e->offset < tracepos) {
+            continue;
+        }
+        // an appended session may restart the clock below the first frame, count it as time 0 instead of wrapping
+        uint32_t ts = (e->timestamp >= r->base) ? e->timestamp - r->base : 0;
+        if (ts >= r->from && ts <= r->to) {
+            *offset = e->offset;
+            return true;
+        }
+    }
+    return false;
+}
+
 // Copy an existing buffer into client trace buffer
 // I think this is cleaner than further globalizing gs_trace, and may lend itself to more modularity later?
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len) {
     if (trace_len == 0 || trace_src == NULL) return (false);
-    if (gs_trace) {
-        free(gs_trace);
-        gs_traceLen = 0;
-    }
+    trace_free();
     gs_trace = calloc(trace_len, sizeof(uint8_t));
     if (gs_trace == NULL) {
         return (false);
@@ -122,9 +906,7 @@ static uint8_t extract_uid[10] = {0};
 static uint8_t extract_uidlen = 0;
 static uint8_t extract_epurse[8] = {0};
 
-#define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
-
-static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
+static uint32_t extractChall_ev2(uint32_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
     tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
     if (next_hdr->data_len != 21) {
         return 0;
@@ -145,7 +927,7 @@ static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdp
     return tracepos;
 }
 
-static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t *trace) {
+static uint32_t extractChallenges(uint32_t tracepos, uint32_t traceLen, uint8_t *trace) {
 
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -419,7 +1201,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2F: {
                 PrintAndLogEx(INFO, "Found a MFDES Auth EV2 First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -428,7 +1210,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2NF: {
                 PrintAndLogEx(INFO, "Found a MFDES Auth EV2 Non First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -440,7 +1222,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
     return tracepos;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint32_t printHexLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
@@ -458,7 +1240,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
         return tracepos;
     }
 
-    uint16_t ret;
+    uint32_t ret;
 
     switch (protocol) {
         case ISO_14443A: {
@@ -506,7 +1288,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+static uint32_t printTraceLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
                                const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -538,6 +1320,7 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
 
     uint8_t *frame = hdr->frame;
     uint8_t *parityBytes = hdr->frame + data_len;
+    uint32_t frame_pos = tracepos;
 
     tracepos += TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr);
 
@@ -549,6 +1332,8 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
         }
     }
 
+    PrintAndLogRecord(PM3_RECORD_TRACE, frame_pos, hdr->isResponse, hdr->timestamp, frame, data_len);
+
     //Check the CRC status
     trace_crc_status_t crcStatus = TRACE_CRC_NONE;
 
@@ -1122,11 +1907,7 @@ static int download_trace(void) {
     }
 
     // reserve some space.
-    if (gs_trace) {
-        free(gs_trace);
-    }
-
-    gs_traceLen = 0;
+    trace_free();
 
     gs_trace = calloc(PM3_CMD_DATA_SIZE, sizeof(uint8_t));
     if (gs_trace == NULL) {
@@ -1140,8 +1921,7 @@ static int download_trace(void) {
     PacketResponseNG resp;
     if (!GetFromDevice(BIG_BUF, gs_trace, PM3_CMD_DATA_SIZE, 0, NULL, 0, &resp, 4000, true)) {
         PrintAndLogEx(WARNING, "timeout while waiting for reply");
-        free(gs_trace);
-        gs_trace = NULL;
+        trace_free();
         return PM3_ETIMEOUT;
     }
 
@@ -1154,13 +1934,13 @@ static int download_trace(void) {
         gs_trace = calloc(gs_traceLen, sizeof(uint8_t));
         if (gs_trace == NULL) {
             PrintAndLogEx(WARNING, "Failed to allocate memory");
+            gs_traceLen = 0;
             return PM3_EMALLOC;
         }
 
         if (!GetFromDevice(BIG_BUF, gs_trace, gs_traceLen, 0, NULL, 0, NULL, 2500, false)) {
             PrintAndLogEx(WARNING, "command execution time out");
-            free(gs_trace);
-            gs_trace = NULL;
+            trace_free();
             return PM3_ETIMEOUT;
         }
     }
@@ -1210,7 +1990,7 @@ static int CmdTraceExtract(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while (tracepos < gs_traceLen) {
         tracepos = extractChallenges(tracepos, gs_traceLen, gs_trace);
@@ -1227,8 +2007,11 @@ static int CmdTraceLoad(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace load",
                   "Load protocol data from binary file to trace buffer\n"
-                  "File extension is <.trace>",
-                  "trace load -f mytracefile    -> w/o file extension"
+                  "File extension is <.trace>\n"
+                  "Both plain and indexed trace files are memory mapped, not copied\n"
+                  "pcapng files with ISO14443 or USER0 (ISO15693) link type are converted",
+                  "trace load -f mytracefile           -> w/o file extension\n"
+                  "trace load -f mysniff.pcapng        -> convert pcapng file"
                  );
 
     void *argtable[] = {
@@ -1243,21 +2026,32 @@ static int CmdTraceLoad(const char *Cmd) {
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
-    if (gs_trace) {
-        free(gs_trace); // maybe better to not clobber this until we have successful load?
-        gs_trace = NULL;
-        gs_traceLen = 0;
-    }
+    trace_free(); // maybe better to not clobber this until we have successful load?
 
-    size_t len = 0;
-    if (loadFile_safe(filename, ".trace", (void **)&gs_trace, &len) != PM3_SUCCESS) {
+    const char *suffix = str_endswith(filename, ".pcapng") ? ".pcapng" : ".trace";
+
+    char *path = NULL;
+    if (searchFile(&path, RESOURCES_SUBDIR, filename, suffix, false) != PM3_SUCCESS) {
         PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
         return PM3_EIO;
     }
 
-    gs_traceLen = (long)len;
+    int res;
+    if (is_pcapng_file(path)) {
+        res = trace_load_pcapng(path);
+    } else {
+        res = trace_map_file(path);
+    }
+    free(path);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
+        return PM3_EIO;
+    }
 
     PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%u") " bytes)", gs_traceLen);
+    if (gs_trace_index) {
+        PrintAndLogEx(SUCCESS, "Indexed trace, " _YELLOW_("%u") " frames in " _YELLOW_("%u") " session(s)", gs_trace_frames, gs_trace_sessions);
+    }
     PrintAndLogEx(HINT, "Hint: Try `" _YELLOW_("trace list -1 -t ...") "` to view trace.  Remember the " _YELLOW_("`-1`") " param");
     return PM3_SUCCESS;
 }
@@ -1267,13 +2061,22 @@ static int CmdTraceSave(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace save",
                   "Save protocol data from trace buffer to binary file\n"
-                  "File extension is <.trace>",
-                  "trace save -f mytracefile    -> w/o file extension"
+                  "File extension is <.trace>\n"
+                  "Indexed trace files carry a frame index, `trace list` can seek in them without decoding",
+                  "trace save -f mytracefile             -> w/o file extension\n"
+                  "trace save -f mytracefile --idx       -> save as indexed trace file\n"
+                  "trace save -f mysession --append      -> add trace buffer as new session to indexed trace file\n"
+                  "trace save -f mysniff --pcapng        -> save as pcapng for Wireshark (ISO14443)\n"
+                  "trace save -f mysniff --pcapng -t 15  -> save as pcapng, ISO15693 frames"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str1("f", "file", "<fn>", "Specify trace file to save"),
+        arg_lit0(NULL, "idx", "save as indexed trace file"),
+        arg_lit0(NULL, "append", "append to indexed trace file, created if missing"),
+        arg_lit0(NULL, "pcapng", "save as pcapng file"),
+        arg_str0("t", "type", "<str>", "pcapng frame type: 14a (def), 14b, 15, iclass"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -1281,8 +2084,24 @@ static int CmdTraceSave(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool indexed = arg_get_lit(ctx, 2);
+    bool append = arg_get_lit(ctx, 3);
+    bool pcapng = arg_get_lit(ctx, 4);
+
+    int tlen = 0;
+    char type[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)type, sizeof(type), &tlen);
+    str_lower(type);
     CLIParserFree(ctx);
 
+    uint16_t linktype = PCAPNG_LINKTYPE_ISO14443;
+    if (strcmp(type, "15") == 0 || strcmp(type, "iclass") == 0) {
+        linktype = PCAPNG_LINKTYPE_USER0;
+    } else if (tlen && strcmp(type, "14a") != 0 && strcmp(type, "14b") != 0) {
+        PrintAndLogEx(FAILED, "Unknown pcapng frame type \"%s\"", type);
+        return PM3_EINVARG;
+    }
+
     if (gs_traceLen == 0) {
         download_trace();
         if (gs_traceLen == 0) {
@@ -1291,6 +2110,14 @@ static int CmdTraceSave(const char *Cmd) {
         }
     }
 
+    if (pcapng) {
+        return trace_save_pcapng(filename, linktype);
+    }
+
+    if (indexed || append) {
+        return trace_save_indexed(filename, append);
+    }
+
     saveFile(filename, ".trace", gs_trace, gs_traceLen);
     return PM3_SUCCESS;
 }
@@ -1306,8 +2133,9 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
     char example[200] = {0};
     snprintf(example, sizeof(example) - 1,
              "%s list --frame      -> show frame delay times\n"
-             "%s list -1           -> use trace buffer ",
-             alias, alias);
+             "%s list -1           -> use trace buffer\n"
+             "%s list -1 --first 100 --count 20 -> list frames 100..119 of trace buffer",
+             alias, alias, alias);
     char fullalias[100] = {0};
     snprintf(fullalias, sizeof(fullalias) - 1, "%s list", alias);
     CLIParserInit(&ctx, fullalias, desc, example);
@@ -1322,6 +2150,10 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "first", "<dec>", "first frame to list"),
+        arg_u64_0(NULL, "count", "<dec>", "number of frames to list"),
+        arg_u64_0(NULL, "from", "<dec>", "list frames starting at or after this timestamp"),
+        arg_u64_0(NULL, "to", "<dec>", "list frames starting at or before this timestamp"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1364,7 +2196,9 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf -f mfc_default_keys.dic     -> use default dictionary file\n"
                   "trace list -t 14a --frame                    -> show frame delay times\n"
-                  "trace list -t 14a -1                         -> use trace buffer "
+                  "trace list -t 14a -1                         -> use trace buffer\n"
+                  "trace list -t 14a -1 --first 1000 --count 50 -> list frames 1000..1049\n"
+                  "trace list -t 14a -1 --from 500000 --to 900000 -> list frames within timestamp window"
                  );
 
     void *argtable[] = {
@@ -1378,6 +2212,10 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", "<str>", "protocol to annotate the trace"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "first", "<dec>", "first frame to list"),
+        arg_u64_0(NULL, "count", "<dec>", "number of frames to list"),
+        arg_u64_0(NULL, "from", "<dec>", "list frames starting at or after this timestamp"),
+        arg_u64_0(NULL, "to", "<dec>", "list frames starting at or before this timestamp"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1401,6 +2239,12 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    uint32_t first_frame = arg_get_u32_def(ctx, 9, 0);
+    uint32_t frame_count = arg_get_u32_def(ctx, 10, 0);
+    uint32_t ts_from = arg_get_u32_def(ctx, 11, 0);
+    uint32_t ts_to = arg_get_u32_def(ctx, 12, UINT32_MAX);
+    bool use_range = arg_get_u64_count(ctx, 9) || arg_get_u64_count(ctx, 10) || arg_get_u64_count(ctx, 11) || arg_get_u64_count(ctx, 12);
+
     CLIParserFree(ctx);
 
     clearCommandBuffer();
@@ -1456,7 +2300,25 @@ int CmdTraceList(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    trace_range_t range = {0};
+    if (use_range) {
+        int res = trace_range_init(&range, first_frame, frame_count, ts_from, ts_to);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+        if (range.idx >= range.end) {
+            PrintAndLogEx(WARNING, "No frames in selected range ( %u frames in trace )", gs_trace_frames);
+            return PM3_SUCCESS;
+        }
+        PrintAndLogEx(SUCCESS, "Selected frames ( " _YELLOW_("%u") " .. " _YELLOW_("%u") " of %u )"
+                      , range.idx
+                      , range.end - 1
+                      , gs_trace_frames
+                     );
+    }
+
+    uint32_t tracepos = 0;
+    uint32_t framepos = 0;
 
     /*
     if (protocol == FELICA) {
@@ -1464,8 +2326,14 @@ int CmdTraceList(const char *Cmd) {
     } */
 
     if (show_hex) {
-        while (tracepos < gs_traceLen) {
-            tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
+        if (use_range) {
+            while (trace_range_next(&range, tracepos, &framepos)) {
+                tracepos = printHexLine(framepos, gs_traceLen, gs_trace, protocol);
+            }
+        } else {
+            while (tracepos < gs_traceLen) {
+                tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
+            }
         }
     } else {
 
@@ -1622,12 +2490,26 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        if (use_range) {
 
-            if (kbd_enter_pressed()) {
-                PrintAndLogEx(INFO, "User interrupted detected. Aborting");
-                break;
+            while (trace_range_next(&range, tracepos, &framepos)) {
+                tracepos = printTraceLine(framepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+
+                if (kbd_enter_pressed()) {
+                    PrintAndLogEx(INFO, "User interrupted detected. Aborting");
+                    break;
+                }
+            }
+
+        } else {
+
+            while (tracepos < gs_traceLen) {
+                tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+
+                if (kbd_enter_pressed()) {
+                    PrintAndLogEx(INFO, "User interrupted detected. Aborting");
+                    break;
+                }
             }
         }
 
@@ -1638,6 +2520,7 @@ int CmdTraceList(const char *Cmd) {
 
     if (show_hex) {
         PrintAndLogEx(HINT, "Hint: Syntax is: `" _YELLOW_("text2pcap -t \"%%S.\" -l 264 -n <input-text-file> <output-pcapng-file>") "`");
+        PrintAndLogEx(HINT, "Hint: Try `" _YELLOW_("trace save -f <fn> --pcapng") "` to write pcapng directly");
     }
 
     return PM3_SUCCESS;
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 
 #include "uart/uart.h"
+#include "uart/ringbuffer.h"
 #include "ui.h"
 #include "crc16.h"
 #include "util.h" // g_pendingPrompt
@@ -406,6 +407,51 @@ bool IsReconnectedOk(void) {
     return ret;
 }
 
+// Read-ahead for the communications thread.
+// Frames are pulled from the port in large bursts into a ring and handed out
+// from there, so back to back frames don't cost a select() + read() for each
+// preamble, payload and postamble.
+#define COMM_RX_RING_SIZE   (sizeof(PacketResponseNGRaw) * 32)
+
+static RingBuffer *comm_rx_ring = NULL;
+
+// Called before each communication thread starts. The ring is emptied, so bytes
+// left over from a previous connection aren't parsed as the start of a frame.
+static int comm_rx_ring_prepare(void) {
+    if (comm_rx_ring == NULL) {
+        comm_rx_ring = RingBuf_create(COMM_RX_RING_SIZE);
+        if (comm_rx_ring == NULL) {
+            return PM3_EMALLOC;
+        }
+    }
+    RingBuf_reset(comm_rx_ring);
+    return PM3_SUCCESS;
+}
+
+static int comm_receive(RingBuffer *ring, uint8_t *dst, uint32_t len, uint32_t *rxlen) {
+    *rxlen = 0;
+
+    while (*rxlen < len) {
+
+        if (RingBuf_isEmpty(ring) == false) {
+            *rxlen += RingBuf_dequeueBatch(ring, dst + *rxlen, len - *rxlen);
+            continue;
+        }
+
+        uint32_t n = 0;
+        int res = uart_receive_burst(sp, RingBuf_getRearPtr(ring), RingBuf_getContinousAvailableSize(ring), &n);
+        if (res != PM3_SUCCESS) {
+            // timeout after a partial read is reported like uart_receive does
+            if (res == PM3_ENODATA && *rxlen) {
+                return PM3_SUCCESS;
+            }
+            return res;
+        }
+        RingBuf_postEnqueueBatch(ring, n);
+    }
+    return PM3_SUCCESS;
+}
+
 // The communications thread.
 // signals to main thread when a response is ready to process.
 //
@@ -428,6 +474,8 @@ __attribute__((force_align_arg_pointer))
     disableAppNap("Proxmark3 polling UART");
 #endif
 
+    RingBuffer *rx_ring = comm_rx_ring;
+
     // is this connection->run a cross thread call?
     while (connection->run) {
         rxlen = 0;
@@ -457,7 +505,13 @@ __attribute__((force_align_arg_pointer))
 
                 rxMaxLen = MIN(COMM_RAW_RECEIVE_LEN, rxMaxLen);
 
-                res = uart_receive(sp, bufferData + bufferPos, rxMaxLen, &rxlen);
+                // hand out what was read ahead before switching to raw mode
+                if (RingBuf_isEmpty(rx_ring) == false) {
+                    rxlen = RingBuf_dequeueBatch(rx_ring, bufferData + bufferPos, rxMaxLen);
+                    res = PM3_SUCCESS;
+                } else {
+                    res = uart_receive(sp, bufferData + bufferPos, rxMaxLen, &rxlen);
+                }
                 if (res == PM3_SUCCESS) {
                     uint64_t clk = msclock();
                     __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
@@ -473,7 +527,7 @@ __attribute__((force_align_arg_pointer))
                 // Ignore data when bufferPos >= bufferLen and is_receiving_raw has not been set to false
                 uint8_t dummyData[64];
                 uint32_t dummyLen;
-                uart_receive(sp, dummyData, sizeof(dummyData), &dummyLen);
+                comm_receive(rx_ring, dummyData, sizeof(dummyData), &dummyLen);
             }
         } else {
             if (is_receiving_raw_last) {
@@ -483,7 +537,7 @@ __attribute__((force_align_arg_pointer))
                 // comm_raw_data == NULL is used in SetCommunicationReceiveMode()
                 __atomic_store_n(&comm_raw_data, NULL, __ATOMIC_SEQ_CST);
             }
-            res = uart_receive(sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
+            res = comm_receive(rx_ring, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
 
             if ((res == PM3_SUCCESS) && (rxlen == sizeof(PacketResponseNGPreamble))) {
 
@@ -503,7 +557,7 @@ __attribute__((force_align_arg_pointer))
 
                     if ((!error) && (length > 0)) { // Get the variable length payload
 
-                        res = uart_receive(sp, (uint8_t *)&rx_raw.data, length, &rxlen);
+                        res = comm_receive(rx_ring, (uint8_t *)&rx_raw.data, length, &rxlen);
 
                         if ((res != PM3_SUCCESS) || (rxlen != length)) {
 
@@ -554,7 +608,7 @@ __attribute__((force_align_arg_pointer))
                     }
 
                     if (!error) {                        // Get the postamble
-                        res = uart_receive(sp, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
+                        res = comm_receive(rx_ring, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
                         if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseNGPostamble))) {
                             PrintAndLogEx(WARNING, "Received packet frame without postamble");
                             error = true;
@@ -590,7 +644,7 @@ __attribute__((force_align_arg_pointer))
                     PacketResponseOLD rx_old;
                     memcpy(&rx_old, &rx_raw.pre, sizeof(PacketResponseNGPreamble));
 
-                    res = uart_receive(sp, ((uint8_t *)&rx_old) + sizeof(PacketResponseNGPreamble), sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble), &rxlen);
+                    res = comm_receive(rx_ring, ((uint8_t *)&rx_old) + sizeof(PacketResponseNGPreamble), sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble), &rxlen);
                     if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble))) {
                         PrintAndLogEx(WARNING, "Received packet OLD frame with payload too short? %d/%zu", rxlen, sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble));
                         error = true;
@@ -761,6 +815,12 @@ bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
         g_conn.send_via_fpc_usart = false;
 
+        if (comm_rx_ring_prepare() != PM3_SUCCESS) {
+            uart_close(sp);
+            sp = NULL;
+            return false;
+        }
+
         pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
         __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
         __atomic_clear(&reconnect_ok, __ATOMIC_SEQ_CST);
@@ -827,6 +887,13 @@ bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
         g_conn.send_via_fpc_usart = false;
 
+        if (comm_rx_ring_prepare() != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            uart_close(sp);
+            sp = NULL;
+            return false;
+        }
+
         pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
         __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
         g_session.pm3_present = true; // TODO support for multiple devices
@@ -972,6 +1039,8 @@ void CloseProxmark(pm3_device_t *dev) {
 
     // Clean up our state
     sp = NULL;
+    RingBuf_destroy(comm_rx_ring);
+    comm_rx_ring = NULL;
 #ifdef __BIONIC__
     if (communication_thread != 0) {
         memset(&communication_thread, 0, sizeof(pthread_t));
@@ -27,6 +27,7 @@
 #include "cmdparser.h"
 #include "proxmark3.h"
 #include "emv_roca.h"
+#include "emv_pk.h"
 #include "emvcore.h"
 #include "cmdhf14a.h"
 #include "dol.h"
@@ -38,6 +39,8 @@
 #include <mbedtls/des.h>    // DES
 #include "crypto/libpcrypto.h"
 #include "iso4217.h"        // currency lookup
+#include "util_posix.h"     // msclock
+#include "workpool.h"
 
 static int CmdHelp(const char *Cmd);
 
@@ -2769,6 +2772,315 @@ out:
     return ret;
 }
 
+// offline certificate checks of `emv scan` files
+#define EMV_VERIFY_MAX_FILES    8192
+#define EMV_VERIFY_MAX_THREADS  64
+
+typedef struct {
+    const char *filename;
+    int res;                // PM3_EFILE when the file can't be used
+    uint8_t rid[5];
+    uint8_t caidx;
+    bool oda;               // card has a CA public key index
+    bool ca;                // CA public key found and verified
+    bool issuer;
+    bool icc_cert;          // card has an ICC certificate
+    bool icc;
+    int8_t sda;             // -1 no SSAD, 0 failed, 1 DAC recovered
+    size_t issuer_bits;
+    size_t icc_bits;
+    bool issuer_roca;
+    bool icc_roca;
+} emv_verify_t;
+
+typedef struct {
+    emv_verify_t *items;
+    workpool_t wp;
+} emv_verify_pool_t;
+
+static void emv_verify_file(emv_verify_t *v) {
+    v->sda = -1;
+
+    json_error_t error;
+    json_t *root = json_load_file(v->filename, 0, &error);
+    if (root == NULL || json_is_object(root) == false) {
+        json_decref(root);
+        v->res = PM3_EFILE;
+        return;
+    }
+
+    const char *alr = "Root terminal TLV tree";
+    struct tlvdb *tlvRoot = tlvdb_fixed(1, strlen(alr), (const unsigned char *)alr);
+    bool loaded = JsonLoadCardTLV(root, tlvRoot);
+    json_decref(root);
+    if (loaded == false) {
+        tlvdb_free(tlvRoot);
+        v->res = PM3_EFILE;
+        return;
+    }
+
+    v->res = PM3_SUCCESS;
+
+    const struct tlv *df_tlv = tlvdb_get(tlvRoot, 0x84, NULL);
+    const struct tlv *caidx_tlv = tlvdb_get(tlvRoot, 0x8f, NULL);
+    if (df_tlv == NULL || df_tlv->len < 5 || caidx_tlv == NULL || caidx_tlv->len != 1) {
+        tlvdb_free(tlvRoot);
+        return;
+    }
+
+    v->oda = true;
+    memcpy(v->rid, df_tlv->value, 5);
+    v->caidx = caidx_tlv->value[0];
+
+    struct emv_pk *pk = emv_pk_get_ca_pk(v->rid, v->caidx);
+    if (pk == NULL) {
+        tlvdb_free(tlvRoot);
+        return;
+    }
+    v->ca = true;
+
+    // the opened key is shared by the key store and mbedtls caches into it, each worker opens its own
+    pk->cpk = NULL;
+
+    struct emv_pk *issuer_pk = emv_pki_recover_issuer_cert(pk, tlvRoot);
+    emv_pk_free(pk);
+    if (issuer_pk == NULL) {
+        tlvdb_free(tlvRoot);
+        return;
+    }
+
+    v->issuer = true;
+    v->issuer_bits = issuer_pk->mlen * 8;
+    v->issuer_roca = emv_rocacheck(issuer_pk->modulus, issuer_pk->mlen, false);
+
+    const struct tlv *sda_tlv = tlvdb_get(tlvRoot, 0x21, NULL);
+    if (tlvdb_get(tlvRoot, 0x93, NULL)) {
+        struct tlvdb *dac_db = emv_pki_recover_dac(issuer_pk, tlvRoot, sda_tlv);
+        v->sda = (dac_db != NULL);
+        tlvdb_free(dac_db);
+    }
+
+    v->icc_cert = (tlvdb_get(tlvRoot, 0x9f46, NULL) != NULL);
+    if (v->icc_cert) {
+        struct emv_pk *icc_pk = emv_pki_recover_icc_cert(issuer_pk, tlvRoot, sda_tlv);
+        if (icc_pk) {
+            v->icc = true;
+            v->icc_bits = icc_pk->mlen * 8;
+            v->icc_roca = emv_rocacheck(icc_pk->modulus, icc_pk->mlen, false);
+            emv_pk_free(icc_pk);
+        }
+    }
+
+    emv_pk_free(issuer_pk);
+    tlvdb_free(tlvRoot);
+}
+
+static void *emv_verify_worker(void *arg) {
+    emv_verify_pool_t *pool = arg;
+    // the crypto code talks a lot, keep the workers quiet
+    PrintAndLogMuteThread(true);
+    uint64_t i, end;
+    while (workpool_claim(&pool->wp, 1, &i, &end)) {
+        emv_verify_file(&pool->items[i]);
+    }
+    PrintAndLogMuteThread(false);
+    return NULL;
+}
+
+static bool emv_verify_failed(const emv_verify_t *v) {
+    if (v->res != PM3_SUCCESS) {
+        return true;
+    }
+    return v->oda && (v->ca == false || v->issuer == false || (v->icc_cert && v->icc == false) || v->sda == 0);
+}
+
+static const char *emv_verify_state(bool present, bool ok) {
+    if (present == false) {
+        return " n/a  ";
+    }
+    return (ok) ? _GREEN_("  ok  ") : _RED_(" fail ");
+}
+
+static void emv_verify_print(const emv_verify_t *v) {
+    if (v->res != PM3_SUCCESS) {
+        PrintAndLogEx(INFO, _RED_("unreadable   ") " |        |        |        |        |        | %s", v->filename);
+        return;
+    }
+
+    if (v->oda == false) {
+        PrintAndLogEx(INFO, "no ODA data   |        |        |        |        |        | %s", v->filename);
+        return;
+    }
+
+    PrintAndLogEx(INFO, "%s %02X | %s | %s | %s | %s | %s | %s",
+                  sprint_hex_inrow(v->rid, 5),
+                  v->caidx,
+                  emv_verify_state(true, v->ca),
+                  emv_verify_state(v->ca, v->issuer),
+                  emv_verify_state(v->issuer && v->sda >= 0, v->sda == 1),
+                  emv_verify_state(v->issuer && v->icc_cert, v->icc),
+                  (v->issuer == false) ? " n/a  " : (v->issuer_roca || v->icc_roca) ? _RED_(" weak ") : _GREEN_("  no  "),
+                  v->filename
+                 );
+}
+
+static int CmdEMVVerify(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "emv verify",
+                  "Offline check of `emv scan` json files. Recovers the issuer and ICC public keys from\n"
+                  "the certificates with the CA keys from `capk.txt`, checks the static signature (SDA)\n"
+                  "and runs the ROCA test on the recovered keys. The files are spread over a thread pool.",
+                  "emv verify -f card.json\n"
+                  "emv verify --dir scans/ -> check all json files in the folder\n"
+                  "emv verify --dir scans/ -t 4 -v");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_strn("f", "file", "<fn>", 0, 64, "`emv scan` json file"),
+        arg_str0("d", "dir", "<dir>", "folder with `emv scan` json files"),
+        arg_int0("t", "threads", "<dec>", "number of threads (def: number of CPUs)"),
+        arg_lit0("v", "verbose", "print every file, not only the ones with findings"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    struct arg_str *files = arg_get_str(ctx, 1);
+    char dir[FILE_PATH_SIZE] = {0};
+    int dirlen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)dir, sizeof(dir) - 1, &dirlen);
+    int threads = arg_get_int_def(ctx, 3, num_CPUs());
+    bool verbose = arg_get_lit(ctx, 4);
+
+    size_t maxfiles = files->count + ((dirlen) ? EMV_VERIFY_MAX_FILES : 0);
+    if (maxfiles == 0) {
+        CLIParserFree(ctx);
+        PrintAndLogEx(ERR, "Need a file or a folder");
+        return PM3_EINVARG;
+    }
+
+    char *paths = calloc(maxfiles, FILE_PATH_SIZE);
+    if (paths == NULL) {
+        CLIParserFree(ctx);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    size_t count = 0;
+    for (int i = 0; i < files->count; i++) {
+        strncpy(paths + count * FILE_PATH_SIZE, files->sval[i], FILE_PATH_SIZE - 1);
+        count++;
+    }
+    CLIParserFree(ctx);
+
+    if (dirlen) {
+        size_t dircount = 0;
+        int res = collect_file_paths_recursive(dir, paths + count * FILE_PATH_SIZE, FILE_PATH_SIZE, EMV_VERIFY_MAX_FILES, &dircount, false, 0);
+        if (res == PM3_EOVFLOW) {
+            PrintAndLogEx(WARNING, "More than %u files in folder, only checking the first ones", EMV_VERIFY_MAX_FILES);
+        } else if (res != PM3_SUCCESS) {
+            PrintAndLogEx(ERR, "Can't read folder " _YELLOW_("%s"), dir);
+            free(paths);
+            return PM3_EFILE;
+        }
+
+        // keep the json files only
+        size_t base = count;
+        for (size_t i = 0; i < dircount; i++) {
+            const char *path = paths + (base + i) * FILE_PATH_SIZE;
+            if (str_endswith(path, ".json")) {
+                memmove(paths + count * FILE_PATH_SIZE, path, FILE_PATH_SIZE);
+                count++;
+            }
+        }
+    }
+
+    if (count == 0) {
+        PrintAndLogEx(WARNING, "No json files found");
+        free(paths);
+        return PM3_EFILE;
+    }
+
+    emv_verify_t *items = calloc(count, sizeof(emv_verify_t));
+    if (items == NULL) {
+        free(paths);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        items[i].filename = paths + i * FILE_PATH_SIZE;
+    }
+
+    // CA keys and json hash seed before the workers start, they only read shared state after this
+    if (emv_pk_load_ca_store() != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Can't load CA public keys");
+    }
+    json_object_seed(0);
+
+    threads = MAX(1, MIN(threads, EMV_VERIFY_MAX_THREADS));
+    threads = MIN((size_t)threads, count);
+
+    emv_verify_pool_t pool = {
+        .items = items,
+    };
+
+    PrintAndLogEx(INFO, "Checking " _YELLOW_("%zu") " file(s) with " _YELLOW_("%d") " thread(s)", count, threads);
+
+    uint64_t t1 = msclock();
+
+    workpool_run(&pool.wp, threads, count, emv_verify_worker, &pool, 0);
+
+    t1 = msclock() - t1;
+
+    size_t nodata = 0, nooda = 0, issuer = 0, icc = 0, failed = 0, weak = 0;
+    bool header = false;
+    for (size_t i = 0; i < count; i++) {
+        const emv_verify_t *v = &items[i];
+
+        nodata += (v->res != PM3_SUCCESS);
+        nooda += (v->res == PM3_SUCCESS && v->oda == false);
+        issuer += v->issuer;
+        icc += v->icc;
+        failed += (v->res == PM3_SUCCESS && emv_verify_failed(v));
+        weak += (v->issuer_roca || v->icc_roca);
+
+        if (verbose || emv_verify_failed(v) || v->issuer_roca || v->icc_roca) {
+            if (header == false) {
+                PrintAndLogEx(NORMAL, "");
+                PrintAndLogEx(INFO, "RID       IDX |   CA   | Issuer |  SDA   |  ICC   |  ROCA  | file");
+                PrintAndLogEx(INFO, "--------------+--------+--------+--------+--------+--------+-----------------");
+                header = true;
+            }
+            emv_verify_print(v);
+        }
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "----------------- " _CYAN_("Summary") " -----------------");
+    PrintAndLogEx(INFO, "Files.................. %zu", count);
+    PrintAndLogEx(INFO, "Issuer key recovered... %zu", issuer);
+    PrintAndLogEx(INFO, "ICC key recovered...... %zu", icc);
+    PrintAndLogEx(INFO, "No ODA data............ %zu", nooda);
+    if (nodata) {
+        PrintAndLogEx(INFO, "Unreadable............. " _RED_("%zu"), nodata);
+    }
+    if (failed) {
+        PrintAndLogEx(INFO, "Failed checks.......... " _RED_("%zu"), failed);
+    } else {
+        PrintAndLogEx(INFO, "Failed checks.......... " _GREEN_("0"));
+    }
+    if (weak) {
+        PrintAndLogEx(INFO, "ROCA weak keys......... " _RED_("%zu"), weak);
+    } else {
+        PrintAndLogEx(INFO, "ROCA weak keys......... " _GREEN_("0"));
+    }
+    PrintAndLogEx(INFO, "Time................... %" PRIu64 " ms", t1);
+
+    free(items);
+    free(paths);
+    return PM3_SUCCESS;
+}
+
 static int CmdEMVReader(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "emv reader",
@@ -2982,6 +3294,7 @@ static command_t CommandTable[] =  {
     {"help",        CmdHelp,                        AlwaysAvailable, "This help"},
     {"list",        CmdEMVList,                     AlwaysAvailable, "List ISO7816 history"},
     {"test",        CmdEMVTest,                     AlwaysAvailable, "Perform crypto logic self tests"},
+    {"verify",      CmdEMVVerify,                   AlwaysAvailable, "Offline certificate and ROCA check of `emv scan` files"},
     {"-----------", CmdHelp,                        IfPm3Iso14443a,  "---------------------- " _CYAN_("Operations") " ---------------------"},
     {"challenge",   CmdEMVGenerateChallenge,        IfPm3Iso14443,   "Generate challenge"},
     {"exec",        CmdEMVExec,                     IfPm3Iso14443,   "Executes EMV contactless transaction"},
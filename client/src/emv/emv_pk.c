@@ -432,38 +432,115 @@ void emv_pk_free(struct emv_pk *pk) {
     free(pk);
 }
 
-static struct emv_pk *emv_pk_get_ca_pk_from_file(const char *fname,
-                                                 const unsigned char *rid,
-                                                 unsigned char idx) {
-    if (!fname)
+// CA public keys from capk.txt, parsed, verified and opened once per session.
+// Open addressing on (RID, index), the table is at most half full.
+typedef struct {
+    struct emv_pk *pk;
+    bool verified;
+    struct crypto_pk *cpk;
+} emv_capk_t;
+
+static struct {
+    bool loaded;
+    size_t size;        // power of two
+    emv_capk_t *table;
+} emv_capk_store;
+
+static size_t emv_capk_slot(const unsigned char *rid, unsigned char idx, size_t size) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 5; i++) {
+        h = (h ^ rid[i]) * 16777619u;
+    }
+    h = (h ^ idx) * 16777619u;
+    return h & (size - 1);
+}
+
+static emv_capk_t *emv_capk_find(const unsigned char *rid, unsigned char idx) {
+    if (emv_capk_store.table == NULL) {
         return NULL;
+    }
+
+    size_t mask = emv_capk_store.size - 1;
+    for (size_t i = emv_capk_slot(rid, idx, emv_capk_store.size); emv_capk_store.table[i].pk; i = (i + 1) & mask) {
+        struct emv_pk *pk = emv_capk_store.table[i].pk;
+        if (pk->index == idx && memcmp(pk->rid, rid, 5) == 0) {
+            return &emv_capk_store.table[i];
+        }
+    }
+    return NULL;
+}
+
+static void emv_capk_insert(struct emv_pk *pk) {
+    // first entry in the file wins, as with the old line by line search
+    if (emv_capk_find(pk->rid, pk->index)) {
+        emv_pk_free(pk);
+        return;
+    }
+
+    size_t mask = emv_capk_store.size - 1;
+    size_t i = emv_capk_slot(pk->rid, pk->index, emv_capk_store.size);
+    while (emv_capk_store.table[i].pk) {
+        i = (i + 1) & mask;
+    }
+
+    emv_capk_t *e = &emv_capk_store.table[i];
+    e->pk = pk;
+    e->verified = emv_pk_verify(pk);
+    if (e->verified) {
+        e->cpk = crypto_pk_open(pk->pk_algo, pk->modulus, pk->mlen, pk->exp, pk->elen);
+    }
+}
+
+static int emv_capk_load(const char *fname) {
 
     FILE *f = fopen(fname, "r");
     if (!f) {
         PrintAndLogEx(ERR, "Error: can't open file %s.", fname);
-        return NULL;
+        return PM3_EFILE;
     }
 
-    while (!feof(f)) {
-        char buf[2048];
-        if (fgets(buf, sizeof(buf), f) == NULL)
-            break;
-
-        struct emv_pk *pk = emv_pk_parse_pk(buf, sizeof(buf));
-        if (!pk)
-            continue;
+    size_t lines = 0;
+    char buf[2048];
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        lines++;
+    }
 
-        if (memcmp(pk->rid, rid, 5) || pk->index != idx) {
-            emv_pk_free(pk);
-            continue;
-        }
+    size_t size = 16;
+    while (size < lines * 2) {
+        size <<= 1;
+    }
 
+    emv_capk_store.table = calloc(size, sizeof(emv_capk_t));
+    if (emv_capk_store.table == NULL) {
         fclose(f);
-        return pk;
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+    emv_capk_store.size = size;
+
+    rewind(f);
+    size_t n = 0;
+    while (n < lines && fgets(buf, sizeof(buf), f) != NULL) {
+        n++;
+        struct emv_pk *pk = emv_pk_parse_pk(buf, sizeof(buf));
+        if (pk) {
+            emv_capk_insert(pk);
+        }
     }
 
     fclose(f);
-    return NULL;
+    return PM3_SUCCESS;
+}
+
+void emv_pk_free_ca_store(void) {
+    for (size_t i = 0; i < emv_capk_store.size; i++) {
+        if (emv_capk_store.table[i].cpk) {
+            crypto_pk_close(emv_capk_store.table[i].cpk);
+        }
+        emv_pk_free(emv_capk_store.table[i].pk);
+    }
+    free(emv_capk_store.table);
+    memset(&emv_capk_store, 0, sizeof(emv_capk_store));
 }
 
 // not used
@@ -512,52 +589,55 @@ char *emv_pk_get_ca_pk_rid_file(const char *dirname, const unsigned char *rid) {
 }
 */
 
-struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx) {
-    struct emv_pk *pk = NULL;
-
-    /*  if (!pk) {
-            char *fname = emv_pk_get_ca_pk_file(NULL, rid, idx);
-            if (fname) {
-                pk = emv_pk_get_ca_pk_from_file(fname, rid, idx);
-                free(fname);
-            }
-        }
+int emv_pk_load_ca_store(void) {
+    if (emv_capk_store.loaded) {
+        return (emv_capk_store.table) ? PM3_SUCCESS : PM3_EFILE;
+    }
+    emv_capk_store.loaded = true;
 
-        if (!pk) {
-            char *fname = emv_pk_get_ca_pk_rid_file(NULL, rid);
-            if (fname) {
-                pk = emv_pk_get_ca_pk_from_file(fname, rid, idx);
-                free(fname);
-            }
-        }
-    */
     char *path;
     if (searchFile(&path, RESOURCES_SUBDIR, "capk", ".txt", false) != PM3_SUCCESS) {
-        return NULL;
+        return PM3_EFILE;
     }
-    pk = emv_pk_get_ca_pk_from_file(path, rid, idx);
+    int res = emv_capk_load(path);
     free(path);
+    return res;
+}
 
-    if (!pk)
-        return NULL;
+struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx) {
 
-    bool isok = emv_pk_verify(pk);
+    emv_pk_load_ca_store();
+
+    emv_capk_t *e = emv_capk_find(rid, idx);
+    if (e == NULL) {
+        return NULL;
+    }
 
     PrintAndLogEx(INFO, "Verifying CA PK for %02hhx:%02hhx:%02hhx:%02hhx:%02hhx IDX %02hhx %zu bits.  ( %s )",
-                  pk->rid[0],
-                  pk->rid[1],
-                  pk->rid[2],
-                  pk->rid[3],
-                  pk->rid[4],
-                  pk->index,
-                  pk->mlen * 8,
-                  (isok) ? _GREEN_("ok") : _RED_("failed")
+                  e->pk->rid[0],
+                  e->pk->rid[1],
+                  e->pk->rid[2],
+                  e->pk->rid[3],
+                  e->pk->rid[4],
+                  e->pk->index,
+                  e->pk->mlen * 8,
+                  (e->verified) ? _GREEN_("ok") : _RED_("failed")
                  );
 
-    if (isok) {
-        return pk;
+    if (e->verified == false) {
+        return NULL;
     }
 
-    emv_pk_free(pk);
-    return NULL;
+    // callers own and free the key, hand out a copy sharing the opened public key
+    struct emv_pk *pk = emv_pk_new(e->pk->mlen, e->pk->elen);
+    if (pk == NULL) {
+        return NULL;
+    }
+
+    unsigned char *modulus = pk->modulus;
+    *pk = *e->pk;
+    pk->modulus = modulus;
+    memcpy(pk->modulus, e->pk->modulus, e->pk->mlen);
+    pk->cpk = e->cpk;
+    return pk;
 }
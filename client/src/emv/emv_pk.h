@@ -24,6 +24,8 @@
 #include "common.h"
 #include <stdbool.h>
 
+struct crypto_pk;
+
 struct emv_pk {
     unsigned char rid[5];
     unsigned char index;
@@ -37,6 +39,7 @@ struct emv_pk {
     size_t mlen;
     unsigned char *modulus;
     unsigned int expire;
+    const struct crypto_pk *cpk;    // opened public key, set on CA keys from the key store which owns it
 };
 
 #define EXPIRE(yy, mm, dd) 0x ## yy ## mm ## dd
@@ -50,4 +53,7 @@ bool emv_pk_verify(const struct emv_pk *pk);
 // char *emv_pk_get_ca_pk_file(const char *dirname, const unsigned char *rid, unsigned char idx);
 // char *emv_pk_get_ca_pk_rid_file(const char *dirname, const unsigned char *rid);
 struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx);
+// loads capk.txt if not done yet, lookups after this only read the key store
+int emv_pk_load_ca_store(void);
+void emv_pk_free_ca_store(void);
 #endif
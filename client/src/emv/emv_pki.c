@@ -66,14 +66,19 @@ static unsigned char *emv_pki_decode_message(const struct emv_pk *enc_pk,
         PrintAndLogEx(WARNING, "ERROR: Certificate length (%zu) not equal key length (%zu)", cert_tlv->len, enc_pk->mlen);
         return NULL;
     }
-    kcp = crypto_pk_open(enc_pk->pk_algo,
-                         enc_pk->modulus, enc_pk->mlen,
-                         enc_pk->exp, enc_pk->elen);
-    if (!kcp)
-        return NULL;
+    // CA keys come with the public key already opened by the key store
+    if (enc_pk->cpk) {
+        data = crypto_pk_encrypt(enc_pk->cpk, cert_tlv->value, cert_tlv->len, &data_len);
+    } else {
+        kcp = crypto_pk_open(enc_pk->pk_algo,
+                             enc_pk->modulus, enc_pk->mlen,
+                             enc_pk->exp, enc_pk->elen);
+        if (!kcp)
+            return NULL;
 
-    data = crypto_pk_encrypt(kcp, cert_tlv->value, cert_tlv->len, &data_len);
-    crypto_pk_close(kcp);
+        data = crypto_pk_encrypt(kcp, cert_tlv->value, cert_tlv->len, &data_len);
+        crypto_pk_close(kcp);
+    }
 
     if (data == NULL || data_len < 3) {
         PrintAndLogEx(WARNING, "ERROR: Certificate decrypt failed");
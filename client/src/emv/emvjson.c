@@ -25,6 +25,7 @@
 #include "emv_tags.h"
 #include "fileutils.h"
 #include "pm3_cmd.h"
+#include "iso7816/iso7816core.h"
 
 static const ApplicationDataElm_t ApplicationData[] = {
     {0x82,    "AIP"},
@@ -405,3 +406,147 @@ bool ParamLoadFromJson(struct tlvdb *tlv) {
     return true;
 }
 
+static tlv_tag_t GetApplicationDataTag(const char *name) {
+    for (int i = 0; i < ARRAYLEN(ApplicationData); i++)
+        if (strcmp(ApplicationData[i].Name, name) == 0)
+            return ApplicationData[i].Tag;
+
+    return 0;
+}
+
+static bool JsonLoadTag(json_t *elm, tlv_tag_t *tag) {
+    uint8_t buf[4] = {0};
+    size_t buflen = 0;
+    if (JsonLoadBufAsHex(elm, "$.tag", buf, sizeof(buf), &buflen) || buflen == 0)
+        return false;
+
+    *tag = 0;
+    for (int i = 0; i < buflen; i++)
+        *tag = (*tag << 8) | buf[i];
+
+    return true;
+}
+
+// Encodes one element saved by JsonSaveTLVElm() or JsonSaveTLVTree() back to its TLV bytes.
+// Elements linked to $.ApplicationData take their value from there, templates are rebuilt from their children.
+static bool JsonEncodeTLV(json_t *root, json_t *elm, uint8_t *data, size_t maxlen, size_t *datalen) {
+    struct tlv tlv = {0};
+    uint8_t value[APDU_RES_LEN] = {0};
+    size_t valuelen = 0;
+
+    json_t *jappdata = json_object_get(elm, "appdata");
+    json_t *jchilds = json_object_get(elm, "Childs");
+
+    if (json_is_string(jappdata)) {
+        char path[200] = {0};
+        snprintf(path, sizeof(path), "$.ApplicationData.%s", json_string_value(jappdata));
+        tlv.tag = GetApplicationDataTag(json_string_value(jappdata));
+        if (tlv.tag == 0 || JsonLoadBufAsHex(root, path, value, sizeof(value), &valuelen))
+            return false;
+    } else {
+        if (JsonLoadTag(elm, &tlv.tag) == false)
+            return false;
+
+        if (json_is_array(jchilds)) {
+            for (size_t i = 0; i < json_array_size(jchilds); i++) {
+                size_t len = 0;
+                if (JsonEncodeTLV(root, json_array_get(jchilds, i), value + valuelen, sizeof(value) - valuelen, &len) == false)
+                    return false;
+                valuelen += len;
+            }
+        } else if (JsonLoadBufAsHex(elm, "$.value", value, sizeof(value), &valuelen)) {
+            return false;
+        }
+    }
+
+    tlv.len = valuelen;
+    tlv.value = value;
+
+    size_t len = 0;
+    unsigned char *enc = tlv_encode(&tlv, &len);
+    if (enc == NULL || len > maxlen) {
+        free(enc);
+        return false;
+    }
+
+    memcpy(data, enc, len);
+    *datalen = len;
+    free(enc);
+    return true;
+}
+
+static json_t *JsonFindRecord(json_t *records, uint8_t sfi, uint8_t recnum) {
+    for (size_t i = 0; i < json_array_size(records); i++) {
+        json_t *rec = json_array_get(records, i);
+        uint8_t jsfi = 0, jrecnum = 0;
+        size_t len = 0;
+        if (JsonLoadBufAsHex(rec, "$.SFI", &jsfi, 1, &len) || JsonLoadBufAsHex(rec, "$.RecordNum", &jrecnum, 1, &len))
+            continue;
+
+        if (jsfi == sfi && jrecnum == recnum)
+            return rec;
+    }
+    return NULL;
+}
+
+bool JsonLoadCardTLV(json_t *root, struct tlvdb *tlvRoot) {
+    uint8_t buf[APDU_RES_LEN] = {0};
+    size_t buflen = 0;
+
+    if (JsonLoadBufAsHex(root, "$.Application.AID", buf, APDU_AID_LEN, &buflen) || buflen == 0)
+        return false;
+    tlvdb_add(tlvRoot, tlvdb_fixed(0x84, buflen, buf));
+
+    if (JsonLoadBufAsHex(root, "$.ApplicationData.AIP", buf, sizeof(buf), &buflen) == 0 && buflen)
+        tlvdb_add(tlvRoot, tlvdb_fixed(0x82, buflen, buf));
+
+    json_t *records = json_path_get(root, "$.Application.Records");
+    if (json_is_array(records) == false)
+        return true;
+
+    for (size_t i = 0; i < json_array_size(records); i++) {
+        json_t *data = json_object_get(json_array_get(records, i), "Data");
+        if (json_is_object(data) && JsonEncodeTLV(root, data, buf, sizeof(buf), &buflen))
+            tlvdb_add(tlvRoot, tlvdb_parse_multi(buf, buflen));
+    }
+
+    // Input list for Offline Data Authentication, EMV 4.3 book3 10.3
+    uint8_t afl[APDU_RES_LEN] = {0};
+    size_t afllen = 0;
+    if (JsonLoadBufAsHex(root, "$.ApplicationData.AFL", afl, sizeof(afl), &afllen) || afllen % 4)
+        return true;
+
+    uint8_t *oda = calloc(1, 4096);
+    if (oda == NULL)
+        return false;
+    size_t odalen = 0;
+
+    for (size_t i = 0; i < afllen; i += 4) {
+        uint8_t sfi = afl[i] >> 3;
+        for (int n = afl[i + 1]; n < afl[i + 1] + afl[i + 3] && n <= afl[i + 2]; n++) {
+            json_t *data = json_object_get(JsonFindRecord(records, sfi, n), "Data");
+            if (json_is_object(data) == false || JsonEncodeTLV(root, data, buf, sizeof(buf), &buflen) == false)
+                continue;
+
+            // SFI 1..10 records contribute the value of their template only
+            const unsigned char *value = buf;
+            size_t valuelen = buflen;
+            if (sfi < 11) {
+                struct tlv e;
+                if (tlv_parse_tl(&value, &valuelen, &e) == false)
+                    continue;
+            }
+
+            if (odalen + valuelen > 4096)
+                break;
+            memcpy(oda + odalen, value, valuelen);
+            odalen += valuelen;
+        }
+    }
+
+    if (odalen)
+        tlvdb_add(tlvRoot, tlvdb_fixed(0x21, odalen, oda)); // not a standard tag
+
+    free(oda);
+    return true;
+}
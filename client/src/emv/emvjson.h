@@ -50,4 +50,8 @@ int JsonLoadBufAsHex(json_t *elm, const char *path, uint8_t *data, size_t maxbuf
 
 bool ParamLoadFromJson(struct tlvdb *tlv);
 
+// Rebuilds the card data of an `emv scan` file: AID (as 0x84), AIP, the records
+// and the input list for Offline Data Authentication (as 0x21)
+bool JsonLoadCardTLV(json_t *root, struct tlvdb *tlvRoot);
+
 #endif
@@ -36,6 +36,7 @@
 #include "sda_test.h"
 #include "dda_test.h"
 #include "cda_test.h"
+#include "tlv_test.h"
 #include "crypto/libpcrypto.h"
 #include "emv/emv_roca.h"
 
@@ -93,6 +94,9 @@ int ExecuteCryptoTests(bool verbose, bool ignore_time, bool include_slow_tests)
     res = mbedtls_x509_self_test(verbose);
     if (res) TestFail = true;
 
+    res = exec_tlv_test(verbose, include_slow_tests);
+    if (res) TestFail = true;
+
     res = exec_sda_test(verbose);
     if (res) TestFail = true;
 
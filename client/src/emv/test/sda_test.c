@@ -217,8 +217,7 @@ static int sda_test_raw(bool verbose) {
     return 0;
 }
 
-static int sda_test_pk(bool verbose) {
-    const struct emv_pk *pk = &vsdc_01;
+static int sda_test_pk(const struct emv_pk *pk, bool verbose) {
     struct tlvdb *db;
 
     db = tlvdb_external(0x90, sizeof(issuer_cert), issuer_cert);
@@ -263,6 +262,35 @@ static int sda_test_pk(bool verbose) {
     return 0;
 }
 
+// same key from capk.txt, twice, recovering the issuer cert with the store's opened public key
+static int sda_test_capk(bool verbose) {
+    for (int i = 0; i < 2; i++) {
+        struct emv_pk *pk = emv_pk_get_ca_pk(vsdc_01.rid, vsdc_01.index);
+        if (!pk) {
+            PrintAndLogEx(WARNING, "CA key not found in key store!");
+            return 1;
+        }
+
+        if (pk->cpk == NULL || pk->mlen != vsdc_01.mlen || memcmp(pk->modulus, vsdc_01.modulus, vsdc_01.mlen)) {
+            PrintAndLogEx(WARNING, "CA key from key store doesn't match!");
+            emv_pk_free(pk);
+            return 1;
+        }
+
+        int ret = sda_test_pk(pk, verbose);
+        emv_pk_free(pk);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    if (emv_pk_get_ca_pk((const unsigned char *)"\xa0\x00\x00\x00\x00", 0xFF) != NULL) {
+        PrintAndLogEx(WARNING, "Unknown CA key found in key store!");
+        return 1;
+    }
+    return 0;
+}
+
 int exec_sda_test(bool verbose) {
     int ret = sda_test_raw(verbose);
     if (ret) {
@@ -271,11 +299,18 @@ int exec_sda_test(bool verbose) {
     }
     PrintAndLogEx(SUCCESS, "SDA raw test ( %s )", _GREEN_("ok"));
 
-    ret = sda_test_pk(verbose);
+    ret = sda_test_pk(&vsdc_01, verbose);
     if (ret) {
         PrintAndLogEx(WARNING, "SDA test pk ( %s )", _RED_("fail"));
         return ret;
     }
     PrintAndLogEx(SUCCESS, "SDA test pk ( %s )", _GREEN_("ok"));
+
+    ret = sda_test_capk(verbose);
+    if (ret) {
+        PrintAndLogEx(WARNING, "SDA test CA key store ( %s )", _RED_("fail"));
+        return ret;
+    }
+    PrintAndLogEx(SUCCESS, "SDA test CA key store ( %s )", _GREEN_("ok"));
     return 0;
 }
@@ -0,0 +1,350 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// TLV database tests and parse / lookup timings
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "../tlv.h"
+#include "ui.h"         // printandlog
+#include "commonutil.h" // ARRAYLEN
+#include "util_posix.h" // usclock
+#include "tlv_test.h"
+
+// responses captured from a Visa test card
+// SELECT 2PAY.SYS.DDF01
+static const unsigned char t_ppse[] = {
+    0x6f, 0x4d, 0x84, 0x0e, 0x32, 0x50, 0x41, 0x59, 0x2e, 0x53, 0x59, 0x53, 0x2e, 0x44, 0x44, 0x46,
+    0x30, 0x31, 0xa5, 0x3b, 0xbf, 0x0c, 0x38, 0x61, 0x19, 0x4f, 0x07, 0xa0, 0x00, 0x00, 0x00, 0x03,
+    0x10, 0x10, 0x50, 0x0b, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x87,
+    0x01, 0x01, 0x61, 0x1b, 0x4f, 0x07, 0xa0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10, 0x50, 0x0d, 0x56,
+    0x49, 0x53, 0x41, 0x20, 0x45, 0x4c, 0x45, 0x43, 0x54, 0x52, 0x4f, 0x4e, 0x87, 0x01, 0x02
+};
+
+// SELECT A0000000031010
+static const unsigned char t_fci[] = {
+    0x6f, 0x53, 0x84, 0x07, 0xa0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0xa5, 0x48, 0x50, 0x0b, 0x56,
+    0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x87, 0x01, 0x01, 0x9f, 0x38, 0x18,
+    0x9f, 0x66, 0x04, 0x9f, 0x02, 0x06, 0x9f, 0x03, 0x06, 0x9f, 0x1a, 0x02, 0x95, 0x05, 0x5f, 0x2a,
+    0x02, 0x9a, 0x03, 0x9c, 0x01, 0x9f, 0x37, 0x04, 0x5f, 0x2d, 0x04, 0x65, 0x6e, 0x66, 0x72, 0xbf,
+    0x0c, 0x13, 0x9f, 0x5a, 0x05, 0x31, 0x08, 0x26, 0x08, 0x26, 0x9f, 0x0a, 0x08, 0x00, 0x01, 0x05,
+    0x01, 0x00, 0x00, 0x00, 0x00
+};
+
+// GET PROCESSING OPTIONS
+static const unsigned char t_gpo[] = {
+    0x77, 0x4e, 0x82, 0x02, 0x20, 0x00, 0x94, 0x10, 0x08, 0x01, 0x01, 0x00, 0x10, 0x01, 0x02, 0x01,
+    0x18, 0x01, 0x02, 0x00, 0x20, 0x01, 0x01, 0x00, 0x9f, 0x36, 0x02, 0x00, 0x61, 0x9f, 0x26, 0x08,
+    0x0a, 0x6d, 0x3c, 0x3a, 0xb2, 0xbf, 0xc5, 0x14, 0x9f, 0x10, 0x07, 0x06, 0x01, 0x12, 0x03, 0xa0,
+    0x00, 0x00, 0x57, 0x13, 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x00, 0x10, 0xd2, 0x21, 0x22, 0x01,
+    0x11, 0x43, 0x80, 0x44, 0x00, 0x00, 0x0f, 0x5f, 0x34, 0x01, 0x01, 0x9f, 0x6c, 0x02, 0x16, 0x00
+};
+
+// READ RECORD SFI 1 record 1
+static const unsigned char t_record[] = {
+    0x70, 0x82, 0x01, 0x1a, 0x5a, 0x08, 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x00, 0x10, 0x5f, 0x24,
+    0x03, 0x22, 0x12, 0x31, 0x5f, 0x25, 0x03, 0x17, 0x01, 0x01, 0x5f, 0x28, 0x02, 0x00, 0x56, 0x9f,
+    0x07, 0x02, 0xff, 0x00, 0x8e, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x03,
+    0x1e, 0x03, 0x1f, 0x03, 0x9f, 0x0d, 0x05, 0xf0, 0x40, 0x64, 0x20, 0x00, 0x9f, 0x0e, 0x05, 0x00,
+    0x10, 0x00, 0x00, 0x00, 0x9f, 0x0f, 0x05, 0xf0, 0x40, 0x64, 0x98, 0x00, 0x5f, 0x20, 0x0f, 0x43,
+    0x41, 0x52, 0x44, 0x48, 0x4f, 0x4c, 0x44, 0x45, 0x52, 0x2f, 0x56, 0x49, 0x53, 0x41, 0x9f, 0x4a,
+    0x01, 0x82, 0x8c, 0x21, 0x9f, 0x02, 0x06, 0x9f, 0x03, 0x06, 0x9f, 0x1a, 0x02, 0x95, 0x05, 0x5f,
+    0x2a, 0x02, 0x9a, 0x03, 0x9c, 0x01, 0x9f, 0x37, 0x04, 0x9f, 0x35, 0x01, 0x9f, 0x45, 0x02, 0x9f,
+    0x4c, 0x08, 0x9f, 0x34, 0x03, 0x8d, 0x0c, 0x91, 0x0a, 0x8a, 0x02, 0x95, 0x05, 0x9f, 0x37, 0x04,
+    0x9f, 0x4c, 0x08, 0x9f, 0x46, 0x81, 0x80, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+    0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
+    0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+    0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f, 0x9f, 0x47, 0x01, 0x03, 0x8f, 0x01, 0x92
+};
+
+// GET DATA, several tags in a row
+static const unsigned char t_multi[] = {
+    0x9f, 0x13, 0x02, 0x00, 0x61, 0x9f, 0x17, 0x01, 0x03, 0x9f, 0x36, 0x02, 0x00, 0x62, 0x9f, 0x4f,
+    0x1a, 0x9f, 0x27, 0x01, 0x9f, 0x02, 0x06, 0x5f, 0x2a, 0x02, 0x9a, 0x03, 0x9f, 0x36, 0x02, 0x9f,
+    0x52, 0x06, 0xdf, 0x3e, 0x01, 0x9f, 0x21, 0x03, 0x9f, 0x7c, 0x14
+};
+
+struct tlv_sample {
+    const char *name;
+    const unsigned char *buf;
+    size_t len;
+};
+
+static const struct tlv_sample tlv_samples[] = {
+    { "ppse",   t_ppse,   sizeof(t_ppse) },
+    { "fci",    t_fci,    sizeof(t_fci) },
+    { "gpo",    t_gpo,    sizeof(t_gpo) },
+    { "record", t_record, sizeof(t_record) },
+    { "multi",  t_multi,  sizeof(t_multi) },
+};
+
+// tags an EMV transaction looks up, the last one isn't in any sample
+static const tlv_tag_t tlv_lookups[] = {
+    0x4f, 0x50, 0x57, 0x5a, 0x82, 0x8c, 0x8e, 0x94, 0x9f36, 0x9f38, 0x9f46, 0x9f4f, 0x9f7f,
+};
+
+// the node based parse, as done for a caller allocated root
+static struct tlvdb_root *tlv_parse_nodes(const unsigned char *buf, size_t len) {
+    struct tlvdb_root *root = calloc(1, sizeof(*root) + len);
+    if (root == NULL) {
+        return NULL;
+    }
+
+    root->len = len;
+    memcpy(root->buf, buf, len);
+    if (tlvdb_parse_root_multi(root) == false) {
+        tlvdb_root_free(root);
+        return NULL;
+    }
+    return root;
+}
+
+static size_t tlv_offs(const struct tlv *tlv, const unsigned char *buf) {
+    return (tlv) ? (size_t)(tlv->value - buf) : SIZE_MAX;
+}
+
+static bool tlv_test_same_tree(const struct tlvdb *a, const unsigned char *abuf, const struct tlvdb *b, const unsigned char *bbuf) {
+    for (; a && b; a = a->next, b = b->next) {
+        if (a->tag.tag != b->tag.tag || a->tag.len != b->tag.len || tlv_offs(&a->tag, abuf) != tlv_offs(&b->tag, bbuf)) {
+            return false;
+        }
+        if (tlv_test_same_tree(a->children, abuf, b->children, bbuf) == false) {
+            return false;
+        }
+    }
+    return (a == NULL && b == NULL);
+}
+
+// every lookup on the arena has to end on the same element as the walk over the nodes
+static bool tlv_test_same_lookups(struct tlvdb *a, const unsigned char *abuf, struct tlvdb *b, const unsigned char *bbuf, tlv_tag_t tag) {
+    const struct tlvdb *fa = tlvdb_find_full(a, tag);
+    const struct tlvdb *fb = tlvdb_find_full(b, tag);
+    if (tlv_offs(fa ? &fa->tag : NULL, abuf) != tlv_offs(fb ? &fb->tag : NULL, bbuf)) {
+        return false;
+    }
+
+    const struct tlv *ta = NULL, *tb = NULL;
+    do {
+        ta = tlvdb_get(a, tag, ta);
+        tb = tlvdb_get(b, tag, tb);
+        if (tlv_offs(ta, abuf) != tlv_offs(tb, bbuf)) {
+            return false;
+        }
+    } while (ta && tb);
+
+    return true;
+}
+
+static int tlv_test_parse(bool verbose) {
+    for (size_t i = 0; i < ARRAYLEN(tlv_samples); i++) {
+        const struct tlv_sample *s = &tlv_samples[i];
+
+        struct tlvdb *db = tlvdb_parse_multi(s->buf, s->len);
+        struct tlvdb_root *nodes = tlv_parse_nodes(s->buf, s->len);
+        if (db == NULL || nodes == NULL) {
+            PrintAndLogEx(WARNING, "%s: parse failed", s->name);
+            tlvdb_free(db);
+            tlvdb_root_free(nodes);
+            return 1;
+        }
+
+        const unsigned char *abuf = ((struct tlvdb_root *)db)->buf;
+        bool ok = tlv_test_same_tree(db, abuf, &nodes->db, nodes->buf);
+
+        // with the arena behind another element, like the EMV commands keep their data
+        struct tlvdb *host = tlvdb_external(0x01, 0, NULL);
+        tlvdb_add(host, db);
+
+        for (size_t j = 0; ok && j < ARRAYLEN(tlv_lookups); j++) {
+            ok = tlv_test_same_lookups(db, abuf, &nodes->db, nodes->buf, tlv_lookups[j]) &&
+                 tlv_test_same_lookups(host, abuf, &nodes->db, nodes->buf, tlv_lookups[j]);
+        }
+
+        if (verbose) {
+            PrintAndLogEx(INFO, "%-8s %3zu bytes  %s", s->name, s->len, ok ? _GREEN_("ok") : _RED_("fail"));
+        }
+
+        tlvdb_free(host);
+        tlvdb_root_free(nodes);
+        if (ok == false) {
+            return 1;
+        }
+    }
+
+    // a single element with trailing data is rejected
+    if (tlvdb_parse(t_multi, sizeof(t_multi)) != NULL) {
+        return 1;
+    }
+    // and so is a truncated one
+    if (tlvdb_parse_multi(t_record, sizeof(t_record) - 1) != NULL) {
+        return 1;
+    }
+    return 0;
+}
+
+static int tlv_test_change(bool verbose) {
+    const unsigned char atc[] = { 0x00, 0x63 };
+    const unsigned char amount[] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00 };
+
+    struct tlvdb *db = tlvdb_parse(t_gpo, sizeof(t_gpo));
+    if (db == NULL) {
+        return 1;
+    }
+
+    // replace an element inside the template, add one and chain another parsed response
+    tlvdb_change_or_add_node(db, 0x9f36, sizeof(atc), atc);
+    tlvdb_change_or_add_node(db, 0x9f02, sizeof(amount), amount);
+    tlvdb_add(db, tlvdb_parse_multi(t_multi, sizeof(t_multi)));
+
+    const struct tlv *tlv = tlvdb_get(db, 0x9f36, NULL);
+    bool ok = (tlv && tlv->len == sizeof(atc) && memcmp(tlv->value, atc, sizeof(atc)) == 0);
+
+    // the second 9F36 lives in the chained response
+    tlv = tlvdb_get(db, 0x9f36, tlv);
+    ok = ok && (tlv && tlv->len == 2 && memcmp(tlv->value, "\x00\x62", 2) == 0);
+    ok = ok && (tlvdb_get(db, 0x9f36, tlv) == NULL);
+
+    struct tlvdb *elm = tlvdb_find_full(db, 0x9f02);
+    ok = ok && (elm && elm->tag.len == sizeof(amount));
+    ok = ok && (tlvdb_find_full(db, 0x9f4f) != NULL);
+    ok = ok && (tlvdb_find_full(db, 0x5f34) != NULL);
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "change and add  %s", ok ? _GREEN_("ok") : _RED_("fail"));
+    }
+
+    tlvdb_free(db);
+    return (ok) ? 0 : 1;
+}
+
+// replaces the first top level element of a multi parse, its siblings share the allocation
+static int tlv_test_change_multi(bool verbose) {
+    const unsigned char resp[] = { 0x9f, 0x13, 0x02, 0x00, 0x10, 0x9f, 0x17, 0x01, 0x03, 0x9f, 0x36, 0x02, 0x00, 0x63 };
+    const unsigned char lastonline[] = { 0x00, 0x42 };
+    const unsigned char amount[] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00 };
+
+    struct tlvdb *db = tlvdb_external(0x9f02, sizeof(amount), amount);
+    if (db == NULL) {
+        return 1;
+    }
+    tlvdb_add(db, tlvdb_parse_multi(resp, sizeof(resp)));
+
+    tlvdb_change_or_add_node(db, 0x9f13, sizeof(lastonline), lastonline);
+
+    const struct tlv *tlv = tlvdb_get(db, 0x9f13, NULL);
+    bool ok = (tlv && tlv->len == sizeof(lastonline) && memcmp(tlv->value, lastonline, sizeof(lastonline)) == 0);
+    tlv = tlvdb_get(db, 0x9f17, NULL);
+    ok = ok && (tlv && tlv->len == 1 && tlv->value[0] == 0x03);
+    tlv = tlvdb_get(db, 0x9f36, NULL);
+    ok = ok && (tlv && tlv->len == 2 && memcmp(tlv->value, "\x00\x63", 2) == 0);
+    ok = ok && (tlvdb_find_full(db, 0x9f36) != NULL);
+
+    // and the remaining ones, the allocation goes with the last
+    tlvdb_change_or_add_node(db, 0x9f17, 1, (const unsigned char *)"\x05");
+    tlv = tlvdb_get(db, 0x9f36, NULL);
+    ok = ok && (tlv && tlv->len == 2 && memcmp(tlv->value, "\x00\x63", 2) == 0);
+    tlvdb_change_or_add_node(db, 0x9f36, 2, (const unsigned char *)"\x00\x64");
+    tlv = tlvdb_get(db, 0x9f36, NULL);
+    ok = ok && (tlv && tlv->len == 2 && memcmp(tlv->value, "\x00\x64", 2) == 0);
+    tlv = tlvdb_get(db, 0x9f17, NULL);
+    ok = ok && (tlv && tlv->len == 1 && tlv->value[0] == 0x05);
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "change multi    %s", ok ? _GREEN_("ok") : _RED_("fail"));
+    }
+
+    tlvdb_free(db);
+    return (ok) ? 0 : 1;
+}
+
+static uint64_t tlv_bench_arena(const struct tlv_sample *s, size_t rounds) {
+    uint64_t t = usclock();
+    for (size_t i = 0; i < rounds; i++) {
+        struct tlvdb *db = tlvdb_parse_multi(s->buf, s->len);
+        for (size_t j = 0; j < ARRAYLEN(tlv_lookups); j++) {
+            tlvdb_find_full(db, tlv_lookups[j]);
+        }
+        tlvdb_free(db);
+    }
+    return usclock() - t;
+}
+
+static uint64_t tlv_bench_nodes(const struct tlv_sample *s, size_t rounds) {
+    uint64_t t = usclock();
+    for (size_t i = 0; i < rounds; i++) {
+        struct tlvdb_root *root = tlv_parse_nodes(s->buf, s->len);
+        for (size_t j = 0; j < ARRAYLEN(tlv_lookups); j++) {
+            tlvdb_find_full(&root->db, tlv_lookups[j]);
+        }
+        tlvdb_root_free(root);
+    }
+    return usclock() - t;
+}
+
+// parse, look up the usual tags and free every captured response
+static void tlv_bench(bool verbose, bool include_slow_tests) {
+    size_t rounds = (include_slow_tests) ? 200000 : 20000;
+
+    if (verbose == false) {
+        return;
+    }
+
+    PrintAndLogEx(INFO, "parse + %zu lookups + free, %zu rounds", ARRAYLEN(tlv_lookups), rounds);
+    for (size_t i = 0; i < ARRAYLEN(tlv_samples); i++) {
+        const struct tlv_sample *s = &tlv_samples[i];
+        uint64_t ta = tlv_bench_arena(s, rounds);
+        uint64_t tn = tlv_bench_nodes(s, rounds);
+
+        PrintAndLogEx(INFO, "%-8s arena " _YELLOW_("%6.3f") " us  nodes " _YELLOW_("%6.3f") " us"
+                      , s->name
+                      , (double)ta / rounds
+                      , (double)tn / rounds
+                     );
+    }
+}
+
+int exec_tlv_test(bool verbose, bool include_slow_tests) {
+    int ret = tlv_test_parse(verbose);
+    if (ret) {
+        PrintAndLogEx(WARNING, "TLV parse test ( %s )", _RED_("fail"));
+        return ret;
+    }
+    PrintAndLogEx(SUCCESS, "TLV parse test ( %s )", _GREEN_("ok"));
+
+    ret = tlv_test_change(verbose);
+    if (ret) {
+        PrintAndLogEx(WARNING, "TLV change test ( %s )", _RED_("fail"));
+        return ret;
+    }
+    PrintAndLogEx(SUCCESS, "TLV change test ( %s )", _GREEN_("ok"));
+
+    ret = tlv_test_change_multi(verbose);
+    if (ret) {
+        PrintAndLogEx(WARNING, "TLV change multi test ( %s )", _RED_("fail"));
+        return ret;
+    }
+    PrintAndLogEx(SUCCESS, "TLV change multi test ( %s )", _GREEN_("ok"));
+
+    tlv_bench(verbose, include_slow_tests);
+    return 0;
+}
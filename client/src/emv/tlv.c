@@ -113,9 +113,151 @@ bool tlv_parse_tl(const unsigned char **buf, size_t *len, struct tlv *tlv) {
     return true;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent);
+// tlvdb_parse() and tlvdb_parse_multi() put the root, the input copy and all nodes into
+// one allocation. Nodes are laid out in parse order, which is the order tlvdb_find_full()
+// and tlvdb_get() walk them, so a sorted tag index answers those without walking the tree.
+// Anything that changes the links inside the arena marks it dirty and the walk is used again.
+// Appending after the last top level node (tlvdb_add) keeps the index valid.
+// Top level nodes can be replaced one by one, the allocation goes with the last of them.
+struct tlvdb_arena_tag {
+    tlv_tag_t tag;
+    uint32_t first;
+};
+
+struct tlvdb_arena {
+    struct tlvdb *root;             // first node, start of the allocation
+    struct tlvdb *tail;             // last top level node
+    struct tlvdb *nodes;            // all other nodes, in parse order
+    size_t count;                   // number of nodes including the root
+    size_t used;
+    struct tlvdb_arena_tag *tags;   // sorted by tag
+    size_t tags_count;
+    uint32_t *next_same;            // position of the next node with the same tag or count
+    size_t live;                    // top level nodes not freed yet
+    bool indexed;
+    bool dirty;
+};
+
+#define TLV_ARENA_ALIGN(x)  (((x) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+static struct tlvdb *tlvdb_alloc(struct tlvdb_arena *arena) {
+    if (arena == NULL) {
+        return calloc(1, sizeof(struct tlvdb));
+    }
+
+    if (arena->used + 1 >= arena->count) {
+        return NULL;
+    }
+    return &arena->nodes[arena->used++];
+}
+
+static struct tlvdb *tlvdb_arena_node(const struct tlvdb_arena *arena, size_t pos) {
+    return (pos == 0) ? arena->root : &arena->nodes[pos - 1];
+}
+
+static size_t tlvdb_arena_pos(const struct tlvdb_arena *arena, const struct tlvdb *tlvdb) {
+    return (tlvdb == arena->root) ? 0 : (size_t)(tlvdb - arena->nodes) + 1;
+}
+
+static bool tlvdb_arena_clean(const struct tlvdb *tlvdb) {
+    return tlvdb->arena != NULL && tlvdb->arena->dirty == false;
+}
+
+static void tlvdb_touch(struct tlvdb *tlvdb) {
+    if (tlvdb && tlvdb->arena) {
+        tlvdb->arena->dirty = true;
+    }
+}
+
+// validates and counts the elements the way tlvdb_parse_one() builds them
+static bool tlv_count_one(const unsigned char **tmp, size_t *left, size_t *count) {
+    struct tlv tlv;
+
+    tlv.tag = tlv_parse_tag(tmp, left);
+    if (tlv.tag == TLV_TAG_INVALID)
+        return false;
+
+    tlv.len = tlv_parse_len(tmp, left);
+    if (tlv.len == TLV_LEN_INVALID || tlv.len > *left)
+        return false;
+
+    const unsigned char *value = *tmp;
+    size_t vleft = tlv.len;
+
+    *tmp += tlv.len;
+    *left -= tlv.len;
+    (*count)++;
+
+    if (tlv_is_constructed(&tlv)) {
+        while (vleft != 0) {
+            if (tlv_count_one(&value, &vleft, count) == false) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// built on the first lookup, a lot of responses are only parsed to be printed
+static void tlvdb_arena_index(struct tlvdb_arena *arena) {
+    struct tlvdb_arena_tag *tags = arena->tags;
+
+    // insertion sort, stable so equal tags stay in parse order. Responses have a few dozen elements
+    for (size_t i = 0; i < arena->count; i++) {
+        struct tlvdb_arena_tag cur = { tlvdb_arena_node(arena, i)->tag.tag, i };
+        size_t j = i;
+        for (; j > 0 && tags[j - 1].tag > cur.tag; j--) {
+            tags[j] = tags[j - 1];
+        }
+        tags[j] = cur;
+    }
+
+    // chain the positions of every tag and keep its first one
+    size_t n = 0;
+    for (size_t i = 0; i < arena->count; i++) {
+        struct tlvdb_arena_tag cur = tags[i];
+        bool last = (i + 1 == arena->count) || (tags[i + 1].tag != cur.tag);
+
+        arena->next_same[cur.first] = last ? arena->count : tags[i + 1].first;
+        if (i == 0 || tags[n - 1].tag != cur.tag) {
+            tags[n++] = cur;
+        }
+    }
+    arena->tags_count = n;
+    arena->indexed = true;
+}
+
+// first node at position pos or later with the tag, NULL if there is none in the arena
+static struct tlvdb *tlvdb_arena_find(struct tlvdb_arena *arena, tlv_tag_t tag, size_t pos) {
+    if (arena->indexed == false) {
+        tlvdb_arena_index(arena);
+    }
+
+    size_t lo = 0, hi = arena->tags_count;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (arena->tags[mid].tag < tag)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == arena->tags_count || arena->tags[lo].tag != tag) {
+        return NULL;
+    }
 
-static bool tlvdb_parse_one(struct tlvdb *tlvdb,
+    size_t i = arena->tags[lo].first;
+    while (i < pos) {
+        i = arena->next_same[i];
+    }
+    return (i < arena->count) ? tlvdb_arena_node(arena, i) : NULL;
+}
+
+static struct tlvdb *tlvdb_parse_children(struct tlvdb_arena *arena, struct tlvdb *parent);
+
+static bool tlvdb_parse_one(struct tlvdb_arena *arena,
+                            struct tlvdb *tlvdb,
                             struct tlvdb *parent,
                             const unsigned char **tmp,
                             size_t *left) {
@@ -124,6 +266,7 @@ static bool tlvdb_parse_one(struct tlvdb *tlvdb,
     }
     tlvdb->next = tlvdb->children = NULL;
     tlvdb->parent = parent;
+    tlvdb->arena = arena;
 
     tlvdb->tag.tag = tlv_parse_tag(tmp, left);
     if (tlvdb->tag.tag == TLV_TAG_INVALID)
@@ -142,7 +285,7 @@ static bool tlvdb_parse_one(struct tlvdb *tlvdb,
     *left -= tlvdb->tag.len;
 
     if (tlv_is_constructed(&tlvdb->tag) && (tlvdb->tag.len != 0)) {
-        tlvdb->children = tlvdb_parse_children(tlvdb);
+        tlvdb->children = tlvdb_parse_children(arena, tlvdb);
         if (!tlvdb->children)
             goto err;
     } else {
@@ -155,7 +298,7 @@ err:
     return false;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent) {
+static struct tlvdb *tlvdb_parse_children(struct tlvdb_arena *arena, struct tlvdb *parent) {
     if (parent == NULL) {
         return NULL;
     }
@@ -164,7 +307,7 @@ static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent) {
     struct tlvdb *tlvdb, *first = NULL, *prev = NULL;
 
     while (left != 0) {
-        tlvdb = calloc(1, sizeof(*tlvdb));
+        tlvdb = tlvdb_alloc(arena);
         if (tlvdb == NULL) {
             goto err;
         }
@@ -174,7 +317,7 @@ static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent) {
             first = tlvdb;
         prev = tlvdb;
 
-        if (!tlvdb_parse_one(tlvdb, parent, &tmp, &left))
+        if (!tlvdb_parse_one(arena, tlvdb, parent, &tmp, &left))
             goto err;
 
         tlvdb->parent = parent;
@@ -188,6 +331,48 @@ err:
     return NULL;
 }
 
+static struct tlvdb_root *tlvdb_arena_new(const unsigned char *buf, size_t len, bool multi) {
+    const unsigned char *tmp = buf;
+    size_t left = len;
+    size_t count = 0;
+
+    do {
+        if (tlv_count_one(&tmp, &left, &count) == false) {
+            return NULL;
+        }
+    } while (multi && left != 0);
+
+    if (left != 0) {
+        return NULL;
+    }
+
+    size_t arena_offs = TLV_ARENA_ALIGN(sizeof(struct tlvdb_root) + len);
+    size_t nodes_offs = TLV_ARENA_ALIGN(arena_offs + sizeof(struct tlvdb_arena));
+    size_t tags_offs = TLV_ARENA_ALIGN(nodes_offs + (count - 1) * sizeof(struct tlvdb));
+    size_t next_offs = TLV_ARENA_ALIGN(tags_offs + count * sizeof(struct tlvdb_arena_tag));
+
+    uint8_t *mem = calloc(1, next_offs + count * sizeof(uint32_t));
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    struct tlvdb_root *root = (struct tlvdb_root *)mem;
+    root->len = len;
+    memcpy(root->buf, buf, len);
+
+    struct tlvdb_arena *arena = (struct tlvdb_arena *)(mem + arena_offs);
+    arena->root = &root->db;
+    arena->tail = &root->db;
+    arena->nodes = (struct tlvdb *)(mem + nodes_offs);
+    arena->count = count;
+    arena->tags = (struct tlvdb_arena_tag *)(mem + tags_offs);
+    arena->next_same = (uint32_t *)(mem + next_offs);
+    arena->live = 1;
+    root->db.arena = arena;
+
+    return root;
+}
+
 struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len) {
     struct tlvdb_root *root;
     const unsigned char *tmp;
@@ -196,17 +381,15 @@ struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len) {
     if (!len || !buf)
         return NULL;
 
-    root = calloc(1, sizeof(*root) + len);
+    root = tlvdb_arena_new(buf, len, false);
     if (root == NULL) {
         return NULL;
     }
-    root->len = len;
-    memcpy(root->buf, buf, len);
 
     tmp = root->buf;
     left = len;
 
-    if (!tlvdb_parse_one(&root->db, NULL, &tmp, &left))
+    if (!tlvdb_parse_one(root->db.arena, &root->db, NULL, &tmp, &left))
         goto err;
 
     if (left)
@@ -228,33 +411,33 @@ struct tlvdb *tlvdb_parse_multi(const unsigned char *buf, size_t len) {
         return NULL;
     }
 
-    root = calloc(1, sizeof(*root) + len);
+    root = tlvdb_arena_new(buf, len, true);
     if (root == NULL) {
         return NULL;
     }
 
-    root->len = len;
-    memcpy(root->buf, buf, len);
+    struct tlvdb_arena *arena = root->db.arena;
 
     tmp = root->buf;
     left = len;
 
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == false) {
+    if (tlvdb_parse_one(arena, &root->db, NULL, &tmp, &left) == false) {
         goto err;
     }
 
     while (left != 0) {
-        struct tlvdb *db = calloc(1, sizeof(*db));
+        struct tlvdb *db = tlvdb_alloc(arena);
         if (db == NULL) {
             goto err;
         }
 
-        if (tlvdb_parse_one(db, NULL, &tmp, &left) == false) {
-            free(db);
+        if (tlvdb_parse_one(arena, db, NULL, &tmp, &left) == false) {
             goto err;
         }
 
-        tlvdb_add(&root->db, db);
+        arena->tail->next = db;
+        arena->tail = db;
+        arena->live++;
     }
 
     return &root->db;
@@ -274,7 +457,7 @@ bool tlvdb_parse_root(struct tlvdb_root *root) {
 
     tmp = root->buf;
     left = root->len;
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == true) {
+    if (tlvdb_parse_one(NULL, &root->db, NULL, &tmp, &left) == true) {
         if (left == 0) {
             return true;
         }
@@ -292,13 +475,13 @@ bool tlvdb_parse_root_multi(struct tlvdb_root *root) {
 
     tmp = root->buf;
     left = root->len;
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == true) {
+    if (tlvdb_parse_one(NULL, &root->db, NULL, &tmp, &left) == true) {
         while (left > 0) {
             struct tlvdb *db = calloc(1, sizeof(*db));
             if (db == NULL) {
                 return false;
             }
-            if (tlvdb_parse_one(db, NULL, &tmp, &left) == true) {
+            if (tlvdb_parse_one(NULL, db, NULL, &tmp, &left) == true) {
                 tlvdb_add(&root->db, db);
             } else {
                 free(db);
@@ -353,7 +536,16 @@ void tlvdb_free(struct tlvdb *tlvdb) {
     for (; tlvdb; tlvdb = next) {
         next = tlvdb->next;
         tlvdb_free(tlvdb->children);
-        free(tlvdb);
+
+        if (tlvdb->arena == NULL) {
+            free(tlvdb);
+        } else if (tlvdb->parent == NULL) {
+            // other top level nodes may still point into this allocation
+            struct tlvdb_arena *arena = tlvdb->arena;
+            if (--arena->live == 0) {
+                free(arena->root);
+            }
+        }
     }
 }
 
@@ -400,6 +592,15 @@ struct tlvdb *tlvdb_find_full(struct tlvdb *tlvdb, tlv_tag_t tag) {
     }
 
     for (; tlvdb; tlvdb = tlvdb->next) {
+        if (tlvdb_arena_clean(tlvdb) && tlvdb->arena->root == tlvdb) {
+            struct tlvdb *found = tlvdb_arena_find(tlvdb->arena, tag, 0);
+            if (found) {
+                return found;
+            }
+            tlvdb = tlvdb->arena->tail;
+            continue;
+        }
+
         if (tlvdb->tag.tag == tag) {
             return tlvdb;
         }
@@ -443,6 +644,9 @@ void tlvdb_add(struct tlvdb *tlvdb, struct tlvdb *other) {
         tlvdb = tlvdb->next;
     }
 
+    if (tlvdb->arena && tlvdb->arena->tail != tlvdb) {
+        tlvdb_touch(tlvdb);
+    }
     tlvdb->next = other;
 }
 
@@ -464,6 +668,10 @@ void tlvdb_change_or_add_node_ex(struct tlvdb *tlvdb, tlv_tag_t tag, size_t len,
         }
 
         // replace tlv element
+        tlvdb_touch(tlvdb);
+        tlvdb_touch(telm);
+        tlvdb_touch(telm->parent);
+
         struct tlvdb *tnewelm = tlvdb_fixed(tag, len, value);
         bool tnewelm_linked = false;
         tnewelm->next = telm->next;
@@ -487,6 +695,7 @@ void tlvdb_change_or_add_node_ex(struct tlvdb *tlvdb, tlv_tag_t tag, size_t len,
             // find previous element
             for (; celm; celm = celm->next) {
                 if (celm->next == telm) {
+                    tlvdb_touch(celm);
                     celm->next = tnewelm;
                     tnewelm_linked = true;
                     break;
@@ -553,6 +762,17 @@ const struct tlv *tlvdb_get(const struct tlvdb *tlvdb, tlv_tag_t tag, const stru
 
 
     while (tlvdb) {
+        if (tlvdb_arena_clean(tlvdb)) {
+            struct tlvdb_arena *arena = tlvdb->arena;
+            struct tlvdb *found = tlvdb_arena_find(arena, tag, tlvdb_arena_pos(arena, tlvdb));
+            if (found) {
+                return &found->tag;
+            }
+            // the arena is done, go on after its last top level node
+            tlvdb = arena->tail->next;
+            continue;
+        }
+
         if (tlvdb->tag.tag == tag) {
             return &tlvdb->tag;
         }
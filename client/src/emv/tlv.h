@@ -26,6 +26,8 @@
 
 typedef uint32_t tlv_tag_t;
 
+struct tlvdb_arena;
+
 struct tlv {
     tlv_tag_t tag;
     size_t len;
@@ -37,6 +39,7 @@ struct tlvdb {
     struct tlvdb *next;
     struct tlvdb *parent;
     struct tlvdb *children;
+    struct tlvdb_arena *arena;  // set for nodes made by tlvdb_parse(_multi), freed with the last top level one
 };
 
 struct tlvdb_root {
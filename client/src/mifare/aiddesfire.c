@@ -23,6 +23,7 @@
 #include <string.h>
 #include "pm3_cmd.h"
 #include "fileutils.h"
+#include "rescache.h"
 #include "jansson.h"
 
 // NXP Appnote AN10787 - Application Directory (MAD)
@@ -222,58 +223,25 @@ const char *nxp_cluster_to_text(uint8_t cluster) {
 }
 
 static json_t *df_known_aids = NULL;
-static bool df_known_aids_load_tried = false;
-
-static int open_aiddf_file(json_t **root, bool verbose) {
-
-    char *path;
-    int res = searchFile(&path, RESOURCES_SUBDIR, "aid_desfire", ".json", true);
-    if (res != PM3_SUCCESS) {
-        return PM3_EFILE;
-    }
-
-    int retval = PM3_SUCCESS;
-    json_error_t error;
-
-    *root = NULL;
-    *root = json_load_file(path, 0, &error);
-    if (!*root) {
-        PrintAndLogEx(ERR, "json (%s) error on line %d: %s", path, error.line, error.text);
-        retval = PM3_ESOFT;
-        goto out;
-    }
-
-    if (!json_is_array(*root)) {
-        PrintAndLogEx(ERR, "Invalid json (%s) format. root must be an array.", path);
-        json_decref(*root);
-        *root = NULL;
-        retval = PM3_ESOFT;
-        goto out;
-    }
-
-    if (verbose) {
-        PrintAndLogEx(SUCCESS, "Loaded file `" _YELLOW_("%s") "` " _GREEN_("%zu") " records ( " _GREEN_("ok") " )"
-                      , path
-                      , json_array_size(*root)
-                     );
-    }
-
-out:
-    free(path);
-    return retval;
-}
 
+// aid_desfire.json is parsed once per session, see rescache.c
 static int ensure_aiddf_file_loaded(void) {
     if (df_known_aids != NULL) {
         return PM3_SUCCESS;
     }
 
-    if (df_known_aids_load_tried) {
+    json_t *root = rescache_get("aid_desfire", false);
+    if (root == NULL) {
         return PM3_EFILE;
     }
 
-    df_known_aids_load_tried = true;
-    return open_aiddf_file(&df_known_aids, false);
+    if (!json_is_array(root)) {
+        PrintAndLogEx(ERR, "Invalid json (aid_desfire) format. root must be an array.");
+        return PM3_ESOFT;
+    }
+
+    df_known_aids = root;
+    return PM3_SUCCESS;
 }
 
 static const char *aiddf_json_get_str_ex(json_t *data, const char *name, bool verbose) {
@@ -329,18 +297,20 @@ static json_t *find_aiddf_entry(json_t *root, uint32_t aid) {
         return NULL;
     }
 
-    for (uint32_t idx = 0; idx < json_array_size(root); idx++) {
-        json_t *data = json_array_get(root, idx);
+    char key[7] = {0};
+    snprintf(key, sizeof(key), "%06X", aid & 0xFFFFFF);
+
+    json_t *positions = rescache_index_get(rescache_index("aid_desfire", "AID"), key, strlen(key));
+    size_t i;
+    json_t *jpos;
+    json_array_foreach(positions, i, jpos) {
+        json_t *data = json_array_get(root, json_integer_value(jpos));
         if (!json_is_object(data)) {
             continue;
         }
 
         uint32_t db_aid = 0;
-        if (aiddf_parse_aid_str(aiddf_json_get_str_quiet(data, "AID"), &db_aid) == false) {
-            continue;
-        }
-
-        if (db_aid == aid) {
+        if (aiddf_parse_aid_str(aiddf_json_get_str_quiet(data, "AID"), &db_aid) && (db_aid == aid)) {
             return data;
         }
     }
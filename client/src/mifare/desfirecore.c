@@ -980,6 +980,178 @@ int DesfireExchange(DesfireContext_t *ctx, uint8_t cmd, uint8_t *data, size_t da
     return DesfireExchangeEx(false, ctx, cmd, data, datalen, respcode, resp, resplen, true, 0);
 }
 
+// Only the iso wrapped native commands, the firmware handles WTX for them.
+// D40 and EV1 chain the IV through every command and LRP keeps a running counter,
+// their next command can't be prepared before the answer to the last one is in.
+static bool DesfireQueueAllowed(DesfireContext_t *ctx) {
+    return (ctx->cmdSet == DCCNativeISO) && (ctx->secureChannel == DACNone || ctx->secureChannel == DACEV2);
+}
+
+typedef struct {
+    uint8_t apdu[APDU_RES_LEN];
+    int apdulen;
+    // secure channel state for decoding the answer
+    uint8_t lastCommand;
+    bool lastRequestZeroLen;
+    DesfireCommunicationMode commMode;
+} DesfireQueueFrame_t;
+
+// EV2 MACs and IVs only depend on the command counter, so a command is encoded
+// with the counter the card will have when it gets there.
+static int DesfireQueueEncode(DesfireContext_t *ctx, uint16_t cmdcntr, DesfireCommunicationMode commmode, DesfireQueueItem_t *item, DesfireQueueFrame_t *frame) {
+    uint16_t cntr = ctx->cmdCntr;
+    DesfireCommunicationMode mode = ctx->commMode;
+
+    ctx->cmdCntr = cmdcntr;
+    ctx->commMode = commmode;
+
+    uint8_t data[64] = {0};
+    size_t datalen = 0;
+    DesfireSecureChannelEncode(ctx, item->cmd, item->data, item->datalen, data, &datalen);
+
+    frame->lastCommand = ctx->lastCommand;
+    frame->lastRequestZeroLen = ctx->lastRequestZeroLen;
+    frame->commMode = ctx->commMode;
+
+    ctx->cmdCntr = cntr;
+    ctx->commMode = mode;
+
+    sAPDU_t apdu = {
+        .CLA = MFDES_NATIVE_ISO7816_WRAP_CLA, //0x90
+        .INS = item->cmd,
+        .P1 = 0,
+        .P2 = 0,
+        .Lc = datalen,
+        .data = data,
+    };
+
+    frame->apdulen = 0;
+    if (APDUEncodeS(&apdu, false, APDU_INCLUDE_LE_00, frame->apdu, &frame->apdulen)) {
+        PrintAndLogEx(ERR, "APDU encoding error.");
+        return PM3_EAPDU_ENCODEFAIL;
+    }
+    return PM3_SUCCESS;
+}
+
+static void DesfireQueueResult(DesfireQueueItem_t *item, const uint8_t *resp, size_t resplen) {
+    if (item->res == PM3_SUCCESS && item->respcode != MFDES_S_OPERATION_OK) {
+        item->res = PM3_EAPDU_FAIL;
+    }
+
+    item->resplen = MIN(resplen, sizeof(item->resp));
+    memcpy(item->resp, resp, item->resplen);
+}
+
+// Runs a list of independent commands. Up to DESFIRE_QUEUE_DEPTH commands are sent before the
+// first answer is read, the secure channel work for the next command is done while the card works
+// on the ones before. Answers must fit in one frame, a card asking for an additional frame fails the
+// command. Channels which can't be pipelined run the list one command after the other.
+// Each item gets its own result, the return value is PM3_SUCCESS unless the queue couldn't run.
+int DesfireExchangeQueue(DesfireContext_t *ctx, DesfireQueueItem_t *items, size_t count) {
+
+    if (DesfireQueueAllowed(ctx) == false) {
+        uint8_t *buf = calloc(DESFIRE_BUFFER_SIZE, 1);
+        if (buf == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            size_t buflen = 0;
+            items[i].respcode = 0xFF;
+            items[i].res = DesfireExchangeEx(false, ctx, items[i].cmd, items[i].data, items[i].datalen, &items[i].respcode, buf, &buflen, true, 0);
+            DesfireQueueResult(&items[i], buf, buflen);
+        }
+
+        free(buf);
+        return PM3_SUCCESS;
+    }
+
+    DesfireQueueFrame_t *frames = calloc(DESFIRE_QUEUE_DEPTH, sizeof(DesfireQueueFrame_t));
+    if (frames == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint16_t cmdcntr = ctx->cmdCntr;
+    DesfireCommunicationMode commmode = ctx->commMode;
+    int sendres = PM3_SUCCESS;
+    size_t sent = 0;
+
+    for (size_t done = 0; done < count; done++) {
+
+        // keep the pipe full, a command which can't be sent stops the queue there
+        while (sendres == PM3_SUCCESS && sent < count && sent < done + DESFIRE_QUEUE_DEPTH) {
+            DesfireQueueFrame_t *frame = &frames[sent % DESFIRE_QUEUE_DEPTH];
+
+            if (sent == 0 || items[sent].cmd != items[sent - 1].cmd) {
+                if (PrintChannelModeWarning(items[sent].cmd, ctx->secureChannel, ctx->cmdSet, commmode) == false) {
+                    DesfirePrintContext(ctx);
+                }
+            }
+
+            sendres = DesfireQueueEncode(ctx, cmdcntr + sent, commmode, &items[sent], frame);
+            if (sendres == PM3_SUCCESS) {
+                if (GetAPDULogging()) {
+                    PrintAndLogEx(SUCCESS, ">>>> %s", sprint_hex(frame->apdu, frame->apdulen));
+                }
+                sendres = SendAPDU14a(frame->apdu, frame->apdulen);
+            }
+
+            if (sendres == PM3_SUCCESS) {
+                sent++;
+            }
+        }
+
+        DesfireQueueItem_t *item = &items[done];
+        item->respcode = 0xFF;
+        item->resplen = 0;
+
+        if (done >= sent) {
+            item->res = sendres;
+            continue;
+        }
+
+        uint8_t buf[sizeof(item->resp) + 2] = {0};
+        int buflen = 0;
+        item->res = ReceiveAPDU14a(buf, sizeof(buf), &buflen);
+
+        if (item->res == PM3_SUCCESS) {
+            if (GetAPDULogging()) {
+                PrintAndLogEx(SUCCESS, "<<<< %s", sprint_hex(buf, buflen));
+            }
+
+            if (buflen >= 2) {
+                buflen -= 2;
+                uint16_t sw = (buf[buflen] << 8) | buf[buflen + 1];
+                if ((sw & 0xFF00) == 0x9100) {
+                    item->respcode = sw & 0xFF;
+                }
+            } else {
+                item->res = PM3_EAPDU_FAIL;
+            }
+        }
+
+        // like DesfireExchangeEx(), a failed command goes through the decoder with no data
+        if (item->res != PM3_SUCCESS || item->respcode != MFDES_S_OPERATION_OK) {
+            buflen = 0;
+        }
+
+        DesfireQueueFrame_t *frame = &frames[done % DESFIRE_QUEUE_DEPTH];
+        ctx->lastCommand = frame->lastCommand;
+        ctx->lastRequestZeroLen = frame->lastRequestZeroLen;
+        ctx->commMode = frame->commMode;
+
+        uint8_t data[sizeof(item->resp)] = {0};
+        size_t datalen = 0;
+        DesfireSecureChannelDecode(ctx, buf, buflen, item->respcode, data, &datalen);
+        DesfireQueueResult(item, data, datalen);
+    }
+
+    free(frames);
+    return PM3_SUCCESS;
+}
+
 int DesfireSelectAID(DesfireContext_t *ctx, uint8_t *aid1, uint8_t *aid2) {
     if (aid1 == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
@@ -2349,10 +2521,27 @@ int DesfireFillFileList(DesfireContext_t *dctx, FileList_t FileList, size_t *fil
     if (buflen == 0)
         return PM3_SUCCESS;
 
+    DesfireQueueItem_t *items = calloc(buflen, sizeof(DesfireQueueItem_t));
+    if (items == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
     for (int i = 0; i < buflen; i++) {
         FileList[i].fileNum = buf[i];
-        DesfireFileSettingsStruct(dctx, FileList[i].fileNum, &FileList[i].fileSettings);
+        items[i].cmd = MFDES_GET_FILE_SETTINGS;
+        items[i].data[0] = buf[i];
+        items[i].datalen = 1;
     }
+
+    DesfireExchangeQueue(dctx, items, buflen);
+
+    for (int i = 0; i < buflen; i++) {
+        if (items[i].res == PM3_SUCCESS && items[i].resplen > 0) {
+            DesfireFillFileSettings(items[i].resp, items[i].resplen, &FileList[i].fileSettings);
+        }
+    }
+    free(items);
     *filescount = buflen;
 
     buflen = 0;
@@ -2431,6 +2620,60 @@ int DesfireReadFile(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint3
     return DesfireCommand(dctx, (dctx->isoChaining) ? MFDES_READ_DATA2 : MFDES_READ_DATA, data, 7, resp, resplen, -1);
 }
 
+// ReadData in chunks whose answers fit in one frame, so they go through DesfireExchangeQueue()
+// instead of one additional frame round trip after the other.
+int DesfireReadFileChunked(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *resp, size_t *resplen) {
+    if (len == 0 || len > DESFIRE_BUFFER_SIZE || DesfireQueueAllowed(dctx) == false) {
+        return DesfireReadFile(dctx, fnum, offset, len, resp, resplen);
+    }
+
+    *resplen = 0;
+
+    // data, padding and MAC within the 59 bytes of a frame
+    uint32_t chunk = (dctx->commMode == DCMPlain || dctx->commMode == DCMMACed) ? 48 : 32;
+    size_t count = (len + chunk - 1) / chunk;
+
+    DesfireQueueItem_t *items = calloc(count, sizeof(DesfireQueueItem_t));
+    if (items == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t clen = MIN(chunk, len - i * chunk);
+        items[i].cmd = (dctx->isoChaining) ? MFDES_READ_DATA2 : MFDES_READ_DATA;
+        items[i].data[0] = fnum;
+        Uint3byteToMemLe(&items[i].data[1], offset + i * chunk);
+        Uint3byteToMemLe(&items[i].data[4], clen);
+        items[i].datalen = 7;
+    }
+
+    int res = DesfireExchangeQueue(dctx, items, count);
+
+    for (size_t i = 0; i < count && res == PM3_SUCCESS; i++) {
+        res = items[i].res;
+        if (res == PM3_SUCCESS) {
+            memcpy(&resp[*resplen], items[i].resp, items[i].resplen);
+            *resplen += items[i].resplen;
+        }
+    }
+
+    free(items);
+
+    if (res == PM3_EMALLOC) {
+        return res;
+    }
+
+    // a chunk failed, read the whole range the usual way so the caller gets
+    // the same data or status it would have without the queue
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(DEBUG, "chunked read failed ( %d ), falling back to a single ReadData", res);
+        *resplen = 0;
+        res = DesfireReadFile(dctx, fnum, offset, len, resp, resplen);
+    }
+    return res;
+}
+
 int DesfireWriteFile(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *data) {
     uint8_t xdata[1024] = {0};
     xdata[0] = fnum;
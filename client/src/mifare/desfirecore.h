@@ -28,6 +28,9 @@
 #define DESFIRE_TX_FRAME_MAX_LEN 54
 #define DESFIRE_BUFFER_SIZE 65538
 
+// commands DesfireExchangeQueue() keeps in flight
+#define DESFIRE_QUEUE_DEPTH 4
+
 enum DesfireISOSelectControlEnum {
     ISSMFDFEF     = 0x00,
     ISSChildDF    = 0x01,
@@ -100,6 +103,19 @@ typedef struct {
 
 typedef FileListElm_t FileList_t[32];
 
+// one command of DesfireExchangeQueue(), its answer must fit in one frame
+typedef struct {
+    uint8_t cmd;
+    uint8_t data[16];
+    size_t datalen;
+
+    // result
+    int res;
+    uint8_t respcode;
+    uint8_t resp[256];
+    size_t resplen;
+} DesfireQueueItem_t;
+
 typedef struct {
     bool checked;
     bool auth;
@@ -168,6 +184,7 @@ void DesfirePrintContext(DesfireContext_t *ctx);
 
 int DesfireExchange(DesfireContext_t *ctx, uint8_t cmd, uint8_t *data, size_t datalen, uint8_t *respcode, uint8_t *resp, size_t *resplen);
 int DesfireExchangeEx(bool activate_field, DesfireContext_t *ctx, uint8_t cmd, uint8_t *data, size_t datalen, uint8_t *respcode, uint8_t *resp, size_t *resplen, bool enable_chaining, size_t splitbysize);
+int DesfireExchangeQueue(DesfireContext_t *ctx, DesfireQueueItem_t *items, size_t count);
 
 int DesfireReadSignature(DesfireContext_t *dctx, uint8_t sid, uint8_t *resp, size_t *resplen);
 
@@ -258,6 +275,7 @@ int DesfireValueFileOperations(DesfireContext_t *dctx, uint8_t fid, uint8_t oper
 int DesfireClearRecordFile(DesfireContext_t *dctx, uint8_t fnum);
 
 int DesfireReadFile(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *resp, size_t *resplen);
+int DesfireReadFileChunked(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *resp, size_t *resplen);
 int DesfireWriteFile(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *data);
 int DesfireReadRecords(DesfireContext_t *dctx, uint8_t fnum, uint32_t recnum, uint32_t reccount, uint8_t *resp, size_t *resplen);
 int DesfireWriteRecord(DesfireContext_t *dctx, uint8_t fnum, uint32_t offset, uint32_t len, uint8_t *data);
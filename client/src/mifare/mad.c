@@ -23,6 +23,7 @@
 #include "crc.h"
 #include "util.h"
 #include "fileutils.h"
+#include "rescache.h"
 #include "jansson.h"
 #include "mifaredefault.h"
 #include "mifare4.h"
@@ -47,45 +48,19 @@ static const char *aid_admin[] = {
     "not applicable"
 };
 
+// mad.json is parsed once per session, see rescache.c
 static int open_mad_file(json_t **root, bool verbose) {
-    char *path;
-    int res = searchFile(&path, RESOURCES_SUBDIR, "mad", ".json", true);
-    if (res != PM3_SUCCESS) {
-        return PM3_EFILE;
-    }
 
-    int retval = PM3_SUCCESS;
-    json_error_t error;
-
-    *root = json_load_file(path, 0, &error);
-    if (!*root) {
-        PrintAndLogEx(ERR, "json (%s) error on line %d: %s", path, error.line, error.text);
-        retval = PM3_ESOFT;
-        goto out;
+    *root = rescache_get("mad", verbose);
+    if (*root == NULL) {
+        return PM3_EFILE;
     }
 
     if (!json_is_array(*root)) {
-        PrintAndLogEx(ERR, "Invalid json (%s) format. root must be an array.", path);
-        json_decref(*root);
+        PrintAndLogEx(ERR, "Invalid json (mad) format. root must be an array.");
         *root = NULL;
-        retval = PM3_ESOFT;
-        goto out;
-    }
-
-    if (verbose) {
-        PrintAndLogEx(SUCCESS, "Loaded file `" _YELLOW_("%s") "` " _GREEN_("%zu") " records ( " _GREEN_("ok") " )"
-                      , path
-                      , json_array_size(*root)
-                     );
+        return PM3_ESOFT;
     }
-
-out:
-    free(path);
-    return retval;
-}
-
-static int close_mad_file(json_t *root) {
-    json_decref(root);
     return PM3_SUCCESS;
 }
 
@@ -116,30 +91,18 @@ static json_t *mad_lookup_aid(json_t *root, uint16_t aid) {
     char lmad[7] = {0};
     snprintf(lmad, sizeof(lmad), "0x%04x", aid);
 
-    for (uint32_t idx = 0; idx < json_array_size(root); idx++) {
-
-        json_t *data = json_array_get(root, idx);
-        if (!json_is_object(data)) {
-            PrintAndLogEx(ERR, "data [%u] is not an object", idx);
-            continue;
-        }
-
-        const char *fmad = mad_json_get_str(data, "mad");
-        if (fmad == NULL) {
-            continue;
-        }
-
-        char lfmad[16];
-        strncpy(lfmad, fmad, sizeof(lfmad) - 1);
-        lfmad[sizeof(lfmad) - 1] = '\0';
-
-        str_lower(lfmad);
+    json_t *positions = rescache_index_get(rescache_index("mad", "mad"), lmad, strlen(lmad));
+    if (positions == NULL) {
+        return NULL;
+    }
 
-        if (strcmp(lmad, lfmad) == 0) {
-            return data;
-        }
+    json_int_t idx = json_integer_value(json_array_get(positions, 0));
+    json_t *data = json_array_get(root, idx);
+    if (!json_is_object(data)) {
+        PrintAndLogEx(ERR, "data [%" JSON_INTEGER_FORMAT "] is not an object", idx);
+        return NULL;
     }
-    return NULL;
+    return data;
 }
 
 static const char *mad_aid_description(json_t *elm) {
@@ -402,7 +365,6 @@ int MAD1DecodeAndPrint(const mad1_sector_t *sector, bool swapmad, bool verbose,
             prev_aid = aid;
         }
     }
-    close_mad_file(mad_known_aids);
     return PM3_SUCCESS;
 }
 
@@ -470,7 +432,6 @@ int MAD2DecodeAndPrint(const mad2_sector_t *sector, bool swapmad, bool verbose)
             prev_aid = aid;
         }
     }
-    close_mad_file(mad_known_aids);
 
     return PM3_SUCCESS;
 }
@@ -488,7 +449,6 @@ int MADDFDecodeAndPrint(uint32_t short_aid, bool verbose) {
         mad_print_aid_verbose(elm);
     }
 
-    close_mad_file(mad_known_aids);
     return PM3_SUCCESS;
 }
 
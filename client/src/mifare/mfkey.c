@@ -18,6 +18,8 @@
 //-----------------------------------------------------------------------------
 #include "mfkey.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include "crapto1/crapto1.h"
 
 // MIFARE
@@ -49,6 +51,71 @@ uint32_t intersection(uint64_t *listA, uint64_t *listB) {
     return p3 - listA;
 }
 
+// sort a list of 64-bit values ascending with a LSD radix sort, one byte per pass.
+// scratch must hold len values, if NULL it is allocated here.
+// Passes where every value has the same byte are skipped, which drops most of them for 48-bit keys.
+void radix_sort_uint64(uint64_t *list, uint32_t len, uint64_t *scratch) {
+    if (list == NULL || len < 2)
+        return;
+
+    uint64_t *tmp = scratch;
+    if (tmp == NULL) {
+        tmp = calloc(len, sizeof(uint64_t));
+        if (tmp == NULL) {
+            qsort(list, len, sizeof(uint64_t), compare_uint64);
+            return;
+        }
+    }
+
+    uint64_t *src = list;
+    uint64_t *dst = tmp;
+
+    for (uint8_t shift = 0; shift < 64; shift += 8) {
+
+        uint32_t count[0x100] = {0};
+        for (uint32_t i = 0; i < len; i++) {
+            count[(src[i] >> shift) & 0xFF]++;
+        }
+
+        if (count[(src[0] >> shift) & 0xFF] == len) {
+            continue;
+        }
+
+        uint32_t pos = 0;
+        for (uint16_t d = 0; d < 0x100; d++) {
+            uint32_t c = count[d];
+            count[d] = pos;
+            pos += c;
+        }
+
+        for (uint32_t i = 0; i < len; i++) {
+            dst[count[(src[i] >> shift) & 0xFF]++] = src[i];
+        }
+
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != list) {
+        memcpy(list, src, len * sizeof(uint64_t));
+    }
+
+    if (scratch == NULL) {
+        free(tmp);
+    }
+}
+
+// radix sort two -1 terminated lists of lenA / lenB values and intersect them. Result will be in listA.
+uint32_t radix_intersection(uint64_t *listA, uint32_t lenA, uint64_t *listB, uint32_t lenB, uint64_t *scratch) {
+    if (listA == NULL || listB == NULL)
+        return 0;
+
+    radix_sort_uint64(listA, lenA, scratch);
+    radix_sort_uint64(listB, lenB, scratch);
+    return intersection(listA, listB);
+}
+
 // Darkside attack (hf mf mifare)
 // if successful it will return a list of keys, not just one.
 uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t par_info, uint64_t ks_info, uint64_t **keys) {
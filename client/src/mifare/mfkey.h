@@ -31,5 +31,7 @@ int mfkey64(nonces_t *data, uint64_t *outputkey);
 
 int compare_uint64(const void *a, const void *b);
 uint32_t intersection(uint64_t *listA, uint64_t *listB);
+void radix_sort_uint64(uint64_t *list, uint32_t len, uint64_t *scratch);
+uint32_t radix_intersection(uint64_t *listA, uint32_t lenA, uint64_t *listB, uint32_t lenB, uint64_t *scratch);
 
 #endif
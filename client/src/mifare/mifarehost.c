@@ -164,7 +164,7 @@ int mf_dark_side(uint8_t blockno, uint8_t key_type, uint64_t *key) {
 
         // only parity zero attack
         if (par_list == 0) {
-            qsort(keylist, keycount, sizeof(*keylist), compare_uint64);
+            radix_sort_uint64(keylist, keycount, NULL);
             keycount = intersection(last_keylist, keylist);
             if (keycount == 0) {
                 free(last_keylist);
@@ -506,6 +506,85 @@ inline static int Compare16Bits(const void *a, const void *b) {
     return -1;
 }
 
+// Same order as qsort with Compare16Bits (descending on those 16 bits),
+// done as two counting sort passes. scratch must hold len values.
+static void Sort16Bits(uint64_t *list, uint32_t len, uint64_t *scratch) {
+    uint64_t *src = list;
+    uint64_t *dst = scratch;
+
+    // least significant byte (odd) first, then even.
+    const uint8_t shifts[] = { 16, 48 };
+    for (uint8_t n = 0; n < ARRAYLEN(shifts); n++) {
+
+        uint32_t count[0x100] = {0};
+        for (uint32_t i = 0; i < len; i++) {
+            count[0xFF - ((src[i] >> shifts[n]) & 0xFF)]++;
+        }
+
+        uint32_t pos = 0;
+        for (uint16_t d = 0; d < 0x100; d++) {
+            uint32_t c = count[d];
+            count[d] = pos;
+            pos += c;
+        }
+
+        for (uint32_t i = 0; i < len; i++) {
+            dst[count[0xFF - ((src[i] >> shifts[n]) & 0xFF)]++] = src[i];
+        }
+
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+    // two passes, sorted data is back in list
+}
+
+// crapto1 work memory for the two nested worker threads.
+// Kept between calls while a caller holds it via mf_nested_arena_init()
+static struct Crypto1Arena nested_arena[2];
+static bool nested_arena_kept = false;
+
+static bool nested_arena_get(void) {
+    if (nested_arena_kept) {
+        return true;
+    }
+
+    if (crypto1_arena_init(&nested_arena[0]) == false) {
+        return false;
+    }
+
+    if (crypto1_arena_init(&nested_arena[1]) == false) {
+        crypto1_arena_free(&nested_arena[0]);
+        return false;
+    }
+    return true;
+}
+
+static void nested_arena_put(void) {
+    if (nested_arena_kept) {
+        return;
+    }
+    crypto1_arena_free(&nested_arena[0]);
+    crypto1_arena_free(&nested_arena[1]);
+}
+
+int mf_nested_arena_init(void) {
+    if (nested_arena_kept) {
+        return PM3_SUCCESS;
+    }
+
+    if (nested_arena_get() == false) {
+        return PM3_EMALLOC;
+    }
+    nested_arena_kept = true;
+    return PM3_SUCCESS;
+}
+
+void mf_nested_arena_free(void) {
+    nested_arena_kept = false;
+    nested_arena_put();
+}
+
 // wrapper function for multi-threaded lfsr_recovery32
 static void
 #ifdef __has_attribute
@@ -516,23 +595,95 @@ __attribute__((force_align_arg_pointer))
 *nested_worker_thread(void *arg) {
     struct Crypto1State *p1;
     StateList_t *statelist = arg;
-    statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+    statelist->head.slhead = lfsr_recovery32_arena(statelist->ks1, statelist->nt_enc ^ statelist->uid, statelist->arena);
 
     for (p1 = statelist->head.slhead; p1->odd | p1->even; p1++) {};
 
     statelist->len = p1 - statelist->head.slhead;
     statelist->tail.sltail = --p1;
 
-    qsort(statelist->head.slhead, statelist->len, sizeof(uint64_t), Compare16Bits);
+    // the odd table isn't needed anymore after recovery, use it as scratch
+    Sort16Bits(statelist->head.keyhead, statelist->len, (uint64_t *)statelist->arena->odd);
 
     return statelist->head.slhead;
 }
 
+// run lfsr_recovery32 for both nonces and reduce the two statelists to the common key candidates.
+// Candidates end up in statelists[0], number of them is returned.
+static uint32_t nested_recover_keys(StateList_t *statelists) {
+    struct Crypto1State *p1, *p2, *p3, *p4;
+
+    statelists[0].arena = &nested_arena[0];
+    statelists[1].arena = &nested_arena[1];
+
+    // calc keys
+    pthread_t thread_id[2];
+
+    // create and run worker threads
+    for (uint8_t i = 0; i < 2; i++) {
+        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+    }
+
+    // wait for threads to terminate:
+    for (uint8_t i = 0; i < 2; i++) {
+        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
+    }
+
+    // the first 16 Bits of the cryptostate already contain part of our key.
+    // Create the intersection of the two lists based on these 16 Bits and
+    // roll back the cryptostate
+    p1 = p3 = statelists[0].head.slhead;
+    p2 = p4 = statelists[1].head.slhead;
+
+    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
+
+        if (Compare16Bits(p1, p2) == 0) {
+
+            struct Crypto1State savestate;
+
+            savestate = *p1;
+            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
+                *p3 = *p1;
+                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
+                p3++;
+                p1++;
+            }
+
+            savestate = *p2;
+            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
+                *p4 = *p2;
+                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
+                p4++;
+                p2++;
+            }
+
+        } else {
+            while (Compare16Bits(p1, p2) == -1) p1++;
+            while (Compare16Bits(p1, p2) == 1) p2++;
+        }
+    }
+
+    p3->odd = -1;
+    p3->even = -1;
+    p4->odd = -1;
+    p4->even = -1;
+    statelists[0].len = p3 - statelists[0].head.slhead;
+    statelists[1].len = p4 - statelists[1].head.slhead;
+    statelists[0].tail.sltail = --p3;
+    statelists[1].tail.sltail = --p4;
+
+    // the statelists now contain possible keys. The key we are searching for must be in the
+    // intersection of both lists
+    statelists[0].len = radix_intersection(statelists[0].head.keyhead, statelists[0].len,
+                                           statelists[1].head.keyhead, statelists[1].len,
+                                           (uint64_t *)statelists[0].arena->odd);
+    return statelists[0].len;
+}
+
 int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
 
     uint32_t uid = 0;
     StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
 
     struct {
         uint8_t block;
@@ -589,68 +740,12 @@ int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo
     memcpy(&statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
     memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
 
-    // calc keys
-    pthread_t thread_id[2];
-
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++) {
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
-    }
-
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++) {
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
-    }
-
-    // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
-    p1 = p3 = statelists[0].head.slhead;
-    p2 = p4 = statelists[1].head.slhead;
-
-    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-
-        if (Compare16Bits(p1, p2) == 0) {
-
-            struct Crypto1State savestate;
-
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
-                *p4 = *p2;
-                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
-                p4++;
-                p2++;
-            }
-
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
-        }
+    if (nested_arena_get() == false) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
     }
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
-    statelists[0].len = p3 - statelists[0].head.slhead;
-    statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
-
-    // the statelists now contain possible keys. The key we are searching for must be in the
-    // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
+    nested_recover_keys(statelists);
 
     bool looped = false;
 
@@ -687,8 +782,7 @@ int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo
                 PrintAndLogEx(NORMAL, "");
             }
 
-            free(statelists[0].head.slhead);
-            free(statelists[1].head.slhead);
+            nested_arena_put();
             num_to_bytes(key64, MIFARE_KEY_SIZE, resultKey);
 
             if (package->keytype < 2) {
@@ -729,8 +823,7 @@ out:
                       MIFARE_AUTH_KEYA + package->keytype
                      );
     }
-    free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
+    nested_arena_put();
     return PM3_ESOFT;
 }
 
@@ -738,7 +831,6 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
 
     uint32_t uid = 0;
     StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
 
     struct {
         uint8_t block;
@@ -790,62 +882,12 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
     memcpy(&statelists[1].nt_enc, package->nt_b, sizeof(package->nt_b));
     memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
 
-    // calc keys
-    pthread_t thread_id[2];
-
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
-
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
-
-    // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
-    p1 = p3 = statelists[0].head.slhead;
-    p2 = p4 = statelists[1].head.slhead;
-
-    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-        if (Compare16Bits(p1, p2) == 0) {
-
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
-                *p4 = *p2;
-                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
-                p4++;
-                p2++;
-            }
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
-        }
+    if (nested_arena_get() == false) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
     }
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
-    statelists[0].len = p3 - statelists[0].head.slhead;
-    statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
-
-    // the statelists now contain possible keys. The key we are searching for must be in the
-    // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
+    nested_recover_keys(statelists);
 
     uint32_t keycnt = statelists[0].len;
     if (keycnt == 0) {
@@ -870,7 +912,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
         mem = calloc((maxkeysinblock * MIFARE_KEY_SIZE) + 5, sizeof(uint8_t));
         if (mem == NULL) {
             PrintAndLogEx(WARNING, "Failed to allocate memory");
-            free(statelists[0].head.slhead);
+            nested_arena_put();
             return PM3_EMALLOC;
         }
 
@@ -887,7 +929,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
         mem = calloc((maxkeysinblock * MIFARE_KEY_SIZE), sizeof(uint8_t));
         if (mem == NULL) {
             PrintAndLogEx(WARNING, "Failed to allocate memory");
-            free(statelists[0].head.slhead);
+            nested_arena_put();
             return PM3_EMALLOC;
         }
         p_keyblock = mem;
@@ -902,6 +944,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
         while (kbd_enter_pressed()) {
             SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
             PrintAndLogEx(NORMAL, "");
+            nested_arena_put();
             free(mem);
             return PM3_EOPABORTED;
         }
@@ -926,6 +969,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
             res = flashmem_spiffs_load((char *)fn, mem, 5 + (chunk * MIFARE_KEY_SIZE));
             if (res != PM3_SUCCESS) {
                 PrintAndLogEx(WARNING, "\nSPIFFS upload failed");
+                nested_arena_put();
                 free(mem);
                 return res;
             }
@@ -936,7 +980,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
 
         if (res == PM3_SUCCESS) {
             p_keyblock = NULL;
-            free(statelists[0].head.slhead);
+            nested_arena_put();
             free(mem);
 
             num_to_bytes(key64, MIFARE_KEY_SIZE, resultKey);
@@ -953,6 +997,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
             return PM3_SUCCESS;
         } else if (res == PM3_ETIMEOUT || res == PM3_EOPABORTED) {
             PrintAndLogEx(NORMAL, "");
+            nested_arena_put();
             free(mem);
             return res;
         }
@@ -971,8 +1016,7 @@ out:
                   package->keytype ? 'B' : 'A'
                  );
 
-    free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
+    nested_arena_put();
     return PM3_ESOFT;
 }
 
@@ -1022,6 +1066,58 @@ int mf_read_block(uint8_t blockNo, uint8_t keyType, const uint8_t *key, uint8_t
     return PM3_SUCCESS;
 }
 
+// Whole card in one command, the device keeps the card selected and streams it back per sector.
+// readmask gets a bit per read block for every sector, sectorsread the number of sectors replied,
+// they arrive in order so these are sectors 0 .. sectorsread - 1.
+// Returns PM3_ENOTIMPL when nothing came back, ie the firmware doesn't know the command,
+// and PM3_ETIMEOUT when the replies stopped part way.
+int mf_read_card(uint8_t sectorcnt, const uint8_t *keyA, const uint8_t *keyB, uint8_t *carddata, uint16_t *readmask, uint8_t *sectorsread) {
+
+    if (sectorcnt > MIFARE_4K_MAXSECTOR) {
+        return PM3_EINVARG;
+    }
+
+    mf_dump_t payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.sectorcnt = sectorcnt;
+    memcpy(payload.keya, keyA, sectorcnt * MIFARE_KEY_SIZE);
+    memcpy(payload.keyb, keyB, sectorcnt * MIFARE_KEY_SIZE);
+    memset(readmask, 0, sectorcnt * sizeof(uint16_t));
+    *sectorsread = 0;
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_DUMP, (uint8_t *)&payload, sizeof(payload));
+
+    PacketResponseNG resp;
+    while (true) {
+
+        if (WaitForResponseTimeout(CMD_HF_MIFARE_DUMP, &resp, 2500) == false) {
+            PrintAndLogEx(DEBUG, "command execution time out");
+            return (*sectorsread) ? PM3_ETIMEOUT : PM3_ENOTIMPL;
+        }
+
+        // empty reply ends the dump
+        if (resp.length == 0) {
+            return resp.status;
+        }
+
+        const mf_dump_sector_t *sector = (const mf_dump_sector_t *)resp.data.asBytes;
+        if (sector->sector != *sectorsread || sector->sector >= sectorcnt || sector->blockcnt != mfNumBlocksPerSector(sector->sector)) {
+            PrintAndLogEx(DEBUG, "unexpected sector %u", sector->sector);
+            continue;
+        }
+
+        memcpy(carddata + (mfFirstBlockOfSector(sector->sector) * MFBLOCK_SIZE), sector->data, sector->blockcnt * MFBLOCK_SIZE);
+        readmask[sector->sector] = sector->readmask;
+        (*sectorsread)++;
+
+        PrintAndLogEx(INPLACE, "Sector... " _YELLOW_("%2d") " ( %s )"
+                      , sector->sector
+                      , (resp.status == PM3_SUCCESS) ? _GREEN_("ok") : _RED_("fail")
+                     );
+    }
+}
+
 int mf_write_block(uint8_t blockno, uint8_t keyType, const uint8_t *key, const uint8_t *block) {
 
     uint8_t data[26];
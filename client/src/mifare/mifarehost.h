@@ -53,6 +53,7 @@ typedef struct {
     uint32_t keyType;
     uint32_t nt_enc;
     uint32_t ks1;
+    struct Crypto1Arena *arena;
 } StateList_t;
 
 typedef struct {
@@ -73,6 +74,9 @@ typedef struct {
 int mf_dark_side(uint8_t blockno, uint8_t key_type, uint64_t *key);
 int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate);
 int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool forceDetectDist);
+// keep the nested recovery memory allocated across mf_nested / mf_static_nested calls until mf_nested_arena_free()
+int mf_nested_arena_init(void);
+void mf_nested_arena_free(void);
 int mf_check_keys(uint8_t blockNo, uint8_t keyType, bool clear_trace, uint8_t keycnt, uint8_t *keyBlock, uint64_t *key);
 int mf_check_keys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk,
                        uint8_t strategy, uint32_t size, uint8_t *keyBlock, sector_t *e_sector,
@@ -87,6 +91,7 @@ int mf_key_brute(uint8_t blockNo, uint8_t keyType, const uint8_t *key, uint64_t
 
 int mf_read_sector(uint8_t sectorNo, uint8_t keyType, const uint8_t *key, uint8_t *data);
 int mf_read_block(uint8_t blockNo, uint8_t keyType, const uint8_t *key, uint8_t *data);
+int mf_read_card(uint8_t sectorcnt, const uint8_t *keyA, const uint8_t *keyB, uint8_t *carddata, uint16_t *readmask, uint8_t *sectorsread);
 
 int mf_write_block(uint8_t blockno, uint8_t keyType, const uint8_t *key, const uint8_t *block);
 int mf_write_sector(uint8_t sectorNo, uint8_t keyType, const uint8_t *key, uint8_t *sector);
@@ -64,6 +64,7 @@ int pm3_console(pm3_device_t *dev, const char *cmd, bool capture, bool quiet) {
     uint8_t prev_printAndLog = g_printAndLog;
     if (capture) {
         g_printAndLog |= PRINTANDLOG_GRAB;
+        clear_record_grabber();
     }
     if (quiet) {
         g_printAndLog &= ~PRINTANDLOG_PRINT;
@@ -80,9 +81,9 @@ const char *pm3_name_get(pm3_device_t *dev) {
 const char *pm3_grabbed_output_get(pm3_device_t *dev) {
     if (g_grabbed_output.ptr != NULL) {
         char *tmp = g_grabbed_output.ptr;
-        tmp[g_grabbed_output.size] = 0;
+        tmp[g_grabbed_output.idx] = 0;
+        // keep the buffer, next capture starts over at the beginning
         g_grabbed_output.idx = 0;
-        g_grabbed_output.size = 0;
         return tmp;
     } else {
         return "";
@@ -92,3 +93,19 @@ const char *pm3_grabbed_output_get(pm3_device_t *dev) {
 pm3_device_t *pm3_get_current_dev(void) {
     return g_session.current_device;
 }
+
+void pm3_record_callback_set(pm3_device_t *dev, pm3_record_cb cb, void *userdata) {
+    // For now, there is no real device context:
+    (void) dev;
+    set_record_callback(cb, userdata);
+}
+
+size_t pm3_records_count(pm3_device_t *dev) {
+    (void) dev;
+    return grabbed_records_count();
+}
+
+const pm3_record *pm3_record_get(pm3_device_t *dev, size_t index) {
+    (void) dev;
+    return grabbed_record_get(index);
+}
@@ -18,6 +18,80 @@
         $1 = Py_True;
     }
 #endif
+
+%include "stdint.i"
+
+/* Typed records, see pm3.h */
+typedef enum {
+    PM3_RECORD_KEY,
+    PM3_RECORD_BLOCK,
+    PM3_RECORD_UID,
+    PM3_RECORD_TRACE,
+} pm3_record_type;
+
+#ifdef SWIGPYTHON
+%{
+/* Python callable handed to record_callback_set(), called with a record only valid during the call */
+static PyObject *pm3_py_record_cb_obj = NULL;
+
+static void pm3_py_record_cb(const pm3_record *rec, void *userdata) {
+    (void)userdata;
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyObject *obj = SWIG_NewPointerObj(SWIG_as_voidptr(rec), SWIGTYPE_p_pm3_record, 0);
+    PyObject *res = PyObject_CallFunctionObjArgs(pm3_py_record_cb_obj, obj, NULL);
+    if (res == NULL) {
+        PyErr_Print();
+    }
+    Py_XDECREF(res);
+    Py_DECREF(obj);
+    PyGILState_Release(gstate);
+}
+%}
+
+/* record_callback_set(callable or None) */
+%typemap(in) (pm3_record_cb cb, void *userdata) {
+    if ($input == Py_None) {
+        $1 = NULL;
+    } else if (PyCallable_Check($input)) {
+        $1 = pm3_py_record_cb;
+    } else {
+        SWIG_exception_fail(SWIG_TypeError, "in method '" "$symname" "', argument " "2"" must be callable or None");
+    }
+    Py_XDECREF(pm3_py_record_cb_obj);
+    pm3_py_record_cb_obj = ($1) ? $input : NULL;
+    Py_XINCREF(pm3_py_record_cb_obj);
+    $2 = NULL;
+}
+
+/* record data as bytes */
+%typemap(out) const uint8_t *data {
+    $result = PyBytes_FromStringAndSize((const char *)$1, (Py_ssize_t)arg1->len);
+}
+#endif
+
+#ifdef SWIGLUA
+/* record data as string */
+%typemap(out) const uint8_t *data {
+    lua_pushlstring(L, (const char *)$1, arg1->len);
+    SWIG_arg++;
+}
+#endif
+
+%nodefaultctor pm3_record;
+%nodefaultdtor pm3_record;
+%immutable;
+typedef struct pm3_record {
+    pm3_record_type type;
+    uint32_t index;
+    uint32_t timestamp;
+    uint8_t subtype;
+    size_t len;
+    const uint8_t *data;
+} pm3_record;
+%mutable;
+
+typedef void (*pm3_record_cb)(const pm3_record *rec, void *userdata);
+
 typedef struct {
     %extend {
         pm3() {
@@ -41,6 +115,12 @@ typedef struct {
             }
         }
         int console(char *cmd, bool capture = true, bool quiet = true);
+#ifdef SWIGPYTHON
+        // records may be emitted from worker threads, only Python takes the GIL for the callback
+        void record_callback_set(pm3_record_cb cb, void *userdata);
+#endif
+        size_t records_count();
+        const pm3_record *record_get(size_t index);
         char const * const name;
         char const * const grabbed_output;
     }
@@ -2650,8 +2650,9 @@ SWIG_Lua_dostring(lua_State *L, const char *str) {
 /* -------- TYPES TABLE (BEGIN) -------- */
 
 #define SWIGTYPE_p_pm3 swig_types[0]
-static swig_type_info *swig_types[2];
-static swig_module_info swig_module = {swig_types, 1, 0, 0, 0, 0};
+#define SWIGTYPE_p_pm3_record swig_types[1]
+static swig_type_info *swig_types[3];
+static swig_module_info swig_module = {swig_types, 2, 0, 0, 0, 0};
 #define SWIG_TypeQuery(name) SWIG_TypeQueryModule(&swig_module, &swig_module, name)
 #define SWIG_MangledTypeQuery(name) SWIG_MangledTypeQueryModule(&swig_module, &swig_module, name)
 
@@ -2667,6 +2668,10 @@ static swig_module_info swig_module = {swig_types, 1, 0, 0, 0, 0};
 #include "pm3.h"
 #include "comms.h"
 
+
+#include <stdint.h>		// Use the C99 official header
+
+
 SWIGINTERN pm3 *new_pm3__SWIG_0(void) {
 //            printf("SWIG pm3 constructor, get current pm3\n");
     pm3_device_t *p = pm3_get_current_dev();
@@ -2698,6 +2703,193 @@ SWIGINTERN void delete_pm3(pm3 *self) {
 #ifdef __cplusplus
 extern "C" {
 #endif
+static int _wrap_record_type_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    pm3_record_type result;
+
+    SWIG_check_num_args("pm3_record::type", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::type", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_type_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = (pm3_record_type) ((arg1)->type);
+    lua_pushnumber(L, (lua_Number)(int)(result));
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_record_index_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    uint32_t result;
+
+    SWIG_check_num_args("pm3_record::index", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::index", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_index_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = (uint32_t) ((arg1)->index);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_record_timestamp_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    uint32_t result;
+
+    SWIG_check_num_args("pm3_record::timestamp", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::timestamp", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_timestamp_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = (uint32_t) ((arg1)->timestamp);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_record_subtype_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    uint8_t result;
+
+    SWIG_check_num_args("pm3_record::subtype", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::subtype", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_subtype_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = (uint8_t) ((arg1)->subtype);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_record_len_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    size_t result;
+
+    SWIG_check_num_args("pm3_record::len", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::len", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_len_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = ((arg1)->len);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_record_data_get(lua_State *L) {
+    int SWIG_arg = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    uint8_t *result = 0 ;
+
+    SWIG_check_num_args("pm3_record::data", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3_record::data", 1, "struct pm3_record *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3_record, 0))) {
+        SWIG_fail_ptr("record_data_get", 1, SWIGTYPE_p_pm3_record);
+    }
+
+    result = (uint8_t *) ((arg1)->data);
+    {
+        lua_pushlstring(L, (const char *)result, arg1->len);
+        SWIG_arg++;
+    }
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static swig_lua_attribute swig_pm3_record_attributes[] = {
+    { "type", _wrap_record_type_get, SWIG_Lua_set_immutable },
+    { "index", _wrap_record_index_get, SWIG_Lua_set_immutable },
+    { "timestamp", _wrap_record_timestamp_get, SWIG_Lua_set_immutable },
+    { "subtype", _wrap_record_subtype_get, SWIG_Lua_set_immutable },
+    { "len", _wrap_record_len_get, SWIG_Lua_set_immutable },
+    { "data", _wrap_record_data_get, SWIG_Lua_set_immutable },
+    {0, 0, 0}
+};
+static swig_lua_method swig_pm3_record_methods[] = {
+    {0, 0}
+};
+static swig_lua_method swig_pm3_record_meta[] = {
+    {0, 0}
+};
+
+static swig_lua_attribute swig_pm3_record_Sf_SwigStatic_attributes[] = {
+    {0, 0, 0}
+};
+static swig_lua_const_info swig_pm3_record_Sf_SwigStatic_constants[] = {
+    {0, 0, 0, 0, 0, 0}
+};
+static swig_lua_method swig_pm3_record_Sf_SwigStatic_methods[] = {
+    {0, 0}
+};
+static swig_lua_class *swig_pm3_record_Sf_SwigStatic_classes[] = {
+    0
+};
+
+static swig_lua_namespace swig_pm3_record_Sf_SwigStatic = {
+    "record",
+    swig_pm3_record_Sf_SwigStatic_methods,
+    swig_pm3_record_Sf_SwigStatic_attributes,
+    swig_pm3_record_Sf_SwigStatic_constants,
+    swig_pm3_record_Sf_SwigStatic_classes,
+    0
+};
+static swig_lua_class *swig_pm3_record_bases[] = {0};
+static const char *swig_pm3_record_base_names[] = {0};
+static swig_lua_class _wrap_class_pm3_record = { "record", "record", &SWIGTYPE_p_pm3_record, 0, 0, swig_pm3_record_methods, swig_pm3_record_attributes, &swig_pm3_record_Sf_SwigStatic, swig_pm3_record_meta, swig_pm3_record_bases, swig_pm3_record_base_names };
+
 static int _wrap_new_pm3__SWIG_0(lua_State *L) {
     int SWIG_arg = 0;
     pm3 *result = 0 ;
@@ -2801,6 +2993,58 @@ fail:
 }
 
 
+static int _wrap_pm3_records_count(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    size_t result;
+
+    SWIG_check_num_args("pm3::records_count", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::records_count", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_records_count", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = pm3_records_count(arg1);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_pm3_record_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    size_t arg2 ;
+    pm3_record *result = 0 ;
+
+    SWIG_check_num_args("pm3::record_get", 2, 2)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::record_get", 1, "pm3 *");
+    if (!lua_isnumber(L, 2)) SWIG_fail_arg("pm3::record_get", 2, "size_t");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_record_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    SWIG_contract_assert((lua_tonumber(L, 2) >= 0), "number must not be negative");
+    arg2 = (size_t)lua_tonumber(L, 2);
+    result = (pm3_record *)pm3_record_get(arg1, arg2);
+    SWIG_NewPointerObj(L, result, SWIGTYPE_p_pm3_record, 0);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
 static int _wrap_pm3_name_get(lua_State *L) {
     int SWIG_arg = 0;
     pm3 *arg1 = (pm3 *) 0 ;
@@ -2868,6 +3112,8 @@ static swig_lua_attribute swig_pm3_attributes[] = {
 };
 static swig_lua_method swig_pm3_methods[] = {
     { "console", _wrap_pm3_console},
+    { "records_count", _wrap_pm3_records_count},
+    { "record_get", _wrap_pm3_record_get},
     {0, 0}
 };
 static swig_lua_method swig_pm3_meta[] = {
@@ -2903,12 +3149,17 @@ static swig_lua_attribute swig_SwigModule_attributes[] = {
     {0, 0, 0}
 };
 static swig_lua_const_info swig_SwigModule_constants[] = {
+    {SWIG_LUA_CONSTTAB_INT("PM3_RECORD_KEY", PM3_RECORD_KEY)},
+    {SWIG_LUA_CONSTTAB_INT("PM3_RECORD_BLOCK", PM3_RECORD_BLOCK)},
+    {SWIG_LUA_CONSTTAB_INT("PM3_RECORD_UID", PM3_RECORD_UID)},
+    {SWIG_LUA_CONSTTAB_INT("PM3_RECORD_TRACE", PM3_RECORD_TRACE)},
     {0, 0, 0, 0, 0, 0}
 };
 static swig_lua_method swig_SwigModule_methods[] = {
     {0, 0}
 };
 static swig_lua_class *swig_SwigModule_classes[] = {
+    &_wrap_class_pm3_record,
     &_wrap_class_pm3,
     0
 };
@@ -2931,15 +3182,19 @@ static swig_lua_namespace swig_SwigModule = {
 /* -------- TYPE CONVERSION AND EQUIVALENCE RULES (BEGIN) -------- */
 
 static swig_type_info _swigt__p_pm3 = {"_p_pm3", "pm3 *", 0, 0, (void *) &_wrap_class_pm3, 0};
+static swig_type_info _swigt__p_pm3_record = {"_p_pm3_record", "struct pm3_record *|pm3_record *", 0, 0, (void *) &_wrap_class_pm3_record, 0};
 
 static swig_type_info *swig_type_initial[] = {
     &_swigt__p_pm3,
+    &_swigt__p_pm3_record,
 };
 
 static swig_cast_info _swigc__p_pm3[] = {  {&_swigt__p_pm3, 0, 0, 0}, {0, 0, 0, 0}};
+static swig_cast_info _swigc__p_pm3_record[] = {  {&_swigt__p_pm3_record, 0, 0, 0}, {0, 0, 0, 0}};
 
 static swig_cast_info *swig_cast_initial[] = {
     _swigc__p_pm3,
+    _swigc__p_pm3_record,
 };
 
 
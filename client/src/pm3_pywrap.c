@@ -3114,8 +3114,9 @@ done:
 
 #define SWIGTYPE_p_char swig_types[0]
 #define SWIGTYPE_p_pm3 swig_types[1]
-static swig_type_info *swig_types[3];
-static swig_module_info swig_module = {swig_types, 2, 0, 0, 0, 0};
+#define SWIGTYPE_p_pm3_record swig_types[2]
+static swig_type_info *swig_types[4];
+static swig_module_info swig_module = {swig_types, 3, 0, 0, 0, 0};
 #define SWIG_TypeQuery(name) SWIG_TypeQueryModule(&swig_module, &swig_module, name)
 #define SWIG_MangledTypeQuery(name) SWIG_MangledTypeQueryModule(&swig_module, &swig_module, name)
 
@@ -3146,6 +3147,90 @@ static swig_module_info swig_module = {swig_types, 2, 0, 0, 0, 0};
 #include "pm3.h"
 #include "comms.h"
 
+
+#include <stdint.h>		// Use the C99 official header
+
+
+/* Python callable handed to record_callback_set(), called with a record only valid during the call */
+static PyObject *pm3_py_record_cb_obj = NULL;
+
+static void pm3_py_record_cb(const pm3_record *rec, void *userdata) {
+    (void)userdata;
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyObject *obj = SWIG_NewPointerObj(SWIG_as_voidptr(rec), SWIGTYPE_p_pm3_record, 0);
+    PyObject *res = PyObject_CallFunctionObjArgs(pm3_py_record_cb_obj, obj, NULL);
+    if (res == NULL) {
+        PyErr_Print();
+    }
+    Py_XDECREF(res);
+    Py_DECREF(obj);
+    PyGILState_Release(gstate);
+}
+
+
+SWIGINTERNINLINE PyObject *
+SWIG_From_int(int value) {
+    return PyInt_FromLong((long) value);
+}
+
+
+SWIGINTERNINLINE PyObject *
+SWIG_From_unsigned_SS_int(unsigned int value) {
+    return PyInt_FromSize_t((size_t) value);
+}
+
+
+SWIGINTERNINLINE PyObject *
+SWIG_From_unsigned_SS_long(unsigned long value) {
+    return (value > LONG_MAX) ?
+           PyLong_FromUnsignedLong(value) : PyInt_FromLong((long)(value));
+}
+
+
+SWIGINTERNINLINE PyObject *
+SWIG_From_unsigned_SS_char(unsigned char value) {
+    return SWIG_From_unsigned_SS_long(value);
+}
+
+
+#include <limits.h>
+#if !defined(SWIG_NO_LLONG_MAX)
+# if !defined(LLONG_MAX) && defined(__GNUC__) && defined (__LONG_LONG_MAX__)
+#   define LLONG_MAX __LONG_LONG_MAX__
+#   define LLONG_MIN (-LLONG_MAX - 1LL)
+#   define ULLONG_MAX (LLONG_MAX * 2ULL + 1ULL)
+# endif
+#endif
+
+
+#if defined(LLONG_MAX) && !defined(SWIG_LONG_LONG_AVAILABLE)
+#  define SWIG_LONG_LONG_AVAILABLE
+#endif
+
+
+#ifdef SWIG_LONG_LONG_AVAILABLE
+SWIGINTERNINLINE PyObject *
+SWIG_From_unsigned_SS_long_SS_long(unsigned long long value) {
+    return (value > LONG_MAX) ?
+           PyLong_FromUnsignedLongLong(value) : PyInt_FromLong((long)(value));
+}
+#endif
+
+
+SWIGINTERNINLINE PyObject *
+SWIG_From_size_t(size_t value) {
+#ifdef SWIG_LONG_LONG_AVAILABLE
+    if (sizeof(size_t) <= sizeof(unsigned long)) {
+#endif
+        return SWIG_From_unsigned_SS_long((unsigned long)(value));
+#ifdef SWIG_LONG_LONG_AVAILABLE
+    } else {
+        /* assume sizeof(size_t) <= sizeof(unsigned long long) */
+        return SWIG_From_unsigned_SS_long_SS_long((unsigned long long)(value));
+    }
+#endif
+}
+
 SWIGINTERN pm3 *new_pm3__SWIG_0(void) {
 //            printf("SWIG pm3 constructor, get current pm3\n");
     pm3_device_t *p = pm3_get_current_dev();
@@ -3413,12 +3498,6 @@ SWIG_AsVal_bool(PyObject *obj, bool *val) {
 }
 
 
-SWIGINTERNINLINE PyObject *
-SWIG_From_int(int value) {
-    return PyInt_FromLong((long) value);
-}
-
-
 SWIGINTERNINLINE PyObject *
 SWIG_FromCharPtrAndSize(const char *carray, size_t size) {
     if (carray) {
@@ -3448,9 +3527,273 @@ SWIG_FromCharPtr(const char *cptr) {
     return SWIG_FromCharPtrAndSize(cptr, (cptr ? strlen(cptr) : 0));
 }
 
+
+SWIGINTERN int
+SWIG_AsVal_unsigned_SS_long(PyObject *obj, unsigned long *val) {
+#if PY_VERSION_HEX < 0x03000000
+    if (PyInt_Check(obj)) {
+        long v = PyInt_AsLong(obj);
+        if (v >= 0) {
+            if (val) *val = v;
+            return SWIG_OK;
+        } else {
+            return SWIG_OverflowError;
+        }
+    } else
+#endif
+        if (PyLong_Check(obj)) {
+            unsigned long v = PyLong_AsUnsignedLong(obj);
+            if (!PyErr_Occurred()) {
+                if (val) *val = v;
+                return SWIG_OK;
+            } else {
+                PyErr_Clear();
+                return SWIG_OverflowError;
+            }
+        }
+#ifdef SWIG_PYTHON_CAST_MODE
+    {
+        int dispatch = 0;
+        unsigned long v = PyLong_AsUnsignedLong(obj);
+        if (!PyErr_Occurred()) {
+            if (val) *val = v;
+            return SWIG_AddCast(SWIG_OK);
+        } else {
+            PyErr_Clear();
+        }
+        if (!dispatch) {
+            double d;
+            int res = SWIG_AddCast(SWIG_AsVal_double(obj, &d));
+            // Largest double not larger than ULONG_MAX (not portably calculated easily)
+            // Note that double(ULONG_MAX) is stored in a double rounded up by one (for 64-bit unsigned long)
+            // 0xfffffffffffff800ULL == (uint64_t)std::nextafter(double(__uint128_t(ULONG_MAX)+1), double(0))
+            const double ulong_max = sizeof(unsigned long) == 8 ? 0xfffffffffffff800ULL : ULONG_MAX;
+            if (SWIG_IsOK(res) && SWIG_CanCastAsInteger(&d, 0, ulong_max)) {
+                if (val) *val = (unsigned long)(d);
+                return res;
+            }
+        }
+    }
+#endif
+    return SWIG_TypeError;
+}
+
+
+#ifdef SWIG_LONG_LONG_AVAILABLE
+SWIGINTERN int
+SWIG_AsVal_unsigned_SS_long_SS_long(PyObject *obj, unsigned long long *val) {
+    int res = SWIG_TypeError;
+    if (PyLong_Check(obj)) {
+        unsigned long long v = PyLong_AsUnsignedLongLong(obj);
+        if (!PyErr_Occurred()) {
+            if (val) *val = v;
+            return SWIG_OK;
+        } else {
+            PyErr_Clear();
+            res = SWIG_OverflowError;
+        }
+    } else {
+        unsigned long v;
+        res = SWIG_AsVal_unsigned_SS_long(obj, &v);
+        if (SWIG_IsOK(res)) {
+            if (val) *val = v;
+            return res;
+        }
+    }
+#ifdef SWIG_PYTHON_CAST_MODE
+    {
+        const double mant_max = 1LL << DBL_MANT_DIG;
+        double d;
+        res = SWIG_AsVal_double(obj, &d);
+        if (SWIG_IsOK(res) && !SWIG_CanCastAsInteger(&d, 0, mant_max))
+            return SWIG_OverflowError;
+        if (SWIG_IsOK(res) && SWIG_CanCastAsInteger(&d, 0, mant_max)) {
+            if (val) *val = (unsigned long long)(d);
+            return SWIG_AddCast(res);
+        }
+        res = SWIG_TypeError;
+    }
+#endif
+    return res;
+}
+#endif
+
+
+SWIGINTERNINLINE int
+SWIG_AsVal_size_t(PyObject *obj, size_t *val) {
+    int res = SWIG_TypeError;
+#ifdef SWIG_LONG_LONG_AVAILABLE
+    if (sizeof(size_t) <= sizeof(unsigned long)) {
+#endif
+        unsigned long v;
+        res = SWIG_AsVal_unsigned_SS_long(obj, val ? &v : 0);
+        if (SWIG_IsOK(res) && val) *val = (size_t)(v);
+#ifdef SWIG_LONG_LONG_AVAILABLE
+    } else if (sizeof(size_t) <= sizeof(unsigned long long)) {
+        unsigned long long v;
+        res = SWIG_AsVal_unsigned_SS_long_SS_long(obj, val ? &v : 0);
+        if (SWIG_IsOK(res) && val) *val = (size_t)(v);
+    }
+#endif
+    return res;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
+SWIGINTERN PyObject *_wrap_record_type_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    pm3_record_type result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_type_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = (pm3_record_type) ((arg1)->type);
+    resultobj = SWIG_From_int((int)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_record_index_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    uint32_t result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_index_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = (uint32_t) ((arg1)->index);
+    resultobj = SWIG_From_unsigned_SS_int((unsigned int)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_record_timestamp_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    uint32_t result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_timestamp_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = (uint32_t) ((arg1)->timestamp);
+    resultobj = SWIG_From_unsigned_SS_int((unsigned int)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_record_subtype_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    uint8_t result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_subtype_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = (uint8_t) ((arg1)->subtype);
+    resultobj = SWIG_From_unsigned_SS_char((unsigned char)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_record_len_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    size_t result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_len_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = ((arg1)->len);
+    resultobj = SWIG_From_size_t((size_t)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_record_data_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    struct pm3_record *arg1 = (struct pm3_record *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    uint8_t *result = 0 ;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3_record, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "record_data_get" "', argument " "1"" of type '" "struct pm3_record *""'");
+    }
+    arg1 = (struct pm3_record *)(argp1);
+    result = (uint8_t *) ((arg1)->data);
+    {
+        resultobj = PyBytes_FromStringAndSize((const char *)result, (Py_ssize_t)arg1->len);
+    }
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *record_swigregister(PyObject *SWIGUNUSEDPARM(self), PyObject *args) {
+    PyObject *obj;
+    if (!SWIG_Python_UnpackTuple(args, "swigregister", 1, 1, &obj)) return NULL;
+    SWIG_TypeNewClientData(SWIGTYPE_p_pm3_record, SWIG_NewClientData(obj));
+    return SWIG_Py_Void();
+}
+
 SWIGINTERN PyObject *_wrap_new_pm3__SWIG_0(PyObject *self, Py_ssize_t nobjs, PyObject **SWIGUNUSEDPARM(swig_obj)) {
     PyObject *resultobj = 0;
     pm3 *result = 0 ;
@@ -3596,6 +3939,98 @@ fail:
 }
 
 
+SWIGINTERN PyObject *_wrap_pm3_record_callback_set(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    pm3_record_cb arg2 = (pm3_record_cb) 0 ;
+    void *arg3 = (void *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[2] ;
+
+    (void)self;
+    if (!SWIG_Python_UnpackTuple(args, "pm3_record_callback_set", 2, 2, swig_obj)) SWIG_fail;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_record_callback_set" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    {
+        if (swig_obj[1] == Py_None) {
+            arg2 = NULL;
+        } else if (PyCallable_Check(swig_obj[1])) {
+            arg2 = pm3_py_record_cb;
+        } else {
+            SWIG_exception_fail(SWIG_TypeError, "in method '" "pm3_record_callback_set" "', argument " "2"" must be callable or None");
+        }
+        Py_XDECREF(pm3_py_record_cb_obj);
+        pm3_py_record_cb_obj = (arg2) ? swig_obj[1] : NULL;
+        Py_XINCREF(pm3_py_record_cb_obj);
+        arg3 = NULL;
+    }
+    pm3_record_callback_set(arg1, arg2, arg3);
+    resultobj = SWIG_Py_Void();
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_pm3_records_count(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    size_t result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_records_count" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    result = pm3_records_count(arg1);
+    resultobj = SWIG_From_size_t((size_t)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_pm3_record_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    size_t arg2 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    size_t val2 ;
+    int ecode2 = 0 ;
+    PyObject *swig_obj[2] ;
+    pm3_record *result = 0 ;
+
+    (void)self;
+    if (!SWIG_Python_UnpackTuple(args, "pm3_record_get", 2, 2, swig_obj)) SWIG_fail;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_record_get" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    ecode2 = SWIG_AsVal_size_t(swig_obj[1], &val2);
+    if (!SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "pm3_record_get" "', argument " "2"" of type '" "size_t""'");
+    }
+    arg2 = (size_t)(val2);
+    result = (pm3_record *)pm3_record_get(arg1, arg2);
+    resultobj = SWIG_NewPointerObj(SWIG_as_voidptr(result), SWIGTYPE_p_pm3_record, 0 |  0);
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
 SWIGINTERN PyObject *_wrap_pm3_name_get(PyObject *self, PyObject *args) {
     PyObject *resultobj = 0;
     pm3 *arg1 = (pm3 *) 0 ;
@@ -3656,9 +4091,19 @@ SWIGINTERN PyObject *pm3_swiginit(PyObject *SWIGUNUSEDPARM(self), PyObject *args
 }
 
 static PyMethodDef SwigMethods[] = {
+    { "record_type_get", _wrap_record_type_get, METH_O, NULL},
+    { "record_index_get", _wrap_record_index_get, METH_O, NULL},
+    { "record_timestamp_get", _wrap_record_timestamp_get, METH_O, NULL},
+    { "record_subtype_get", _wrap_record_subtype_get, METH_O, NULL},
+    { "record_len_get", _wrap_record_len_get, METH_O, NULL},
+    { "record_data_get", _wrap_record_data_get, METH_O, NULL},
+    { "record_swigregister", record_swigregister, METH_O, NULL},
     { "new_pm3", _wrap_new_pm3, METH_VARARGS, NULL},
     { "delete_pm3", _wrap_delete_pm3, METH_O, NULL},
     { "pm3_console", _wrap_pm3_console, METH_VARARGS, NULL},
+    { "pm3_record_callback_set", _wrap_pm3_record_callback_set, METH_VARARGS, NULL},
+    { "pm3_records_count", _wrap_pm3_records_count, METH_O, NULL},
+    { "pm3_record_get", _wrap_pm3_record_get, METH_VARARGS, NULL},
     { "pm3_name_get", _wrap_pm3_name_get, METH_O, NULL},
     { "pm3_grabbed_output_get", _wrap_pm3_grabbed_output_get, METH_O, NULL},
     { "pm3_swigregister", pm3_swigregister, METH_O, NULL},
@@ -3671,18 +4116,22 @@ static PyMethodDef SwigMethods[] = {
 
 static swig_type_info _swigt__p_char = {"_p_char", "char *", 0, 0, (void *)0, 0};
 static swig_type_info _swigt__p_pm3 = {"_p_pm3", "pm3 *", 0, 0, (void *)0, 0};
+static swig_type_info _swigt__p_pm3_record = {"_p_pm3_record", "struct pm3_record *|pm3_record *", 0, 0, (void *)0, 0};
 
 static swig_type_info *swig_type_initial[] = {
     &_swigt__p_char,
     &_swigt__p_pm3,
+    &_swigt__p_pm3_record,
 };
 
 static swig_cast_info _swigc__p_char[] = {  {&_swigt__p_char, 0, 0, 0}, {0, 0, 0, 0}};
 static swig_cast_info _swigc__p_pm3[] = {  {&_swigt__p_pm3, 0, 0, 0}, {0, 0, 0, 0}};
+static swig_cast_info _swigc__p_pm3_record[] = {  {&_swigt__p_pm3_record, 0, 0, 0}, {0, 0, 0, 0}};
 
 static swig_cast_info *swig_cast_initial[] = {
     _swigc__p_char,
     _swigc__p_pm3,
+    _swigc__p_pm3_record,
 };
 
 
@@ -4150,6 +4599,11 @@ SWIG_init(void) {
 
     SWIG_InstallConstants(d, swig_const_table);
 
+    SWIG_Python_SetConstant(d, "PM3_RECORD_KEY", SWIG_From_int((int)(PM3_RECORD_KEY)));
+    SWIG_Python_SetConstant(d, "PM3_RECORD_BLOCK", SWIG_From_int((int)(PM3_RECORD_BLOCK)));
+    SWIG_Python_SetConstant(d, "PM3_RECORD_UID", SWIG_From_int((int)(PM3_RECORD_UID)));
+    SWIG_Python_SetConstant(d, "PM3_RECORD_TRACE", SWIG_From_int((int)(PM3_RECORD_TRACE)));
+
 #if PY_VERSION_HEX >= 0x03000000
     return m;
 #else
@@ -32,39 +32,91 @@
 #include "ui.h"                          // g_session
 #include "util.h"                        // str_ndup
 
+#if defined(HAVE_READLINE) || defined(HAVE_LINENOISE)
+// vocabulary in name order, sorted on the first completion.
+// All the commands starting with a prefix are then one range found by a binary search.
+static uint16_t *vocabulary_order = NULL;
+static size_t vocabulary_count = 0;
+
+static int vocabulary_cmp(const void *a, const void *b) {
+    return strcmp(vocabulary[*(const uint16_t *)a].name, vocabulary[*(const uint16_t *)b].name);
+}
+
+static bool vocabulary_index(void) {
+    if (vocabulary_order) {
+        return true;
+    }
+
+    size_t count = 0;
+    while (vocabulary[count].name) {
+        count++;
+    }
+
+    vocabulary_order = calloc(count + 1, sizeof(uint16_t));
+    if (vocabulary_order == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        vocabulary_order[i] = i;
+    }
+    qsort(vocabulary_order, count, sizeof(uint16_t), vocabulary_cmp);
+    vocabulary_count = count;
+    return true;
+}
+
+// first position in vocabulary_order whose name is >= prefix
+static size_t vocabulary_lower_bound(const char *prefix) {
+    size_t lo = 0, hi = vocabulary_count;
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) / 2);
+        if (strcmp(vocabulary[vocabulary_order[mid]].name, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+#endif
+
 #if defined(HAVE_READLINE)
 
 static char *rl_command_generator(const char *text, int state) {
-    static int index;
+    static size_t pos;
     static size_t len;
     size_t rlen = strlen(rl_line_buffer);
-    const char *command;
 
     if (!state) {
-        index = 0;
+        if (vocabulary_index() == false) {
+            return NULL;
+        }
+        pos = vocabulary_lower_bound(rl_line_buffer);
         len = strlen(text);
     }
 
-    while ((command = vocabulary[index].name))  {
+    while (pos < vocabulary_count)  {
+
+        int index = vocabulary_order[pos++];
+        const char *command = vocabulary[index].name;
+
+        // past the commands starting with the line
+        if (strncmp(command, rl_line_buffer, rlen) != 0) {
+            break;
+        }
 
         // When no pm3 device present
         // and the command is not available offline,
         // we skip it.
         if ((g_session.pm3_present == false) && (vocabulary[index].offline == false))  {
-            index++;
             continue;
         }
 
-        index++;
-
-        if (strncmp(command, rl_line_buffer, rlen) == 0) {
-            const char *next = command + (rlen - len);
-            const char *space = strstr(next, " ");
-            if (space != NULL) {
-                return str_ndup(next, space - next);
-            }
-            return str_dup(next);
+        const char *next = command + (rlen - len);
+        const char *space = strstr(next, " ");
+        if (space != NULL) {
+            return str_ndup(next, space - next);
         }
+        return str_dup(next);
     }
 
     return NULL;
@@ -77,34 +129,39 @@ static char **rl_command_completion(const char *text, int start, int end) {
 
 #elif defined(HAVE_LINENOISE)
 static void ln_command_completion(const char *text, linenoiseCompletions *lc) {
-    int index = 0;
+    if (vocabulary_index() == false) {
+        return;
+    }
+
     const char *prev_match = "";
     size_t prev_match_len = 0;
     size_t len = strlen(text);
-    const char *command;
-    while ((command = vocabulary[index].name))  {
+    for (size_t pos = vocabulary_lower_bound(text); pos < vocabulary_count; pos++)  {
+
+        int index = vocabulary_order[pos];
+        const char *command = vocabulary[index].name;
+
+        // past the commands starting with text
+        if (strncmp(command, text, len) != 0) {
+            break;
+        }
 
         // When no pm3 device present
         // and the command is not available offline,
         // we skip it.
         if ((g_session.pm3_present == false) && (vocabulary[index].offline == false))  {
-            index++;
             continue;
         }
 
-        index++;
-
-        if (strncmp(command, text, len) == 0) {
-            const char *space = strstr(command + len, " ");
-            if (space != NULL) {
-                if ((prev_match_len == 0) || (strncmp(prev_match, command, prev_match_len < space - command ? prev_match_len : space - command) != 0)) {
-                    linenoiseAddCompletion(lc, str_ndup(command, space - command + 1));
-                    prev_match = command;
-                    prev_match_len = space - command + 1;
-                }
-            } else {
-                linenoiseAddCompletion(lc, command);
+        const char *space = strstr(command + len, " ");
+        if (space != NULL) {
+            if ((prev_match_len == 0) || (strncmp(prev_match, command, prev_match_len < space - command ? prev_match_len : space - command) != 0)) {
+                linenoiseAddCompletion(lc, str_ndup(command, space - command + 1));
+                prev_match = command;
+                prev_match_len = space - command + 1;
             }
+        } else {
+            linenoiseAddCompletion(lc, command);
         }
     }
 }
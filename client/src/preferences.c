@@ -116,6 +116,7 @@ int preferences_load(void) {
     g_session.overlay_sliders = true;
     g_session.show_hints = true;
     g_session.dense_output = false;
+    g_session.lua_persistent = false;
 
     g_session.bar_mode = STYLE_VALUE;
     setDefaultPath(spDefault, "");
@@ -260,6 +261,8 @@ void preferences_save_callback(json_t *root) {
 
     JsonSaveBoolean(root, "output.dense", g_session.dense_output);
 
+    JsonSaveBoolean(root, "script.lua.persistent", g_session.lua_persistent);
+
     JsonSaveBoolean(root, "os.supports.colors", g_session.supports_colors);
 
     JsonSaveStr(root, "file.default.savepath", g_session.defaultPaths[spDefault]);
@@ -410,6 +413,9 @@ void preferences_load_callback(json_t *root) {
     if (json_unpack_ex(root, &up_error, 0, "{s:b}", "output.dense", &b1) == 0)
         g_session.dense_output = (bool)b1;
 
+    if (json_unpack_ex(root, &up_error, 0, "{s:b}", "script.lua.persistent", &b1) == 0)
+        g_session.lua_persistent = (bool)b1;
+
     if (json_unpack_ex(root, &up_error, 0, "{s:b}", "os.supports.colors", &b1) == 0)
         g_session.supports_colors = (bool)b1;
 
@@ -638,6 +644,13 @@ static void showHintsState(prefShowOpt_t opt) {
                  );
 }
 
+static void showScriptPersistState(prefShowOpt_t opt) {
+    PrintAndLogEx(INFO, "   %s persistent Lua state.... %s"
+                  , pref_show_status_msg(opt)
+                  , (g_session.lua_persistent) ? pref_show_value(opt, "on") : pref_show_value(opt, "off")
+                 );
+}
+
 static void showPlotSliderState(prefShowOpt_t opt) {
     PrintAndLogEx(INFO, "   %s show plot sliders....... %s"
                   , pref_show_status_msg(opt)
@@ -1169,6 +1182,51 @@ static int setCmdHint(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int setCmdScriptPersist(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs set script.persist",
+                  "Set persistent preference of keeping one Lua state for all `script run` calls.\n"
+                  "Loaded lualibs stay in memory, each script still gets its own globals.\n"
+                  "Lualibs edited while the client runs are picked up after switching it off.",
+                  "prefs set script.persist --on"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "off", "new Lua state for every script"),
+        arg_lit0(NULL, "on", "reuse the Lua state"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool use_off = arg_get_lit(ctx, 1);
+    bool use_on = arg_get_lit(ctx, 2);
+    CLIParserFree(ctx);
+
+    if ((use_off + use_on) > 1) {
+        PrintAndLogEx(FAILED, "Can only set one option");
+        return PM3_EINVARG;
+    }
+
+    bool new_value = g_session.lua_persistent;
+    if (use_off) {
+        new_value = false;
+    }
+    if (use_on) {
+        new_value = true;
+    }
+
+    if (g_session.lua_persistent != new_value) {
+        showScriptPersistState(prefShowOLD);
+        g_session.lua_persistent = new_value;
+        showScriptPersistState(prefShowNEW);
+        preferences_save();
+    } else {
+        showScriptPersistState(prefShowNone);
+    }
+
+    return PM3_SUCCESS;
+}
+
 static int setCmdPlotSliders(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs set plotsliders",
@@ -1445,6 +1503,22 @@ static int getCmdHint(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int getCmdScriptPersist(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs get script.persist",
+                  "Get preference of keeping one Lua state for all `script run` calls",
+                  "prefs get script.persist"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIParserFree(ctx);
+    showScriptPersistState(prefShowNone);
+    return PM3_SUCCESS;
+}
+
 static int getCmdColor(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs get color",
@@ -1622,6 +1696,7 @@ static command_t CommandTableGet[] = {
     {"hints",            getCmdHint,          AlwaysAvailable, "Get hint display preference"},
     {"output",           getCmdOutput,        AlwaysAvailable, "Get dump output style preference"},
     {"plotsliders",      getCmdPlotSlider,    AlwaysAvailable, "Get plot slider display preference"},
+    {"script.persist",   getCmdScriptPersist, AlwaysAvailable, "Get persistent Lua state preference"},
     {"mqtt",             getCmdMqtt,          AlwaysAvailable, "Get MQTT preference"},
     {NULL, NULL, NULL, NULL}
 };
@@ -1641,6 +1716,7 @@ static command_t CommandTableSet[] = {
     //  {"devicedebug",      setCmdDeviceDebug,   AlwaysAvailable, "Set device debug level"},
     {"output",           setCmdOutput,        AlwaysAvailable, "Set dump output style"},
     {"plotsliders",      setCmdPlotSliders,   AlwaysAvailable, "Set plot slider display"},
+    {"script.persist",   setCmdScriptPersist, AlwaysAvailable, "Set persistent Lua state"},
     {"mqtt",             setCmdMqtt,          AlwaysAvailable, "Set MQTT default values"},
     {NULL, NULL, NULL, NULL}
 };
@@ -1701,6 +1777,7 @@ static int CmdPrefShow(const char *Cmd) {
     showSavePathState(spTrace, prefShowNone);
     showClientDebugState(prefShowNone);
     showPlotSliderState(prefShowNone);
+    showScriptPersistState(prefShowNone);
 //    showDeviceDebugState(prefShowNone);
     showBarModeState(prefShowNone);
     showClientExeDelayState();
@@ -35,6 +35,8 @@
 #include "fileutils.h"
 #include "flash.h"
 #include "preferences.h"
+#include "rescache.h"
+#include "emv/emv_pk.h"
 #include "commonutil.h"
 #include "cmdscript.h"
 
@@ -512,6 +514,8 @@ check_script:
                     prompt_compose(prompt, sizeof(prompt), prompt_ctx, prompt_dev, prompt_net, true);
                     char prompt_filtered[PROXPROMPT_MAX_SIZE] = {0};
                     memcpy_filter_ansi(prompt_filtered, prompt, sizeof(prompt_filtered), !g_session.supports_colors);
+                    // everything queued must be out before the prompt shows
+                    PrintAndLogFlush();
                     g_pendingPrompt = true;
                     // TODO this should be free'd via pm3line_free
                     script_cmd = pm3line_read(prompt_filtered);
@@ -747,6 +751,7 @@ static void show_help(bool showFullHelp, char *exec_name) {
         PrintAndLogEx(NORMAL, "      -p/--port                           serial port to connect to");
         PrintAndLogEx(NORMAL, "      -w/--wait                           20sec waiting the serial port to appear in the OS");
         PrintAndLogEx(NORMAL, "      -f/--flush                          output will be flushed after every print");
+        PrintAndLogEx(NORMAL, "      --async-log                         write output and log from a background thread");
         PrintAndLogEx(NORMAL, "      -d/--debug <0|1|2>                  set debugmode");
         PrintAndLogEx(NORMAL, "\nOptions in client mode:");
         PrintAndLogEx(NORMAL, "      -t/--text                           dump all interactive command list at once");
@@ -1173,6 +1178,14 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
+        // write output from a background thread
+        if (strcmp(argv[i], "--async-log") == 0) {
+            if (PrintAndLogAsync(true) != PM3_SUCCESS) {
+                PrintAndLogEx(WARNING, "Failed to start async logging, falling back to synchronous output");
+            }
+            continue;
+        }
+
         // set baudrate
         if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baud") == 0) {
             if (i + 1 == argc) {
@@ -1520,6 +1533,9 @@ int main(int argc, char *argv[]) {
         preferences_save();
     }
 
+    PrintAndLogAsync(false);
+    rescache_free();
+    emv_pk_free_ca_store();
     free_grabber();
 
     return mainret;
@@ -0,0 +1,196 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Session wide cache of the json files in resources/
+//-----------------------------------------------------------------------------
+#include "rescache.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fileutils.h"
+#include "pm3_cmd.h"
+#include "ui.h"
+
+// longest normalized key, AIDs are at most 16 bytes
+#define RESCACHE_MAX_KEY    64
+
+typedef struct rescache_entry_s {
+    char *name;
+    json_t *root;       // NULL if the load failed
+    json_t *indexes;    // member name -> index object
+    struct rescache_entry_s *next;
+} rescache_entry_t;
+
+static rescache_entry_t *rescache_list = NULL;
+
+static rescache_entry_t *rescache_find(const char *name) {
+    for (rescache_entry_t *e = rescache_list; e != NULL; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static rescache_entry_t *rescache_load(const char *name, bool verbose) {
+
+    rescache_entry_t *e = rescache_find(name);
+    if (e != NULL) {
+        return e;
+    }
+
+    e = calloc(1, sizeof(rescache_entry_t));
+    if (e == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return NULL;
+    }
+
+    e->name = strdup(name);
+    if (e->name == NULL) {
+        free(e);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return NULL;
+    }
+
+    char *path = NULL;
+    if (searchFile(&path, RESOURCES_SUBDIR, name, ".json", false) == PM3_SUCCESS) {
+
+        json_error_t error;
+        e->root = json_load_file(path, 0, &error);
+        if (e->root == NULL) {
+            PrintAndLogEx(ERR, "json (%s) error on line %d: %s", path, error.line, error.text);
+        } else if (verbose) {
+            PrintAndLogEx(SUCCESS, "Loaded file `" _YELLOW_("%s") "` " _GREEN_("%zu") " records ( " _GREEN_("ok") " )"
+                          , path
+                          , json_is_array(e->root) ? json_array_size(e->root) : json_object_size(e->root)
+                         );
+        }
+        free(path);
+    }
+
+    e->next = rescache_list;
+    rescache_list = e;
+    return e;
+}
+
+json_t *rescache_get(const char *name, bool verbose) {
+    if (name == NULL) {
+        return NULL;
+    }
+
+    rescache_entry_t *e = rescache_load(name, verbose);
+    return (e) ? e->root : NULL;
+}
+
+// upper case hex digits only without a leading 0x, so "0x3e00", "3E00" and "3E 00" end up on the same key
+static size_t rescache_normalize(const char *value, size_t len, char *out) {
+    size_t i = 0;
+    while (i < len && isspace((uint8_t)value[i])) {
+        i++;
+    }
+    if (i + 1 < len && value[i] == '0' && (value[i + 1] == 'x' || value[i + 1] == 'X')) {
+        i += 2;
+    }
+
+    size_t n = 0;
+    for (; i < len && value[i] != '\0'; i++) {
+        if (isxdigit((uint8_t)value[i]) == 0) {
+            continue;
+        }
+        if (n == RESCACHE_MAX_KEY) {
+            return 0;
+        }
+        out[n++] = toupper((uint8_t)value[i]);
+    }
+    out[n] = '\0';
+    return n;
+}
+
+json_t *rescache_index(const char *name, const char *key) {
+    if (name == NULL || key == NULL) {
+        return NULL;
+    }
+
+    rescache_entry_t *e = rescache_load(name, false);
+    if (e == NULL || json_is_array(e->root) == false) {
+        return NULL;
+    }
+
+    if (e->indexes == NULL) {
+        e->indexes = json_object();
+        if (e->indexes == NULL) {
+            return NULL;
+        }
+    }
+
+    json_t *index = json_object_get(e->indexes, key);
+    if (index != NULL) {
+        return index;
+    }
+
+    index = json_object();
+    if (index == NULL) {
+        return NULL;
+    }
+
+    size_t pos;
+    json_t *elm;
+    json_array_foreach(e->root, pos, elm) {
+
+        json_t *jstr = json_object_get(elm, key);
+        if (json_is_string(jstr) == false) {
+            continue;
+        }
+
+        char nkey[RESCACHE_MAX_KEY + 1];
+        if (rescache_normalize(json_string_value(jstr), SIZE_MAX, nkey) == 0) {
+            continue;
+        }
+
+        json_t *positions = json_object_get(index, nkey);
+        if (positions == NULL) {
+            positions = json_array();
+            json_object_set_new(index, nkey, positions);
+        }
+        json_array_append_new(positions, json_integer(pos));
+    }
+
+    json_object_set_new(e->indexes, key, index);
+    return index;
+}
+
+json_t *rescache_index_get(json_t *index, const char *value, size_t len) {
+    if (index == NULL || value == NULL) {
+        return NULL;
+    }
+
+    char nkey[RESCACHE_MAX_KEY + 1];
+    if (rescache_normalize(value, len, nkey) == 0) {
+        return NULL;
+    }
+    return json_object_get(index, nkey);
+}
+
+void rescache_free(void) {
+    while (rescache_list) {
+        rescache_entry_t *e = rescache_list;
+        rescache_list = e->next;
+        json_decref(e->indexes);
+        json_decref(e->root);
+        free(e->name);
+        free(e);
+    }
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Session wide cache of the json files in resources/
+//-----------------------------------------------------------------------------
+
+#ifndef RESCACHE_H__
+#define RESCACHE_H__
+
+#include "common.h"
+#include "jansson.h"
+
+/**
+ * @brief Get a parsed json file from the resources folder.
+ * The file is searched and parsed on first use and kept until the client exits,
+ * a failed load is remembered as well and not retried.
+ * The returned root is owned by the cache, use json_incref() to keep it beyond the cache.
+ * @param name file name without the .json suffix, e.g. "aidlist"
+ * @param verbose print the loaded file name and number of records
+ * @return the json root or NULL
+ */
+json_t *rescache_get(const char *name, bool verbose);
+
+/**
+ * @brief Get an index over a json array resource.
+ * Maps the string member `key` of every element, upper cased and with non hex digit
+ * characters dropped, to a json array with the positions of those elements in the root array.
+ * The index is built on first use and owned by the cache.
+ * @param name file name without the .json suffix
+ * @param key element member to index, e.g. "AID"
+ * @return json object or NULL if the resource isn't a json array
+ */
+json_t *rescache_index(const char *name, const char *key);
+
+/**
+ * @brief Look up one normalized key in an index.
+ * @param index index from rescache_index()
+ * @param value key to search for, normalized like the index keys
+ * @param len number of characters of value to use
+ * @return json array with element positions or NULL
+ */
+json_t *rescache_index_get(json_t *index, const char *value, size_t len);
+
+// release all cached files
+void rescache_free(void);
+
+#endif
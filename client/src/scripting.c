@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include "lauxlib.h"
 #include "lua_bitlib.h"
@@ -38,6 +39,7 @@
 #include "nfc/ndef.h"     // ndef parsing
 #include "commonutil.h"
 #include "ui.h"
+#include "util.h"         // str_dup
 
 #include "crc16.h"
 #include "protocols.h"
@@ -663,7 +665,6 @@ static int l_crc16legic(lua_State *L) {
     const char *p_uid = luaL_checklstring(L, 2, &uidsize);
     uint16_t uidcrc = CRC8Legic((uint8_t *)p_uid, uidsize);
 
-    init_table(CRC_LEGIC_16);
     uint16_t retval = crc16_legic((uint8_t *)p_hexstr, hexsize, uidcrc);
     lua_pushinteger(L, retval);
     return 1;
@@ -1374,6 +1375,150 @@ static int l_printandlogex(lua_State *L) {
     return 0;
 }
 
+// Compiled chunks of Lua files, kept for the whole client session.
+// A file is parsed only once as long as its size and mtime don't change,
+// later loads of luascripts or `require`d lualibs just undump the bytecode.
+typedef struct {
+    char *path;
+    int64_t mtime_ns;
+    off_t size;
+    char *code;
+    size_t len;
+} lua_chunk_cache_t;
+
+static lua_chunk_cache_t *g_lua_chunks = NULL;
+static size_t g_lua_chunks_cnt = 0;
+
+static int lua_chunk_writer(lua_State *L, const void *p, size_t sz, void *ud) {
+    (void)L;
+    lua_chunk_cache_t *c = (lua_chunk_cache_t *)ud;
+    char *tmp = realloc(c->code, c->len + sz);
+    if (tmp == NULL) {
+        return 1;
+    }
+    c->code = tmp;
+    memcpy(c->code + c->len, p, sz);
+    c->len += sz;
+    return 0;
+}
+
+// mtime in ns where stat() has it, so a same size edit within one second isn't missed.
+// Windows only has seconds.
+static int64_t lua_chunk_mtime_ns(const struct stat *st) {
+#if defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#elif defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+int pm3_lua_loadfile(lua_State *L, const char *path) {
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return luaL_loadfile(L, path);
+    }
+
+    lua_chunk_cache_t *c = NULL;
+    for (size_t i = 0; i < g_lua_chunks_cnt; i++) {
+        if (strcmp(g_lua_chunks[i].path, path) == 0) {
+            c = &g_lua_chunks[i];
+            break;
+        }
+    }
+
+    char chunkname[strlen(path) + 2];
+    snprintf(chunkname, sizeof(chunkname), "@%s", path);
+
+    if (c && c->mtime_ns == lua_chunk_mtime_ns(&st) && c->size == st.st_size && c->code) {
+        return luaL_loadbufferx(L, c->code, c->len, chunkname, "b");
+    }
+
+    int res = luaL_loadfile(L, path);
+    if (res != LUA_OK) {
+        return res;
+    }
+
+    if (c == NULL) {
+        lua_chunk_cache_t *tmp = realloc(g_lua_chunks, (g_lua_chunks_cnt + 1) * sizeof(lua_chunk_cache_t));
+        if (tmp == NULL) {
+            return res;
+        }
+        g_lua_chunks = tmp;
+        c = &g_lua_chunks[g_lua_chunks_cnt];
+        memset(c, 0, sizeof(lua_chunk_cache_t));
+        c->path = str_dup(path);
+        if (c->path == NULL) {
+            return res;
+        }
+        g_lua_chunks_cnt++;
+    }
+
+    free(c->code);
+    c->code = NULL;
+    c->len = 0;
+    // keep the debug info, error messages should still show line numbers
+    if (lua_dump(L, lua_chunk_writer, c, 0) != 0) {
+        free(c->code);
+        c->code = NULL;
+        c->len = 0;
+        return res;
+    }
+    c->mtime_ns = lua_chunk_mtime_ns(&st);
+    c->size = st.st_size;
+    return res;
+}
+
+void pm3_lua_cache_free(void) {
+    for (size_t i = 0; i < g_lua_chunks_cnt; i++) {
+        free(g_lua_chunks[i].path);
+        free(g_lua_chunks[i].code);
+    }
+    free(g_lua_chunks);
+    g_lua_chunks = NULL;
+    g_lua_chunks_cnt = 0;
+}
+
+// package.searchers entry, same as the stock Lua file searcher but loads through the chunk cache
+static int l_cached_searcher(lua_State *L) {
+    const char *name = luaL_checkstring(L, 1);
+
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, name);
+    lua_getfield(L, -3, "path");
+    lua_call(L, 2, 2);
+    if (lua_isnil(L, -2)) {
+        // error message of searchpath, the stock searchers add theirs too
+        return 1;
+    }
+    lua_pop(L, 1);
+
+    const char *filename = lua_tostring(L, -1);
+    if (pm3_lua_loadfile(L, filename) != LUA_OK) {
+        return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", name, filename, lua_tostring(L, -1));
+    }
+    lua_pushstring(L, filename);
+    return 2;
+}
+
+static void set_cached_searcher(lua_State *L) {
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchers");
+    if (lua_istable(L, -1)) {
+        // insert in front of the stock Lua file searcher, after the preload one
+        for (lua_Integer i = luaL_len(L, -1); i >= 2; i--) {
+            lua_geti(L, -1, i);
+            lua_seti(L, -2, i + 1);
+        }
+        lua_pushcfunction(L, l_cached_searcher);
+        lua_seti(L, -2, 2);
+    }
+    lua_pop(L, 2);
+}
+
 /**
  * @brief Sets the lua path to include "./lualibs/?.lua", in order for a script to be
  * able to do "require('foobar')" if foobar.lua is within lualibs folder.
@@ -1465,6 +1610,9 @@ int set_pm3_libraries(lua_State *L) {
     // print redirect here
     lua_register(L, "print", l_printandlogex);
 
+    // `require` goes through the chunk cache
+    set_cached_searcher(L);
+
     // add to the LUA_PATH (package.path in lua)
     // so we can load scripts from various places:
     const char *exec_path = get_my_executable_directory();
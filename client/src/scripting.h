@@ -32,4 +32,16 @@
 
 int set_pm3_libraries(lua_State *L);
 
+/**
+ * @brief pm3_lua_loadfile works like luaL_loadfile but keeps the compiled
+ *  chunk for the session, a file is only parsed again when its size or mtime changed
+ * @param L
+ * @param path
+ * @return LUA_OK or a Lua load error, like luaL_loadfile
+ */
+int pm3_lua_loadfile(lua_State *L, const char *path);
+
+// frees all cached chunks
+void pm3_lua_cache_free(void);
+
 #endif
@@ -95,6 +95,12 @@ inline int RingBuf_getAvailableSize(RingBuffer *buffer) {
     return (buffer->capacity) - (buffer->size);
 }
 
+void RingBuf_reset(RingBuffer *buffer) {
+    buffer->size = 0;
+    buffer->front = 0;
+    buffer->rear = 0;
+}
+
 void RingBuf_destroy(RingBuffer *buffer) {
     if (buffer != NULL)
         free(buffer->data);
@@ -22,6 +22,7 @@ int RingBuf_dequeueBatch(RingBuffer *buffer, uint8_t *values, int count);
 int RingBuf_getUsedSize(RingBuffer *buffer);
 int RingBuf_getAvailableSize(RingBuffer *buffer);
 void RingBuf_destroy(RingBuffer *buffer);
+void RingBuf_reset(RingBuffer *buffer);
 
 // for direct write
 int RingBuf_getContinousAvailableSize(RingBuffer *buffer);
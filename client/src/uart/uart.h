@@ -62,6 +62,14 @@ void uart_close(const serial_port sp);
  */
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen);
 
+/* Like uart_receive, but returns as soon as one burst of data has been read.
+ * Waits up to the timeout for the first byte, then fetches whatever is already
+ * pending (up to pszMaxRxLen) with a single read. Used for read-ahead buffering.
+ *
+ * Returns PM3_ENODATA if nothing arrived before the timeout.
+ */
+int uart_receive_burst(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen);
+
 /* Sends a buffer to a given serial port.
  *   pbtTx: A pointer to a buffer containing the data to send.
  *   len: The amount of data to be sent.
@@ -45,6 +45,7 @@
 #include "comms.h"
 #include "ui.h"
 #include "util_posix.h" // msleep
+#include "vdevice/vdevice.h"
 
 // Taken from https://github.com/unbit/uwsgi/commit/b608eb1772641d525bfde268fe9d6d8d0d5efde7
 #ifndef SOL_TCP
@@ -60,6 +61,7 @@ typedef struct {
     term_info tiOld;  // Terminal info before using the port
     term_info tiNew;  // Terminal info during the transaction
     RingBuffer *udpBuffer;
+    vdevice_t *sim;   // virtual device behind a "sim:" port
 } serial_port_unix_t_t;
 
 // see pm3_cmd.h
@@ -109,6 +111,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
     bool isUDP = false;
     bool isBluetooth = false;
     bool isUnixSocket = false;
+    bool isSim = (strncmp(prefix, "sim:", 4) == 0);
     if (strlen(prefix) > 4) {
         isTCP = (memcmp(prefix, "tcp:", 4) == 0);
         isUDP = (memcmp(prefix, "udp:", 4) == 0);
@@ -120,6 +123,21 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
         isUnixSocket = (memcmp(prefix, "socket:", 7) == 0);
     }
 
+    if (isSim) {
+
+        free(prefix);
+
+        sp->fd = vdevice_start(&sp->sim);
+        if (sp->fd == -1) {
+            PrintAndLogEx(ERR, "error: failed to start virtual device");
+            free(sp);
+            return INVALID_SERIAL_PORT;
+        }
+
+        g_conn.send_via_ip = PM3_NONE;
+        return sp;
+    }
+
     if (isTCP || isUDP) {
 
         free(prefix);
@@ -469,6 +487,7 @@ void uart_close(const serial_port sp) {
     }
     RingBuf_destroy(spu->udpBuffer);
     close(spu->fd);
+    vdevice_stop(spu->sim);
     free(sp);
 }
 
@@ -591,6 +610,60 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
     return PM3_SUCCESS;
 }
 
+int uart_receive_burst(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
+    uint32_t byteCount;  // FIONREAD returns size on 32b
+    fd_set rfds;
+    struct timeval tv;
+    const serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+
+    *pszRxLen = 0;
+
+    // UDP datagrams are already reassembled in udpBuffer
+    if (spu->udpBuffer != NULL) {
+        if (RingBuf_isEmpty(spu->udpBuffer) == false) {
+            *pszRxLen = RingBuf_dequeueBatch(spu->udpBuffer, pbtRx, pszMaxRxLen);
+            return PM3_SUCCESS;
+        }
+        return uart_receive(sp, pbtRx, MIN(pszMaxRxLen, 1), pszRxLen);
+    }
+
+    if (newtimeout_pending) {
+        timeout.tv_usec = ((suseconds_t)newtimeout_value) * 1000;
+        newtimeout_pending = false;
+    }
+
+    FD_ZERO(&rfds);
+    FD_SET(spu->fd, &rfds);
+    tv = timeout;
+    int res = select(spu->fd + 1, &rfds, NULL, NULL, &tv);
+    if (res < 0) {
+        return PM3_EIO;
+    }
+    if (res == 0) {
+        return PM3_ENODATA;
+    }
+
+    res = ioctl(spu->fd, FIONREAD, &byteCount);
+    if (res < 0) {
+        return PM3_ENOTTY;
+    } else if (byteCount == 0) {
+        // see uart_receive, readable but empty means the peer is gone
+        rx_empty_counter++;
+        if (rx_empty_counter > 3) {
+            return PM3_ENOTTY;
+        }
+        return PM3_ENODATA;
+    }
+    rx_empty_counter = 0;
+
+    res = read(spu->fd, pbtRx, MIN(byteCount, pszMaxRxLen));
+    if (res <= 0) {
+        return PM3_EIO;
+    }
+    *pszRxLen = res;
+    return PM3_SUCCESS;
+}
+
 int uart_send(const serial_port sp, const uint8_t *pbtTx, const uint32_t len) {
     uint32_t pos = 0;
     fd_set rfds;
@@ -503,6 +503,78 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
     }
 }
 
+int uart_receive_burst(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
+    const serial_port_windows_t *spw = (serial_port_windows_t *)sp;
+
+    *pszRxLen = 0;
+
+    // ReadFile only returns early when the interval timeout hits, which is set to the full timeout.
+    // Ask for what the driver already holds, or wait for a single byte when nothing is there yet.
+    if (spw->hSocket == INVALID_SOCKET) {
+        DWORD errors = 0;
+        COMSTAT stat;
+        memset(&stat, 0, sizeof(stat));
+        uint32_t want = 1;
+        if (ClearCommError(spw->hPort, &errors, &stat) && stat.cbInQue > 0) {
+            want = MIN(stat.cbInQue, pszMaxRxLen);
+        }
+        int res = uart_receive(sp, pbtRx, want, pszRxLen);
+        // nothing before the timeout, same as the socket path below
+        if (res == PM3_SUCCESS && *pszRxLen == 0) {
+            return PM3_ENODATA;
+        }
+        return res;
+    }
+
+    // UDP datagrams are already reassembled in udpBuffer
+    if (spw->udpBuffer != NULL) {
+        if (RingBuf_isEmpty(spw->udpBuffer) == false) {
+            *pszRxLen = RingBuf_dequeueBatch(spw->udpBuffer, pbtRx, pszMaxRxLen);
+            return PM3_SUCCESS;
+        }
+        return uart_receive(sp, pbtRx, MIN(pszMaxRxLen, 1), pszRxLen);
+    }
+
+    if (newtimeout_pending) {
+        timeout.tv_usec = newtimeout_value * 1000;
+        newtimeout_pending = false;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(spw->hSocket, &rfds);
+    struct timeval tv = timeout;
+    // the first argument nfds is ignored in Windows
+    int res = select(0, &rfds, NULL, NULL, &tv);
+    if (res == SOCKET_ERROR) {
+        return PM3_EIO;
+    }
+    if (res == 0) {
+        return PM3_ENODATA;
+    }
+
+    uint32_t byteCount = 0;
+    res = ioctlsocket(spw->hSocket, FIONREAD, (u_long *)&byteCount);
+    if (res == SOCKET_ERROR) {
+        return PM3_ENOTTY;
+    } else if (byteCount == 0) {
+        // see uart_receive, readable but empty means the peer is gone
+        rx_empty_counter++;
+        if (rx_empty_counter > 3) {
+            return PM3_ENOTTY;
+        }
+        return PM3_ENODATA;
+    }
+    rx_empty_counter = 0;
+
+    res = recv(spw->hSocket, (char *)pbtRx, MIN(byteCount, pszMaxRxLen), 0);
+    if (res <= 0) { // includes 0(gracefully closed) and -1(SOCKET_ERROR)
+        return PM3_EIO;
+    }
+    *pszRxLen = res;
+    return PM3_SUCCESS;
+}
+
 int uart_send(const serial_port sp, const uint8_t *p_tx, const uint32_t len) {
     const serial_port_windows_t *spw = (serial_port_windows_t *)sp;
     if (spw->hSocket == INVALID_SOCKET) { // serial port
@@ -33,10 +33,12 @@
 #endif
 
 #include <complex.h>
+#include <sched.h>      // sched_yield
 #include "util.h"
 #include "proxmark3.h"  // PROXLOG
 #include "fileutils.h"
 #include "pm3_cmd.h"
+#include "pm3.h"        // pm3_record
 
 #ifdef _WIN32
 # include <direct.h>    // _mkdir
@@ -62,6 +64,12 @@ bool g_GridLocked = false;
 pthread_mutex_t g_print_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static void fPrintAndLog(FILE *stream, const char *fmt, ...);
+static void async_log_push(FILE *stream, const char *text, bool linefeed, bool to_print, bool to_log, bool inplace);
+static void output_inplace(FILE *stream, const char *msg, bool flush);
+
+static FILE *logfile = NULL;
+static int logging = 1;
+static __thread bool thread_muted = false;
 
 #ifdef _WIN32
 #define MKDIR_CHK _mkdir(path)
@@ -171,32 +179,148 @@ int searchHomeFilePath(char **foundpath, const char *subdir, const char *filenam
     return PM3_SUCCESS;
 }
 
+// records collected while grabbing, data is kept as offset until handed out
+typedef struct {
+    pm3_record rec;
+    size_t offset;
+} grabbed_record_t;
+
+static struct {
+    grabbed_record_t *list;
+    size_t count;
+    size_t size;
+    uint8_t *data;
+    size_t data_idx;
+    size_t data_size;
+    pm3_record_cb cb;
+    void *userdata;
+} g_grabbed_records = {NULL, 0, 0, NULL, 0, 0, NULL, NULL};
+
 void free_grabber(void) {
     free(g_grabbed_output.ptr);
     g_grabbed_output.ptr = NULL;
     g_grabbed_output.size = 0;
     g_grabbed_output.idx = 0;
+
+    free(g_grabbed_records.list);
+    free(g_grabbed_records.data);
+    g_grabbed_records.list = NULL;
+    g_grabbed_records.data = NULL;
+    g_grabbed_records.count = 0;
+    g_grabbed_records.size = 0;
+    g_grabbed_records.data_idx = 0;
+    g_grabbed_records.data_size = 0;
 }
 
 static void fill_grabber(const char *string) {
-    if (g_grabbed_output.ptr == NULL || g_grabbed_output.size - g_grabbed_output.idx < MAX_PRINT_BUFFER) {
-        char *tmp = realloc(g_grabbed_output.ptr, g_grabbed_output.size + MAX_PRINT_BUFFER);
+    size_t len = strlen(string);
+
+    // grow geometrically, always keeping room for the terminating NUL
+    if (g_grabbed_output.ptr == NULL || g_grabbed_output.size - g_grabbed_output.idx <= len) {
+        size_t newsize = (g_grabbed_output.size) ? g_grabbed_output.size : MAX_PRINT_BUFFER;
+        while (newsize - g_grabbed_output.idx <= len) {
+            newsize *= 2;
+        }
+
+        char *tmp = realloc(g_grabbed_output.ptr, newsize);
         if (tmp == NULL) {
             // We leave current g_grabbed_output untouched
             PrintAndLogEx(WARNING, "Failed to allocate memory");
             return;
         }
         g_grabbed_output.ptr = tmp;
-        g_grabbed_output.size += MAX_PRINT_BUFFER;
+        g_grabbed_output.size = newsize;
+    }
+
+    memcpy(g_grabbed_output.ptr + g_grabbed_output.idx, string, len + 1);
+    g_grabbed_output.idx += len;
+}
+
+static void fill_record_grabber(const pm3_record *rec) {
+
+    if (g_grabbed_records.count == g_grabbed_records.size) {
+        size_t newsize = (g_grabbed_records.size) ? g_grabbed_records.size * 2 : 64;
+        grabbed_record_t *tmp = realloc(g_grabbed_records.list, newsize * sizeof(grabbed_record_t));
+        if (tmp == NULL) {
+            return;
+        }
+        g_grabbed_records.list = tmp;
+        g_grabbed_records.size = newsize;
     }
 
-    int len = snprintf(g_grabbed_output.ptr + g_grabbed_output.idx, MAX_PRINT_BUFFER, "%s", string);
-    if (len < 0 || len > MAX_PRINT_BUFFER) {
-        // We leave current g_grabbed_output_len untouched
-        PrintAndLogEx(ERR, "snprintf error in fill_grabber()");
+    if (g_grabbed_records.data_size - g_grabbed_records.data_idx < rec->len) {
+        size_t newsize = (g_grabbed_records.data_size) ? g_grabbed_records.data_size : MAX_PRINT_BUFFER;
+        while (newsize - g_grabbed_records.data_idx < rec->len) {
+            newsize *= 2;
+        }
+
+        uint8_t *tmp = realloc(g_grabbed_records.data, newsize);
+        if (tmp == NULL) {
+            return;
+        }
+        g_grabbed_records.data = tmp;
+        g_grabbed_records.data_size = newsize;
+    }
+
+    grabbed_record_t *r = &g_grabbed_records.list[g_grabbed_records.count++];
+    r->rec = *rec;
+    r->rec.data = NULL;
+    r->offset = g_grabbed_records.data_idx;
+    if (rec->len) {
+        memcpy(g_grabbed_records.data + g_grabbed_records.data_idx, rec->data, rec->len);
+        g_grabbed_records.data_idx += rec->len;
+    }
+}
+
+void PrintAndLogRecord(uint8_t type, uint32_t index, uint8_t subtype, uint32_t timestamp, const uint8_t *data, size_t len) {
+
+    // nobody is listening
+    if (g_grabbed_records.cb == NULL && (g_printAndLog & PRINTANDLOG_GRAB) == 0) {
         return;
     }
-    g_grabbed_output.idx += len;
+
+    pm3_record rec = {
+        .type = type,
+        .index = index,
+        .timestamp = timestamp,
+        .subtype = subtype,
+        .len = (data) ? len : 0,
+        .data = data,
+    };
+
+    if (g_grabbed_records.cb) {
+        g_grabbed_records.cb(&rec, g_grabbed_records.userdata);
+    }
+
+    if (g_printAndLog & PRINTANDLOG_GRAB) {
+        pthread_mutex_lock(&g_print_lock);
+        fill_record_grabber(&rec);
+        pthread_mutex_unlock(&g_print_lock);
+    }
+}
+
+void set_record_callback(pm3_record_cb cb, void *userdata) {
+    g_grabbed_records.cb = cb;
+    g_grabbed_records.userdata = userdata;
+}
+
+void clear_record_grabber(void) {
+    g_grabbed_records.count = 0;
+    g_grabbed_records.data_idx = 0;
+}
+
+size_t grabbed_records_count(void) {
+    return g_grabbed_records.count;
+}
+
+const pm3_record *grabbed_record_get(size_t index) {
+    if (index >= g_grabbed_records.count) {
+        return NULL;
+    }
+
+    grabbed_record_t *r = &g_grabbed_records.list[index];
+    r->rec.data = (r->rec.len) ? g_grabbed_records.data + r->offset : NULL;
+    return &r->rec;
 }
 
 void PrintAndLogOptions(const char *str[][2], size_t size, size_t space) {
@@ -270,6 +394,10 @@ void PrintAndLogInfoHeader(const char *title) {
 
 static uint8_t PrintAndLogEx_spinidx = 0;
 
+void PrintAndLogMuteThread(bool mute) {
+    thread_muted = mute;
+}
+
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
 
     // skip debug messages if client debugging is turned off i.e. 'DATA SETDEBUG -0'
@@ -282,6 +410,16 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
         return;
     }
 
+    if (thread_muted) {
+        return;
+    }
+
+    // nobody will see it, don't spend time formatting it
+    if ((g_printAndLog & (PRINTANDLOG_PRINT | PRINTANDLOG_GRAB)) == 0 &&
+            ((g_printAndLog & PRINTANDLOG_LOG) == 0 || logging == 0)) {
+        return;
+    }
+
     char prefix[40] = {0};
     char buffer[MAX_PRINT_BUFFER] = {0};
     char buffer2[MAX_PRINT_BUFFER + sizeof(prefix)] = {0};
@@ -391,12 +529,11 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
         if (level == INPLACE) {
             // ignore INPLACE if rest of output is grabbed
             if (!(g_printAndLog & PRINTANDLOG_GRAB)) {
-                char buffer3[sizeof(buffer2)] = {0};
-                char buffer4[sizeof(buffer2)] = {0};
-                memcpy_filter_ansi(buffer3, buffer2, sizeof(buffer2), !g_session.supports_colors);
-                memcpy_filter_emoji(buffer4, buffer3, sizeof(buffer3), g_session.emoji_mode);
-                fprintf(stream, "\r%s", buffer4);
-                fflush(stream);
+                if (PrintAndLogIsAsync()) {
+                    async_log_push(stream, buffer2, false, true, false, true);
+                } else {
+                    output_inplace(stream, buffer2, true);
+                }
             }
         } else {
             fPrintAndLog(stream, "%s", buffer2);
@@ -404,100 +541,63 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
     }
 }
 
-static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
-    va_list argptr;
-    static FILE *logfile = NULL;
-    static int logging = 1;
-    char buffer[MAX_PRINT_BUFFER] = {0};
-    char buffer2[MAX_PRINT_BUFFER] = {0};
-    char buffer3[MAX_PRINT_BUFFER] = {0};
+static void open_logfile(void) {
+    char *my_logfile_path = NULL;
+    char filename[40];
+    struct tm *timenow;
+    time_t now = time(NULL);
+    timenow = gmtime(&now);
+    strftime(filename, sizeof(filename), PROXLOG, timenow);
 
-    bool linefeed = true;
+    if (searchHomeFilePath(&my_logfile_path, LOGS_SUBDIR, filename, true) != PM3_SUCCESS) {
 
-    if (logging && g_session.incognito) {
+        printf(_YELLOW_("[-]") " Logging disabled!\n");
+        my_logfile_path = NULL;
         logging = 0;
-    }
 
-    if ((g_printAndLog & PRINTANDLOG_LOG) && logging && !logfile) {
-        char *my_logfile_path = NULL;
-        char filename[40];
-        struct tm *timenow;
-        time_t now = time(NULL);
-        timenow = gmtime(&now);
-        strftime(filename, sizeof(filename), PROXLOG, timenow);
-
-        if (searchHomeFilePath(&my_logfile_path, LOGS_SUBDIR, filename, true) != PM3_SUCCESS) {
+    } else {
 
-            printf(_YELLOW_("[-]") " Logging disabled!\n");
-            my_logfile_path = NULL;
+        logfile = fopen(my_logfile_path, "a");
+        if (logfile == NULL) {
+            printf(_YELLOW_("[-]") " Can't open logfile %s, logging disabled!\n", my_logfile_path);
             logging = 0;
-
         } else {
 
-            logfile = fopen(my_logfile_path, "a");
-            if (logfile == NULL) {
-                printf(_YELLOW_("[-]") " Can't open logfile %s, logging disabled!\n", my_logfile_path);
-                logging = 0;
+            if (g_session.supports_colors) {
+                printf("["_YELLOW_("=")"] Session log " _YELLOW_("%s") "\n", my_logfile_path);
             } else {
-
-                if (g_session.supports_colors) {
-                    printf("["_YELLOW_("=")"] Session log " _YELLOW_("%s") "\n", my_logfile_path);
-                } else {
-                    printf("[=] Session log %s\n", my_logfile_path);
-                }
-
+                printf("[=] Session log %s\n", my_logfile_path);
             }
-            free(my_logfile_path);
+
         }
+        free(my_logfile_path);
     }
+}
 
-    // lock this section to avoid interlacing prints from different threads
-    pthread_mutex_lock(&g_print_lock);
+// filter one formatted message and send it to the enabled outputs.
+// Caller holds g_print_lock.
+static void output_message(FILE *stream, const char *msg, bool linefeed, bool to_print, bool to_log, bool to_grab, bool flush) {
+    char buffer[MAX_PRINT_BUFFER] = {0};
+    char buffer2[MAX_PRINT_BUFFER] = {0};
+    char buffer3[MAX_PRINT_BUFFER] = {0};
 
-// If there is an incoming message from the hardware (eg: lf hid read) in
-// the background (while the prompt is displayed and accepting user input),
-// stash the prompt and bring it back later.
-#ifdef RL_STATE_READCMD
-    // We are using GNU readline. libedit (OSX) doesn't support this flag.
-    int need_hack = (rl_readline_state & RL_STATE_READCMD) > 0;
-    char *saved_line = NULL;
-
-    if (need_hack) {
-        saved_line = rl_copy_text(0, rl_end);
-        rl_clear_visible_line();
-    }
-#endif
-    va_start(argptr, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, argptr);
-    va_end(argptr);
-    if (strlen(buffer) > 0 && buffer[strlen(buffer) - 1] == NOLF[0]) {
-        linefeed = false;
-        buffer[strlen(buffer) - 1] = 0;
-    }
+    strncpy(buffer, msg, sizeof(buffer) - 1);
 
     bool filter_ansi = !g_session.supports_colors;
     memcpy_filter_ansi(buffer2, buffer, sizeof(buffer), filter_ansi);
 
-    if ((g_printAndLog & PRINTANDLOG_PRINT) == PRINTANDLOG_PRINT) {
+    if (to_print) {
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), g_session.emoji_mode);
         fprintf(stream, "%s", buffer3);
         if (linefeed) {
             fprintf(stream, "\n");
         }
-        fflush(stream);
-    }
-
-#ifdef RL_STATE_READCMD
-    if (need_hack) {
-        rl_on_new_line();
-        rl_replace_line(saved_line, 0);
-        rl_redisplay();
-        free(saved_line);
+        if (flush) {
+            fflush(stream);
+        }
     }
-#endif
 
-    if (((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile) ||
-            (g_printAndLog & PRINTANDLOG_GRAB)) {
+    if (to_log || to_grab) {
 
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), EMO_ALTTEXT);
 
@@ -506,7 +606,7 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
         }
     }
 
-    if ((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile) {
+    if (to_log) {
 
         if (filter_ansi) {
             fprintf(logfile, "%s", buffer3);
@@ -517,10 +617,12 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
         if (linefeed) {
             fprintf(logfile, "\n");
         }
-        fflush(logfile);
+        if (flush) {
+            fflush(logfile);
+        }
     }
 
-    if (g_printAndLog & PRINTANDLOG_GRAB) {
+    if (to_grab) {
 
         if (filter_ansi) {
             fill_grabber(buffer3);
@@ -532,6 +634,399 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
             fill_grabber("\n");
         }
     }
+}
+
+// INPLACE lines go to the terminal only, overwriting the current line
+static void output_inplace(FILE *stream, const char *msg, bool flush) {
+    char buffer3[MAX_PRINT_BUFFER] = {0};
+    char buffer4[MAX_PRINT_BUFFER] = {0};
+    memcpy_filter_ansi(buffer3, msg, sizeof(buffer3), !g_session.supports_colors);
+    memcpy_filter_emoji(buffer4, buffer3, sizeof(buffer3), g_session.emoji_mode);
+    fprintf(stream, "\r%s", buffer4);
+    if (flush) {
+        fflush(stream);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Asynchronous output
+// Producers push formatted messages on a lock-free MPSC list (Vyukov style),
+// a single writer thread filters them and writes them out in batches.
+//-----------------------------------------------------------------------------
+#define ASYNC_LOG_MAX_PENDING   4096
+#define ASYNC_LOG_BATCH         256
+
+typedef struct async_msg_s {
+    struct async_msg_s *next;
+    FILE *stream;
+    bool linefeed;
+    bool to_print;
+    bool to_log;
+    bool inplace;
+    char text[];
+} async_msg_t;
+
+static struct {
+    async_msg_t *head;          // producers push here
+    async_msg_t *tail;          // writer pops here
+    async_msg_t stub;
+    uint64_t pushed;
+    uint64_t written;
+    uint32_t pushing;           // producers between the running check and the enqueue
+    bool running;
+    bool stop;
+    bool writer_idle;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_cond_t drained;
+} g_async_log = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wakeup = PTHREAD_COND_INITIALIZER,
+    .drained = PTHREAD_COND_INITIALIZER,
+};
+
+static void async_log_enqueue(async_msg_t *msg) {
+    msg->next = NULL;
+    async_msg_t *prev = __atomic_exchange_n(&g_async_log.head, msg, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, msg, __ATOMIC_RELEASE);
+}
+
+// single consumer only
+static async_msg_t *async_log_dequeue(void) {
+    async_msg_t *tail = g_async_log.tail;
+    async_msg_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &g_async_log.stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        g_async_log.tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next) {
+        g_async_log.tail = next;
+        return tail;
+    }
+
+    // a producer is between exchange and linking, try again later
+    if (tail != __atomic_load_n(&g_async_log.head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    async_log_enqueue(&g_async_log.stub);
+
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        g_async_log.tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void async_log_write_now(FILE *stream, const char *text, bool linefeed, bool to_print, bool to_log, bool inplace) {
+    pthread_mutex_lock(&g_print_lock);
+    if (inplace) {
+        output_inplace(stream, text, true);
+    } else {
+        output_message(stream, text, linefeed, to_print, to_log && logfile, false, true);
+    }
+    pthread_mutex_unlock(&g_print_lock);
+}
+
+static void async_log_push(FILE *stream, const char *text, bool linefeed, bool to_print, bool to_log, bool inplace) {
+    // PrintAndLogAsync(false) waits for us before it stops the writer
+    __atomic_add_fetch(&g_async_log.pushing, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_async_log.running, __ATOMIC_SEQ_CST) == false) {
+        __atomic_sub_fetch(&g_async_log.pushing, 1, __ATOMIC_SEQ_CST);
+        async_log_write_now(stream, text, linefeed, to_print, to_log, inplace);
+        return;
+    }
+
+    size_t len = strlen(text);
+    async_msg_t *msg = malloc(sizeof(async_msg_t) + len + 1);
+    if (msg == NULL) {
+        // can't defer it, write it now
+        __atomic_sub_fetch(&g_async_log.pushing, 1, __ATOMIC_SEQ_CST);
+        async_log_write_now(stream, text, linefeed, to_print, to_log, inplace);
+        return;
+    }
+
+    msg->stream = stream;
+    msg->linefeed = linefeed;
+    msg->to_print = to_print;
+    msg->to_log = to_log;
+    msg->inplace = inplace;
+    memcpy(msg->text, text, len + 1);
+
+    // don't let a stalled terminal eat all memory
+    if (__atomic_load_n(&g_async_log.pushed, __ATOMIC_ACQUIRE) - __atomic_load_n(&g_async_log.written, __ATOMIC_ACQUIRE) > ASYNC_LOG_MAX_PENDING) {
+        PrintAndLogFlush();
+    }
+
+    async_log_enqueue(msg);
+    __atomic_add_fetch(&g_async_log.pushed, 1, __ATOMIC_ACQ_REL);
+
+    if (__atomic_load_n(&g_async_log.writer_idle, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g_async_log.lock);
+        pthread_cond_signal(&g_async_log.wakeup);
+        pthread_mutex_unlock(&g_async_log.lock);
+    }
+    __atomic_sub_fetch(&g_async_log.pushing, 1, __ATOMIC_SEQ_CST);
+}
+
+static void *async_log_writer(void *arg) {
+    (void) arg;
+    async_msg_t *batch[ASYNC_LOG_BATCH];
+
+    while (true) {
+
+        size_t n = 0;
+        async_msg_t *msg;
+        while (n < ASYNC_LOG_BATCH && (msg = async_log_dequeue()) != NULL) {
+            batch[n++] = msg;
+        }
+
+        if (n == 0) {
+            pthread_mutex_lock(&g_async_log.lock);
+            if (__atomic_load_n(&g_async_log.pushed, __ATOMIC_ACQUIRE) == __atomic_load_n(&g_async_log.written, __ATOMIC_ACQUIRE)) {
+                pthread_cond_broadcast(&g_async_log.drained);
+                if (g_async_log.stop) {
+                    pthread_mutex_unlock(&g_async_log.lock);
+                    break;
+                }
+            }
+
+            __atomic_store_n(&g_async_log.writer_idle, true, __ATOMIC_RELEASE);
+            // timed, so a wakeup racing with going idle only costs a few ms
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 10 * 1000 * 1000;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&g_async_log.wakeup, &g_async_log.lock, &ts);
+            __atomic_store_n(&g_async_log.writer_idle, false, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&g_async_log.lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&g_print_lock);
+
+#ifdef RL_STATE_READCMD
+        int need_hack = (rl_readline_state & RL_STATE_READCMD) > 0;
+        char *saved_line = NULL;
+
+        if (need_hack) {
+            saved_line = rl_copy_text(0, rl_end);
+            rl_clear_visible_line();
+        }
+#endif
+        bool used_stderr = false;
+        FILE *last_stream = NULL;
+        for (size_t i = 0; i < n; i++) {
+            msg = batch[i];
+            // keep stdout / stderr ordering when they are interleaved
+            if (last_stream && last_stream != msg->stream) {
+                fflush(last_stream);
+            }
+            last_stream = msg->stream;
+            if (msg->inplace) {
+                output_inplace(msg->stream, msg->text, false);
+            } else {
+                output_message(msg->stream, msg->text, msg->linefeed, msg->to_print, msg->to_log && logfile, false, false);
+            }
+            used_stderr |= (msg->stream == stderr);
+        }
+
+        // one flush per batch instead of one per line
+        fflush(stdout);
+        if (used_stderr) {
+            fflush(stderr);
+        }
+        if (logfile) {
+            fflush(logfile);
+        }
+
+#ifdef RL_STATE_READCMD
+        if (need_hack) {
+            rl_on_new_line();
+            rl_replace_line(saved_line, 0);
+            rl_redisplay();
+            free(saved_line);
+        }
+#endif
+        pthread_mutex_unlock(&g_print_lock);
+
+        for (size_t i = 0; i < n; i++) {
+            // the stub node is never handed out
+            free(batch[i]);
+        }
+        __atomic_add_fetch(&g_async_log.written, n, __ATOMIC_ACQ_REL);
+    }
+    return NULL;
+}
+
+void PrintAndLogFlush(void) {
+    if (__atomic_load_n(&g_async_log.running, __ATOMIC_ACQUIRE) == false) {
+        return;
+    }
+
+    // nothing to wait for when called from the writer itself
+    if (pthread_equal(pthread_self(), g_async_log.thread)) {
+        return;
+    }
+
+    uint64_t target = __atomic_load_n(&g_async_log.pushed, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&g_async_log.lock);
+    while (__atomic_load_n(&g_async_log.written, __ATOMIC_ACQUIRE) < target) {
+        pthread_cond_signal(&g_async_log.wakeup);
+        pthread_cond_wait(&g_async_log.drained, &g_async_log.lock);
+    }
+    pthread_mutex_unlock(&g_async_log.lock);
+}
+
+static void async_log_atexit(void) {
+    PrintAndLogAsync(false);
+}
+
+int PrintAndLogAsync(bool enable) {
+
+    if (enable == __atomic_load_n(&g_async_log.running, __ATOMIC_ACQUIRE)) {
+        return PM3_SUCCESS;
+    }
+
+    if (enable) {
+        static bool atexit_set = false;
+
+        g_async_log.stub.next = NULL;
+        g_async_log.head = &g_async_log.stub;
+        g_async_log.tail = &g_async_log.stub;
+        g_async_log.pushed = 0;
+        g_async_log.written = 0;
+        g_async_log.stop = false;
+
+        if (pthread_create(&g_async_log.thread, NULL, async_log_writer, NULL) != 0) {
+            return PM3_EFAILED;
+        }
+
+        if (atexit_set == false) {
+            atexit(async_log_atexit);
+            atexit_set = true;
+        }
+
+        __atomic_store_n(&g_async_log.running, true, __ATOMIC_RELEASE);
+        return PM3_SUCCESS;
+    }
+
+    // producers from here on write synchronously again,
+    // wait for the ones that already passed the check to queue their message
+    __atomic_store_n(&g_async_log.running, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&g_async_log.pushing, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+
+    // the writer drains the queue before it stops
+    pthread_mutex_lock(&g_async_log.lock);
+    g_async_log.stop = true;
+    pthread_cond_signal(&g_async_log.wakeup);
+    pthread_mutex_unlock(&g_async_log.lock);
+
+    pthread_join(g_async_log.thread, NULL);
+
+    // anything still queued is written here, the writer is gone so we are the consumer
+    async_msg_t *msg;
+    while ((msg = async_log_dequeue()) != NULL) {
+        async_log_write_now(msg->stream, msg->text, msg->linefeed, msg->to_print, msg->to_log, msg->inplace);
+        free(msg);
+        __atomic_add_fetch(&g_async_log.written, 1, __ATOMIC_ACQ_REL);
+    }
+    return PM3_SUCCESS;
+}
+
+bool PrintAndLogIsAsync(void) {
+    return __atomic_load_n(&g_async_log.running, __ATOMIC_ACQUIRE);
+}
+
+static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
+    va_list argptr;
+    char buffer[MAX_PRINT_BUFFER] = {0};
+
+    bool linefeed = true;
+
+    if (logging && g_session.incognito) {
+        logging = 0;
+    }
+
+    if ((g_printAndLog & PRINTANDLOG_LOG) && logging && !logfile) {
+        open_logfile();
+    }
+
+    bool to_print = ((g_printAndLog & PRINTANDLOG_PRINT) == PRINTANDLOG_PRINT);
+    bool to_log = ((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile);
+    bool to_grab = (g_printAndLog & PRINTANDLOG_GRAB);
+
+    if (PrintAndLogIsAsync()) {
+
+        va_start(argptr, fmt);
+        vsnprintf(buffer, sizeof(buffer), fmt, argptr);
+        va_end(argptr);
+        if (strlen(buffer) > 0 && buffer[strlen(buffer) - 1] == NOLF[0]) {
+            linefeed = false;
+            buffer[strlen(buffer) - 1] = 0;
+        }
+
+        // grabbed output must be complete when the command returns
+        if (to_grab) {
+            pthread_mutex_lock(&g_print_lock);
+            output_message(stream, buffer, linefeed, false, false, true, false);
+            pthread_mutex_unlock(&g_print_lock);
+        }
+
+        if (to_print || to_log) {
+            async_log_push(stream, buffer, linefeed, to_print, to_log, false);
+        }
+        return;
+    }
+
+    // lock this section to avoid interlacing prints from different threads
+    pthread_mutex_lock(&g_print_lock);
+
+// If there is an incoming message from the hardware (eg: lf hid read) in
+// the background (while the prompt is displayed and accepting user input),
+// stash the prompt and bring it back later.
+#ifdef RL_STATE_READCMD
+    // We are using GNU readline. libedit (OSX) doesn't support this flag.
+    int need_hack = (rl_readline_state & RL_STATE_READCMD) > 0;
+    char *saved_line = NULL;
+
+    if (need_hack) {
+        saved_line = rl_copy_text(0, rl_end);
+        rl_clear_visible_line();
+    }
+#endif
+    va_start(argptr, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, argptr);
+    va_end(argptr);
+    if (strlen(buffer) > 0 && buffer[strlen(buffer) - 1] == NOLF[0]) {
+        linefeed = false;
+        buffer[strlen(buffer) - 1] = 0;
+    }
+
+    output_message(stream, buffer, linefeed, to_print, to_log, to_grab, true);
+
+#ifdef RL_STATE_READCMD
+    if (need_hack) {
+        rl_on_new_line();
+        rl_replace_line(saved_line, 0);
+        rl_redisplay();
+        free(saved_line);
+    }
+#endif
 
     if (flushAfterWrite) {
         fflush(stdout);
@@ -50,6 +50,7 @@ typedef struct {
     bool help_dump_mode;
     bool show_hints;
     bool dense_output;
+    bool lua_persistent; // keep one Lua state for all `script run`
     bool window_changed; // track if plot/overlay pos/size changed to save on exit
     qtWindow_t plot;
     qtWindow_t overlay;
@@ -83,11 +84,26 @@ void PrintAndLogInfoHeaderWithWidth(const char *title, size_t width);
 void PrintAndLogInfoHeader(const char *title);
 void SetFlushAfterWrite(bool value);
 bool GetFlushAfterWrite(void);
+// print and log from a background writer thread
+int PrintAndLogAsync(bool enable);
+bool PrintAndLogIsAsync(void);
+// wait until everything printed so far is written out
+void PrintAndLogFlush(void);
+// drop everything the calling thread prints, for chatty worker threads
+void PrintAndLogMuteThread(bool mute);
 void memcpy_filter_ansi(void *dest, const void *src, size_t n, bool filter);
 void memcpy_filter_rlmarkers(void *dest, const void *src, size_t n);
 void memcpy_filter_emoji(void *dest, const void *src, size_t n, emojiMode_t mode);
 void free_grabber(void);
 
+// structured output for library users, type is a pm3_record_type, see pm3.h
+struct pm3_record;
+void PrintAndLogRecord(uint8_t type, uint32_t index, uint8_t subtype, uint32_t timestamp, const uint8_t *data, size_t len);
+void set_record_callback(void (*cb)(const struct pm3_record *rec, void *userdata), void *userdata);
+void clear_record_grabber(void);
+size_t grabbed_records_count(void);
+const struct pm3_record *grabbed_record_get(size_t index);
+
 int searchHomeFilePath(char **foundpath, const char *subdir, const char *filename, bool create_home);
 
 extern pthread_mutex_t g_print_lock;
@@ -0,0 +1,1479 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Host side virtual Proxmark3 device
+//-----------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+#include "vdevice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "pm3_cmd.h"
+#include "mifare.h"
+#include "iso15.h"
+#include "iso15693tools.h"
+#include "iso18.h"
+#include "protocols.h"
+#include "ansi.h"
+#include "commonutil.h"
+#include "crc16.h"
+#include "parity.h"
+#include "fpga.h"
+#include "crapto1/crapto1.h"
+#include "mifare/mifaredefault.h"   // MFBLOCK_SIZE
+
+#ifdef MSG_NOSIGNAL
+# define VDEV_SEND_FLAGS MSG_NOSIGNAL
+#else
+# define VDEV_SEND_FLAGS 0
+#endif
+
+// same order of magnitude as on a PM3 generic
+#define VDEV_BIGBUF_SIZE    40000
+#define VDEV_EML_SIZE       4096
+
+#ifndef AddCrc14A
+# define AddCrc14A(data, len) compute_crc(CRC_14443_A, (data), (len), (data)+(len), (data)+(len)+1)
+#endif
+
+#define VDEV_MF_MAXSECTOR   40
+
+// DESFire data per answer frame, like a real card
+#define VDEV_DF_FRAME       59
+#define VDEV_DF_FILES       2
+
+// blocks a READ MULTIPLE BLOCKS may ask for, real tags limit this differently
+#define VDEV_15_MAXMULTI    32
+
+#ifndef AddCrc15
+# define AddCrc15(data, len) compute_crc(CRC_15693, (data), (len), (data)+(len), (data)+(len)+1)
+#endif
+
+// FeliCa crc is sent MSB first
+#define AddCrcFelica(data, len) compute_crc(CRC_FELICA, (data), (len), (data)+(len)+1, (data)+(len))
+
+// AT91SAM7S512 Rev B
+#define VDEV_CHIP_ID        0x270B0A4F
+
+struct vdevice_s {
+    int fd;                     // device end of the socketpair
+    pthread_t thread;
+    uint8_t bigbuf[VDEV_BIGBUF_SIZE];
+    uint32_t trace_len;
+    uint32_t timestamp;         // simulated air time, carrier ticks
+    uint8_t eml[VDEV_EML_SIZE];
+    uint32_t nt;                // card PRNG state
+    // hf mf fchk state kept between key chunks
+    uint8_t chk_sector[VDEV_MF_MAXSECTOR][2][MIFARE_KEY_SIZE];
+    uint8_t chk_found[VDEV_MF_MAXSECTOR * 2];
+    uint8_t chk_foundkeys;
+    // virtual ISO15693 tag, fixed content
+    iso15_tag_t tag15;
+    // ISO14443-4 layer of the virtual 14a card and its DESFire application
+    uint8_t pcb_blocknum;
+    uint32_t df_aid;
+    uint8_t df_pending;         // file of a ReadData waiting for additional frames, 0xFF for none
+    uint32_t df_pos;
+    uint32_t df_end;
+};
+
+//-----------------------------------------------------------------------------
+// transport
+//-----------------------------------------------------------------------------
+static bool vdev_read(vdevice_t *dev, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len) {
+        ssize_t res = read(dev->fd, p, len);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        len -= res;
+    }
+    return true;
+}
+
+static bool vdev_write(vdevice_t *dev, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len) {
+        ssize_t res = send(dev->fd, p, len, VDEV_SEND_FLAGS);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        p += res;
+        len -= res;
+    }
+    return true;
+}
+
+static int vdev_reply_internal(vdevice_t *dev, uint16_t cmd, int8_t status, const uint8_t *data, size_t len, bool ng) {
+    PacketResponseNGRaw tx;
+
+    tx.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    tx.pre.cmd = cmd;
+    tx.pre.status = status;
+    tx.pre.reason = PM3_REASON_UNKNOWN;
+    tx.pre.ng = ng;
+    if (len > PM3_CMD_DATA_SIZE) {
+        len = PM3_CMD_DATA_SIZE;
+        tx.pre.status = PM3_EOVFLOW;
+    }
+    tx.pre.length = (len & 0x7FFF);
+
+    if (data && len) {
+        memcpy(tx.data, data, len);
+    }
+
+    // like USB-CDC, no CRC
+    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)((uint8_t *)&tx + sizeof(PacketResponseNGPreamble) + len);
+    tx_post->crc = RESPONSENG_POSTAMBLE_MAGIC;
+
+    if (vdev_write(dev, &tx, sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble)) == false) {
+        return PM3_EIO;
+    }
+    return PM3_SUCCESS;
+}
+
+static int vdev_reply_ng(vdevice_t *dev, uint16_t cmd, int8_t status, const uint8_t *data, size_t len) {
+    return vdev_reply_internal(dev, cmd, status, data, len, true);
+}
+
+static int vdev_reply_mix(vdevice_t *dev, uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    int8_t status = PM3_SUCCESS;
+    uint64_t arg[3] = {arg0, arg1, arg2};
+    if (len > PM3_CMD_DATA_SIZE - sizeof(arg)) {
+        len = PM3_CMD_DATA_SIZE - sizeof(arg);
+        status = PM3_EOVFLOW;
+    }
+    uint8_t cmddata[PM3_CMD_DATA_SIZE];
+    memcpy(cmddata, arg, sizeof(arg));
+    if (len && data) {
+        memcpy(cmddata + sizeof(arg), data, len);
+    }
+    return vdev_reply_internal(dev, (cmd & 0xFFFF), status, cmddata, len + sizeof(arg), false);
+}
+
+static int vdev_reply_old(vdevice_t *dev, uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    PacketResponseOLD tx;
+    memset(&tx, 0, sizeof(tx));
+    tx.cmd = cmd;
+    tx.arg[0] = arg0;
+    tx.arg[1] = arg1;
+    tx.arg[2] = arg2;
+    if (data && len) {
+        memcpy(tx.d.asBytes, data, MIN(len, PM3_CMD_DATA_SIZE));
+    }
+    return vdev_write(dev, &tx, sizeof(tx)) ? PM3_SUCCESS : PM3_EIO;
+}
+
+// Same framing rules as receive_ng_internal() in armsrc/cmd.c
+static int vdev_receive(vdevice_t *dev, PacketCommandNG *rx) {
+
+    PacketCommandNGRaw rx_raw;
+    if (vdev_read(dev, &rx_raw.pre, sizeof(PacketCommandNGPreamble)) == false) {
+        return PM3_EIO;
+    }
+
+    rx->magic = rx_raw.pre.magic;
+    rx->ng = rx_raw.pre.ng;
+    rx->cmd = rx_raw.pre.cmd;
+    uint16_t length = rx_raw.pre.length;
+
+    if (rx->magic == COMMANDNG_PREAMBLE_MAGIC) {
+
+        if (length > PM3_CMD_DATA_SIZE) {
+            return PM3_EOVFLOW;
+        }
+
+        if (vdev_read(dev, rx_raw.data, length) == false) {
+            return PM3_EIO;
+        }
+
+        if (rx->ng) {
+            memcpy(rx->data.asBytes, rx_raw.data, length);
+            rx->length = length;
+        } else {
+            uint64_t arg[3] = {0};
+            if (length < sizeof(arg)) {
+                return PM3_EINVARG;
+            }
+            memcpy(arg, rx_raw.data, sizeof(arg));
+            rx->oldarg[0] = arg[0];
+            rx->oldarg[1] = arg[1];
+            rx->oldarg[2] = arg[2];
+            memcpy(rx->data.asBytes, rx_raw.data + sizeof(arg), length - sizeof(arg));
+            rx->length = length - sizeof(arg);
+        }
+
+        PacketCommandNGPostamble post;
+        if (vdev_read(dev, &post, sizeof(post)) == false) {
+            return PM3_EIO;
+        }
+
+        // Check CRC, accept MAGIC as placeholder
+        rx->crc = post.crc;
+        if (rx->crc != COMMANDNG_POSTAMBLE_MAGIC) {
+            uint8_t first, second;
+            compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, sizeof(PacketCommandNGPreamble) + length, &first, &second);
+            if ((first << 8) + second != rx->crc) {
+                return PM3_ECRC;
+            }
+        }
+
+    } else {
+        PacketCommandOLD rx_old;
+        memcpy(&rx_old, &rx_raw.pre, sizeof(PacketCommandNGPreamble));
+        if (vdev_read(dev, ((uint8_t *)&rx_old) + sizeof(PacketCommandNGPreamble), sizeof(PacketCommandOLD) - sizeof(PacketCommandNGPreamble)) == false) {
+            return PM3_EIO;
+        }
+        rx->ng = false;
+        rx->magic = 0;
+        rx->crc = 0;
+        rx->cmd = (rx_old.cmd & 0xFFFF);
+        rx->oldarg[0] = rx_old.arg[0];
+        rx->oldarg[1] = rx_old.arg[1];
+        rx->oldarg[2] = rx_old.arg[2];
+        rx->length = PM3_CMD_DATA_SIZE;
+        memcpy(&rx->data, &rx_old.d.asBytes, rx->length);
+    }
+    return PM3_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// trace
+//-----------------------------------------------------------------------------
+static void vdev_log(vdevice_t *dev, const uint8_t *frame, uint16_t len, bool response) {
+
+    tracelog_hdr_t hdr = {0};
+    hdr.data_len = len;
+    uint16_t parlen = TRACELOG_PARITY_LEN(&hdr);
+    uint32_t need = TRACELOG_HDR_LEN + len + parlen;
+
+    // no more space, tracing stops like on the device
+    if (dev->trace_len + need > sizeof(dev->bigbuf)) {
+        return;
+    }
+
+    // 9 bits of 128 carrier ticks per byte, plus a frame delay
+    hdr.timestamp = dev->timestamp;
+    hdr.duration = len * 9 * 128;
+    hdr.isResponse = response;
+    dev->timestamp += hdr.duration + 1172;
+
+    uint8_t *p = dev->bigbuf + dev->trace_len;
+    memcpy(p, &hdr, TRACELOG_HDR_LEN);
+    memcpy(p + TRACELOG_HDR_LEN, frame, len);
+
+    // parity bits are sent as odd parity of the transmitted byte, they are not encrypted
+    uint8_t *par = p + TRACELOG_HDR_LEN + len;
+    memset(par, 0, parlen);
+    for (uint16_t i = 0; i < len; i++) {
+        par[i / 8] |= oddparity8(frame[i]) << (7 - (i % 8));
+    }
+
+    dev->trace_len += need;
+}
+
+//-----------------------------------------------------------------------------
+// virtual MIFARE Classic card, backed by emulator memory
+//-----------------------------------------------------------------------------
+typedef struct {
+    struct Crypto1State reader;
+    struct Crypto1State card;
+    uint8_t keytype;
+} vdev_mf_session_t;
+
+static uint8_t vdev_mf_trailer(uint8_t blockno) {
+    return (blockno < 128) ? (blockno | 0x03) : (blockno | 0x0F);
+}
+
+static void vdev_eml_clear(vdevice_t *dev) {
+
+    const uint8_t trailer[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x07, 0x80, 0x69, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    const uint8_t uid[]   =   {0xe6, 0x84, 0x87, 0xf3, 0x16, 0x88, 0x04, 0x00, 0x46, 0x8e, 0x45, 0x55, 0x4d, 0x70, 0x41, 0x04};
+
+    memset(dev->eml, 0, sizeof(dev->eml));
+    for (uint16_t b = 0; b < 256; b++) {
+        if (b == vdev_mf_trailer(b)) {
+            memcpy(dev->eml + b * MFBLOCK_SIZE, trailer, sizeof(trailer));
+        }
+    }
+    memcpy(dev->eml, uid, sizeof(uid));
+}
+
+static uint32_t vdev_mf_cuid(const vdevice_t *dev) {
+    return bytes_to_num(dev->eml, 4);
+}
+
+static uint64_t vdev_mf_key(const vdevice_t *dev, uint8_t blockno, uint8_t keytype) {
+    const uint8_t *trailer = dev->eml + vdev_mf_trailer(blockno) * MFBLOCK_SIZE;
+    return bytes_to_num(trailer + ((keytype & 1) ? 10 : 0), MIFARE_KEY_SIZE);
+}
+
+// the card PRNG keeps running between authentications
+static uint32_t vdev_mf_nonce(vdevice_t *dev) {
+    dev->nt = prng_successor(dev->nt, 160 + (dev->timestamp & 0xFF));
+    return dev->nt;
+}
+
+static void vdev_mf_crypt(struct Crypto1State *s, uint8_t *d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        d[i] ^= crypto1_byte(s, 0x00, 0);
+    }
+}
+
+// WUPA and anticollision of the 4 byte UID in block 0 (uid, bcc, sak, atqa)
+static void vdev_14a_select(vdevice_t *dev) {
+
+    const uint8_t *b0 = dev->eml;
+    uint8_t frame[9];
+
+    frame[0] = ISO14443A_CMD_WUPA;
+    vdev_log(dev, frame, 1, false);
+    vdev_log(dev, b0 + 6, 2, true);
+
+    frame[0] = ISO14443A_CMD_ANTICOLL_OR_SELECT;
+    frame[1] = 0x20;
+    vdev_log(dev, frame, 2, false);
+    vdev_log(dev, b0, 5, true);
+
+    frame[1] = 0x70;
+    memcpy(frame + 2, b0, 5);
+    AddCrc14A(frame, 7);
+    vdev_log(dev, frame, 9, false);
+
+    frame[0] = b0[5];
+    AddCrc14A(frame, 1);
+    vdev_log(dev, frame, 3, true);
+}
+
+//-----------------------------------------------------------------------------
+// virtual DESFire application, plain communication without keys
+//-----------------------------------------------------------------------------
+// sizes of the standard data files of application 123456, byte n of a file holds n
+static const uint16_t vdev_df_files[VDEV_DF_FILES] = {32, 200};
+
+static void vdev_df_reset(vdevice_t *dev) {
+    dev->pcb_blocknum = 0;
+    dev->df_aid = 0;
+    dev->df_pending = 0xFF;
+}
+
+static uint16_t vdev_df_status(uint8_t *out, uint16_t n, uint8_t status) {
+    out[n++] = 0x91;
+    out[n++] = status;
+    return n;
+}
+
+// next frame of a ReadData
+static uint16_t vdev_df_readframe(vdevice_t *dev, uint8_t *out) {
+    uint16_t n = 0;
+    while (dev->df_pos < dev->df_end && n < VDEV_DF_FRAME) {
+        out[n++] = dev->df_pos++ & 0xFF;
+    }
+
+    if (dev->df_pos < dev->df_end) {
+        return vdev_df_status(out, n, MFDES_S_ADDITIONAL_FRAME);
+    }
+
+    dev->df_pending = 0xFF;
+    return vdev_df_status(out, n, MFDES_S_OPERATION_OK);
+}
+
+// Answers one native command wrapped in an ISO7816 APDU (90 cmd 00 00 [Lc data] 00),
+// returns the answer length with the status word
+static uint16_t vdev_df_answer(vdevice_t *dev, const uint8_t *apdu, uint16_t len, uint8_t *out) {
+
+    if (len < 5 || apdu[0] != MFDES_NATIVE_ISO7816_WRAP_CLA) {
+        out[0] = 0x6E;
+        out[1] = 0x00;
+        return 2;
+    }
+
+    uint8_t cmd = apdu[1];
+    const uint8_t *data = apdu + 5;
+    uint16_t datalen = (len > 5) ? apdu[4] : 0;
+    if (5 + datalen > len) {
+        return vdev_df_status(out, 0, MFDES_E_LENGTH);
+    }
+
+    if (cmd == MFDES_ADDITIONAL_FRAME && dev->df_pending != 0xFF) {
+        return vdev_df_readframe(dev, out);
+    }
+    dev->df_pending = 0xFF;
+
+    uint16_t n = 0;
+    switch (cmd) {
+        case MFDES_SELECT_APPLICATION: {
+            if (datalen != 3) {
+                return vdev_df_status(out, 0, MFDES_E_LENGTH);
+            }
+            uint32_t aid = MemLeToUint3byte(data);
+            if (aid != 0x000000 && aid != 0x123456) {
+                return vdev_df_status(out, 0, MFDES_E_APPLICATION_NOT_FOUND);
+            }
+            dev->df_aid = aid;
+            return vdev_df_status(out, 0, MFDES_S_OPERATION_OK);
+        }
+        case MFDES_GET_APPLICATION_IDS: {
+            Uint3byteToMemLe(out, 0x123456);
+            return vdev_df_status(out, 3, MFDES_S_OPERATION_OK);
+        }
+        case MFDES_GET_FILE_IDS:
+        case MFDES_GET_ISOFILE_IDS: {
+            if (dev->df_aid == 0) {
+                return vdev_df_status(out, 0, MFDES_E_PERMISSION_DENIED);
+            }
+            // the files have no ISO file IDs
+            if (cmd == MFDES_GET_FILE_IDS) {
+                for (uint8_t i = 0; i < VDEV_DF_FILES; i++) {
+                    out[n++] = i;
+                }
+            }
+            return vdev_df_status(out, n, MFDES_S_OPERATION_OK);
+        }
+        case MFDES_GET_FILE_SETTINGS: {
+            if (dev->df_aid == 0 || datalen != 1 || data[0] >= VDEV_DF_FILES) {
+                return vdev_df_status(out, 0, MFDES_E_FILE_NOT_FOUND);
+            }
+            // standard data file, plain, free access
+            out[n++] = 0x00;
+            out[n++] = 0x00;
+            out[n++] = 0xEE;
+            out[n++] = 0xEE;
+            Uint3byteToMemLe(out + n, vdev_df_files[data[0]]);
+            return vdev_df_status(out, n + 3, MFDES_S_OPERATION_OK);
+        }
+        case MFDES_READ_DATA: {
+            if (dev->df_aid == 0 || datalen != 7 || data[0] >= VDEV_DF_FILES) {
+                return vdev_df_status(out, 0, MFDES_E_FILE_NOT_FOUND);
+            }
+            uint32_t size = vdev_df_files[data[0]];
+            uint32_t offset = MemLeToUint3byte(data + 1);
+            uint32_t rlen = MemLeToUint3byte(data + 4);
+            if (rlen == 0 && offset < size) {
+                rlen = size - offset;
+            }
+            if (offset + rlen > size) {
+                return vdev_df_status(out, 0, MFDES_E_BOUNDARY);
+            }
+            dev->df_pending = data[0];
+            dev->df_pos = offset;
+            dev->df_end = offset + rlen;
+            return vdev_df_readframe(dev, out);
+        }
+        default:
+            return vdev_df_status(out, 0, MFDES_E_ILLEGAL_COMMAND_CODE);
+    }
+}
+
+// RATS, answered with a DESFire EV1 ATS
+static void vdev_14a_raw(vdevice_t *dev, const uint8_t *data, uint16_t len) {
+
+    if (len < 2 || data[0] != ISO14443A_CMD_RATS) {
+        vdev_reply_mix(dev, CMD_ACK, 0, 0, 0, NULL, 0);
+        return;
+    }
+
+    uint8_t frame[4];
+    memcpy(frame, data, 2);
+    AddCrc14A(frame, 2);
+    vdev_log(dev, frame, 4, false);
+
+    uint8_t ats[] = {0x06, 0x75, 0x77, 0x81, 0x02, 0x80, 0x00, 0x00};
+    AddCrc14A(ats, 6);
+    vdev_log(dev, ats, sizeof(ats), true);
+
+    vdev_df_reset(dev);
+    vdev_reply_mix(dev, CMD_ACK, sizeof(ats), 0, 0, ats, sizeof(ats));
+}
+
+// one APDU in an I-block, the answer fits in one frame and comes back without PCB
+static void vdev_14a_apdu(vdevice_t *dev, const uint8_t *apdu, uint16_t len) {
+
+    uint8_t frame[1 + PM3_CMD_DATA_SIZE + 2];
+    if (len > PM3_CMD_DATA_SIZE) {
+        vdev_reply_mix(dev, CMD_ACK, 0, 0, 0, NULL, 0);
+        return;
+    }
+
+    frame[0] = 0x02 | dev->pcb_blocknum;
+    memcpy(frame + 1, apdu, len);
+    AddCrc14A(frame, len + 1);
+    vdev_log(dev, frame, len + 3, false);
+
+    frame[0] = 0x02 | dev->pcb_blocknum;
+    uint16_t n = vdev_df_answer(dev, apdu, len, frame + 1);
+    AddCrc14A(frame, n + 1);
+    vdev_log(dev, frame, n + 3, true);
+    dev->pcb_blocknum ^= 1;
+
+    vdev_reply_mix(dev, CMD_ACK, n + 2, frame[0], 0, frame + 1, n + 2);
+}
+
+// hf 14a reader. Select of the virtual card, RATS and APDUs to its DESFire application
+static void vdev_14a_reader(vdevice_t *dev, uint64_t flags, uint64_t arg1, const uint8_t *data, uint16_t datalen) {
+
+    if ((flags & ISO14A_CONNECT) == 0) {
+        uint16_t len = MIN(arg1 & 0xFFFF, datalen);
+        if (flags & ISO14A_APDU) {
+            vdev_14a_apdu(dev, data, len);
+        } else if (flags & ISO14A_RAW) {
+            vdev_14a_raw(dev, data, len);
+        }
+        return;
+    }
+
+    if (flags & ISO14A_CLEARTRACE) {
+        dev->trace_len = 0;
+    }
+
+    vdev_df_reset(dev);
+
+    iso14a_card_select_t card;
+    memset(&card, 0, sizeof(card));
+    memcpy(card.uid, dev->eml, 4);
+    card.uidlen = 4;
+    card.sak = dev->eml[5];
+    card.atqa[0] = dev->eml[6];
+    card.atqa[1] = dev->eml[7];
+
+    vdev_14a_select(dev);
+
+    // 2: OK, no ATS
+    vdev_reply_mix(dev, CMD_ACK, 2, card.uidlen, 0, &card, sizeof(card));
+}
+
+// Three pass authentication, reader side with the given key against the card side
+// with the key in emulator memory. Both sides run crypto1 and the frames go to the trace.
+// A nested authentication runs inside the session s and skips the select.
+static bool vdev_mf_auth_ex(vdevice_t *dev, vdev_mf_session_t *s, uint8_t blockno, uint8_t keytype, uint64_t key, bool nested, uint32_t *nt_out) {
+
+    uint32_t cuid = vdev_mf_cuid(dev);
+    uint8_t frame[8];
+
+    if (nested == false) {
+        vdev_14a_select(dev);
+    }
+
+    frame[0] = MIFARE_AUTH_KEYA + (keytype & 1);
+    frame[1] = blockno;
+    AddCrc14A(frame, 2);
+    if (nested) {
+        vdev_mf_crypt(&s->reader, frame, 4);
+    }
+    vdev_log(dev, frame, 4, false);
+    s->keytype = keytype & 1;
+
+    uint32_t nt = vdev_mf_nonce(dev);
+    if (nt_out) {
+        *nt_out = nt;
+    }
+    num_to_bytes(nt, 4, frame);
+    vdev_log(dev, frame, 4, true);
+
+    crypto1_init(&s->reader, key);
+    crypto1_init(&s->card, vdev_mf_key(dev, blockno, keytype));
+    crypto1_word(&s->reader, cuid ^ nt, 0);
+    crypto1_word(&s->card, cuid ^ nt, 0);
+
+    // reader: {nr}{ar}
+    uint32_t nr = prng_successor(nt ^ cuid, 17);
+    uint32_t nr_enc = crypto1_word(&s->reader, nr, 0) ^ nr;
+    uint32_t ar_enc = crypto1_word(&s->reader, 0, 0) ^ prng_successor(nt, 64);
+    num_to_bytes(nr_enc, 4, frame);
+    num_to_bytes(ar_enc, 4, frame + 4);
+    vdev_log(dev, frame, 8, false);
+
+    // card: decrypt and verify ar, stays silent on a wrong key
+    crypto1_word(&s->card, nr_enc, 1);
+    uint32_t ar = crypto1_word(&s->card, 0, 0) ^ ar_enc;
+    if (ar != prng_successor(nt, 64)) {
+        return false;
+    }
+
+    uint32_t at_enc = crypto1_word(&s->card, 0, 0) ^ prng_successor(nt, 96);
+    num_to_bytes(at_enc, 4, frame);
+    vdev_log(dev, frame, 4, true);
+
+    // reader: verify at
+    return (crypto1_word(&s->reader, 0, 0) ^ at_enc) == prng_successor(nt, 96);
+}
+
+static bool vdev_mf_auth(vdevice_t *dev, vdev_mf_session_t *s, uint8_t blockno, uint8_t keytype, uint64_t key, uint32_t *nt_out) {
+    return vdev_mf_auth_ex(dev, s, blockno, keytype, key, false, nt_out);
+}
+
+// read access of the access conditions in the sector trailer
+static bool vdev_mf_readable(const vdevice_t *dev, uint8_t blockno, uint8_t keytype) {
+
+    const uint8_t *ac = dev->eml + vdev_mf_trailer(blockno) * MFBLOCK_SIZE + 6;
+    uint8_t area = (blockno < 128) ? (blockno & 0x03) : (blockno & 0x0F) / 5;
+    uint8_t c = (((ac[1] >> (4 + area)) & 1) << 2) | (((ac[2] >> area) & 1) << 1) | ((ac[2] >> (4 + area)) & 1);
+
+    if (blockno == vdev_mf_trailer(blockno)) {
+        // key A reads the access bits, key B only when it isn't readable itself
+        return (keytype == MF_KEY_A) || (c != 0 && c != 1 && c != 2);
+    }
+
+    // C1C2C3 111 never, 011 and 101 key B only
+    if (c == 7) {
+        return false;
+    }
+    return (keytype == MF_KEY_B) || (c != 3 && c != 5);
+}
+
+// false when the access conditions deny the read, the card answers a NAK and goes idle
+static bool vdev_mf_read(vdevice_t *dev, vdev_mf_session_t *s, uint8_t blockno, uint8_t *out) {
+
+    uint8_t cmd[4] = {ISO14443A_CMD_READBLOCK, blockno};
+    AddCrc14A(cmd, 2);
+    vdev_mf_crypt(&s->reader, cmd, sizeof(cmd));
+    vdev_log(dev, cmd, sizeof(cmd), false);
+    vdev_mf_crypt(&s->card, cmd, sizeof(cmd));
+
+    if (vdev_mf_readable(dev, blockno, s->keytype) == false) {
+        uint8_t nak = 0x04 ^ (crypto1_byte(&s->card, 0x00, 0) & 0x0F);
+        vdev_log(dev, &nak, 1, true);
+        return false;
+    }
+
+    uint8_t resp[MFBLOCK_SIZE + 2];
+    memcpy(resp, dev->eml + blockno * MFBLOCK_SIZE, MFBLOCK_SIZE);
+
+    // key A is never readable
+    if (blockno == vdev_mf_trailer(blockno)) {
+        memset(resp, 0, MIFARE_KEY_SIZE);
+    }
+
+    AddCrc14A(resp, MFBLOCK_SIZE);
+    vdev_mf_crypt(&s->card, resp, sizeof(resp));
+    vdev_log(dev, resp, sizeof(resp), true);
+    vdev_mf_crypt(&s->reader, resp, sizeof(resp));
+
+    memcpy(out, resp, MFBLOCK_SIZE);
+    return true;
+}
+
+static void vdev_mf_readbl(vdevice_t *dev, const mf_readblock_t *payload) {
+    vdev_mf_session_t s;
+    uint8_t out[MFBLOCK_SIZE] = {0};
+    int retval = PM3_ESOFT;
+    dev->trace_len = 0;
+    if (vdev_mf_auth(dev, &s, payload->blockno, payload->keytype, bytes_to_num(payload->key, MIFARE_KEY_SIZE), NULL)) {
+        if (vdev_mf_read(dev, &s, payload->blockno, out)) {
+            retval = PM3_SUCCESS;
+        }
+    }
+    vdev_reply_ng(dev, CMD_HF_MIFARE_READBL, retval, out, sizeof(out));
+}
+
+static void vdev_mf_readsc(vdevice_t *dev, uint8_t sector, uint8_t keytype, const uint8_t *key) {
+
+    uint8_t first = (sector < 32) ? sector * 4 : 128 + (sector - 32) * 16;
+    uint8_t count = (sector < 32) ? 4 : 16;
+    uint8_t out[16 * MFBLOCK_SIZE] = {0};
+    dev->trace_len = 0;
+
+    vdev_mf_session_t s;
+    bool ok = vdev_mf_auth(dev, &s, first, keytype, bytes_to_num(key, MIFARE_KEY_SIZE), NULL);
+    for (uint8_t i = 0; ok && i < count; i++) {
+        ok = vdev_mf_read(dev, &s, first + i, out + i * MFBLOCK_SIZE);
+    }
+    vdev_reply_old(dev, CMD_ACK, ok, 0, 0, out, count * MFBLOCK_SIZE);
+}
+
+static void vdev_mf_chkkeys(vdevice_t *dev, const uint8_t *datain) {
+
+    uint8_t keytype = datain[0];
+    uint8_t blockno = datain[1];
+    bool clear_trace = datain[2];
+    uint8_t keycnt = datain[4];
+
+    struct {
+        uint8_t key[MIFARE_KEY_SIZE];
+        bool found;
+    } PACKED keyresult = {{0}, false};
+
+    if (clear_trace) {
+        dev->trace_len = 0;
+    }
+
+    for (uint8_t i = 0; i < keycnt; i++) {
+        const uint8_t *key = datain + 5 + i * MIFARE_KEY_SIZE;
+        vdev_mf_session_t s;
+        if (vdev_mf_auth(dev, &s, blockno, keytype, bytes_to_num(key, MIFARE_KEY_SIZE), NULL)) {
+            memcpy(keyresult.key, key, MIFARE_KEY_SIZE);
+            keyresult.found = true;
+            break;
+        }
+    }
+    vdev_reply_ng(dev, CMD_HF_MIFARE_CHKKEYS, PM3_SUCCESS, (uint8_t *)&keyresult, sizeof(keyresult));
+}
+
+// Key chunks as sent by mf_check_keys_fast_ex(), replies like MifareChkKeys_fast().
+// Strategies and the flash dictionary are not simulated, every chunk is tried
+// once against every sector still missing a key.
+static void vdev_mf_chkkeys_fast(vdevice_t *dev, uint64_t arg0, uint64_t arg2, const uint8_t *datain) {
+
+    uint8_t sectorcnt = MIN(arg0 & 0xFF, VDEV_MF_MAXSECTOR);
+    bool firstchunk = (arg0 >> 8) & 0xF;
+    bool lastchunk = (arg0 >> 12) & 0xF;
+    uint16_t single = (arg0 >> 16) & 0xFFFF;
+    uint16_t keycnt = MIN(arg2 & 0xFF, PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE);
+
+    if (firstchunk) {
+        dev->trace_len = 0;
+        memset(dev->chk_sector, 0, sizeof(dev->chk_sector));
+        memset(dev->chk_found, 0, sizeof(dev->chk_found));
+        dev->chk_foundkeys = 0;
+    }
+
+    vdev_mf_session_t s;
+
+    if ((single >> 15) & 1) {
+        uint8_t blockno = single & 0xFF;
+        uint8_t keytype = (single >> 8) & 1;
+        for (uint16_t i = 0; i < keycnt; i++) {
+            const uint8_t *key = datain + i * MIFARE_KEY_SIZE;
+            if (vdev_mf_auth(dev, &s, blockno, keytype, bytes_to_num(key, MIFARE_KEY_SIZE), NULL)) {
+                vdev_reply_old(dev, CMD_ACK, 1, 0, 0, key, MIFARE_KEY_SIZE);
+                return;
+            }
+        }
+        vdev_reply_mix(dev, CMD_ACK, 0, 0, 0, NULL, 0);
+        return;
+    }
+
+    uint8_t allkeys = sectorcnt * 2;
+    for (uint8_t sec = 0; sec < sectorcnt && dev->chk_foundkeys < allkeys; sec++) {
+        uint8_t blockno = (sec < 32) ? sec * 4 : 128 + (sec - 32) * 16;
+        for (uint8_t keytype = 0; keytype < 2; keytype++) {
+            if (dev->chk_found[sec * 2 + keytype]) {
+                continue;
+            }
+            for (uint16_t i = 0; i < keycnt; i++) {
+                const uint8_t *key = datain + i * MIFARE_KEY_SIZE;
+                if (vdev_mf_auth(dev, &s, blockno, keytype, bytes_to_num(key, MIFARE_KEY_SIZE), NULL)) {
+                    memcpy(dev->chk_sector[sec][keytype], key, MIFARE_KEY_SIZE);
+                    dev->chk_found[sec * 2 + keytype] = 1;
+                    dev->chk_foundkeys++;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (dev->chk_foundkeys == allkeys || lastchunk) {
+        uint8_t out[480 + 10] = {0};
+        memcpy(out, dev->chk_sector, sectorcnt * 2 * MIFARE_KEY_SIZE);
+
+        uint64_t foo = 0;
+        for (uint8_t m = 0; m < 64; m++) {
+            foo |= ((uint64_t)(dev->chk_found[m] & 1) << m);
+        }
+        uint16_t bar = 0;
+        for (uint8_t m = 64; m < ARRAYLEN(dev->chk_found); m++) {
+            bar |= ((uint16_t)(dev->chk_found[m] & 1) << (m - 64));
+        }
+        num_to_bytes(foo, 8, out + 480);
+        out[488] = bar & 0xFF;
+        out[489] = (bar >> 8) & 0xFF;
+
+        vdev_reply_old(dev, CMD_ACK, dev->chk_foundkeys, 0, 0, out, sizeof(out));
+    } else {
+        vdev_reply_mix(dev, CMD_ACK, dev->chk_foundkeys, 0, 0, NULL, 0);
+    }
+}
+
+// Authenticates with the known key, then returns two plain target nonces with the
+// keystream that encrypted them, exactly what MifareNested() hands to the client.
+// same flow as MifareDump() in the firmware: one select, nested authentication between
+// sectors and key B for the blocks key A can't read
+static void vdev_mf_dump(vdevice_t *dev, const mf_dump_t *payload) {
+
+    uint8_t sectorcnt = MIN(payload->sectorcnt, VDEV_MF_MAXSECTOR);
+    bool authed = false;
+    int retval = PM3_SUCCESS;
+    vdev_mf_session_t s;
+    mf_dump_sector_t sector;
+
+    dev->trace_len = 0;
+
+    for (uint8_t sc = 0; sc < sectorcnt; sc++) {
+
+        uint8_t first = (sc < 32) ? sc * 4 : 128 + (sc - 32) * 16;
+        const uint8_t *keys[2] = { payload->keya[sc], payload->keyb[sc] };
+        bool key_failed[2] = { false, false };
+        int8_t current = -1;
+
+        memset(&sector, 0, sizeof(sector));
+        sector.sector = sc;
+        sector.blockcnt = (sc < 32) ? 4 : 16;
+
+        for (uint8_t b = 0; b < sector.blockcnt; b++) {
+
+            uint8_t order[2] = { MF_KEY_A, MF_KEY_B };
+            if (current == MF_KEY_B) {
+                order[0] = MF_KEY_B;
+                order[1] = MF_KEY_A;
+            }
+
+            for (uint8_t i = 0; i < 2; i++) {
+                uint8_t kt = order[i];
+                if (key_failed[kt]) {
+                    continue;
+                }
+
+                if (current != kt) {
+                    if (vdev_mf_auth_ex(dev, &s, first, kt, bytes_to_num(keys[kt], MIFARE_KEY_SIZE), authed, NULL) == false) {
+                        key_failed[kt] = true;
+                        authed = false;
+                        current = -1;
+                        continue;
+                    }
+                    authed = true;
+                    current = kt;
+                }
+
+                if (vdev_mf_read(dev, &s, first + b, sector.data + b * MFBLOCK_SIZE)) {
+                    sector.readmask |= (1 << b);
+                    break;
+                }
+
+                authed = false;
+                current = -1;
+            }
+        }
+
+        uint16_t all = (1 << sector.blockcnt) - 1;
+        int status = (sector.readmask == all) ? PM3_SUCCESS : (sector.readmask) ? PM3_EPARTIAL : PM3_EFAILED;
+        if (status != PM3_SUCCESS) {
+            retval = PM3_EPARTIAL;
+        }
+
+        if (vdev_reply_ng(dev, CMD_HF_MIFARE_DUMP, status, (uint8_t *)&sector, 4 + sector.blockcnt * MFBLOCK_SIZE) != PM3_SUCCESS) {
+            return;
+        }
+    }
+
+    vdev_reply_ng(dev, CMD_HF_MIFARE_DUMP, retval, NULL, 0);
+}
+
+static void vdev_mf_nested(vdevice_t *dev, const uint8_t *datain) {
+
+    struct p {
+        uint8_t block;
+        uint8_t keytype;
+        uint8_t target_block;
+        uint8_t target_keytype;
+        bool calibrate;
+        uint8_t key[6];
+    } PACKED;
+    const struct p *payload = (const struct p *)datain;
+
+    struct {
+        int16_t isOK;
+        uint8_t block;
+        uint8_t keytype;
+        uint8_t cuid[4];
+        uint8_t nt_a[4];
+        uint8_t ks_a[4];
+        uint8_t nt_b[4];
+        uint8_t ks_b[4];
+    } PACKED out;
+    memset(&out, 0, sizeof(out));
+
+    uint32_t cuid = vdev_mf_cuid(dev);
+    out.block = payload->target_block;
+    dev->trace_len = 0;
+    out.keytype = payload->target_keytype;
+    memcpy(out.cuid, &cuid, 4);
+
+    vdev_mf_session_t s;
+    if (vdev_mf_auth(dev, &s, payload->block, payload->keytype, bytes_to_num(payload->key, MIFARE_KEY_SIZE), NULL) == false) {
+        out.isOK = PM3_ESOFT;
+        vdev_reply_ng(dev, CMD_HF_MIFARE_NESTED, PM3_SUCCESS, (uint8_t *)&out, sizeof(out));
+        return;
+    }
+
+    uint64_t target_key = vdev_mf_key(dev, payload->target_block, payload->target_keytype);
+    uint32_t nt[2], ks[2];
+    for (int i = 0; i < 2; i++) {
+        do {
+            nt[i] = vdev_mf_nonce(dev);
+        } while (i == 1 && nt[1] == nt[0]);
+
+        struct Crypto1State card;
+        crypto1_init(&card, target_key);
+        ks[i] = crypto1_word(&card, cuid ^ nt[i], 0);
+        crypto1_deinit(&card);
+    }
+
+    out.isOK = PM3_SUCCESS;
+    memcpy(out.nt_a, &nt[0], 4);
+    memcpy(out.ks_a, &ks[0], 4);
+    memcpy(out.nt_b, &nt[1], 4);
+    memcpy(out.ks_b, &ks[1], 4);
+    vdev_reply_ng(dev, CMD_HF_MIFARE_NESTED, PM3_SUCCESS, (uint8_t *)&out, sizeof(out));
+}
+
+//-----------------------------------------------------------------------------
+// virtual ISO15693 tag
+//-----------------------------------------------------------------------------
+// 80 blocks of 4 bytes, like a ICODE SLIX2, block n holds 4n .. 4n+3
+static void vdev_15_default(vdevice_t *dev) {
+
+    const uint8_t uid[] = {0x78, 0x56, 0x34, 0x12, 0x08, 0x01, 0x04, 0xE0};
+
+    iso15_tag_t *tag = &dev->tag15;
+    memset(tag, 0, sizeof(iso15_tag_t));
+    memcpy(tag->uid, uid, sizeof(uid));
+    tag->bytesPerPage = 4;
+    tag->pagesCount = 80;
+    tag->ic = 0x01;
+    for (uint16_t i = 0; i < tag->pagesCount * tag->bytesPerPage; i++) {
+        tag->data[i] = i & 0xFF;
+    }
+}
+
+// Answers one ISO15693 frame from the virtual tag, returns the answer length or 0 for no answer
+static uint16_t vdev_15_answer(vdevice_t *dev, const uint8_t *cmd, uint16_t len, uint8_t *out) {
+
+    const iso15_tag_t *tag = &dev->tag15;
+
+    if (len < 4 || check_crc(CRC_15693, cmd, len) == false || tag->pagesCount == 0) {
+        return 0;
+    }
+
+    uint8_t flags = cmd[0];
+    uint16_t pos = 2;
+    uint16_t n = 0;
+
+    if (cmd[1] == ISO15693_INVENTORY) {
+        if ((flags & ISO15_REQ_INVENTORY) == 0) {
+            return 0;
+        }
+        out[n++] = ISO15_NOERROR;
+        out[n++] = tag->dsfid;
+        memcpy(out + n, tag->uid, sizeof(tag->uid));
+        n += sizeof(tag->uid);
+        AddCrc15(out, n);
+        return n + 2;
+    }
+
+    if (flags & ISO15_REQ_ADDRESS) {
+        if (len < pos + ISO15693_UID_LENGTH + 2 || memcmp(cmd + pos, tag->uid, ISO15693_UID_LENGTH) != 0) {
+            return 0;
+        }
+        pos += ISO15693_UID_LENGTH;
+    }
+
+    uint8_t error = ISO15_NOERROR;
+    out[n++] = ISO15_NOERROR;
+
+    switch (cmd[1]) {
+        case ISO15693_GET_SYSTEM_INFO: {
+            out[n++] = 0x0F;
+            memcpy(out + n, tag->uid, sizeof(tag->uid));
+            n += sizeof(tag->uid);
+            out[n++] = tag->dsfid;
+            out[n++] = tag->afi;
+            out[n++] = tag->pagesCount - 1;
+            out[n++] = tag->bytesPerPage - 1;
+            out[n++] = tag->ic;
+            break;
+        }
+        case ISO15693_READBLOCK:
+        case ISO15693_READ_MULTI_BLOCK: {
+            bool multi = (cmd[1] == ISO15693_READ_MULTI_BLOCK);
+            if (len < pos + (multi ? 2 : 1) + 2) {
+                error = ISO15_ERROR_CMD_NOT_REC;
+                break;
+            }
+
+            uint16_t first = cmd[pos];
+            uint16_t count = (multi) ? cmd[pos + 1] + 1 : 1;
+            if (count > VDEV_15_MAXMULTI) {
+                error = ISO15_ERROR_CMD_OPTION;
+                break;
+            }
+            if (first + count > tag->pagesCount || first + count > ISO15693_TAG_MAX_PAGES ||
+                    (first + count) * tag->bytesPerPage > ISO15693_TAG_MAX_SIZE) {
+                error = ISO15_ERROR_BLOCK_UNAVAILABLE;
+                break;
+            }
+
+            for (uint16_t i = first; i < first + count; i++) {
+                if (flags & ISO15_REQ_OPTION) {
+                    out[n++] = tag->locks[i];
+                }
+                memcpy(out + n, tag->data + i * tag->bytesPerPage, tag->bytesPerPage);
+                n += tag->bytesPerPage;
+            }
+            break;
+        }
+        default: {
+            error = ISO15_ERROR_CMD_NOT_SUP;
+            break;
+        }
+    }
+
+    if (error != ISO15_NOERROR) {
+        out[0] = ISO15_RES_ERROR;
+        out[1] = error;
+        n = 2;
+    }
+
+    AddCrc15(out, n);
+    return n + 2;
+}
+
+// hf 15 raw frames, the 16 slot inventory isn't modelled
+static void vdev_15_command(vdevice_t *dev, const iso15_raw_cmd_t *packet, uint16_t packetlen) {
+
+    if (packetlen < sizeof(iso15_raw_cmd_t) || packet->rawlen == 0 || packet->rawlen > packetlen - sizeof(iso15_raw_cmd_t)) {
+        vdev_reply_ng(dev, CMD_HF_ISO15693_COMMAND, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    vdev_log(dev, packet->raw, packet->rawlen, false);
+
+    // status, lock bytes, data and crc of a read over the whole memory
+    uint8_t answer[1 + ISO15693_TAG_MAX_PAGES + ISO15693_TAG_MAX_SIZE + 2];
+    uint16_t n = vdev_15_answer(dev, packet->raw, packet->rawlen, answer);
+
+    if ((packet->flags & ISO15_READ_RESPONSE) == 0) {
+        vdev_reply_ng(dev, CMD_HF_ISO15693_COMMAND, PM3_SUCCESS, NULL, 0);
+        return;
+    }
+
+    if (n == 0) {
+        vdev_reply_ng(dev, CMD_HF_ISO15693_COMMAND, PM3_ETIMEOUT, NULL, 0);
+        return;
+    }
+
+    vdev_log(dev, answer, n, true);
+
+    // like the firmware, answers longer than a frame get cut
+    if (n > PM3_CMD_DATA_SIZE) {
+        vdev_reply_ng(dev, CMD_HF_ISO15693_COMMAND, PM3_EOVFLOW, answer, PM3_CMD_DATA_SIZE);
+        return;
+    }
+    vdev_reply_ng(dev, CMD_HF_ISO15693_COMMAND, PM3_SUCCESS, answer, n);
+}
+
+//-----------------------------------------------------------------------------
+// virtual FeliCa card
+//-----------------------------------------------------------------------------
+// one system, a root area holding two services and a sub area with two more
+typedef struct {
+    uint16_t code;          // node code as sent, LSB first
+    uint16_t end;           // end code of an area, 0 otherwise
+    uint16_t key_version;
+} vdev_fc_node_t;
+
+// Search Service Code order, the system node last
+static const vdev_fc_node_t vdev_fc_nodes[] = {
+    {0x0000, 0xFFFE, 0x0000},
+    {0x1008, 0x0000, 0x0101},
+    {0x100B, 0x0000, 0x0101},
+    {0x1800, 0x1BFF, 0x0203},
+    {0x1808, 0x0000, 0x0203},
+    {0x184B, 0x0000, 0x0203},
+    {0xFFFF, 0x0000, 0x0001},
+};
+
+static const uint8_t vdev_fc_idm[] = {0x01, 0x2E, 0x4C, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t vdev_fc_pmm[] = {0x10, 0x0B, 0x4B, 0x42, 0x84, 0x85, 0xD0, 0xFF};
+
+// Answers one FeliCa frame (length byte, command, IDm, ...) from the virtual card,
+// returns the answer length with sync bytes and crc, or 0 for no answer.
+// Request Code List isn't supported, like on most transit cards.
+static uint16_t vdev_fc_answer(const uint8_t *cmd, uint16_t len, uint8_t *out) {
+
+    if (len < 1 + 1 + 8 || cmd[0] != len || memcmp(cmd + 2, vdev_fc_idm, sizeof(vdev_fc_idm)) != 0) {
+        return 0;
+    }
+
+    uint16_t n = 0;
+    out[n++] = 0xB2;
+    out[n++] = 0x4D;
+    out[n++] = 0;       // length, set below
+    out[n++] = cmd[1] + 1;
+    memcpy(out + n, vdev_fc_idm, sizeof(vdev_fc_idm));
+    n += sizeof(vdev_fc_idm);
+
+    switch (cmd[1]) {
+        case FELICA_SRCHSYSCODE_REQ: {
+            if (len < 12) {
+                return 0;
+            }
+            uint16_t index = cmd[10] | (cmd[11] << 8);
+            // past the end the card keeps answering with the system node
+            if (index >= ARRAYLEN(vdev_fc_nodes)) {
+                index = ARRAYLEN(vdev_fc_nodes) - 1;
+            }
+            const vdev_fc_node_t *node = &vdev_fc_nodes[index];
+            out[n++] = node->code & 0xFF;
+            out[n++] = node->code >> 8;
+            if (node->end) {
+                out[n++] = node->end & 0xFF;
+                out[n++] = node->end >> 8;
+            }
+            break;
+        }
+        case FELICA_REQSRV_REQ: {
+            uint8_t count = (len > 10) ? cmd[10] : 0;
+            if (count == 0 || count > 32 || len < 11 + (count * 2)) {
+                return 0;
+            }
+            out[n++] = count;
+            for (uint8_t i = 0; i < count; i++) {
+                uint16_t code = cmd[11 + (i * 2)] | (cmd[12 + (i * 2)] << 8);
+                uint16_t key_version = 0xFFFF;
+                for (size_t j = 0; j < ARRAYLEN(vdev_fc_nodes); j++) {
+                    if (vdev_fc_nodes[j].code == code) {
+                        key_version = vdev_fc_nodes[j].key_version;
+                        break;
+                    }
+                }
+                out[n++] = key_version & 0xFF;
+                out[n++] = key_version >> 8;
+            }
+            break;
+        }
+        default: {
+            return 0;
+        }
+    }
+
+    out[2] = n - 2;
+    AddCrcFelica(out + 2, n - 2);
+    return n + 2;
+}
+
+// hf felica raw frames, the reader side as felica_sendraw() does it
+static void vdev_fc_command(vdevice_t *dev, const felica_raw_cmd_t *packet, uint16_t packetlen) {
+
+    if (packetlen < sizeof(felica_raw_cmd_t) || packet->rawlen > packetlen - sizeof(felica_raw_cmd_t)) {
+        vdev_reply_ng(dev, CMD_HF_FELICA_COMMAND, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    if (packet->flags & FELICA_CLEARTRACE) {
+        dev->trace_len = 0;
+    }
+
+    if ((packet->flags & FELICA_CONNECT) && (packet->flags & FELICA_NO_SELECT) == 0) {
+        felica_card_select_t card;
+        memset(&card, 0, sizeof(card));
+        memcpy(card.IDm, vdev_fc_idm, sizeof(card.IDm));
+        memcpy(card.code, vdev_fc_idm, sizeof(card.code));
+        memcpy(card.uid, vdev_fc_idm + 2, sizeof(card.uid));
+        memcpy(card.PMm, vdev_fc_pmm, sizeof(card.PMm));
+        memcpy(card.iccode, vdev_fc_pmm, sizeof(card.iccode));
+        memcpy(card.mrt, vdev_fc_pmm + 2, sizeof(card.mrt));
+        vdev_reply_ng(dev, CMD_HF_FELICA_COMMAND, PM3_SUCCESS, (uint8_t *)&card, sizeof(card));
+    }
+
+    if ((packet->flags & FELICA_RAW) == 0) {
+        return;
+    }
+
+    // length byte in front, like on air
+    uint8_t frame[1 + FELICA_MAX_DATA_SIZE];
+    if (packet->rawlen > FELICA_MAX_DATA_SIZE) {
+        vdev_reply_ng(dev, CMD_HF_FELICA_COMMAND, PM3_ELENGTH, NULL, 0);
+        return;
+    }
+    frame[0] = packet->rawlen + 1;
+    memcpy(frame + 1, packet->raw, packet->rawlen);
+    vdev_log(dev, frame, packet->rawlen + 1, false);
+
+    uint8_t answer[FELICA_MAX_RF_FRAME_SIZE];
+    uint16_t n = vdev_fc_answer(frame, packet->rawlen + 1, answer);
+    if (n == 0) {
+        vdev_reply_ng(dev, CMD_HF_FELICA_COMMAND, PM3_ERFTRANS, NULL, 0);
+        return;
+    }
+
+    vdev_log(dev, answer + 2, n - 2, true);
+    vdev_reply_ng(dev, CMD_HF_FELICA_COMMAND, PM3_SUCCESS, answer, n);
+}
+
+//-----------------------------------------------------------------------------
+// command dispatch
+//-----------------------------------------------------------------------------
+static void vdev_capabilities(vdevice_t *dev) {
+    capabilities_t caps;
+    memset(&caps, 0, sizeof(caps));
+    caps.version = CAPABILITIES_VERSION;
+    caps.baudrate = 0;
+    caps.bigbuf_size = VDEV_BIGBUF_SIZE;
+    caps.via_usb = true;
+    caps.compiled_with_iso14443a = true;
+    caps.compiled_with_iso15693 = true;
+    caps.compiled_with_felica = true;
+    vdev_reply_ng(dev, CMD_CAPABILITIES, PM3_SUCCESS, (uint8_t *)&caps, sizeof(caps));
+}
+
+static void vdev_version(vdevice_t *dev) {
+
+    struct p {
+        uint32_t id;
+        uint32_t section_size;
+        uint32_t versionstr_len;
+        char versionstr[PM3_CMD_DATA_SIZE - 12];
+    } PACKED payload;
+    memset(&payload, 0, sizeof(payload));
+
+    // the virtual device is always built from the client sources
+    char os[160];
+    FormatVersionInformation(os, sizeof(os), "", &g_version_information);
+
+    snprintf(payload.versionstr, sizeof(payload.versionstr),
+             " [ " _YELLOW_("ARM") " ]\n"
+             "  Bootrom.... %s\n"
+             "  OS......... %s\n"
+             "  Device..... virtual (sim:)\n"
+             "\n [ " _YELLOW_("FPGA") " ] \n "
+             "fpga_pm3_hf.ncd image " FPGA_TYPE " virtual",
+             os, os
+            );
+
+    payload.id = VDEV_CHIP_ID;
+    payload.section_size = 0;
+    payload.versionstr_len = strlen(payload.versionstr) + 1;
+    vdev_reply_ng(dev, CMD_VERSION, PM3_SUCCESS, (uint8_t *)&payload, 12 + payload.versionstr_len);
+}
+
+static void vdev_download(vdevice_t *dev, const uint8_t *mem, size_t memsize, uint32_t start, uint32_t len, uint16_t cmd, uint32_t tracelen) {
+
+    if (start > memsize) {
+        start = memsize;
+    }
+    len = MIN(len, memsize - start);
+
+    for (size_t offset = 0; offset < len; offset += PM3_CMD_DATA_SIZE) {
+        size_t n = MIN((len - offset), PM3_CMD_DATA_SIZE);
+        if (vdev_reply_old(dev, cmd, offset, n, tracelen, mem + start + offset, n) != PM3_SUCCESS) {
+            return;
+        }
+    }
+    vdev_reply_mix(dev, CMD_ACK, 1, 0, tracelen, NULL, 0);
+}
+
+static void vdev_handle(vdevice_t *dev, PacketCommandNG *packet) {
+
+    switch (packet->cmd) {
+        // the firmware doesn't answer these
+        case CMD_BREAK_LOOP:
+        case CMD_QUIT_SESSION:
+        case CMD_HF_DROPFIELD:
+        case CMD_FPGA_MAJOR_MODE_OFF:
+            break;
+        case CMD_PING: {
+            vdev_reply_ng(dev, CMD_PING, PM3_SUCCESS, packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_BENCH: {
+            vdev_reply_ng(dev, CMD_BENCH, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_CAPABILITIES: {
+            vdev_capabilities(dev);
+            break;
+        }
+        case CMD_VERSION: {
+            vdev_version(dev);
+            break;
+        }
+        case CMD_BUFF_CLEAR: {
+            memset(dev->bigbuf, 0, sizeof(dev->bigbuf));
+            dev->trace_len = 0;
+            break;
+        }
+        case CMD_DOWNLOAD_BIGBUF: {
+            vdev_download(dev, dev->bigbuf, sizeof(dev->bigbuf), packet->oldarg[0], packet->oldarg[1], CMD_DOWNLOADED_BIGBUF, dev->trace_len);
+            break;
+        }
+        case CMD_DOWNLOAD_EML_BIGBUF: {
+            vdev_download(dev, dev->eml, sizeof(dev->eml), packet->oldarg[0], packet->oldarg[1], CMD_DOWNLOADED_EML_BIGBUF, 0);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMCLR: {
+            vdev_eml_clear(dev);
+            vdev_reply_ng(dev, CMD_HF_MIFARE_EML_MEMCLR, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMSET: {
+            struct p {
+                uint16_t blockno;
+                uint8_t blockcnt;
+                uint8_t blockwidth;
+                uint8_t data[];
+            } PACKED;
+            struct p *payload = (struct p *) packet->data.asBytes;
+            uint8_t width = (payload->blockwidth) ? payload->blockwidth : MFBLOCK_SIZE;
+            size_t offset = payload->blockno * width;
+            size_t size = payload->blockcnt * width;
+            if (offset + size <= sizeof(dev->eml) && size <= packet->length - sizeof(struct p)) {
+                memcpy(dev->eml + offset, payload->data, size);
+            }
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMGET: {
+            struct p {
+                uint16_t blockno;
+                uint8_t blockcnt;
+                uint8_t blockwidth;
+            } PACKED;
+            struct p *payload = (struct p *) packet->data.asBytes;
+            size_t offset = payload->blockno * payload->blockwidth;
+            size_t size = payload->blockcnt * payload->blockwidth;
+            if (size > PM3_CMD_DATA_SIZE || offset + size > sizeof(dev->eml)) {
+                vdev_reply_ng(dev, CMD_HF_MIFARE_EML_MEMGET, PM3_EMALLOC, NULL, 0);
+                break;
+            }
+            vdev_reply_ng(dev, CMD_HF_MIFARE_EML_MEMGET, PM3_SUCCESS, dev->eml + offset, size);
+            break;
+        }
+        case CMD_HF_ISO14443A_READER: {
+            vdev_14a_reader(dev, packet->oldarg[0], packet->oldarg[1], packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_HF_FELICA_COMMAND: {
+            vdev_fc_command(dev, (felica_raw_cmd_t *)packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_HF_ISO15693_COMMAND: {
+            vdev_15_command(dev, (iso15_raw_cmd_t *)packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_HF_MIFARE_STATIC_NONCE: {
+            uint8_t data[1] = { NONCE_NORMAL };
+            vdev_reply_ng(dev, CMD_HF_MIFARE_STATIC_NONCE, PM3_SUCCESS, data, sizeof(data));
+            break;
+        }
+        case CMD_HF_MIFARE_READBL: {
+            vdev_mf_readbl(dev, (mf_readblock_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_READSC: {
+            vdev_mf_readsc(dev, packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_DUMP: {
+            vdev_mf_dump(dev, (mf_dump_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS: {
+            vdev_mf_chkkeys(dev, packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS_FAST: {
+            vdev_mf_chkkeys_fast(dev, packet->oldarg[0], packet->oldarg[2], packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_NESTED: {
+            vdev_mf_nested(dev, packet->data.asBytes);
+            break;
+        }
+        default: {
+            vdev_reply_ng(dev, packet->cmd, PM3_ENOTIMPL, NULL, 0);
+            break;
+        }
+    }
+}
+
+static void *vdevice_thread(void *arg) {
+    vdevice_t *dev = (vdevice_t *)arg;
+    PacketCommandNG packet;
+
+    for (;;) {
+        int res = vdev_receive(dev, &packet);
+        if (res == PM3_EIO) {
+            // client closed its end
+            break;
+        }
+        if (res != PM3_SUCCESS) {
+            continue;
+        }
+        vdev_handle(dev, &packet);
+    }
+    return NULL;
+}
+
+int vdevice_start(vdevice_t **dev) {
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        return -1;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(sv[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    vdevice_t *d = calloc(1, sizeof(vdevice_t));
+    if (d == NULL) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    d->fd = sv[1];
+    d->nt = prng_successor(0x01200145, 32);
+    vdev_eml_clear(d);
+    vdev_15_default(d);
+    vdev_df_reset(d);
+
+    if (pthread_create(&d->thread, NULL, vdevice_thread, d) != 0) {
+        close(sv[0]);
+        close(sv[1]);
+        free(d);
+        return -1;
+    }
+
+    *dev = d;
+    return sv[0];
+}
+
+void vdevice_stop(vdevice_t *dev) {
+    if (dev == NULL) {
+        return;
+    }
+    pthread_join(dev->thread, NULL);
+    close(dev->fd);
+    free(dev);
+}
+
+#endif
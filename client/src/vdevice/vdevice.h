@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Host side virtual Proxmark3 device
+//-----------------------------------------------------------------------------
+// Used by the "sim:" port. A thread on the other end of a socketpair speaks
+// the NG protocol and answers a subset of the firmware commands:
+//  - CMD_PING, CMD_BENCH, CMD_CAPABILITIES, CMD_VERSION
+//  - BigBuf / emulator memory download, emulator memory get/set/clear
+//  - hf 14a reader select
+//  - MIFARE Classic read block/sector, whole card dump, check keys (also fchk) and nested,
+//    answered by a virtual card built from emulator memory with real crypto1 exchanges
+//    which follows the access conditions of the sector trailers
+//  - ISO14443-4 RATS and APDUs, answered by a DESFire application 123456 with two
+//    plain standard data files
+//  - ISO15693 inventory, system info and read (multiple) block(s),
+//    answered by a virtual 80 block tag
+// Unknown commands are answered with PM3_ENOTIMPL instead of timing out.
+//-----------------------------------------------------------------------------
+
+#ifndef VDEVICE_H__
+#define VDEVICE_H__
+
+#include "common.h"
+
+typedef struct vdevice_s vdevice_t;
+
+// Starts a virtual device.
+// Returns the file descriptor the client should use as its port, or -1.
+int vdevice_start(vdevice_t **dev);
+
+// Waits for the device thread to exit and releases it.
+// The client side descriptor must be closed before calling this.
+void vdevice_stop(vdevice_t *dev);
+
+#endif
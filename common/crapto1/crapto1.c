@@ -155,43 +155,70 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
 
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
-/** lfsr_recovery
- * recover the state of the lfsr given 32 bits of the keystream
- * additionally you can use the in parameter to specify the value
- * that was fed into the lfsr at the time the keystream was generated
+/** crypto1_arena_init
+ * allocate the work tables used by lfsr_recovery32 once, so callers running
+ * many recoveries in a row (nested over all sectors) can reuse them.
  */
-struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
-    struct Crypto1State *statelist;
-    uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
-    uint32_t *even_head = 0, *even_tail = 0, eks = 0;
+bool crypto1_arena_init(struct Crypto1Arena *arena) {
+    if (arena == NULL)
+        return false;
+
+    arena->odd = malloc(sizeof(uint32_t) << 21);
+    arena->even = malloc(sizeof(uint32_t) << 21);
+    arena->bucket = malloc((sizeof(uint32_t) << 14) * 2 * 0x100);
+    arena->statelist = malloc(sizeof(struct Crypto1State) << 18);
+
+    if (!arena->odd || !arena->even || !arena->bucket || !arena->statelist) {
+        crypto1_arena_free(arena);
+        return false;
+    }
+    arena->statelist->odd = arena->statelist->even = 0;
+    return true;
+}
+
+void crypto1_arena_free(struct Crypto1Arena *arena) {
+    if (arena == NULL)
+        return;
+
+    free(arena->odd);
+    free(arena->even);
+    free(arena->bucket);
+    free(arena->statelist);
+    arena->odd = arena->even = arena->bucket = NULL;
+    arena->statelist = NULL;
+}
+
+/** lfsr_recovery32_arena
+ * same as lfsr_recovery32, but all memory comes from an initialized arena.
+ * The returned list lives in the arena and is overwritten by the next call,
+ * it must not be freed by the caller.
+ */
+struct Crypto1State *lfsr_recovery32_arena(uint32_t ks2, uint32_t in, struct Crypto1Arena *arena) {
+    uint32_t *odd_head, *odd_tail, oks = 0;
+    uint32_t *even_head, *even_tail, eks = 0;
     register int i;
 
+    if (arena == NULL || arena->statelist == NULL)
+        return 0;
+
     // split the keystream into an odd and even part
     for (i = 31; i >= 0; i -= 2)
         oks = oks << 1 | BEBIT(ks2, i);
     for (i = 30; i >= 0; i -= 2)
         eks = eks << 1 | BEBIT(ks2, i);
 
-    odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
-    even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
-    statelist =  calloc(1, sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
-        free(statelist);
-        statelist = 0;
-        goto out;
-    }
+    odd_head = odd_tail = arena->odd;
+    even_head = even_tail = arena->even;
+    odd_tail--;
+    even_tail--;
 
-    statelist->odd = statelist->even = 0;
+    arena->statelist->odd = arena->statelist->even = 0;
 
-    // allocate memory for out of place bucket_sort
+    // carve the buckets for the out of place bucket_sort from one block
     bucket_array_t bucket;
-
     for (i = 0; i < 2; i++) {
         for (uint32_t j = 0; j <= 0xff; j++) {
-            bucket[i][j].head = calloc(1, sizeof(uint32_t) << 14);
-            if (!bucket[i][j].head) {
-                goto out;
-            }
+            bucket[i][j].head = arena->bucket + (((i << 8) | j) << 14);
         }
     }
 
@@ -217,14 +244,26 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
     // parameter into account.
     in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, arena->statelist, in << 1, bucket);
 
-out:
-    for (i = 0; i < 2; i++)
-        for (uint32_t j = 0; j <= 0xff; j++)
-            free(bucket[i][j].head);
-    free(odd_head);
-    free(even_head);
+    return arena->statelist;
+}
+
+/** lfsr_recovery
+ * recover the state of the lfsr given 32 bits of the keystream
+ * additionally you can use the in parameter to specify the value
+ * that was fed into the lfsr at the time the keystream was generated
+ */
+struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
+    struct Crypto1Arena arena;
+    if (crypto1_arena_init(&arena) == false)
+        return 0;
+
+    struct Crypto1State *statelist = lfsr_recovery32_arena(ks2, in, &arena);
+
+    // hand the statelist over to the caller, who frees it.
+    arena.statelist = NULL;
+    crypto1_arena_free(&arena);
     return statelist;
 }
 
@@ -35,6 +35,14 @@ uint32_t crypto1_word(struct Crypto1State *, uint32_t, int);
 uint32_t prng_successor(uint32_t x, uint32_t n);
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+// reusable work memory for lfsr_recovery32_arena()
+struct Crypto1Arena {
+    uint32_t *odd, *even, *bucket;
+    struct Crypto1State *statelist;
+};
+bool crypto1_arena_init(struct Crypto1Arena *arena);
+void crypto1_arena_free(struct Crypto1Arena *arena);
+struct Crypto1State *lfsr_recovery32_arena(uint32_t ks2, uint32_t in, struct Crypto1Arena *arena);
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
 struct Crypto1State *
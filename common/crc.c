@@ -79,6 +79,78 @@ void crc_update(crc_t *crc, uint32_t data, int data_width) {
     }
 }
 
+#ifndef ON_DEVICE
+
+// byte tables for the 8 bit CRCs, filled on first use and shared between threads
+#define CRC8_TABLE_SLOTS 8
+static struct {
+    uint8_t polynom;
+    uint8_t state;      // 0 = free, 1 = building, 2 = ready
+    uint8_t table[256];
+} crc8_tables[CRC8_TABLE_SLOTS];
+
+static const uint8_t *crc8_get_table(uint8_t polynom) {
+
+    for (int i = 0; i < CRC8_TABLE_SLOTS; i++) {
+
+        uint8_t st = __atomic_load_n(&crc8_tables[i].state, __ATOMIC_ACQUIRE);
+        if (st == 2) {
+            if (crc8_tables[i].polynom == polynom) {
+                return crc8_tables[i].table;
+            }
+            continue;
+        }
+
+        if (st == 1) {
+            continue;
+        }
+
+        uint8_t expected = 0;
+        if (__atomic_compare_exchange_n(&crc8_tables[i].state, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == false) {
+            continue;
+        }
+
+        for (int b = 0; b < 256; b++) {
+            uint8_t c = b;
+            for (int j = 0; j < 8; j++) {
+                c = (c & 0x80) ? (c << 1) ^ polynom : (c << 1);
+            }
+            crc8_tables[i].table[b] = c;
+        }
+        crc8_tables[i].polynom = polynom;
+        __atomic_store_n(&crc8_tables[i].state, 2, __ATOMIC_RELEASE);
+        return crc8_tables[i].table;
+    }
+    // all slots taken or still being built
+    return NULL;
+}
+#endif
+
+void crc_update_bytes(crc_t *crc, const uint8_t *d, size_t n) {
+
+#ifndef ON_DEVICE
+    const uint8_t *table = (crc->order == 8) ? crc8_get_table(crc->polynom) : NULL;
+    if (table != NULL) {
+        uint8_t state = crc->state;
+        if (crc->refin) {
+            for (size_t i = 0; i < n; i++) {
+                state = table[state ^ reflect8(d[i])];
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                state = table[state ^ d[i]];
+            }
+        }
+        crc->state = state;
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < n; i++) {
+        crc_update2(crc, d[i], 8);
+    }
+}
+
 uint32_t crc_finish(crc_t *crc) {
     uint32_t val = crc->state;
     if (crc->refout)
@@ -106,18 +178,14 @@ static void print_crc(crc_t *crc) {
 uint32_t CRC8Maxim(uint8_t *buff, size_t size) {
     crc_t crc;
     crc_init_ref(&crc, 8, 0x31, 0, 0, true, true);
-    for (size_t i = 0; i < size; ++i) {
-        crc_update2(&crc, buff[i], 8);
-    }
+    crc_update_bytes(&crc, buff, size);
     return crc_finish(&crc);
 }
 // width=8 poly=0x1d, init=0xc7 (0xe3 - WRONG! but it mentioned in MAD datasheet) refin=false  refout=false  xorout=0x00 name="CRC-8/MIFARE-MAD"
 uint32_t CRC8Mad(uint8_t *buff, size_t size) {
     crc_t crc;
     crc_init_ref(&crc, 8, 0x1d, 0xc7, 0, false, false);
-    for (size_t i = 0; i < size; ++i) {
-        crc_update2(&crc, buff[i], 8);
-    }
+    crc_update_bytes(&crc, buff, size);
     return crc_finish(&crc);
 }
 // width=4  poly=0xC, reversed poly=0x7  init=0x5   refin=true  refout=true  xorout=0x0000  check=  name="CRC-4/LEGIC"
@@ -134,27 +202,21 @@ uint32_t CRC4Legic(uint8_t *buff, size_t size) {
 uint32_t CRC8Legic(uint8_t *buff, size_t size) {
     crc_t crc;
     crc_init_ref(&crc, 8, 0x63, 0x55, 0, true, true);
-    for (size_t i = 0; i < size; ++i) {
-        crc_update2(&crc, buff[i], 8);
-    }
+    crc_update_bytes(&crc, buff, size);
     return reflect8(crc_finish(&crc));
 }
 // width=8  poly=0x7, init=0x2C  refin=false  refout=false  xorout=0x0000  check=0 name="CRC-8/CARDX"
 uint32_t CRC8Cardx(uint8_t *buff, size_t size) {
     crc_t crc;
     crc_init_ref(&crc, 8, 0x7, 0x2C, 0, false, false);
-    for (size_t i = 0; i < size; ++i) {
-        crc_update2(&crc, buff[i], 8);
-    }
+    crc_update_bytes(&crc, buff, size);
     return crc_finish(&crc);
 }
 
 uint32_t CRC8Hitag1(uint8_t *buff, size_t size) {
     crc_t crc;
     crc_init_ref(&crc, 8, 0x1d, 0xff, 0, false, false);
-    for (size_t i = 0; i < size; i++) {
-        crc_update2(&crc, buff[i], 8);
-    }
+    crc_update_bytes(&crc, buff, size);
     return crc_finish(&crc);
 }
 
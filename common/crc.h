@@ -65,6 +65,9 @@ void crc_init(crc_t *crc, int order, uint32_t polynom, uint32_t initial_value, u
 void crc_update(crc_t *crc, uint32_t data, int data_width);
 void crc_update2(crc_t *crc, uint32_t data, int data_width);
 
+/* Update the crc state with n whole bytes, table driven for 8 bit CRCs */
+void crc_update_bytes(crc_t *crc, const uint8_t *d, size_t n);
+
 /* Clean the crc state, e.g. reset it to initial_value */
 void crc_clear(crc_t *crc);
 
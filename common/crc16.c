@@ -24,6 +24,62 @@ static uint16_t crc_table[256];
 static bool crc_table_init = false;
 static CrcType_t current_crc_type = CRC_NONE;
 
+// Per polynomial tables used by the CRC functions below.
+// Unlike crc_table above they don't depend on the last init_table() call,
+// so different CRC types can be computed side by side and from several threads.
+typedef enum {
+    CRC16_TBL_CCITT_REF,    // 0x1021 reflected  14443-A/B, 15693, iCLASS, Kermit, CryptoRF
+    CRC16_TBL_CCITT,        // 0x1021            FeliCa, XModem, CCITT-FALSE, FDX-B, Philips
+    CRC16_TBL_LEGIC,        // 0xc6c6 reflected
+    CRC16_TBL_LEGIC_16,     // 0x002d reflected
+    CRC16_TBL_COUNT
+} crc16_tbl_t;
+
+static const struct {
+    uint16_t polynomial;
+    bool refin;
+} crc16_tbl_def[CRC16_TBL_COUNT] = {
+    { CRC16_POLY_CCITT, true },
+    { CRC16_POLY_CCITT, false },
+    { CRC16_POLY_LEGIC, true },
+    { CRC16_POLY_LEGIC_16, true },
+};
+
+static void crc16_generate(uint16_t *table, uint16_t polynomial, bool refin) {
+
+    for (uint16_t i = 0; i < 256; i++) {
+
+        uint16_t c, crc = 0;
+
+        if (refin) {
+            c = reflect8(i) << 8;
+        } else {
+            c = i << 8;
+        }
+
+        for (uint16_t j = 0; j < 8; j++) {
+
+            if ((crc ^ c) & 0x8000) {
+                crc = (crc << 1) ^ polynomial;
+            } else {
+                crc =   crc << 1;
+            }
+
+            c = c << 1;
+        }
+
+        if (refin) {
+            crc = reflect16(crc);
+        }
+
+        table[i] = crc;
+    }
+}
+
+#ifdef ON_DEVICE
+static crc16_tbl_t crc16_current_tbl = CRC16_TBL_COUNT;
+#endif
+
 void init_table(CrcType_t crctype) {
 
     // same crc algo, and initialised already
@@ -68,35 +124,11 @@ void init_table(CrcType_t crctype) {
 }
 
 void generate_table(uint16_t polynomial, bool refin) {
-
-    for (uint16_t i = 0; i < 256; i++) {
-
-        uint16_t c, crc = 0;
-
-        if (refin) {
-            c = reflect8(i) << 8;
-        } else {
-            c = i << 8;
-        }
-
-        for (uint16_t j = 0; j < 8; j++) {
-
-            if ((crc ^ c) & 0x8000) {
-                crc = (crc << 1) ^ polynomial;
-            } else {
-                crc =   crc << 1;
-            }
-
-            c = c << 1;
-        }
-
-        if (refin) {
-            crc = reflect16(crc);
-        }
-
-        crc_table[i] = crc;
-    }
+    crc16_generate(crc_table, polynomial, refin);
     crc_table_init = true;
+#ifdef ON_DEVICE
+    crc16_current_tbl = CRC16_TBL_COUNT;
+#endif
 }
 
 void reset_table(void) {
@@ -133,6 +165,112 @@ uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bo
     return crc;
 }
 
+#ifndef ON_DEVICE
+
+// slicing-by-8, slice[k][i] is the crc of byte i followed by k zero bytes
+static uint16_t crc16_slices[CRC16_TBL_COUNT][8][256];
+static uint8_t crc16_slices_state[CRC16_TBL_COUNT];  // 0 = empty, 1 = building, 2 = ready
+
+// NULL while another thread is still building the table
+static const uint16_t (*crc16_get_slices(crc16_tbl_t t))[256] {
+
+    if (__atomic_load_n(&crc16_slices_state[t], __ATOMIC_ACQUIRE) == 2) {
+        return (const uint16_t (*)[256])crc16_slices[t];
+    }
+
+    uint8_t expected = 0;
+    if (__atomic_compare_exchange_n(&crc16_slices_state[t], &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == false) {
+        return NULL;
+    }
+
+    uint16_t (*tbl)[256] = crc16_slices[t];
+    bool refin = crc16_tbl_def[t].refin;
+    crc16_generate(tbl[0], crc16_tbl_def[t].polynomial, refin);
+
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint16_t v = tbl[k - 1][i];
+            if (refin) {
+                tbl[k][i] = (v >> 8) ^ tbl[0][v & 0xFF];
+            } else {
+                tbl[k][i] = (v << 8) ^ tbl[0][v >> 8];
+            }
+        }
+    }
+
+    __atomic_store_n(&crc16_slices_state[t], 2, __ATOMIC_RELEASE);
+    return (const uint16_t (*)[256])tbl;
+}
+
+static uint16_t crc16_calc(crc16_tbl_t t, uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+
+    // same convention as crc16_fast
+    if (n == 0) {
+        return (~initval);
+    }
+
+    const uint16_t (*tbl)[256] = crc16_get_slices(t);
+    if (tbl == NULL) {
+        // table is being built right now, go bitwise meanwhile
+        return Crc16(d, n * 8, initval, crc16_tbl_def[t].polynomial, refin, refout);
+    }
+
+    uint16_t crc = initval;
+
+    if (refin) {
+
+        crc = reflect16(crc);
+
+        while (n >= 8) {
+            uint16_t x = crc ^ (d[0] | (d[1] << 8));
+            crc = tbl[7][x & 0xFF] ^ tbl[6][x >> 8] ^ tbl[5][d[2]] ^ tbl[4][d[3]]
+                  ^ tbl[3][d[4]] ^ tbl[2][d[5]] ^ tbl[1][d[6]] ^ tbl[0][d[7]];
+            d += 8;
+            n -= 8;
+        }
+        while (n--) {
+            crc = (crc >> 8) ^ tbl[0][(crc & 0xFF) ^ *d++];
+        }
+
+    } else {
+
+        while (n >= 8) {
+            uint16_t x = crc ^ ((d[0] << 8) | d[1]);
+            crc = tbl[7][x >> 8] ^ tbl[6][x & 0xFF] ^ tbl[5][d[2]] ^ tbl[4][d[3]]
+                  ^ tbl[3][d[4]] ^ tbl[2][d[5]] ^ tbl[1][d[6]] ^ tbl[0][d[7]];
+            d += 8;
+            n -= 8;
+        }
+        while (n--) {
+            crc = (crc << 8) ^ tbl[0][((crc >> 8) ^ *d++) & 0xFF];
+        }
+    }
+
+    if (refout ^ refin) {
+        crc = reflect16(crc);
+    }
+
+    return crc;
+}
+
+#else
+
+// On device RAM is scarce and there is only one thread,
+// keep a single table and regenerate it when the polynomial changes.
+static uint16_t crc16_calc(crc16_tbl_t t, uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+
+    if (t != crc16_current_tbl || crc_table_init == false) {
+        crc16_generate(crc_table, crc16_tbl_def[t].polynomial, crc16_tbl_def[t].refin);
+        crc_table_init = true;
+        crc16_current_tbl = t;
+        // init_table() has to regenerate
+        current_crc_type = CRC_NONE;
+    }
+    return crc16_fast(d, n, initval, refin, refout);
+}
+
+#endif
+
 // bit looped solution  TODO REMOVED
 uint16_t update_crc16_ex(uint16_t crc, uint8_t c, uint16_t polynomial) {
     uint16_t tmp = 0;
@@ -195,8 +333,6 @@ void compute_crc(CrcType_t ct, const uint8_t *d, size_t n, uint8_t *first, uint8
     // can't calc a crc on less than 1 byte
     if (n == 0) return;
 
-    init_table(ct);
-
     uint16_t crc = 0;
     switch (ct) {
         case CRC_14443_A:
@@ -241,7 +377,6 @@ uint16_t Crc16ex(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return 0;
 
-    init_table(ct);
     switch (ct) {
         case CRC_14443_A:
             return crc16_a(d, n);
@@ -287,8 +422,6 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return false;
 
-    init_table(ct);
-
     switch (ct) {
         case CRC_14443_A:
             return (crc16_a(d, n) == 0);
@@ -323,24 +456,28 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
 
 // poly=0x1021  init=0xffff  refin=false  refout=false  xorout=0x0000  check=0x29b1  residue=0x0000  name="CRC-16/CCITT-FALSE"
 uint16_t crc16_ccitt(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xffff, false, false);
+    return crc16_calc(CRC16_TBL_CCITT, d, n, 0xffff, false, false);
+}
+
+uint16_t crc16_ccitt_ex(uint8_t const *d, size_t n, uint16_t initval) {
+    return crc16_calc(CRC16_TBL_CCITT, d, n, initval, false, false);
 }
 
 // FDX-B ISO11784/85) uses KERMIT/CCITT
 // poly 0x xx  init=0x000  refin=false  refout=true  xorout=0x0000 ...
 uint16_t crc16_fdxb(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, true);
+    return crc16_calc(CRC16_TBL_CCITT, d, n, 0x0000, false, true);
 }
 
 // poly=0x1021  init=0x0000  refin=true  refout=true  xorout=0x0000 name="KERMIT"
 uint16_t crc16_kermit(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, true, true);
+    return crc16_calc(CRC16_TBL_CCITT_REF, d, n, 0x0000, true, true);
 }
 
 // FeliCa uses XMODEM
 // poly=0x1021  init=0x0000  refin=false  refout=false  xorout=0x0000 name="XMODEM"
 uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, false);
+    return crc16_calc(CRC16_TBL_CCITT, d, n, 0x0000, false, false);
 }
 
 // Following standards uses X-25
@@ -349,14 +486,18 @@ uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
 //   ISO/IEC 13239 (formerly ISO/IEC 3309)
 // poly=0x1021  init=0xffff  refin=true  refout=true  xorout=0xffff name="X-25"
 uint16_t crc16_x25(uint8_t const *d, size_t n) {
-    uint16_t crc = crc16_fast(d, n, 0xffff, true, true);
+    uint16_t crc = crc16_calc(CRC16_TBL_CCITT_REF, d, n, 0xffff, true, true);
     crc = ~crc;
     return crc;
 }
 // CRC-A (14443-3)
 // poly=0x1021 init=0xc6c6 refin=true refout=true xorout=0x0000 name="CRC-A"
 uint16_t crc16_a(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xC6C6, true, true);
+    return crc16_calc(CRC16_TBL_CCITT_REF, d, n, 0xC6C6, true, true);
+}
+
+uint16_t crc16_a_ex(uint8_t const *d, size_t n, uint16_t initval) {
+    return crc16_calc(CRC16_TBL_CCITT_REF, d, n, initval, true, true);
 }
 
 // iClass crc
@@ -364,16 +505,16 @@ uint16_t crc16_a(uint8_t const *d, size_t n) {
 // poly       0x1021 reflected 0x8408
 // poly=0x1021  init=0x4807  refin=true  refout=true  xorout=0x0BC3  check=0xF0B8  name="CRC-16/ICLASS"
 uint16_t crc16_iclass(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x4807, true, true);
+    return crc16_calc(CRC16_TBL_CCITT_REF, d, n, 0x4807, true, true);
 }
 
 // This CRC-16 is used in Legic Advant systems.
 // poly=0xB400,  init=depends  refin=true  refout=true  xorout=0x0000  check=  name="CRC-16/LEGIC"
 uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc) {
     uint16_t initial = (uidcrc << 8 | uidcrc);
-    return crc16_fast(d, n, initial, true, false);
+    return crc16_calc(CRC16_TBL_LEGIC_16, d, n, initial, true, false);
 }
 
 uint16_t crc16_philips(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x49A3, false, false);
+    return crc16_calc(CRC16_TBL_CCITT, d, n, 0x49A3, false, false);
 }
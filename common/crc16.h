@@ -57,6 +57,10 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n);
 // Calculate CRC-16/CCITT-FALSE
 uint16_t crc16_ccitt(uint8_t const *d, size_t n);
 
+// Same as above with a caller supplied initial value,
+// lets a CRC continue over several buffers.
+uint16_t crc16_ccitt_ex(uint8_t const *d, size_t n, uint16_t initval);
+
 // Calculate CRC-16/KERMIT (FDX-B ISO11784/85)  LF
 uint16_t crc16_fdxb(uint8_t const *d, size_t n);
 
@@ -72,6 +76,9 @@ uint16_t crc16_x25(uint8_t const *d, size_t n);
 // Calculate CRC-16/CRC-A (ISO14443 CRC-A)
 uint16_t crc16_a(uint8_t const *d, size_t n);
 
+// Same as above with a caller supplied initial value
+uint16_t crc16_a_ex(uint8_t const *d, size_t n, uint16_t initval);
+
 // Calculate CRC-16/iCLASS
 uint16_t crc16_iclass(uint8_t const *d, size_t n);
 
@@ -83,7 +90,8 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc);
 // Calculate CRC-16/ Philips.
 uint16_t crc16_philips(uint8_t const *d, size_t n);
 
-// table implementation
+// Legacy table implementation.
+// The functions above keep their own tables and don't need init_table().
 void init_table(CrcType_t crctype);
 void reset_table(void);
 void generate_table(uint16_t polynomial, bool refin);
@@ -0,0 +1,1120 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2010, Flavio D. Garcia, Peter van Rossum, Roel Verdult
+// and Ronny Wichers Schreur. Radboud University Nijmegen
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// SecureMemory / CryptoRF key recovery, the attack of sma.cpp on worker threads.
+//
+// Candidate states are kept as structure of arrays, the cipher state and the
+// Gc bits known so far (Gc[0] in the top byte), in per thread arenas that are
+// reused from one work item to the next.  Work is handed out in chunks from an
+// atomic counter.  The two state scans run several states per step in GCC
+// vector lanes, computing the modular addition instead of using the lookup tables,
+// and the left scan prunes on the first two keystream bytes before the last cell.
+//-----------------------------------------------------------------------------
+#include "smattack.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cryptolib.h"
+#include "workpool.h"
+
+#define SMA_RIGHT_STATES        0x2000000ULL        // 2^25
+#define SMA_LEFT_CELLS          0x100000ULL         // 2^20, x1 x3 x4 x6 of the left scan
+#define SMA_RIGHT_CHUNK         0x40000ULL
+#define SMA_LEFT_CHUNK          0x1000ULL
+#define SMA_RIGHT_MIN_BITS      90
+#define SMA_MITM_INPUTS         0x100000            // 2^20, 5 bits of 4 Gc bytes
+#define SMA_MATCHBOX_BITS       22
+#define SMA_VERIFY_CHUNK        1024
+#define SMA_MAX_THREADS         WORKPOOL_MAX_THREADS
+#define SMA_ARENA_START         0x10000
+
+// lanes of the state scans, plain vector types sized to one register so the compiler
+// emits SSE2 / AVX2 / NEON instead of splitting them up
+#if defined(__AVX2__)
+#define SMA_VECTOR_SIZE         32
+#else
+#define SMA_VECTOR_SIZE         16
+#endif
+#define SMA_LANES               (SMA_VECTOR_SIZE / 4)
+#define SMA_LEFT_LANES          SMA_VECTOR_SIZE
+typedef uint32_t sma_v32_t __attribute__((vector_size(SMA_VECTOR_SIZE)));
+typedef uint8_t sma_v8_t __attribute__((vector_size(SMA_VECTOR_SIZE)));
+
+#define BIT_ROL_MASK     ((1 << 5) - 1)
+#define BIT_ROL(a)       ((((a) << 1) | ((a) >> 4)) & BIT_ROL_MASK)
+#define BIT_ROR(a)       (((a) >> 1) | (((a) & 1) << 4))
+
+typedef struct {
+    uint8_t addition;
+    uint8_t out;
+} sma_lookup_t;
+
+static uint8_t lookup_left_subtraction[0x400];
+static uint8_t lookup_right_subtraction[0x400];
+static sma_lookup_t lookup_left[0x100000];
+static sma_lookup_t lookup_right[0x8000];
+static pthread_once_t lookup_once = PTHREAD_ONCE_INIT;
+
+// growing list of 64 bit values
+typedef struct {
+    uint64_t *v;
+    size_t count;
+    size_t capacity;
+} sma_list_t;
+
+// candidate cipher states, structure of arrays
+typedef struct {
+    uint64_t *state;
+    uint64_t *gc;
+    size_t count;
+    size_t capacity;
+} sma_cset_t;
+
+// state -> last Gc input reaching it, open addressing on (state << 20 | input)
+typedef struct {
+    uint64_t *slot;
+    uint64_t mask;
+} sma_matchbox_t;
+
+typedef struct sma_ctx_s sma_ctx_t;
+
+typedef struct {
+    sma_ctx_t *c;
+    sma_list_t found;       // scan results, (bits << 56) | state
+    uint32_t topbits;
+    sma_cset_t a;           // expansion arenas
+    sma_cset_t b;
+    sma_cset_t out;         // meet-in-the-middle results
+} sma_thread_t;
+
+struct sma_ctx_s {
+    int threads;
+    sma_thread_t *t;
+
+    const uint8_t *Ci;
+    const uint8_t *Q;
+    const uint8_t *Ch;
+    const uint8_t *Ci_1;
+    uint8_t ks[16];
+    uint8_t mask[16];
+
+    // work distribution of the current stage
+    workpool_t pool;
+    uint64_t done;
+    uint64_t total;
+    bool stop;
+    bool nomem;
+
+    // meet-in-the-middle stage
+    bool right;
+    const sma_cset_t *items;
+    const sma_matchbox_t *matchbox;
+
+    // verify stage
+    const uint64_t *cands;
+    bool found;
+    uint64_t key;
+
+    sma_report_t report;
+    void *report_ctx;
+    pthread_mutex_t report_lock;
+    sma_status_t status;
+};
+
+static uint8_t sma_mod(uint8_t a, uint8_t m) {
+    if (m == 0) {
+        return 0;
+    }
+    if (a < m) {
+        return a;
+    }
+    a %= m;
+    return (a == 0) ? m : a;
+}
+
+static void sma_init_lookup(void) {
+    for (int i = 0; i < 0x400; i++) {
+        uint8_t b6 = i & 0x1f;
+        uint8_t b3 = (i >> 5) & 0x1f;
+        int index = (b3 << 15) | b6;
+        uint8_t temp = sma_mod(b3 + BIT_ROL(b6), 0x1f);
+        lookup_left[index].addition = temp;
+        lookup_left[index].out = ((temp ^ b3) & 0x0f);
+    }
+
+    for (int i = 0; i < 0x400; i++) {
+        uint8_t b18 = i & 0x1f;
+        uint8_t b16 = (i >> 5) & 0x1f;
+        int index = (b16 << 10) | b18;
+        uint8_t temp = sma_mod(b18 + b16, 0x1f);
+        lookup_right[index].addition = temp;
+        lookup_right[index].out = ((temp ^ b16) & 0x0f);
+    }
+
+    for (int i = 0; i < 0x400; i++) {
+        uint8_t b3 = (i >> 5) & 0x1f;
+        uint8_t bx = i & 0x1f;
+        lookup_left_subtraction[i] = BIT_ROR(sma_mod((bx + 0x1f) - b3, 0x1f));
+        lookup_right_subtraction[i] = sma_mod((bx + 0x1f) - b3, 0x1f);
+    }
+}
+
+static inline uint8_t sma_next_left(uint8_t in, uint64_t *left) {
+    *left ^= ((uint64_t)(in & 0x1f) << 20);
+    const sma_lookup_t *lookup = &lookup_left[(*left) & 0xf801f];
+    *left = ((*left) >> 5) | ((uint64_t)lookup->addition << 30);
+    return lookup->out;
+}
+
+static inline uint8_t sma_next_right(uint8_t in, uint64_t *right) {
+    *right ^= ((uint64_t)(in & 0xf8) << 12);
+    const sma_lookup_t *lookup = &lookup_right[(*right) & 0x7c1f];
+    *right = ((*right) >> 5) | ((uint64_t)lookup->addition << 20);
+    return lookup->out;
+}
+
+// the modular addition of the lookup tables, with a > 31 only for sums up to 62.
+// Vectors go by pointer only, passing them by value changes the ABI with the ISA level.
+static inline void sma_vnext_right(sma_v32_t *r, sma_v32_t *out) {
+    sma_v32_t b18 = *r & 0x1f;
+    sma_v32_t b16 = (*r >> 10) & 0x1f;
+    sma_v32_t t = b18 + b16;
+    t -= (sma_v32_t)(t > 31) & 31;
+    *r = (*r >> 5) | (t << 20);
+    *out = (t ^ b16) & 0x0f;
+}
+
+// left cells, x[n] = x[n-4] + rol(x[n-7]) with the same modular addition
+static inline uint8_t sma_left_add(uint8_t a, uint8_t b) {
+    uint8_t t = a + BIT_ROL(b);
+    return t - ((t > 31) ? 31 : 0);
+}
+
+static inline void sma_vleft_add(const sma_v8_t *a, const sma_v8_t *b, sma_v8_t *t) {
+    sma_v8_t s = *a + (((*b << 1) | (*b >> 4)) & 0x1f);
+    *t = s - ((sma_v8_t)(s > 31) & 31);
+}
+
+static inline bool sma_vany(const sma_v8_t *v) {
+    uint64_t w[sizeof(sma_v8_t) / sizeof(uint64_t)];
+    memcpy(w, v, sizeof(w));
+    uint64_t r = 0;
+    for (size_t i = 0; i < sizeof(w) / sizeof(w[0]); i++) {
+        r |= w[i];
+    }
+    return (r != 0);
+}
+
+static inline uint32_t sma_correct_bits(uint8_t bt) {
+    return 8 - __builtin_popcount(bt);
+}
+
+static bool sma_list_push(sma_list_t *l, uint64_t v) {
+    if (l->count == l->capacity) {
+        size_t n = l->capacity ? l->capacity * 2 : 256;
+        uint64_t *p = realloc(l->v, n * sizeof(uint64_t));
+        if (p == NULL) {
+            return false;
+        }
+        l->v = p;
+        l->capacity = n;
+    }
+    l->v[l->count++] = v;
+    return true;
+}
+
+static bool sma_cset_reserve(sma_cset_t *cs, size_t n) {
+    if (n <= cs->capacity) {
+        return true;
+    }
+    size_t cap = cs->capacity ? cs->capacity : SMA_ARENA_START;
+    while (cap < n) {
+        cap *= 2;
+    }
+    uint64_t *s = realloc(cs->state, cap * sizeof(uint64_t));
+    if (s == NULL) {
+        return false;
+    }
+    cs->state = s;
+    uint64_t *g = realloc(cs->gc, cap * sizeof(uint64_t));
+    if (g == NULL) {
+        return false;
+    }
+    cs->gc = g;
+    cs->capacity = cap;
+    return true;
+}
+
+static bool sma_cset_append(sma_cset_t *dst, const sma_cset_t *src) {
+    if (sma_cset_reserve(dst, dst->count + src->count) == false) {
+        return false;
+    }
+    memcpy(dst->state + dst->count, src->state, src->count * sizeof(uint64_t));
+    memcpy(dst->gc + dst->count, src->gc, src->count * sizeof(uint64_t));
+    dst->count += src->count;
+    return true;
+}
+
+static void sma_cset_free(sma_cset_t *cs) {
+    free(cs->state);
+    free(cs->gc);
+    memset(cs, 0, sizeof(sma_cset_t));
+}
+
+static int sma_cmp_desc(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x < y) - (x > y);
+}
+
+// calls the report callback with the current stage status, false when the search should stop.
+// Workers report progress only, the end of a stage is reported once by sma_recover.
+static bool sma_report(sma_ctx_t *c, bool end) {
+    if (__atomic_load_n(&c->stop, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    if (c->report == NULL) {
+        return true;
+    }
+    uint64_t done = __atomic_load_n(&c->done, __ATOMIC_SEQ_CST);
+    if (end == false && done >= c->total) {
+        return true;
+    }
+    pthread_mutex_lock(&c->report_lock);
+    c->status.done = done;
+    bool go_on = c->report(&c->status, c->report_ctx);
+    pthread_mutex_unlock(&c->report_lock);
+    if (go_on == false) {
+        __atomic_store_n(&c->stop, true, __ATOMIC_SEQ_CST);
+    }
+    return go_on;
+}
+
+static void sma_stage(sma_ctx_t *c, sma_stage_t stage, uint64_t total) {
+    c->status.stage = stage;
+    c->status.total = total;
+    c->status.count = 0;
+    c->done = 0;
+    c->total = total;
+}
+
+static void sma_fail_nomem(sma_ctx_t *c) {
+    __atomic_store_n(&c->nomem, true, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&c->stop, true, __ATOMIC_SEQ_CST);
+}
+
+// claims the next chunk of work, false when the stage is done or stopped
+static bool sma_claim(sma_ctx_t *c, uint64_t chunk, uint64_t *start, uint64_t *end) {
+    if (__atomic_load_n(&c->stop, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    return workpool_claim(&c->pool, chunk, start, end);
+}
+
+static void sma_run(sma_ctx_t *c, void *(*worker)(void *)) {
+    workpool_run(&c->pool, c->threads, c->total, worker, c->t, sizeof(sma_thread_t));
+}
+
+// merges the per thread scan results, highest bin first
+static bool sma_collect(sma_ctx_t *c, sma_list_t *out) {
+    out->count = 0;
+    for (int i = 0; i < c->threads; i++) {
+        sma_list_t *f = &c->t[i].found;
+        for (size_t j = 0; j < f->count; j++) {
+            if (sma_list_push(out, f->v[j]) == false) {
+                return false;
+            }
+        }
+        f->count = 0;
+    }
+    qsort(out->v, out->count, sizeof(uint64_t), sma_cmp_desc);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// right states scan, every right state scored by the keystream bits it gets right
+//-----------------------------------------------------------------------------
+static void *sma_right_worker(void *arg) {
+    sma_thread_t *t = arg;
+    sma_ctx_t *c = t->c;
+
+    sma_v32_t lanes;
+    for (int i = 0; i < SMA_LANES; i++) {
+        lanes[i] = i;
+    }
+
+    uint64_t start, end;
+    while (sma_claim(c, SMA_RIGHT_CHUNK, &start, &end)) {
+
+        for (uint64_t counter = start; counter < end; counter += SMA_LANES) {
+
+            sma_v32_t r = lanes + (uint32_t)counter;
+            sma_v32_t miss = {0};
+
+            for (int pos = 0; pos < 16; pos++) {
+                sma_v32_t o1, o2;
+                sma_vnext_right(&r, &o1);
+                sma_vnext_right(&r, &o1);
+                sma_vnext_right(&r, &o2);
+                sma_vnext_right(&r, &o2);
+                sma_v32_t bt = ((o1 << 4) | o2) ^ c->ks[pos];
+
+                // bits differing from the keystream
+                bt = bt - ((bt >> 1) & 0x55);
+                bt = (bt & 0x33) + ((bt >> 2) & 0x33);
+                miss += (bt + (bt >> 4)) & 0x0f;
+            }
+
+            for (int i = 0; i < SMA_LANES; i++) {
+                uint32_t bits = 128 - miss[i];
+                if (bits > t->topbits) {
+                    t->topbits = bits;
+                }
+                if (bits >= SMA_RIGHT_MIN_BITS) {
+                    if (sma_list_push(&t->found, ((uint64_t)bits << 56) | (counter + i)) == false) {
+                        sma_fail_nomem(c);
+                        return NULL;
+                    }
+                }
+            }
+        }
+
+        __atomic_fetch_add(&c->done, end - start, __ATOMIC_SEQ_CST);
+        sma_report(c, false);
+    }
+    return NULL;
+}
+
+// bits of the left output that must match the keystream, where the right output does not
+static void sma_left_mask(const uint8_t *ks, uint8_t *mask, uint64_t rstate) {
+    for (int pos = 0; pos < 16; pos++) {
+        sma_next_right(0, &rstate);
+        uint8_t bt = sma_next_right(0, &rstate) << 4;
+        sma_next_right(0, &rstate);
+        bt |= sma_next_right(0, &rstate);
+        mask[pos] = bt ^ ks[pos];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// left states scan, every left state producing the masked keystream bits
+//-----------------------------------------------------------------------------
+static uint32_t sma_left_bits(const uint8_t *ks, uint64_t lstate) {
+    uint32_t bits = 0;
+    for (int pos = 0; pos < 16; pos++) {
+        sma_next_left(0, &lstate);
+        uint8_t bt = sma_next_left(0, &lstate) << 4;
+        sma_next_left(0, &lstate);
+        bt |= sma_next_left(0, &lstate);
+        bits += sma_correct_bits(bt ^ ks[pos]);
+    }
+    return bits;
+}
+
+// The left state is seven 5 bit cells x[0..6], every step shifts in x[n] = x[n-4] + rol(x[n-7])
+// and keystream byte pos is ((x[4pos+8] ^ x[4pos+4]) & 0xf) << 4 | ((x[4pos+10] ^ x[4pos+6]) & 0xf).
+// Byte 0 only depends on x1 x3 x4 x6, byte 1 adds x0 (low nibble) and x5 (high nibble),
+// so those are pruned first and the 32 values of x2 run in vector lanes.
+static void *sma_left_worker(void *arg) {
+    sma_thread_t *t = arg;
+    sma_ctx_t *c = t->c;
+    const uint8_t *ks = c->ks;
+    const uint8_t *mask = c->mask;
+
+    sma_v8_t x[71];
+    sma_v8_t zero = {0};
+    sma_v8_t lanes;
+    for (int i = 0; i < SMA_LEFT_LANES; i++) {
+        lanes[i] = i;
+    }
+
+    uint64_t start, end;
+    while (sma_claim(c, SMA_LEFT_CHUNK, &start, &end)) {
+
+        for (uint64_t i = start; i < end; i++) {
+            uint8_t x1 = i & 0x1f;
+            uint8_t x4 = (i >> 5) & 0x1f;
+            uint8_t x3 = (i >> 10) & 0x1f;
+            uint8_t x6 = (i >> 15) & 0x1f;
+            uint8_t x8 = sma_left_add(x4, x1);
+            uint8_t x10 = sma_left_add(x6, x3);
+
+            uint8_t bt = (((x8 ^ x4) & 0xf) << 4) | ((x10 ^ x6) & 0xf);
+            if ((bt ^ ks[0]) & mask[0]) {
+                continue;
+            }
+
+            for (uint8_t x0 = 0; x0 < 0x20; x0++) {
+                uint8_t x7 = sma_left_add(x3, x0);
+                uint8_t x11 = sma_left_add(x7, x4);
+                uint8_t x14 = sma_left_add(x10, x7);
+                uint8_t x18 = sma_left_add(x14, x11);
+
+                // low nibbles of bytes 1 and 2 are known here
+                bt = (x14 ^ x10) & 0xf;
+                if ((bt ^ ks[1]) & mask[1] & 0x0f) {
+                    continue;
+                }
+                bt = (x18 ^ x14) & 0xf;
+                if ((bt ^ ks[2]) & mask[2] & 0x0f) {
+                    continue;
+                }
+
+                for (uint8_t x5 = 0; x5 < 0x20; x5++) {
+                    uint8_t x12 = sma_left_add(x8, x5);
+                    bt = ((x12 ^ x8) & 0xf) << 4;
+                    if ((bt ^ ks[1]) & mask[1] & 0xf0) {
+                        continue;
+                    }
+
+                    for (uint8_t x2 = 0; x2 < 0x20; x2 += SMA_LEFT_LANES) {
+                        x[0] = zero + x0;
+                        x[1] = zero + x1;
+                        x[2] = lanes + x2;
+                        x[3] = zero + x3;
+                        x[4] = zero + x4;
+                        x[5] = zero + x5;
+                        x[6] = zero + x6;
+
+                        // a lane dies on the first required bit it gets wrong
+                        sma_v8_t alive = ~zero;
+                        int n = 7;
+                        int pos;
+                        for (pos = 2; pos < 16; pos++) {
+                            for (; n <= (4 * pos) + 10; n++) {
+                                sma_vleft_add(&x[n - 4], &x[n - 7], &x[n]);
+                            }
+                            sma_v8_t vbt = (((x[(4 * pos) + 8] ^ x[(4 * pos) + 4]) & 0xf) << 4) | ((x[(4 * pos) + 10] ^ x[(4 * pos) + 6]) & 0xf);
+                            alive &= (sma_v8_t)(((vbt ^ ks[pos]) & mask[pos]) == 0);
+                            if (sma_vany(&alive) == false) {
+                                break;
+                            }
+                        }
+
+                        if (pos < 16) {
+                            continue;
+                        }
+
+                        for (int k = 0; k < SMA_LEFT_LANES; k++) {
+                            if (alive[k] == 0) {
+                                continue;
+                            }
+                            uint64_t lstate = x0 | ((uint64_t)x1 << 5) | ((uint64_t)(x2 + k) << 10) | ((uint64_t)x3 << 15)
+                                              | ((uint64_t)x4 << 20) | ((uint64_t)x5 << 25) | ((uint64_t)x6 << 30);
+                            uint64_t bits = sma_left_bits(ks, lstate);
+                            if (sma_list_push(&t->found, (bits << 56) | lstate) == false) {
+                                sma_fail_nomem(c);
+                                return NULL;
+                            }
+                            __atomic_fetch_add(&c->status.count, 1, __ATOMIC_SEQ_CST);
+                        }
+                    }
+                }
+            }
+        }
+
+        __atomic_fetch_add(&c->done, end - start, __ATOMIC_SEQ_CST);
+        sma_report(c, false);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// meet-in-the-middle on the Gc bits of one side
+//-----------------------------------------------------------------------------
+
+// one step back with a known input, gc_index >= 0 records the input as that Gc byte.
+// out needs room for 2 * in->count more states.
+static void sma_previous_left(const sma_cset_t *in, uint8_t input, int gc_index, sma_cset_t *out) {
+    uint64_t gc_bits = (gc_index < 0) ? 0 : ((uint64_t)input << ((7 - gc_index) * 8));
+    uint64_t in_bits = ((uint64_t)input & 0x1f) << 20;
+    size_t n = out->count;
+
+    for (size_t i = 0; i < in->count; i++) {
+        uint64_t l = in->state[i];
+        uint8_t bx = (uint8_t)((l >> 30) & 0x1f);
+        unsigned b3 = (unsigned)(l >> 5) & 0x3e0;
+        uint64_t gc = in->gc[i] | gc_bits;
+        l <<= 5;
+
+        if (bx == 0) {
+            // impossible state
+            if (b3 != 0) {
+                continue;
+            }
+            // we only need to consider b6 = 0
+            out->state[n] = ((l & 0x7ffffffe0ull) ^ in_bits);
+            out->gc[n++] = gc;
+            continue;
+        }
+
+        uint8_t b6 = lookup_left_subtraction[b3 | bx];
+        l = ((l & 0x7ffffffe0ull) | b6) ^ in_bits;
+        out->state[n] = l;
+        out->gc[n++] = gc;
+
+        // second candidate
+        if (b6 == 0x1f) {
+            out->state[n] = l & 0x7ffffffe0ull;
+            out->gc[n++] = gc;
+        }
+    }
+    out->count = n;
+}
+
+static void sma_previous_right(const sma_cset_t *in, uint8_t input, int gc_index, sma_cset_t *out) {
+    uint64_t gc_bits = (gc_index < 0) ? 0 : ((uint64_t)input << ((7 - gc_index) * 8));
+    uint64_t in_bits = ((uint64_t)input & 0xf8) << 12;
+    size_t n = out->count;
+
+    for (size_t i = 0; i < in->count; i++) {
+        uint64_t r = in->state[i];
+        uint8_t bx = (uint8_t)((r >> 20) & 0x1f);
+        unsigned b16 = (unsigned)(r & 0x3e0);
+        uint64_t gc = in->gc[i] | gc_bits;
+        r <<= 5;
+
+        if (bx == 0) {
+            if (b16 != 0) {
+                continue;
+            }
+            // we only need to consider b18 = 0
+            out->state[n] = ((r & 0x1ffffe0ull) ^ in_bits);
+            out->gc[n++] = gc;
+            continue;
+        }
+
+        uint8_t b18 = lookup_right_subtraction[b16 | bx];
+        r = ((r & 0x1ffffe0ull) | b18) ^ in_bits;
+        out->state[n] = r;
+        out->gc[n++] = gc;
+
+        if (b18 == 0x1f) {
+            out->state[n] = r & 0x1ffffe0ull;
+            out->gc[n++] = gc;
+        }
+    }
+    out->count = n;
+}
+
+static bool sma_previous_one(const sma_cset_t *in, bool right, uint8_t input, sma_cset_t *out) {
+    out->count = 0;
+    if (sma_cset_reserve(out, in->count * 2) == false) {
+        return false;
+    }
+    if (right) {
+        sma_previous_right(in, input, -1, out);
+    } else {
+        sma_previous_left(in, input, -1, out);
+    }
+    return true;
+}
+
+// one step back over all 32 values of the unknown 5 Gc bits
+static bool sma_previous_all(const sma_cset_t *in, bool right, int gc_index, sma_cset_t *out) {
+    out->count = 0;
+    if (sma_cset_reserve(out, in->count * 64) == false) {
+        return false;
+    }
+    for (uint8_t btGc = 0; btGc < 0x20; btGc++) {
+        if (right) {
+            sma_previous_right(in, btGc << 3, gc_index, out);
+        } else {
+            sma_previous_left(in, btGc, gc_index, out);
+        }
+    }
+    return true;
+}
+
+static inline uint64_t sma_hash(uint64_t state, uint64_t mask) {
+    return ((state * 0x9E3779B97F4A7C15ULL) >> 29) & mask;
+}
+
+static void sma_matchbox_put(sma_matchbox_t *mb, uint64_t state, uint64_t input) {
+    uint64_t h = sma_hash(state, mb->mask);
+    while (mb->slot[h] != UINT64_MAX && (mb->slot[h] >> 20) != state) {
+        h = (h + 1) & mb->mask;
+    }
+    // the last input reaching a state wins, as in sma.cpp
+    mb->slot[h] = (state << 20) | input;
+}
+
+static bool sma_matchbox_get(const sma_matchbox_t *mb, uint64_t state, uint64_t *input) {
+    uint64_t h = sma_hash(state, mb->mask);
+    while (mb->slot[h] != UINT64_MAX) {
+        if ((mb->slot[h] >> 20) == state) {
+            *input = mb->slot[h] & 0xfffff;
+            return true;
+        }
+        h = (h + 1) & mb->mask;
+    }
+    return false;
+}
+
+// every state reachable from the state before Gc with the 5 bits of Gc[0..3] this side sees
+static bool sma_matchbox_build(sma_matchbox_t *mb, bool right, uint64_t before, const uint8_t *Q) {
+    mb->mask = (1ULL << SMA_MATCHBOX_BITS) - 1;
+    mb->slot = malloc((mb->mask + 1) * sizeof(uint64_t));
+    if (mb->slot == NULL) {
+        return false;
+    }
+    memset(mb->slot, 0xff, (mb->mask + 1) * sizeof(uint64_t));
+
+    for (uint64_t counter = 0; counter < SMA_MITM_INPUTS; counter++) {
+        uint64_t s = before;
+        if (right) {
+            sma_next_right((counter >> 12) & 0xf8, &s);
+            sma_next_right((counter >> 7) & 0xf8, &s);
+            sma_next_right(Q[4], &s);
+            sma_next_right((counter >> 2) & 0xf8, &s);
+            sma_next_right((counter << 3) & 0xf8, &s);
+            sma_next_right(Q[5], &s);
+        } else {
+            sma_next_left((counter >> 15) & 0x1f, &s);
+            sma_next_left((counter >> 10) & 0x1f, &s);
+            sma_next_left(Q[4], &s);
+            sma_next_left((counter >> 5) & 0x1f, &s);
+            sma_next_left(counter & 0x1f, &s);
+            sma_next_left(Q[5], &s);
+        }
+        sma_matchbox_put(mb, s, counter);
+    }
+    return true;
+}
+
+static uint64_t sma_matchbox_gc(bool right, uint64_t counter) {
+    uint64_t g0, g1, g2, g3;
+    if (right) {
+        g0 = (counter >> 12) & 0xf8;
+        g1 = (counter >> 7) & 0xf8;
+        g2 = (counter >> 2) & 0xf8;
+        g3 = (counter << 3) & 0xf8;
+    } else {
+        g0 = (counter >> 15) & 0x1f;
+        g1 = (counter >> 10) & 0x1f;
+        g2 = (counter >> 5) & 0x1f;
+        g3 = counter & 0x1f;
+    }
+    return (g0 << 56) | (g1 << 48) | (g2 << 40) | (g3 << 32);
+}
+
+// one item, rolled back over Gc[6], Q[6], Gc[5], Gc[4] and matched against the forward states
+static void *sma_mitm_worker(void *arg) {
+    sma_thread_t *t = arg;
+    sma_ctx_t *c = t->c;
+    bool right = c->right;
+
+    uint64_t start, end;
+    while (sma_claim(c, 1, &start, &end)) {
+
+        t->a.count = 0;
+        if (sma_cset_reserve(&t->a, 1) == false) {
+            sma_fail_nomem(c);
+            return NULL;
+        }
+        t->a.state[0] = c->items->state[start];
+        t->a.gc[0] = c->items->gc[start];
+        t->a.count = 1;
+
+        if (sma_previous_all(&t->a, right, 6, &t->b) == false
+                || sma_previous_one(&t->b, right, c->Q[6], &t->a) == false
+                || sma_previous_all(&t->a, right, 5, &t->b) == false
+                || sma_previous_all(&t->b, right, 4, &t->a) == false) {
+            sma_fail_nomem(c);
+            return NULL;
+        }
+
+        // intersection with the forward states
+        size_t n = 0;
+        for (size_t i = 0; i < t->a.count; i++) {
+            uint64_t counter;
+            if (sma_matchbox_get(c->matchbox, t->a.state[i], &counter)) {
+                t->a.state[n] = t->a.state[i];
+                t->a.gc[n++] = t->a.gc[i] | sma_matchbox_gc(right, counter);
+            }
+        }
+        t->a.count = n;
+
+        if (sma_cset_append(&t->out, &t->a) == false) {
+            sma_fail_nomem(c);
+            return NULL;
+        }
+        __atomic_fetch_add(&c->status.count, n, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&c->done, 1, __ATOMIC_SEQ_CST);
+        sma_report(c, false);
+    }
+    return NULL;
+}
+
+// Gc candidates of one side, from the cipher states right after Gc
+static bool sma_search_gc(sma_ctx_t *c, bool right, uint64_t before, const sma_cset_t *after, sma_cset_t *out) {
+
+    out->count = 0;
+
+    sma_matchbox_t mb = {0};
+    if (sma_matchbox_build(&mb, right, before, c->Q) == false) {
+        return false;
+    }
+
+    // roll back over Q[7] and Gc[7] here, the rest is split over the threads
+    sma_cset_t s1 = {0}, items = {0};
+    bool ok = sma_previous_one(after, right, c->Q[7], &s1) && sma_previous_all(&s1, right, 7, &items);
+    sma_cset_free(&s1);
+    if (ok == false) {
+        sma_cset_free(&items);
+        free(mb.slot);
+        return false;
+    }
+
+    sma_stage(c, right ? SMA_STAGE_RIGHT_MITM : SMA_STAGE_LEFT_MITM, items.count);
+    c->right = right;
+    c->items = &items;
+    c->matchbox = &mb;
+
+    sma_run(c, sma_mitm_worker);
+
+    for (int i = 0; i < c->threads && c->nomem == false; i++) {
+        if (sma_cset_append(out, &c->t[i].out) == false) {
+            sma_fail_nomem(c);
+        }
+        c->t[i].out.count = 0;
+    }
+
+    c->items = NULL;
+    c->matchbox = NULL;
+    sma_cset_free(&items);
+    free(mb.slot);
+    return (c->nomem == false);
+}
+
+//-----------------------------------------------------------------------------
+// left and right candidates agreeing on the two Gc bits both sides see
+//-----------------------------------------------------------------------------
+static inline uint32_t sma_overlap_key(uint64_t gc) {
+    uint64_t k = (gc >> 3) & 0x0303030303030303ULL;
+    k = (k | (k >> 6)) & 0x000F000F000F000FULL;
+    k = (k | (k >> 12)) & 0x000000FF000000FFULL;
+    k = (k | (k >> 24)) & 0xFFFF;
+    return (uint32_t)k;
+}
+
+static bool sma_combine(const sma_cset_t *lc, const sma_cset_t *rc, sma_list_t *out) {
+
+    const sma_cset_t *outer = (lc->count > rc->count) ? lc : rc;
+    const sma_cset_t *inner = (lc->count > rc->count) ? rc : lc;
+
+    // inner candidates bucketed by the overlapping bits
+    uint32_t *start = calloc(0x10001, sizeof(uint32_t));
+    uint64_t *sorted = malloc((inner->count + 1) * sizeof(uint64_t));
+    if (start == NULL || sorted == NULL) {
+        free(start);
+        free(sorted);
+        return false;
+    }
+
+    for (size_t i = 0; i < inner->count; i++) {
+        start[sma_overlap_key(inner->gc[i]) + 1]++;
+    }
+    for (int k = 0; k < 0x10000; k++) {
+        start[k + 1] += start[k];
+    }
+    uint32_t *fill = calloc(0x10000, sizeof(uint32_t));
+    if (fill == NULL) {
+        free(start);
+        free(sorted);
+        return false;
+    }
+    for (size_t i = 0; i < inner->count; i++) {
+        uint32_t k = sma_overlap_key(inner->gc[i]);
+        sorted[start[k] + fill[k]++] = inner->gc[i];
+    }
+    free(fill);
+
+    out->count = 0;
+    bool ok = true;
+    for (size_t i = 0; i < outer->count && ok; i++) {
+        uint32_t k = sma_overlap_key(outer->gc[i]);
+        for (uint32_t j = start[k]; j < start[k + 1]; j++) {
+            if (sma_list_push(out, outer->gc[i] | sorted[j]) == false) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    free(start);
+    free(sorted);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// full authentication of the combined candidates
+//-----------------------------------------------------------------------------
+static void sma_u64_to_bytes(uint64_t n, uint8_t *dst) {
+    for (int i = 7; i >= 0; i--) {
+        dst[i] = (uint8_t)n;
+        n >>= 8;
+    }
+}
+
+static void *sma_verify_worker(void *arg) {
+    sma_thread_t *t = arg;
+    sma_ctx_t *c = t->c;
+
+    crypto_state_t s;
+    uint8_t Gc[8], Ch[8], Ci_1[8];
+
+    uint64_t start, end;
+    while (sma_claim(c, SMA_VERIFY_CHUNK, &start, &end)) {
+        for (uint64_t i = start; i < end; i++) {
+            sma_u64_to_bytes(c->cands[i], Gc);
+            sm_auth(Gc, c->Ci, c->Q, Ch, Ci_1, &s);
+            if (memcmp(Ch, c->Ch, 8) == 0 && memcmp(Ci_1, c->Ci_1, 8) == 0) {
+                pthread_mutex_lock(&c->report_lock);
+                if (c->found == false) {
+                    c->found = true;
+                    c->key = c->cands[i];
+                }
+                pthread_mutex_unlock(&c->report_lock);
+                __atomic_store_n(&c->stop, true, __ATOMIC_SEQ_CST);
+                break;
+            }
+        }
+        __atomic_fetch_add(&c->done, end - start, __ATOMIC_SEQ_CST);
+        sma_report(c, false);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+sma_result_t sma_recover(const uint8_t *Ci, const uint8_t *Q, const uint8_t *Ch, const uint8_t *Ci_1,
+                         int threads, sma_report_t report, void *ctx, uint8_t *Gc) {
+
+    pthread_once(&lookup_once, sma_init_lookup);
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > SMA_MAX_THREADS) {
+        threads = SMA_MAX_THREADS;
+    }
+
+    sma_ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.threads = threads;
+    c.Ci = Ci;
+    c.Q = Q;
+    c.Ch = Ch;
+    c.Ci_1 = Ci_1;
+    c.report = report;
+    c.report_ctx = ctx;
+    pthread_mutex_init(&c.report_lock, NULL);
+
+    c.t = calloc(threads, sizeof(sma_thread_t));
+    if (c.t == NULL) {
+        pthread_mutex_destroy(&c.report_lock);
+        return SMA_NOMEM;
+    }
+    for (int i = 0; i < threads; i++) {
+        c.t[i].c = &c;
+    }
+
+    // keystream, Ci+1 and Ch interleaved
+    for (int pos = 0; pos < 8; pos++) {
+        c.ks[2 * pos] = Ci_1[pos];
+        c.ks[(2 * pos) + 1] = Ch[pos];
+    }
+
+    // load Ci together with the first half of Q
+    uint64_t rstate_before_gc = 0;
+    uint64_t lstate_before_gc = 0;
+    for (int pos = 0; pos < 4; pos++) {
+        sma_next_right(Ci[2 * pos], &rstate_before_gc);
+        sma_next_right(Ci[(2 * pos) + 1], &rstate_before_gc);
+        sma_next_right(Q[pos], &rstate_before_gc);
+
+        sma_next_left(Ci[2 * pos], &lstate_before_gc);
+        sma_next_left(Ci[(2 * pos) + 1], &lstate_before_gc);
+        sma_next_left(Q[pos], &lstate_before_gc);
+    }
+
+    sma_result_t res = SMA_NOT_FOUND;
+    sma_list_t rstates = {0}, lstates = {0}, gc_cands = {0};
+    sma_cset_t crstates = {0}, clstates = {0}, lscan = {0};
+    uint8_t last_mask[16];
+    bool have_left = false;
+
+    // right states scored against the keystream
+    sma_stage(&c, SMA_STAGE_RIGHT, SMA_RIGHT_STATES);
+    sma_run(&c, sma_right_worker);
+    if (c.nomem || c.stop) {
+        goto out;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (c.t[i].topbits > c.status.rbits) {
+            c.status.rbits = c.t[i].topbits;
+        }
+    }
+    if (sma_collect(&c, &rstates) == false) {
+        c.nomem = true;
+        goto out;
+    }
+    c.status.count = rstates.count;
+    c.done = c.total;
+    if (sma_report(&c, true) == false) {
+        goto out;
+    }
+
+    for (size_t ri = 0; ri < rstates.count; ri++) {
+
+        uint64_t rstate_after_gc = rstates.v[ri] & 0xffffffffffffffULL;
+        c.status.rstate = rstate_after_gc;
+
+        sma_left_mask(c.ks, c.mask, rstate_after_gc);
+
+        sma_cset_t after = {0};
+        if (sma_cset_reserve(&after, 1) == false) {
+            c.nomem = true;
+            goto out;
+        }
+        after.state[0] = rstate_after_gc;
+        after.gc[0] = 0;
+        after.count = 1;
+        bool ok = sma_search_gc(&c, true, rstate_before_gc, &after, &crstates);
+        sma_cset_free(&after);
+        if (ok == false || c.stop) {
+            goto out;
+        }
+        c.status.count = crstates.count;
+        c.done = c.total;
+        if (sma_report(&c, true) == false) {
+            goto out;
+        }
+        if (crstates.count == 0) {
+            continue;
+        }
+
+        // the left side only depends on the mask, same mask same left candidates
+        if (have_left == false || memcmp(last_mask, c.mask, sizeof(last_mask)) != 0) {
+
+            sma_stage(&c, SMA_STAGE_LEFT, SMA_LEFT_CELLS);
+            sma_run(&c, sma_left_worker);
+            if (c.nomem || c.stop) {
+                goto out;
+            }
+            if (sma_collect(&c, &lstates) == false) {
+                c.nomem = true;
+                goto out;
+            }
+            c.status.count = lstates.count;
+            c.done = c.total;
+            if (sma_report(&c, true) == false) {
+                goto out;
+            }
+
+            clstates.count = 0;
+            if (lstates.count) {
+                lscan.count = 0;
+                if (sma_cset_reserve(&lscan, lstates.count) == false) {
+                    c.nomem = true;
+                    goto out;
+                }
+                for (size_t i = 0; i < lstates.count; i++) {
+                    lscan.state[i] = lstates.v[i] & 0xffffffffffffffULL;
+                    lscan.gc[i] = 0;
+                }
+                lscan.count = lstates.count;
+
+                if (sma_search_gc(&c, false, lstate_before_gc, &lscan, &clstates) == false || c.stop) {
+                    goto out;
+                }
+                c.status.count = clstates.count;
+                c.done = c.total;
+                if (sma_report(&c, true) == false) {
+                    goto out;
+                }
+            }
+
+            memcpy(last_mask, c.mask, sizeof(last_mask));
+            have_left = true;
+        }
+
+        if (clstates.count == 0) {
+            continue;
+        }
+
+        sma_stage(&c, SMA_STAGE_COMBINE, (uint64_t)clstates.count * crstates.count);
+        if (sma_combine(&clstates, &crstates, &gc_cands) == false) {
+            c.nomem = true;
+            goto out;
+        }
+        c.status.count = gc_cands.count;
+        c.done = c.total;
+        if (sma_report(&c, true) == false) {
+            goto out;
+        }
+
+        sma_stage(&c, SMA_STAGE_VERIFY, gc_cands.count);
+        c.cands = gc_cands.v;
+        c.found = false;
+        sma_run(&c, sma_verify_worker);
+        c.cands = NULL;
+
+        if (c.found) {
+            sma_u64_to_bytes(c.key, Gc);
+            c.status.count = 1;
+            c.stop = false;
+            c.done = c.total;
+            sma_report(&c, true);
+            res = SMA_FOUND;
+            goto out;
+        }
+        if (c.nomem || c.stop) {
+            goto out;
+        }
+        c.done = c.total;
+        if (sma_report(&c, true) == false) {
+            goto out;
+        }
+    }
+
+out:
+    if (res != SMA_FOUND) {
+        if (c.nomem) {
+            res = SMA_NOMEM;
+        } else if (c.stop) {
+            res = SMA_ABORTED;
+        }
+    }
+
+    for (int i = 0; i < threads; i++) {
+        free(c.t[i].found.v);
+        sma_cset_free(&c.t[i].a);
+        sma_cset_free(&c.t[i].b);
+        sma_cset_free(&c.t[i].out);
+    }
+    free(c.t);
+    free(rstates.v);
+    free(lstates.v);
+    free(gc_cands.v);
+    sma_cset_free(&crstates);
+    sma_cset_free(&clstates);
+    sma_cset_free(&lscan);
+    pthread_mutex_destroy(&c.report_lock);
+    return res;
+}
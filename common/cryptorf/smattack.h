@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2010, Flavio D. Garcia, Peter van Rossum, Roel Verdult
+// and Ronny Wichers Schreur. Radboud University Nijmegen
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// SecureMemory / CryptoRF key recovery from one authentication, shared by
+// tools/cryptorf/sma_multi and `hf cryptorf recover`
+//-----------------------------------------------------------------------------
+
+#ifndef _SMATTACK_H_
+#define _SMATTACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    SMA_STAGE_RIGHT = 0,        // scanning the 2^25 right states
+    SMA_STAGE_RIGHT_MITM,       // right Gc bits, meet-in-the-middle
+    SMA_STAGE_LEFT,             // scanning the 2^35 left states
+    SMA_STAGE_LEFT_MITM,        // left Gc bits, meet-in-the-middle
+    SMA_STAGE_COMBINE,          // left and right candidates sharing the overlapping Gc bits
+    SMA_STAGE_VERIFY,           // full authentication of every combined candidate
+} sma_stage_t;
+
+typedef struct {
+    sma_stage_t stage;
+    uint64_t done;              // work done in this stage, out of total
+    uint64_t total;
+    uint64_t count;             // states / candidates found so far
+    uint32_t rbits;             // correct bits of the right top bin
+    uint64_t rstate;            // right state in use, from SMA_STAGE_RIGHT_MITM on
+} sma_status_t;
+
+typedef enum {
+    SMA_FOUND = 0,
+    SMA_NOT_FOUND,
+    SMA_ABORTED,
+    SMA_NOMEM,
+} sma_result_t;
+
+// Progress callback, never called from two threads at once.  Every stage
+// reports done == total once when it ends.  Returning false aborts the search.
+typedef bool (*sma_report_t)(const sma_status_t *status, void *ctx);
+
+// Recovers the secret Gc from Ci, Q, Ch and Ci+1 of one authentication.
+sma_result_t sma_recover(const uint8_t *Ci, const uint8_t *Q, const uint8_t *Ch, const uint8_t *Ci_1,
+                         int threads, sma_report_t report, void *ctx, uint8_t *Gc);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // _SMATTACK_H_
@@ -0,0 +1,160 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Hitag2 key check, portable u64 and 128 bit backends and dispatch
+//-----------------------------------------------------------------------------
+#include "hitag2_bs.h"
+
+#include <string.h>
+
+// 64 lanes in a plain uint64_t
+#define HT2_BS_T        uint64_t
+#define HT2_BS_WORDS    1
+#define HT2_BS_SFX      _64
+#include "hitag2_bs_core.h"
+#undef HT2_BS_T
+#undef HT2_BS_WORDS
+#undef HT2_BS_SFX
+
+// 128 lanes, SSE2 on x86_64 and NEON on aarch64 are part of the base instruction set
+typedef uint64_t ht2_bs128_t __attribute__((vector_size(16)));
+#define HT2_BS_T        ht2_bs128_t
+#define HT2_BS_WORDS    2
+#define HT2_BS_SFX      _128
+#include "hitag2_bs_core.h"
+#undef HT2_BS_T
+#undef HT2_BS_WORDS
+#undef HT2_BS_SFX
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+static const ht2_bs_backend_t backend_128 = {
+    .width = 128,
+    .words = 2,
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    .name  = "NEON",
+#else
+    .name  = "SSE2",
+#endif
+    .check = ht2_bs_check_128,
+};
+#define HT2_BS_HAVE_128
+#else
+// elsewhere a 128 bit vector would be emulated, plain u64 is faster
+static const ht2_bs_backend_t backend_u64 = {
+    .width = 64,
+    .words = 1,
+    .name  = "u64",
+    .check = ht2_bs_check_64,
+};
+#endif
+
+static const ht2_bs_backend_t backend_avx2 = {
+    .width = 256,
+    .words = 4,
+    .name  = "AVX2",
+    .check = ht2_bs_check_256,
+};
+
+static const ht2_bs_backend_t backend_avx512 = {
+    .width = 512,
+    .words = 8,
+    .name  = "AVX-512",
+    .check = ht2_bs_check_512,
+};
+
+const ht2_bs_backend_t *ht2_bs_best_backend(void) {
+    static const ht2_bs_backend_t *cached = NULL;
+    if (cached != NULL) {
+        return cached;
+    }
+
+    if (ht2_bs_avx512_supported()) {
+        cached = &backend_avx512;
+    } else if (ht2_bs_avx2_supported()) {
+        cached = &backend_avx2;
+    } else {
+#ifdef HT2_BS_HAVE_128
+        cached = &backend_128;
+#else
+        cached = &backend_u64;
+#endif
+    }
+    return cached;
+}
+
+// in place 64x64 bit matrix transpose, afterwards bit l of a[k] is the old bit k of a[l]
+static void ht2_bs_transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= (m << j)) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+void ht2_bs_transpose_keys(const uint64_t *keys, uint32_t count, int words, uint64_t *kb) {
+
+    for (int w = 0; w < words; w++) {
+
+        uint64_t a[64] = {0};
+        for (uint32_t l = 0; l < 64; l++) {
+            uint32_t idx = (w * 64) + l;
+            if (idx >= count) {
+                break;
+            }
+            a[l] = keys[idx] & 0xFFFFFFFFFFFFULL;
+        }
+
+        ht2_bs_transpose64(a);
+
+        for (int k = 0; k < HT2_BS_KEY_BITS; k++) {
+            kb[(k * words) + w] = a[k];
+        }
+    }
+}
+
+int64_t ht2_bs_find_key(const uint64_t *keys, uint32_t count, uint32_t uid, uint32_t nr, uint32_t ar) {
+
+    const ht2_bs_backend_t *be = ht2_bs_best_backend();
+
+    uint64_t kb[HT2_BS_KEY_BITS * HT2_BS_MAX_WORDS];
+    uint64_t match[HT2_BS_MAX_WORDS];
+
+    for (uint32_t base = 0; base < count; base += be->width) {
+
+        uint32_t n = count - base;
+        if (n > (uint32_t)be->width) {
+            n = be->width;
+        }
+
+        ht2_bs_transpose_keys(keys + base, n, be->words, kb);
+        be->check(kb, uid, nr, ar, match);
+
+        for (int w = 0; w < be->words; w++) {
+            if (match[w] == 0) {
+                continue;
+            }
+            // lanes past n are padding
+            uint32_t lane = (w * 64) + __builtin_ctzll(match[w]);
+            if (lane < n) {
+                return base + lane;
+            }
+            break;
+        }
+    }
+    return -1;
+}
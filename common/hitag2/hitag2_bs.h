@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Hitag2 key check, client side only.
+//
+// Runs the Hitag2 init and the first 32 keystream bits for one key per lane,
+// and tests them against a sniffed nR / aR pair. Backends are picked at runtime:
+// AVX-512 (512 lanes) > AVX2 (256) > SSE2 / NEON (128) > portable u64 (64).
+//
+// Keys use the same layout as the `key` argument of ht2_hitag2_init(),
+// the uid / nR / aR values the same layout as ht2_hitag2_init() and ht2_hitag2_word().
+//-----------------------------------------------------------------------------
+#ifndef __HITAG2_BS_H
+#define __HITAG2_BS_H
+
+#include "common.h"
+
+#define HT2_BS_MAX_WORDS    8   // AVX-512
+#define HT2_BS_KEY_BITS     48
+
+typedef struct ht2_bs_backend_s {
+    int width;      // 64, 128, 256 or 512 keys per call
+    int words;      // width / 64
+    const char *name;
+    // kb holds the keys transposed by ht2_bs_transpose_keys(), HT2_BS_KEY_BITS * words uint64_t.
+    // match_out gets one bit per lane, set when that key produces aR.
+    void (*check)(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out);
+} ht2_bs_backend_t;
+
+// Returns the widest backend the current CPU supports. Never NULL, cached after the first call.
+const ht2_bs_backend_t *ht2_bs_best_backend(void);
+
+// Transposes up to words * 64 keys into bit planes, missing lanes are zero keys.
+void ht2_bs_transpose_keys(const uint64_t *keys, uint32_t count, int words, uint64_t *kb);
+
+// Returns the index of the first key matching uid / nR / aR, or -1 if none does.
+int64_t ht2_bs_find_key(const uint64_t *keys, uint32_t count, uint32_t uid, uint32_t nr, uint32_t ar);
+
+// backend entry points and cpu checks, use ht2_bs_best_backend() instead
+void ht2_bs_check_64(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out);
+void ht2_bs_check_128(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out);
+void ht2_bs_check_256(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out);
+void ht2_bs_check_512(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out);
+bool ht2_bs_avx2_supported(void);
+bool ht2_bs_avx512_supported(void);
+
+#endif
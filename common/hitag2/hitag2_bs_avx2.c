@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Hitag2 key check, AVX2 backend (256 lanes)
+//-----------------------------------------------------------------------------
+#include "hitag2_bs.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+typedef uint64_t ht2_bs256_t __attribute__((vector_size(32)));
+#define HT2_BS_T        ht2_bs256_t
+#define HT2_BS_WORDS    4
+#define HT2_BS_SFX      _256
+#include "hitag2_bs_core.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+bool ht2_bs_avx2_supported(void) {
+    static int cached = -1;
+    if (cached < 0) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+        cached = 0;
+#endif
+    }
+    return cached != 0;
+}
+
+#else // non-x86 build: ht2_bs_avx2_supported returns false and the check never runs
+
+bool ht2_bs_avx2_supported(void) { return false; }
+
+void ht2_bs_check_256(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out) {
+    (void)kb;
+    (void)uid;
+    (void)nr;
+    (void)ar;
+    memset(match_out, 0, 4 * sizeof(uint64_t));
+}
+
+#endif
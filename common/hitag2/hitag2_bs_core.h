@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Lane type independent core of the bitsliced Hitag2 key check.
+//
+// No include guard, every backend includes this once after defining
+//   HT2_BS_T       lane type, uint64_t or a GCC vector of uint64_t
+//   HT2_BS_WORDS   sizeof(HT2_BS_T) / 8
+//   HT2_BS_SFX     suffix of the generated functions, e.g. _64 gives ht2_bs_check_64()
+// Only plain C operators are used on HT2_BS_T, so the compiler picks the
+// instructions from the target options of the including file.
+//
+// The state is kept as a sliding window over s[], s[n + b] being bit b of the
+// state after n shifts, so the shift register never moves any data.
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#define HT2_BS_CAT_(a, b)   a##b
+#define HT2_BS_CAT(a, b)    HT2_BS_CAT_(a, b)
+#define HT2_BS_FN(name)     HT2_BS_CAT(name, HT2_BS_SFX)
+
+// filter sub-functions, inputs LSB first like i4() in hitag2_crypto.c
+#define HT2_BS_FA(a, b, c, d)       (~(((a | b) & c) ^ (a | d) ^ b))
+#define HT2_BS_FB(a, b, c, d)       (~(((d | c) & (a ^ b)) ^ (d | a | b)))
+#define HT2_BS_FC(a, b, c, d, e)    (~((((((c ^ e) | d) & a) ^ b) & (c ^ b)) ^ (((d ^ e) | a) & ((d ^ b) | c))))
+
+static inline HT2_BS_T HT2_BS_FN(ht2_bs_f20)(const HT2_BS_T *x) {
+    const HT2_BS_T f0 = HT2_BS_FA(x[1],  x[2],  x[4],  x[5]);
+    const HT2_BS_T f1 = HT2_BS_FB(x[7],  x[11], x[13], x[14]);
+    const HT2_BS_T f2 = HT2_BS_FB(x[16], x[20], x[22], x[25]);
+    const HT2_BS_T f3 = HT2_BS_FB(x[27], x[28], x[30], x[32]);
+    const HT2_BS_T f4 = HT2_BS_FA(x[33], x[42], x[43], x[45]);
+    return HT2_BS_FC(f0, f1, f2, f3, f4);
+}
+
+static inline bool HT2_BS_FN(ht2_bs_any)(const HT2_BS_T *v) {
+    uint64_t w[HT2_BS_WORDS];
+    memcpy(w, v, sizeof(w));
+    uint64_t r = 0;
+    for (int i = 0; i < HT2_BS_WORDS; i++) {
+        r |= w[i];
+    }
+    return (r != 0);
+}
+
+void HT2_BS_FN(ht2_bs_check)(const uint64_t *kb, uint32_t uid, uint32_t nr, uint32_t ar, uint64_t *match_out) {
+
+    const HT2_BS_T zero = {0};
+    const HT2_BS_T ones = ~zero;
+
+    // 48 bits initial state, 32 init shifts, 32 keystream shifts
+    HT2_BS_T s[48 + 32 + 32];
+
+    // uid in the low 32 bits, key bits 0..15 on top
+    for (int i = 0; i < 32; i++) {
+        s[i] = ((uid >> i) & 1) ? ones : zero;
+    }
+    for (int i = 0; i < 16; i++) {
+        memcpy(&s[32 + i], kb + (i * HT2_BS_WORDS), sizeof(HT2_BS_T));
+    }
+
+    // shift in nR ^ key bits 16..47, each xored with the filter output
+    for (int i = 0; i < 32; i++) {
+        HT2_BS_T k;
+        memcpy(&k, kb + ((16 + i) * HT2_BS_WORDS), sizeof(HT2_BS_T));
+        s[48 + i] = HT2_BS_FN(ht2_bs_f20)(&s[i + 1]) ^ k ^ (((nr >> i) & 1) ? ones : zero);
+    }
+
+    // keystream, first bit is the MSB of aR.  A lane survives while keystream == ~aR
+    HT2_BS_T alive = ones;
+    for (int j = 0; j < 32; j++) {
+        const HT2_BS_T *x = &s[32 + j];
+        s[80 + j] = x[0] ^ x[2] ^ x[3] ^ x[6] ^ x[7] ^ x[8] ^ x[16] ^ x[22]
+                    ^ x[23] ^ x[26] ^ x[30] ^ x[41] ^ x[42] ^ x[43] ^ x[46] ^ x[47];
+
+        alive &= HT2_BS_FN(ht2_bs_f20)(&s[33 + j]) ^ (((ar >> (31 - j)) & 1) ? ones : zero);
+
+        // after a few bits almost every lane is gone
+        if (j >= 7 && (j & 3) == 3 && HT2_BS_FN(ht2_bs_any)(&alive) == false) {
+            break;
+        }
+    }
+
+    memcpy(match_out, &alive, sizeof(HT2_BS_T));
+}
+
+#undef HT2_BS_CAT_
+#undef HT2_BS_CAT
+#undef HT2_BS_FN
+#undef HT2_BS_FA
+#undef HT2_BS_FB
+#undef HT2_BS_FC
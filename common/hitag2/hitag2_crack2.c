@@ -0,0 +1,439 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Hitag2 crack2 table search, see tools/hitag2crack/crack2 for the table itself
+//-----------------------------------------------------------------------------
+#include "hitag2_crack2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "hitag2_crypto.h"
+#include "commonutil.h"
+#include "pm3_cmd.h"
+
+#define HT2_CRACK2_PATH_SIZE    1024
+
+struct ht2_crack2_table_s {
+    bool packed;
+    char path[HT2_CRACK2_PATH_SIZE];        // sorted folder, or the packed file
+    ht2_crack2_packed_bucket_t *index;
+    uint32_t buckets;
+#ifndef _WIN32
+    const uint8_t *map;
+    size_t map_len;
+#endif
+};
+
+// one bucket of entries, mapped or read in
+typedef struct {
+    const uint8_t *data;
+    uint64_t entries;
+    void *release;
+    size_t release_len;
+} ht2_crack2_bucket_t;
+
+static bool ht2_crack2_is_dir(const char *path) {
+    struct stat st;
+    return (stat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR);
+}
+
+static int ht2_crack2_open_packed(ht2_crack2_table_t *t) {
+
+    FILE *f = fopen(t->path, "rb");
+    if (f == NULL) {
+        return PM3_EFILE;
+    }
+
+    ht2_crack2_packed_hdr_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1
+            || memcmp(hdr.magic, HT2_CRACK2_PACKED_MAGIC, sizeof(hdr.magic)) != 0
+            || hdr.buckets == 0 || hdr.buckets > 0x10000) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    t->index = calloc(hdr.buckets, sizeof(ht2_crack2_packed_bucket_t));
+    if (t->index == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+    if (fread(t->index, sizeof(ht2_crack2_packed_bucket_t), hdr.buckets, f) != hdr.buckets) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+    t->buckets = hdr.buckets;
+
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+#ifdef _WIN32
+    uint64_t fsize = _ftelli64(f);
+#else
+    uint64_t fsize = ftello(f);
+#endif
+    fclose(f);
+
+    // sorted, and every bucket inside the file
+    uint64_t data_start = sizeof(hdr) + ((uint64_t)hdr.buckets * sizeof(ht2_crack2_packed_bucket_t));
+    for (uint32_t i = 0; i < t->buckets; i++) {
+        const ht2_crack2_packed_bucket_t *b = &t->index[i];
+        if (b->prefix > 0xFFFF || (i && b->prefix <= t->index[i - 1].prefix)) {
+            return PM3_EFILE;
+        }
+        if (b->offset < data_start || b->entries > (fsize / HT2_CRACK2_ENTRY_SIZE)
+                || b->offset + (b->entries * HT2_CRACK2_ENTRY_SIZE) > fsize) {
+            return PM3_EFILE;
+        }
+    }
+
+#ifndef _WIN32
+    if (fsize > SIZE_MAX) {
+        return PM3_EFILE;
+    }
+
+    int fd = open(t->path, O_RDONLY);
+    if (fd < 0) {
+        return PM3_EFILE;
+    }
+    void *map = mmap(NULL, (size_t)fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return PM3_EFILE;
+    }
+    // lookups jump all over the file
+    madvise(map, (size_t)fsize, MADV_RANDOM);
+    t->map = map;
+    t->map_len = (size_t)fsize;
+#endif
+    return PM3_SUCCESS;
+}
+
+int ht2_crack2_table_open(const char *path, ht2_crack2_table_t **table) {
+
+    *table = NULL;
+
+    ht2_crack2_table_t *t = calloc(1, sizeof(ht2_crack2_table_t));
+    if (t == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    int res = PM3_SUCCESS;
+    if (ht2_crack2_is_dir(path)) {
+        // the folder holding sorted/ works as well
+        char sub[HT2_CRACK2_PATH_SIZE];
+        snprintf(sub, sizeof(sub), "%s/sorted", path);
+        if (ht2_crack2_is_dir(sub)) {
+            path = sub;
+        }
+        if (strlen(path) >= sizeof(t->path) - 16) {
+            res = PM3_EFILE;
+        } else {
+            snprintf(t->path, sizeof(t->path), "%s", path);
+        }
+    } else {
+        t->packed = true;
+        if (strlen(path) >= sizeof(t->path)) {
+            res = PM3_EFILE;
+        } else {
+            snprintf(t->path, sizeof(t->path), "%s", path);
+            res = ht2_crack2_open_packed(t);
+        }
+    }
+
+    if (res != PM3_SUCCESS) {
+        ht2_crack2_table_close(t);
+        return res;
+    }
+
+    *table = t;
+    return PM3_SUCCESS;
+}
+
+void ht2_crack2_table_close(ht2_crack2_table_t *table) {
+    if (table == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (table->map) {
+        munmap((void *)table->map, table->map_len);
+    }
+#endif
+    free(table->index);
+    free(table);
+}
+
+bool ht2_crack2_table_is_packed(const ht2_crack2_table_t *table) {
+    return table->packed;
+}
+
+static const ht2_crack2_packed_bucket_t *ht2_crack2_find_bucket(const ht2_crack2_table_t *t, uint32_t prefix) {
+    uint32_t lo = 0, hi = t->buckets;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (t->index[mid].prefix < prefix) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < t->buckets && t->index[lo].prefix == prefix) {
+        return &t->index[lo];
+    }
+    return NULL;
+}
+
+#ifdef _WIN32
+// reads `len` bytes at `offset` of a file into a new buffer, no mmap on Windows
+static int ht2_crack2_read_range(const char *fn, uint64_t offset, uint64_t len, ht2_crack2_bucket_t *bk) {
+
+    FILE *f = fopen(fn, "rb");
+    if (f == NULL) {
+        return PM3_EFILE;
+    }
+
+    if (len == UINT64_MAX) {
+        fseek(f, 0, SEEK_END);
+        long end = ftell(f);
+        if (end < 0) {
+            fclose(f);
+            return PM3_EFILE;
+        }
+        len = (uint64_t)end;
+    }
+
+    if (len > SIZE_MAX) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    uint8_t *buf = malloc(len ? (size_t)len : 1);
+    if (buf == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+    if (_fseeki64(f, (int64_t)offset, SEEK_SET) != 0 || fread(buf, 1, (size_t)len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return PM3_EFILE;
+    }
+    fclose(f);
+
+    bk->data = buf;
+    bk->entries = len / HT2_CRACK2_ENTRY_SIZE;
+    bk->release = buf;
+    bk->release_len = 0;
+    return PM3_SUCCESS;
+}
+#endif
+
+static int ht2_crack2_bucket_get(const ht2_crack2_table_t *t, uint8_t b0, uint8_t b1, ht2_crack2_bucket_t *bk) {
+
+    memset(bk, 0, sizeof(ht2_crack2_bucket_t));
+
+    if (t->packed) {
+        const ht2_crack2_packed_bucket_t *b = ht2_crack2_find_bucket(t, ((uint32_t)b0 << 8) | b1);
+        if (b == NULL || b->entries == 0) {
+            return PM3_SUCCESS;
+        }
+#ifndef _WIN32
+        bk->data = t->map + b->offset;
+        bk->entries = b->entries;
+        return PM3_SUCCESS;
+#else
+        return ht2_crack2_read_range(t->path, b->offset, b->entries * HT2_CRACK2_ENTRY_SIZE, bk);
+#endif
+    }
+
+    char fn[HT2_CRACK2_PATH_SIZE + 16];
+    snprintf(fn, sizeof(fn), "%s/%02x/%02x.bin", t->path, b0, b1);
+
+    struct stat st;
+    if (stat(fn, &st) != 0) {
+        // a partial table simply has no match here
+        return PM3_SUCCESS;
+    }
+    if (st.st_size == 0) {
+        return PM3_SUCCESS;
+    }
+
+#ifndef _WIN32
+    int fd = open(fn, O_RDONLY);
+    if (fd < 0) {
+        return PM3_EFILE;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return PM3_EFILE;
+    }
+    bk->data = map;
+    bk->entries = st.st_size / HT2_CRACK2_ENTRY_SIZE;
+    bk->release = map;
+    bk->release_len = st.st_size;
+    return PM3_SUCCESS;
+#else
+    return ht2_crack2_read_range(fn, 0, UINT64_MAX, bk);
+#endif
+}
+
+static void ht2_crack2_bucket_put(ht2_crack2_bucket_t *bk) {
+    if (bk->release == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (bk->release_len) {
+        munmap(bk->release, bk->release_len);
+        return;
+    }
+#endif
+    free(bk->release);
+}
+
+// the lfsr of ht2_hitag2_nstep() for a given shift register
+static uint64_t ht2_crack2_lfsr(uint64_t state) {
+    uint64_t temp = state ^ (state >> 1);
+    return state ^ (state >>  6) ^ (state >> 16)
+           ^ (state >> 26) ^ (state >> 30) ^ (state >> 41)
+           ^ (temp >>  2) ^ (temp >>  7) ^ (temp >> 22)
+           ^ (temp >> 42) ^ (temp >> 46);
+}
+
+// 48 keystream bits starting at a bit offset
+static void ht2_crack2_bits(const uint8_t *ks, uint32_t bitoffset, uint8_t *out) {
+    uint32_t bytenum = bitoffset / 8;
+    uint8_t bitnum = bitoffset % 8;
+    for (int i = 0; i < 6; i++) {
+        if (bitnum == 0) {
+            out[i] = ks[bytenum + i];
+        } else {
+            out[i] = (ks[bytenum + i] << bitnum) | (ks[bytenum + i + 1] >> (8 - bitnum));
+        }
+    }
+}
+
+// runs a candidate state 48 bits forward, or back, and compares the next 48 keystream bits
+static bool ht2_crack2_test(const uint8_t *entry, const uint8_t *expect, bool fwd) {
+
+    hitag_state_t hs;
+    hs.shiftreg = 0;
+    for (int i = 0; i < 6; i++) {
+        hs.shiftreg = (hs.shiftreg << 8) | entry[i + 4];
+    }
+    hs.lfsr = ht2_crack2_lfsr(hs.shiftreg);
+
+    if (fwd) {
+        ht2_hitag2_nstep(&hs, 48);
+    } else {
+        ht2_rollback(&hs, 48);
+        hs.lfsr = ht2_crack2_lfsr(hs.shiftreg);
+    }
+
+    uint32_t ks1 = ht2_hitag2_nstep(&hs, 24);
+    uint32_t ks2 = ht2_hitag2_nstep(&hs, 24);
+
+    uint8_t got[6] = {
+        (ks1 >> 16) & 0xFF, (ks1 >> 8) & 0xFF, ks1 & 0xFF,
+        (ks2 >> 16) & 0xFF, (ks2 >> 8) & 0xFF, ks2 & 0xFF,
+    };
+    return (memcmp(got, expect, sizeof(got)) == 0);
+}
+
+int ht2_crack2_search(ht2_crack2_table_t *table, const uint8_t *ks, size_t kslen, uint32_t bitoffset, uint64_t *state) {
+
+    uint64_t bitlen = (uint64_t)kslen * 8;
+    if (bitlen < 96 || bitoffset > bitlen - 48) {
+        return PM3_ENODATA;
+    }
+
+    uint8_t cand[6], expect[6];
+    ht2_crack2_bits(ks, bitoffset, cand);
+
+    bool fwd = (bitoffset < bitlen - 96);
+    ht2_crack2_bits(ks, fwd ? bitoffset + 48 : bitoffset - 48, expect);
+
+    ht2_crack2_bucket_t bk;
+    int res = ht2_crack2_bucket_get(table, cand[0], cand[1], &bk);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    // lower bound on the four keystream bytes, then every entry sharing them
+    uint64_t lo = 0, hi = bk.entries;
+    while (lo < hi) {
+        uint64_t mid = lo + ((hi - lo) / 2);
+        if (memcmp(bk.data + (mid * HT2_CRACK2_ENTRY_SIZE), cand + 2, 4) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    res = PM3_ENODATA;
+    for (uint64_t i = lo; i < bk.entries; i++) {
+        const uint8_t *e = bk.data + (i * HT2_CRACK2_ENTRY_SIZE);
+        if (memcmp(e, cand + 2, 4) != 0) {
+            break;
+        }
+        if (ht2_crack2_test(e, expect, fwd)) {
+            *state = bytes_to_num(e + 4, 6);
+            res = PM3_SUCCESS;
+            break;
+        }
+    }
+
+    ht2_crack2_bucket_put(&bk);
+    return res;
+}
+
+void ht2_crack2_recover_key(uint64_t state, uint32_t bitoffset, const uint8_t *uid, const uint8_t *nrenc, uint8_t *key) {
+
+    hitag_state_t hs;
+    hs.shiftreg = state;
+    hs.lfsr = ht2_crack2_lfsr(state);
+
+    // back to the start of the keystream, then through the authentication (aR, page 3)
+    ht2_rollback(&hs, bitoffset);
+    ht2_rollback(&hs, 64);
+
+    // the key layout of ht2_hitag2_init(), uid and nR bit reversed
+    uint32_t u = REV32(MemLeToUint4byte(uid));
+    uint32_t nr = REV32(MemLeToUint4byte(nrenc));
+
+    // lower 16 key bits are the low state bits, the rest is nR ^ key under the uid
+    uint64_t k = hs.shiftreg & 0xFFFF;
+    uint32_t nrxork = (hs.shiftreg >> 16) & 0xFFFFFFFF;
+
+    uint32_t b = 0;
+    for (int i = 0; i < 32; i++) {
+        hs.shiftreg = (hs.shiftreg << 1) | ((u >> (31 - i)) & 1);
+        b = (b << 1) | (uint32_t)ht2_fnf(hs.shiftreg);
+    }
+
+    k |= (uint64_t)(nrxork ^ nr ^ b) << 16;
+    k = REV64(k);
+
+    for (int i = 0; i < 6; i++) {
+        key[i] = (k >> (i * 8)) & 0xFF;
+    }
+}
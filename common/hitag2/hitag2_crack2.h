@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Hitag2 crack2 table search, client side only.
+//
+// Same lookup as tools/hitag2crack/crack2/ht2crack2search, on a table built by
+// ht2crack2buildtable.  Two layouts are understood:
+//  - the `sorted/` folder, 65536 files sorted/XX/YY.bin, XX YY the first two keystream bytes
+//  - a single packed file made by ht2crack2packtable, mapped once
+// Each entry is 4 keystream bytes followed by the 6 byte PRNG state, sorted by memcmp.
+//
+// All lookups are read only and may run from several threads on the same table.
+//-----------------------------------------------------------------------------
+#ifndef __HITAG2_CRACK2_H
+#define __HITAG2_CRACK2_H
+
+#include "common.h"
+
+#define HT2_CRACK2_ENTRY_SIZE       10
+#define HT2_CRACK2_PACKED_MAGIC     "HT2C2TB1"
+
+// packed file: header, bucket index sorted by prefix, then the entries.  Little endian.
+typedef struct {
+    uint8_t magic[8];
+    uint32_t buckets;
+    uint32_t reserved;
+} PACKED ht2_crack2_packed_hdr_t;
+
+typedef struct {
+    uint32_t prefix;        // first two keystream bytes, big endian
+    uint32_t reserved;
+    uint64_t offset;        // from the start of the file
+    uint64_t entries;
+} PACKED ht2_crack2_packed_bucket_t;
+
+typedef struct ht2_crack2_table_s ht2_crack2_table_t;
+
+// Opens a `sorted/` folder, its parent, or a packed file.  PM3_SUCCESS, PM3_EFILE or PM3_EMALLOC.
+int ht2_crack2_table_open(const char *path, ht2_crack2_table_t **table);
+void ht2_crack2_table_close(ht2_crack2_table_t *table);
+bool ht2_crack2_table_is_packed(const ht2_crack2_table_t *table);
+
+// Looks up the 48 keystream bits at bitoffset and confirms the match on the 48 bits
+// after it (or before it, near the end).  kslen is in bytes.
+// PM3_SUCCESS with the PRNG state of the match, PM3_ENODATA, or PM3_EFILE on a table read error.
+int ht2_crack2_search(ht2_crack2_table_t *table, const uint8_t *ks, size_t kslen, uint32_t bitoffset, uint64_t *state);
+
+// Rolls a matched state back through the keystream and the authentication and
+// recovers the key.  uid and nR (encrypted) as sent on air, key in the `lf hitag` byte order.
+void ht2_crack2_recover_key(uint64_t state, uint32_t bitoffset, const uint8_t *uid, const uint8_t *nrenc, uint8_t *key);
+
+#endif
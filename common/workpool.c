@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Worker threads sharing a range of work items
+//-----------------------------------------------------------------------------
+#include "workpool.h"
+
+static void *workpool_thread(void *arg) {
+    workpool_slot_t *slot = arg;
+    void *res = slot->wp->worker(slot->arg);
+    __atomic_sub_fetch(&slot->wp->running, 1, __ATOMIC_SEQ_CST);
+    return res;
+}
+
+int workpool_start(workpool_t *wp, int threads, uint64_t total, void *(*worker)(void *), void *args, size_t argsize) {
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > WORKPOOL_MAX_THREADS) {
+        threads = WORKPOOL_MAX_THREADS;
+    }
+
+    wp->next = 0;
+    wp->total = total;
+    wp->stop = false;
+    wp->started = 0;
+    wp->worker = worker;
+    // counted before they start, so workpool_running() can't see zero while they come up
+    wp->running = threads;
+
+    for (int i = 0; i < threads; i++) {
+        wp->slots[i].wp = wp;
+        wp->slots[i].arg = (uint8_t *)args + (i * argsize);
+        if (pthread_create(&wp->tids[i], NULL, workpool_thread, &wp->slots[i]) != 0) {
+            break;
+        }
+        wp->started++;
+    }
+    __atomic_sub_fetch(&wp->running, threads - wp->started, __ATOMIC_SEQ_CST);
+
+    // no thread at all, do the work here
+    if (wp->started == 0) {
+        __atomic_store_n(&wp->running, 1, __ATOMIC_SEQ_CST);
+        workpool_thread(&wp->slots[0]);
+    }
+    return wp->started;
+}
+
+void workpool_join(workpool_t *wp) {
+    for (int i = 0; i < wp->started; i++) {
+        pthread_join(wp->tids[i], NULL);
+    }
+    wp->started = 0;
+}
+
+int workpool_run(workpool_t *wp, int threads, uint64_t total, void *(*worker)(void *), void *args, size_t argsize) {
+    int started = workpool_start(wp, threads, total, worker, args, argsize);
+    workpool_join(wp);
+    return started;
+}
+
+bool workpool_claim(workpool_t *wp, uint64_t chunk, uint64_t *start, uint64_t *end) {
+    if (__atomic_load_n(&wp->stop, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    uint64_t s = __atomic_fetch_add(&wp->next, chunk, __ATOMIC_SEQ_CST);
+    if (s >= wp->total) {
+        return false;
+    }
+    *start = s;
+    *end = (s + chunk > wp->total) ? wp->total : s + chunk;
+    return true;
+}
+
+void workpool_stop(workpool_t *wp) {
+    __atomic_store_n(&wp->stop, true, __ATOMIC_SEQ_CST);
+}
+
+bool workpool_stopped(workpool_t *wp) {
+    return __atomic_load_n(&wp->stop, __ATOMIC_SEQ_CST);
+}
+
+bool workpool_running(workpool_t *wp) {
+    return __atomic_load_n(&wp->running, __ATOMIC_SEQ_CST) != 0;
+}
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Worker threads sharing a range of work items
+//-----------------------------------------------------------------------------
+
+#ifndef WORKPOOL_H__
+#define WORKPOOL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define WORKPOOL_MAX_THREADS    256
+
+typedef struct workpool_s workpool_t;
+
+typedef struct {
+    workpool_t *wp;
+    void *arg;
+} workpool_slot_t;
+
+struct workpool_s {
+    uint64_t next;          // next work item to hand out
+    uint64_t total;
+    uint32_t running;       // workers not done yet
+    bool stop;
+    int started;
+    void *(*worker)(void *);
+    pthread_t tids[WORKPOOL_MAX_THREADS];
+    workpool_slot_t slots[WORKPOOL_MAX_THREADS];
+};
+
+// Starts `threads` workers on `total` work items, which they take with workpool_claim().
+// Each worker gets `args`, or args + i * argsize when argsize isn't 0.
+// If no thread can be started the work is done on the calling thread before this returns.
+// Returns the number of threads started.
+int workpool_start(workpool_t *wp, int threads, uint64_t total, void *(*worker)(void *), void *args, size_t argsize);
+void workpool_join(workpool_t *wp);
+// start and wait for the workers
+int workpool_run(workpool_t *wp, int threads, uint64_t total, void *(*worker)(void *), void *args, size_t argsize);
+
+// claims the next `chunk` items as [start, end), false when all are handed out or the pool is stopped
+bool workpool_claim(workpool_t *wp, uint64_t chunk, uint64_t *start, uint64_t *end);
+void workpool_stop(workpool_t *wp);
+bool workpool_stopped(workpool_t *wp);
+bool workpool_running(workpool_t *wp);
+
+#endif
@@ -102,8 +102,9 @@ typedef enum ISO14A_COMMAND {
     ISO14A_TOPAZMODE = (1 << 8),
     ISO14A_NO_RATS = (1 << 9),
     ISO14A_SEND_CHAINING = (1 << 10),
-    // 11, 12 were used for ECP & MAGSAFE, but they were generalized into CUSTOM_POLLING
-    // In case there is a need to add a new flag, feel free to use those indices
+    ISO14A_APDU_QUEUED = (1 << 11),
+    // 12 was used for MAGSAFE (and 11 for ECP), but they were generalized into CUSTOM_POLLING
+    // In case there is a need to add a new flag, feel free to use this index
     ISO14A_USE_CUSTOM_POLLING = (1 << 13),
     ISO14A_CRYPTO1MODE = (1 << 14),
     ISO14A_SET_WAIT_US = (1 << 15),
@@ -376,6 +376,21 @@ typedef struct {
     uint8_t key[6];
 } PACKED mfc_eload_t;
 
+// whole card read, key A and B of sector 0 .. sectorcnt-1
+typedef struct {
+    uint8_t sectorcnt;
+    uint8_t keya[40][6];
+    uint8_t keyb[40][6];
+} PACKED mf_dump_t;
+
+// one sector of a whole card read, bit n of readmask is set when block n was read
+typedef struct {
+    uint8_t sector;
+    uint8_t blockcnt;
+    uint16_t readmask;
+    uint8_t data[16 * 16];
+} PACKED mf_dump_sector_t;
+
 typedef struct {
     uint16_t turn_off_field : 1;
     uint16_t try_auth : 1;
@@ -539,6 +554,7 @@ typedef struct {
 #define CMD_BREAK_LOOP 0x0118
 #define CMD_SET_TEAROFF 0x0119
 #define CMD_SET_HF_FIELD_TIMEOUT 0x011A
+#define CMD_BENCH 0x011B  // accepts any payload, empty reply. For `hw bench` upload tests
 #define CMD_GET_DBGMODE 0x0120
 
 // RDV40, Flash memory operations
@@ -823,6 +839,7 @@ typedef struct {
 #define CMD_HF_MIFARE_READBL_EX 0x0628
 #define CMD_HF_MIFAREU_READBL 0x0720
 #define CMD_HF_MIFARE_READSC 0x0621
+#define CMD_HF_MIFARE_DUMP 0x062A
 #define CMD_HF_MIFAREU_READCARD 0x0721
 #define CMD_HF_MIFARE_WRITEBL 0x0622
 #define CMD_HF_MIFARE_WRITEBL_EX 0x0629
@@ -0,0 +1,139 @@
+/*
+ * ht2crack2packtable.c
+ * this packs the sorted/ directory tree made by ht2crack2buildtable into a single
+ * file, so the client (lf hitag crack2 --table) can map the whole table at once
+ * instead of opening one of the 65536 bucket files per lookup.
+ *
+ * layout, little endian:
+ *   "HT2C2TB1", uint32 buckets, uint32 reserved
+ *   buckets x { uint32 prefix, uint32 reserved, uint64 offset, uint64 entries }
+ *   the entries of every bucket, as in sorted/XX/YY.bin
+ */
+
+#include "ht2crackutils.h"
+
+#define INPUTFILE "%s/%02x/%02x.bin"
+#define DATASIZE 10
+#define MAGIC "HT2C2TB1"
+#define HDRSIZE 16
+#define IDXSIZE 24
+
+static void putle(unsigned char *buf, uint64_t val, int len) {
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = (val >> (i * 8)) & 0xff;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    char file[1024];
+    struct stat filestat;
+    uint64_t *sizes;
+    uint32_t buckets = 0;
+    uint64_t offset;
+    unsigned char hdr[HDRSIZE];
+    unsigned char idx[IDXSIZE];
+    unsigned char *buf;
+    int i;
+
+    if (argc < 3) {
+        printf("%s sorted_dir outfile\n", argv[0]);
+        exit(1);
+    }
+
+    sizes = (uint64_t *)calloc(0x10000, sizeof(uint64_t));
+    buf = (unsigned char *)calloc(1, 1024 * 1024);
+    if (!sizes || !buf) {
+        printf("cannot calloc\n");
+        exit(1);
+    }
+
+    // find the non empty buckets
+    for (i = 0; i < 0x10000; i++) {
+        snprintf(file, sizeof(file), INPUTFILE, argv[1], i >> 8, i & 0xff);
+        if (stat(file, &filestat)) {
+            continue;
+        }
+        if ((filestat.st_size % DATASIZE) != 0) {
+            printf("file %s is not a multiple of %d bytes\n", file, DATASIZE);
+            exit(1);
+        }
+        sizes[i] = filestat.st_size;
+        if (sizes[i]) {
+            buckets++;
+        }
+    }
+
+    if (!buckets) {
+        printf("no table files found in %s\n", argv[1]);
+        exit(1);
+    }
+
+    FILE *fp = fopen(argv[2], "wb");
+    if (!fp) {
+        printf("cannot open file '%s' for writing\n", argv[2]);
+        exit(1);
+    }
+
+    memcpy(hdr, MAGIC, 8);
+    putle(hdr + 8, buckets, 4);
+    putle(hdr + 12, 0, 4);
+    if (fwrite(hdr, 1, HDRSIZE, fp) != HDRSIZE) {
+        printf("cannot write header\n");
+        exit(1);
+    }
+
+    offset = HDRSIZE + ((uint64_t)buckets * IDXSIZE);
+    for (i = 0; i < 0x10000; i++) {
+        if (!sizes[i]) {
+            continue;
+        }
+        putle(idx, i, 4);
+        putle(idx + 4, 0, 4);
+        putle(idx + 8, offset, 8);
+        putle(idx + 16, sizes[i] / DATASIZE, 8);
+        if (fwrite(idx, 1, IDXSIZE, fp) != IDXSIZE) {
+            printf("cannot write index\n");
+            exit(1);
+        }
+        offset += sizes[i];
+    }
+
+    for (i = 0; i < 0x10000; i++) {
+        if (!sizes[i]) {
+            continue;
+        }
+
+        printf("packing bytes 0x%02x/0x%02x\n", i >> 8, i & 0xff);
+
+        snprintf(file, sizeof(file), INPUTFILE, argv[1], i >> 8, i & 0xff);
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            printf("cannot open file %s\n", file);
+            exit(1);
+        }
+
+        uint64_t left = sizes[i];
+        while (left) {
+            size_t n = (left > (1024 * 1024)) ? (1024 * 1024) : left;
+            if (fread(buf, 1, n, in) != n) {
+                printf("cannot read file %s\n", file);
+                exit(1);
+            }
+            if (fwrite(buf, 1, n, fp) != n) {
+                printf("cannot write file %s\n", argv[2]);
+                exit(1);
+            }
+            left -= n;
+        }
+        fclose(in);
+    }
+
+    fclose(fp);
+    free(buf);
+    free(sizes);
+
+    printf("packed %u buckets into %s\n", buckets, argv[2]);
+    return 0;
+}
@@ -386,6 +386,7 @@ while true; do
       if ! CheckFileExist "ht2crack2gentest exists"        "$HT2CRACK2PATH/ht2crack2gentest"; then break; fi
       if ! CheckFileExist "ht2crack2search exists"         "$HT2CRACK2PATH/ht2crack2search"; then break; fi
       if ! CheckFileExist "ht2crack2search_multi exists"   "$HT2CRACK2PATH/ht2crack2search_multi"; then break; fi
+      if ! CheckFileExist "ht2crack2packtable exists"      "$HT2CRACK2PATH/ht2crack2packtable"; then break; fi
       # 1.5Tb tables are supposed to be absent, so it's just a fast check without real cracking
       if ! CheckExecute "ht2crack2 quick test"             "cd $HT2CRACK2PATH; ./ht2crack2gentest 1 && ./runalltests.sh; rm keystream*" "searching on bit"; then break; fi
 
@@ -443,6 +444,7 @@ while true; do
       if ! CheckExecute "proxmark help text ISO7816"       "$CLIENTBIN -t 2>&1" "ISO7816"; then break; fi
       if ! CheckExecute "proxmark help text hardnested"    "$CLIENTBIN -t 2>&1" "hardnested"; then break; fi
       if ! CheckExecute "proxmark full help dump"          "$CLIENTBIN --fulltext 2>&1" "Full help dump done"; then break; fi
+      if ! CheckExecute "proxmark help search"             "$CLIENTBIN -c 'help amiibo'" "hf mfu amiibo"; then break; fi
       if ! CheckExecute "proxmark multi cmds 1/2"          "$CLIENTBIN -c 'rem foo;rem bar'" "remark: foo"; then break; fi
       if ! CheckExecute "proxmark multi cmds 2/2"          "$CLIENTBIN -c 'rem foo;rem bar'" "remark: bar"; then break; fi
       if ! CheckExecute "proxmark multi stdin 1/4"         "echo 'rem foo;rem bar;quit' |$CLIENTBIN" "remark: foo"; then break; fi
@@ -453,6 +455,7 @@ while true; do
       echo -e "\n${C_BLUE}Testing scripts:${C_NC}"
       if ! CheckExecute "script run cmdscript"             "$CLIENTBIN -c 'script run example.cmd'" "remark: world"; then break; fi
       if ! CheckExecute "script run luascript"             "$CLIENTBIN -c 'script run data_hex_crc -d 010203040506070809'" "CDMA2000.*7B02"; then break; fi
+      if ! CheckExecute "script run persistent luascript"  "$CLIENTBIN -c 'prefs set script.persist --on;script run data_hex_crc -d 0102030405;script run data_hex_crc -d 0102;prefs set script.persist --off'" "CDMA2000.*3600"; then break; fi
 
       CheckExecute ignore "check Python support"        "$CLIENTBIN -c 'hw version'" "Python script.*present"
       if [ $RESULT -eq 0 ]; then
@@ -463,6 +466,7 @@ while true; do
       if ! CheckExecute "reveng readline test"    "$CLIENTBIN -c 'reveng -h;reveng -D'" "CRC-64/GO-ISO"; then break; fi
       if ! CheckExecute "reveng -g test"          "$CLIENTBIN -c 'reveng -g abda202c'" "CRC-16/ISO-IEC-14443-3-A"; then break; fi
       if ! CheckExecute "reveng -w test"          "$CLIENTBIN -c 'reveng -w 8 -s 01020304e3 010204039d'" "CRC-8/SMBUS"; then break; fi
+      if ! CheckExecute "reveng -F search test"   "$CLIENTBIN -c 'reveng -w 24 -F -s 3132333435363738d201f5 0102030405aad18e4a 55aa1234deadbeef5c8a1d'" "poly=0x328b63  init=0xffffff"; then break; fi
       if ! CheckExecute "data qrcode ascii test"  "$CLIENTBIN -c 'data qrcode -d aa --ascii'" "##"; then break; fi
       if ! CheckExecute "data qrcode repeated -d" "$CLIENTBIN -c 'data qrcode -d aa -d bb' 2>&1" "excess option -d\\|--data"; then break; fi
       if ! CheckExecute "data qrcode invalid hex" "$CLIENTBIN -c 'data qrcode -d zz' 2>&1" "QR data must contain only hex characters"; then break; fi
@@ -470,10 +474,16 @@ while true; do
       if ! CheckExecute "data qrcode spaced hex"  "$CLIENTBIN -c 'data qrcode -d \"aa bb\"' 2>&1" "Spaces are not supported; encode a space byte as 20"; then break; fi
       if ! CheckExecute "mfu pwdgen test"         "$CLIENTBIN -c 'hf mfu pwdgen --test'" "Selftest ok"; then break; fi
       if ! CheckExecute "mfu keygen test"         "$CLIENTBIN -c 'hf mfu keygen --uid 11223344556677'" "80 B1 C2 71 D8 A0"; then break; fi
+      if ! CheckExecute "mfu amiibo batch test"   "$CLIENTBIN -c 'hf mfu amiibo -d traces/amiibo'" "Signature ok........... 3"; then break; fi
       if ! CheckExecute "jooki encode test"       "$CLIENTBIN -c 'hf jooki encode --test'" "04 28 F4 DA F0 4A 81  \( ok \)"; then break; fi
       if ! CheckExecute "analyse regex selftest"  "$CLIENTBIN -c 'analyse regex --test'" "Tests \( ok \)"; then break; fi
+      if ! CheckExecute "analyse nuid selftest"   "$CLIENTBIN -c 'analyse nuid --test'" "040D681AB52281 -> 8F 43 0F EF  \( ok \)"; then break; fi
       if ! CheckExecute "trace load/list 14a"     "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a;'" "READBLOCK\(8\)"; then break; fi
       if ! CheckExecute "trace load/list x"       "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -x1 -t 14a;'" "0.0101840425"; then break; fi
+      if ! CheckExecute "trace indexed save/append" "rm -f /tmp/pm3_tests_idx.trace; $CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace save -f /tmp/pm3_tests_idx --idx; trace load -f /tmp/pm3_tests_idx.trace; trace save -f /tmp/pm3_tests_idx --append; trace load -f /tmp/pm3_tests_idx.trace;'" "44 frames in 2 session"; then break; fi
+      if ! CheckExecute "trace list frame range"  "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a --first 4 --count 2;'" "851324 \|     854844 \| Tag \|04  DA  17"; then break; fi
+      if ! CheckExecute "trace list time window"  "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a --from 800000 --to 900000;'" "839624 \|     850152 \| Rdr \|93  70"; then break; fi
+      if ! CheckExecute "trace pcapng round trip" "rm -f /tmp/pm3_tests_rt.*; $CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace save -f /tmp/pm3_tests_rt --pcapng; trace list -1 -t 14a;' | grep -E 'Rdr|Tag' | cut -d'|' -f1,3- > /tmp/pm3_tests_rt.a; $CLIENTBIN -c 'trace load -f /tmp/pm3_tests_rt.pcapng; trace list -1 -t 14a;' | grep -E 'Rdr|Tag' | cut -d'|' -f1,3- > /tmp/pm3_tests_rt.b; diff /tmp/pm3_tests_rt.a /tmp/pm3_tests_rt.b && grep -c READBLOCK /tmp/pm3_tests_rt.b" "^5$"; then break; fi
       if ! CheckExecute "nfc decode test oob"             "$CLIENTBIN -c 'nfc decode -d DA2010016170706C69636174696F6E2F766E642E626C7565746F6F74682E65702E6F6F62301000649201B96DFB0709466C65782032'" "Flex 2"; then break; fi
       if ! CheckExecute "nfc decode test device info"     "$CLIENTBIN -c 'nfc decode -d d1025744690004536f6e79010752432d533338300220426c61636b204e46432052656164657220636f6e6e656374656420746f2050430310123e4567e89b12d3a45642665544000004124e464320506f72742d3130302076312e3032'" "NFC Port-100 v1.02"; then break; fi
       if ! CheckExecute "nfc decode test vcard"           "$CLIENTBIN -c 'nfc decode -d d20ca3746578742f782d7643617264424547494e3a56434152440a56455253494f4e3a332e300a4e3a43687269733b4963656d616e3b3b3b0a464e3a476f7468656e627572670a5245563a323032312d30362d32345432303a31353a30385a0a6974656d322e582d4142444154453b747970653d707265663a323032302d30362d32340a4954454d322e582d41424c4142454c3a5f24213c416e6e69766572736172793e21245f0a454e443a56434152440a'" "END:VCARD"; then break; fi
@@ -529,6 +539,9 @@ while true; do
       if ! CheckExecute "lf FDX/BioThermo test"      "$CLIENTBIN -c 'data load -f traces/lf_FDXB_Bio-Thermo.pm3; lf fdxb demod'" "95.2 F / 35.1 C"; then break; fi
       if ! CheckExecute "lf GPROXII test"            "$CLIENTBIN -c 'data load -f traces/lf_GProx_36_30_14489.pm3; lf search -1'" "Guardall G-Prox II ID found"; then break; fi
       if ! CheckExecute "lf HID Prox test"           "$CLIENTBIN -c 'data load -f traces/lf_HID-proxCardII-05512-11432784-1.pm3;lf search -1'" "HID Prox ID found"; then break; fi
+      if ! CheckExecute "lf Hitag2 lookup test"      "$CLIENTBIN -c 'lf hitag lookup --uid 11223344 --nr 73AA5A62 --ar 8039693D'" "Found valid key \[ 4F4E4D494B52 \]"; then break; fi
+      if ! CheckExecute "lf Hitag2 crack2 packed table test" "$CLIENTBIN -c 'lf hitag crack2 -f traces/hitag2/crack2_keystream.txt --uid 49435769 --nrar 656E4572 --table traces/hitag2/crack2_table.bin'" "Found key \[ 4F4E4D494B52 \]"; then break; fi
+      if ! CheckExecute "lf Hitag2 crack2 sorted table test" "$CLIENTBIN -c 'lf hitag crack2 -f traces/hitag2/crack2_keystream.txt --uid 49435769 --nrar 656E4572 --table traces/hitag2'" "Found key \[ 4F4E4D494B52 \]"; then break; fi
       if ! CheckExecute "lf IDTECK test"             "$CLIENTBIN -c 'data load -f traces/lf_IDTECK_4944544BAC40E069.pm3; lf search -1'" "Idteck ID found"; then break; fi
       if ! CheckExecute "lf INDALA test"             "$CLIENTBIN -c 'data load -f traces/lf_Indala-504278295.pm3;lf search -1'" "Indala ID found"; then break; fi
       if ! CheckExecute "lf KERI test"               "$CLIENTBIN -c 'data load -f traces/lf_Keri.pm3;lf search -1'" "Pyramid ID found"; then break; fi
@@ -631,6 +644,17 @@ while true; do
 
       echo -e "\n${C_BLUE}Testing HF:${C_NC}"
       if ! CheckExecute "hf mf offline text"               "$CLIENTBIN -c 'hf mf'" "content from tag dump file"; then break; fi
+      if ! CheckExecute "hf mf sim: rdbl test"             "$CLIENTBIN -p sim: -c 'hf mf rdbl --blk 0 -k FFFFFFFFFFFF'" "E6 84 87 F3"; then break; fi
+      if ! CheckExecute "hf mf sim: fchk test"             "$CLIENTBIN -p sim: -c 'hf mf fchk --1k'" "015 \| 063 \| FFFFFFFFFFFF \| 1"; then break; fi
+      if ! CheckExecute "hf mf sim: nested test"           "$CLIENTBIN -p sim: -c 'hf mf esetblk --blk 7 -d A0A1A2A3A4A5FF078069B0B1B2B3B4B5; hf mf nested --blk 0 -a -k FFFFFFFFFFFF --tblk 4 --tb'" \
+                                                                "found valid key \[ B0B1B2B3B4B5 \]"; then break; fi
+      if ! CheckExecute "hf mf sim: dump test"             "$CLIENTBIN -p sim: -c 'hf mf esetblk --blk 4 -d 11223344556677889900AABBCCDDEEFF; hf mf esetblk --blk 7 -d FFFFFFFFFFFFCD24B369FFFFFFFFFFFF; hf mf dump --ns -k traces/mifare/s50-empty-key.bin'" \
+                                                                "4 \| 11 22 33 44 55 66 77 88 99 00 AA BB CC DD EE FF"; then break; fi
+      if ! CheckExecute "hf 15 sim: dump test"             "$CLIENTBIN -p sim: -c 'hf 15 dump --ns'" "79 \| 3C 3D 3E 3F"; then break; fi
+      if ! CheckExecute "hf mfdes sim: dump test"          "$CLIENTBIN -p sim: -c 'hf mfdes dump --aid 123456 --no-auth'" "192/0xC0 \| C0 C1 C2 C3 C4 C5 C6 C7"; then break; fi
+      if ! CheckExecute "hf felica sim: discnodes test"    "$CLIENTBIN -p sim: --incognito -c 'hf felica discnodes'" "Discovered 7 node\\(s\\): 2 area"; then break; fi
+      if ! CheckExecute "hf felica sim: node cache test"   "$CLIENTBIN -p sim: --incognito -c 'hf felica discnodes; hf felica discnodes'" "cached layout verified"; then break; fi
+      if ! CheckExecute "hw sim: bench test"               "$CLIENTBIN -p sim: -c 'hw bench -n 5'" "Download.... [0-9]+ bytes/s"; then break; fi
       if ! CheckExecute slow retry ignore "hf mf hardnested long test"  "$CLIENTBIN -c 'hf mf hardnested -t --tk 000000000000'" "found:"; then break; fi
       if ! CheckExecute slow "hf iclass loclass long test" "$CLIENTBIN -c 'hf iclass loclass --long'" "verified \( ok \)"; then break; fi
       if ! CheckExecute slow "emv long test"               "$CLIENTBIN -c 'emv test -l'" "Tests \( ok"; then break; fi
@@ -638,7 +662,10 @@ while true; do
                                                                 "valid key AEA684A6DAB23278"; then break; fi
       if ! CheckExecute "hf iclass loclass test"         "$CLIENTBIN -c 'hf iclass loclass --test'" "Key diversification \( ok \)"; then break; fi
       if ! CheckExecute "emv test"                       "$CLIENTBIN -c 'emv test'" "Tests \( ok"; then break; fi
+      if ! CheckExecute "emv verify test"                "$CLIENTBIN -c 'emv verify -v -f traces/EMV/emv_scan_sda.json'" "A000000003 01 \|   ok   \|   ok   \|   ok"; then break; fi
       if ! CheckExecute "hf cipurse test"                "$CLIENTBIN -c 'hf cipurse test'" "Tests \( ok"; then break; fi
+      if ! CheckExecute "hf cryptorf recover test"       "$CLIENTBIN -c 'hf cryptorf recover --ci ffffffffffffffff --q 1234567812345678 --ch 88c9d4466a501a87 --ci1 dec2ee1b1c9276e9'" \
+                                                                "Valid key found \[ 4F794A463FF81D81 \]"; then break; fi
       if ! CheckExecute "hf mfdes test"                  "$CLIENTBIN -c 'hf mfdes test'"   "Tests \( ok"; then break; fi
       if ! CheckExecute "hf gst test"                    "$CLIENTBIN -c 'hf gst test'"     "Tests \( ok"; then break; fi
       if ! CheckExecute "hf saflok test"                 "$CLIENTBIN -c 'hf saflok test'"  "Tests \( ok"; then break; fi